@@ -0,0 +1,82 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "CMakeFiles/3.25.1/CMakeCXXCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "/root/repo/test/CMakeLists.txt"
+  "/usr/share/cmake-3.25/Modules/CMakeCXXInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCXXSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFileCXX.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckLibraryExists.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageHandleStandardArgs.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageMessage.cmake"
+  "/usr/share/cmake-3.25/Modules/FindThreads.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "CMakeFiles/portable.dir/DependInfo.cmake"
+  "CMakeFiles/spsc_ring_test.dir/DependInfo.cmake"
+  "CMakeFiles/spsc_ring_bench.dir/DependInfo.cmake"
+  "CMakeFiles/sample_convert_test.dir/DependInfo.cmake"
+  "CMakeFiles/sample_convert_bench.dir/DependInfo.cmake"
+  "CMakeFiles/resampler_test.dir/DependInfo.cmake"
+  "CMakeFiles/resampler_bench.dir/DependInfo.cmake"
+  "CMakeFiles/delay_line_test.dir/DependInfo.cmake"
+  "CMakeFiles/delay_line_bench.dir/DependInfo.cmake"
+  "CMakeFiles/channel_matrix_test.dir/DependInfo.cmake"
+  "CMakeFiles/channel_matrix_bench.dir/DependInfo.cmake"
+  "CMakeFiles/continuity_guard_test.dir/DependInfo.cmake"
+  "CMakeFiles/shared_buffer_pool_test.dir/DependInfo.cmake"
+  "CMakeFiles/rect_set_test.dir/DependInfo.cmake"
+  "CMakeFiles/rect_set_bench.dir/DependInfo.cmake"
+  "CMakeFiles/triple_buffer_test.dir/DependInfo.cmake"
+  "CMakeFiles/triple_buffer_bench.dir/DependInfo.cmake"
+  "CMakeFiles/timed_frame_queue_test.dir/DependInfo.cmake"
+  "CMakeFiles/tile_hash_test.dir/DependInfo.cmake"
+  "CMakeFiles/tile_hash_bench.dir/DependInfo.cmake"
+  "CMakeFiles/color_convert_test.dir/DependInfo.cmake"
+  "CMakeFiles/color_convert_bench.dir/DependInfo.cmake"
+  "CMakeFiles/scaler_test.dir/DependInfo.cmake"
+  "CMakeFiles/scaler_bench.dir/DependInfo.cmake"
+  "CMakeFiles/frame_latency_test.dir/DependInfo.cmake"
+  "CMakeFiles/audio_history_test.dir/DependInfo.cmake"
+  "CMakeFiles/capture_file_test.dir/DependInfo.cmake"
+  "CMakeFiles/capture_replay_test.dir/DependInfo.cmake"
+  "CMakeFiles/capture_replay_bench.dir/DependInfo.cmake"
+  "CMakeFiles/synthetic_backend_test.dir/DependInfo.cmake"
+  "CMakeFiles/level_meter_test.dir/DependInfo.cmake"
+  "CMakeFiles/silence_gate_test.dir/DependInfo.cmake"
+  "CMakeFiles/histogram_test.dir/DependInfo.cmake"
+  )
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/audio_history_test.dir/audio_history_test.cc.o"
+  "CMakeFiles/audio_history_test.dir/audio_history_test.cc.o.d"
+  "audio_history_test"
+  "audio_history_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/audio_history_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
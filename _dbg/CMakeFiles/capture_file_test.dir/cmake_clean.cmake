@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/capture_file_test.dir/capture_file_test.cc.o"
+  "CMakeFiles/capture_file_test.dir/capture_file_test.cc.o.d"
+  "capture_file_test"
+  "capture_file_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/capture_file_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
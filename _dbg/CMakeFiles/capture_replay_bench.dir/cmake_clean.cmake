@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/capture_replay_bench.dir/capture_replay_bench.cc.o"
+  "CMakeFiles/capture_replay_bench.dir/capture_replay_bench.cc.o.d"
+  "capture_replay_bench"
+  "capture_replay_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/capture_replay_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
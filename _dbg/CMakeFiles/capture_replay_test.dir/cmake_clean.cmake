@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/capture_replay_test.dir/capture_replay_test.cc.o"
+  "CMakeFiles/capture_replay_test.dir/capture_replay_test.cc.o.d"
+  "capture_replay_test"
+  "capture_replay_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/capture_replay_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/channel_matrix_bench.dir/channel_matrix_bench.cc.o"
+  "CMakeFiles/channel_matrix_bench.dir/channel_matrix_bench.cc.o.d"
+  "channel_matrix_bench"
+  "channel_matrix_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/channel_matrix_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/channel_matrix_test.dir/channel_matrix_test.cc.o"
+  "CMakeFiles/channel_matrix_test.dir/channel_matrix_test.cc.o.d"
+  "channel_matrix_test"
+  "channel_matrix_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/channel_matrix_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/color_convert_bench.dir/color_convert_bench.cc.o"
+  "CMakeFiles/color_convert_bench.dir/color_convert_bench.cc.o.d"
+  "color_convert_bench"
+  "color_convert_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/color_convert_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/color_convert_test.dir/color_convert_test.cc.o"
+  "CMakeFiles/color_convert_test.dir/color_convert_test.cc.o.d"
+  "color_convert_test"
+  "color_convert_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/color_convert_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
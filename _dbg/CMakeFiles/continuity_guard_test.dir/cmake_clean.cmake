@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/continuity_guard_test.dir/continuity_guard_test.cc.o"
+  "CMakeFiles/continuity_guard_test.dir/continuity_guard_test.cc.o.d"
+  "continuity_guard_test"
+  "continuity_guard_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/continuity_guard_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/delay_line_bench.dir/delay_line_bench.cc.o"
+  "CMakeFiles/delay_line_bench.dir/delay_line_bench.cc.o.d"
+  "delay_line_bench"
+  "delay_line_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/delay_line_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/delay_line_test.dir/delay_line_test.cc.o"
+  "CMakeFiles/delay_line_test.dir/delay_line_test.cc.o.d"
+  "delay_line_test"
+  "delay_line_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/delay_line_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
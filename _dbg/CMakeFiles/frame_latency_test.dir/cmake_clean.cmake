@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/frame_latency_test.dir/frame_latency_test.cc.o"
+  "CMakeFiles/frame_latency_test.dir/frame_latency_test.cc.o.d"
+  "frame_latency_test"
+  "frame_latency_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/frame_latency_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/histogram_test.dir/histogram_test.cc.o"
+  "CMakeFiles/histogram_test.dir/histogram_test.cc.o.d"
+  "histogram_test"
+  "histogram_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/histogram_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/level_meter_test.dir/level_meter_test.cc.o"
+  "CMakeFiles/level_meter_test.dir/level_meter_test.cc.o.d"
+  "level_meter_test"
+  "level_meter_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/level_meter_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,40 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/audio_history.cc" "CMakeFiles/portable.dir/root/repo/src/audio_history.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/audio_history.cc.o.d"
+  "/root/repo/src/capture_backend.cc" "CMakeFiles/portable.dir/root/repo/src/capture_backend.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/capture_backend.cc.o.d"
+  "/root/repo/src/capture_file.cc" "CMakeFiles/portable.dir/root/repo/src/capture_file.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/capture_file.cc.o.d"
+  "/root/repo/src/capture_pipeline.cc" "CMakeFiles/portable.dir/root/repo/src/capture_pipeline.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/capture_pipeline.cc.o.d"
+  "/root/repo/src/capture_replay.cc" "CMakeFiles/portable.dir/root/repo/src/capture_replay.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/capture_replay.cc.o.d"
+  "/root/repo/src/channel_matrix.cc" "CMakeFiles/portable.dir/root/repo/src/channel_matrix.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/channel_matrix.cc.o.d"
+  "/root/repo/src/color_convert.cc" "CMakeFiles/portable.dir/root/repo/src/color_convert.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/color_convert.cc.o.d"
+  "/root/repo/src/continuity_guard.cc" "CMakeFiles/portable.dir/root/repo/src/continuity_guard.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/continuity_guard.cc.o.d"
+  "/root/repo/src/cpu_features.cc" "CMakeFiles/portable.dir/root/repo/src/cpu_features.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/cpu_features.cc.o.d"
+  "/root/repo/src/delay_line.cc" "CMakeFiles/portable.dir/root/repo/src/delay_line.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/delay_line.cc.o.d"
+  "/root/repo/src/frame_latency.cc" "CMakeFiles/portable.dir/root/repo/src/frame_latency.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/frame_latency.cc.o.d"
+  "/root/repo/src/host_time.cc" "CMakeFiles/portable.dir/root/repo/src/host_time.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/host_time.cc.o.d"
+  "/root/repo/src/level_meter.cc" "CMakeFiles/portable.dir/root/repo/src/level_meter.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/level_meter.cc.o.d"
+  "/root/repo/src/rect_set.cc" "CMakeFiles/portable.dir/root/repo/src/rect_set.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/rect_set.cc.o.d"
+  "/root/repo/src/resampler.cc" "CMakeFiles/portable.dir/root/repo/src/resampler.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/resampler.cc.o.d"
+  "/root/repo/src/sample_convert.cc" "CMakeFiles/portable.dir/root/repo/src/sample_convert.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/sample_convert.cc.o.d"
+  "/root/repo/src/scaler.cc" "CMakeFiles/portable.dir/root/repo/src/scaler.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/scaler.cc.o.d"
+  "/root/repo/src/shared_buffer_pool.cc" "CMakeFiles/portable.dir/root/repo/src/shared_buffer_pool.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/shared_buffer_pool.cc.o.d"
+  "/root/repo/src/silence_gate.cc" "CMakeFiles/portable.dir/root/repo/src/silence_gate.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/silence_gate.cc.o.d"
+  "/root/repo/src/synthetic_backend.cc" "CMakeFiles/portable.dir/root/repo/src/synthetic_backend.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/synthetic_backend.cc.o.d"
+  "/root/repo/src/tile_hash.cc" "CMakeFiles/portable.dir/root/repo/src/tile_hash.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/tile_hash.cc.o.d"
+  "/root/repo/src/worker_pool.cc" "CMakeFiles/portable.dir/root/repo/src/worker_pool.cc.o" "gcc" "CMakeFiles/portable.dir/root/repo/src/worker_pool.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,53 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/portable.dir/root/repo/src/audio_history.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/audio_history.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/capture_backend.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/capture_backend.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/capture_file.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/capture_file.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/capture_pipeline.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/capture_pipeline.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/capture_replay.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/capture_replay.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/channel_matrix.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/channel_matrix.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/color_convert.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/color_convert.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/continuity_guard.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/continuity_guard.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/cpu_features.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/cpu_features.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/delay_line.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/delay_line.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/frame_latency.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/frame_latency.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/host_time.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/host_time.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/level_meter.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/level_meter.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/rect_set.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/rect_set.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/resampler.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/resampler.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/sample_convert.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/sample_convert.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/scaler.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/scaler.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/shared_buffer_pool.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/shared_buffer_pool.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/silence_gate.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/silence_gate.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/synthetic_backend.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/synthetic_backend.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/tile_hash.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/tile_hash.cc.o.d"
+  "CMakeFiles/portable.dir/root/repo/src/worker_pool.cc.o"
+  "CMakeFiles/portable.dir/root/repo/src/worker_pool.cc.o.d"
+  "libportable.a"
+  "libportable.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/portable.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/rect_set_bench.dir/rect_set_bench.cc.o"
+  "CMakeFiles/rect_set_bench.dir/rect_set_bench.cc.o.d"
+  "rect_set_bench"
+  "rect_set_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/rect_set_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
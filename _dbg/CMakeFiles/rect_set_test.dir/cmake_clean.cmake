@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/rect_set_test.dir/rect_set_test.cc.o"
+  "CMakeFiles/rect_set_test.dir/rect_set_test.cc.o.d"
+  "rect_set_test"
+  "rect_set_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/rect_set_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/resampler_bench.dir/resampler_bench.cc.o"
+  "CMakeFiles/resampler_bench.dir/resampler_bench.cc.o.d"
+  "resampler_bench"
+  "resampler_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/resampler_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
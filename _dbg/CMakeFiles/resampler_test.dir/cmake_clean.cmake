@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/resampler_test.dir/resampler_test.cc.o"
+  "CMakeFiles/resampler_test.dir/resampler_test.cc.o.d"
+  "resampler_test"
+  "resampler_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/resampler_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sample_convert_bench.dir/sample_convert_bench.cc.o"
+  "CMakeFiles/sample_convert_bench.dir/sample_convert_bench.cc.o.d"
+  "sample_convert_bench"
+  "sample_convert_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sample_convert_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/sample_convert_test.dir/sample_convert_test.cc.o"
+  "CMakeFiles/sample_convert_test.dir/sample_convert_test.cc.o.d"
+  "sample_convert_test"
+  "sample_convert_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/sample_convert_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/scaler_bench.dir/scaler_bench.cc.o"
+  "CMakeFiles/scaler_bench.dir/scaler_bench.cc.o.d"
+  "scaler_bench"
+  "scaler_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/scaler_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
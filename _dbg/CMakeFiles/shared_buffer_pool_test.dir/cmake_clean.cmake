@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/shared_buffer_pool_test.dir/shared_buffer_pool_test.cc.o"
+  "CMakeFiles/shared_buffer_pool_test.dir/shared_buffer_pool_test.cc.o.d"
+  "shared_buffer_pool_test"
+  "shared_buffer_pool_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/shared_buffer_pool_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/silence_gate_test.dir/silence_gate_test.cc.o"
+  "CMakeFiles/silence_gate_test.dir/silence_gate_test.cc.o.d"
+  "silence_gate_test"
+  "silence_gate_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/silence_gate_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/spsc_ring_bench.dir/spsc_ring_bench.cc.o"
+  "CMakeFiles/spsc_ring_bench.dir/spsc_ring_bench.cc.o.d"
+  "spsc_ring_bench"
+  "spsc_ring_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/spsc_ring_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/spsc_ring_test.dir/spsc_ring_test.cc.o"
+  "CMakeFiles/spsc_ring_test.dir/spsc_ring_test.cc.o.d"
+  "spsc_ring_test"
+  "spsc_ring_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/spsc_ring_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
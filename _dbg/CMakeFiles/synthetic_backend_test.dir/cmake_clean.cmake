@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/synthetic_backend_test.dir/synthetic_backend_test.cc.o"
+  "CMakeFiles/synthetic_backend_test.dir/synthetic_backend_test.cc.o.d"
+  "synthetic_backend_test"
+  "synthetic_backend_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/synthetic_backend_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tile_hash_bench.dir/tile_hash_bench.cc.o"
+  "CMakeFiles/tile_hash_bench.dir/tile_hash_bench.cc.o.d"
+  "tile_hash_bench"
+  "tile_hash_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tile_hash_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/tile_hash_test.dir/tile_hash_test.cc.o"
+  "CMakeFiles/tile_hash_test.dir/tile_hash_test.cc.o.d"
+  "tile_hash_test"
+  "tile_hash_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/tile_hash_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
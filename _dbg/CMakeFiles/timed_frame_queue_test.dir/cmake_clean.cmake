@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/timed_frame_queue_test.dir/timed_frame_queue_test.cc.o"
+  "CMakeFiles/timed_frame_queue_test.dir/timed_frame_queue_test.cc.o.d"
+  "timed_frame_queue_test"
+  "timed_frame_queue_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/timed_frame_queue_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/triple_buffer_bench.dir/triple_buffer_bench.cc.o"
+  "CMakeFiles/triple_buffer_bench.dir/triple_buffer_bench.cc.o.d"
+  "triple_buffer_bench"
+  "triple_buffer_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/triple_buffer_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/triple_buffer_test.dir/triple_buffer_test.cc.o"
+  "CMakeFiles/triple_buffer_test.dir/triple_buffer_test.cc.o.d"
+  "triple_buffer_test"
+  "triple_buffer_test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/triple_buffer_test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,48 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo/test
+# Build directory: /root/repo/_dbg
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(spsc_ring "/root/repo/_dbg/spsc_ring_test")
+set_tests_properties(spsc_ring PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;64;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(sample_convert "/root/repo/_dbg/sample_convert_test")
+set_tests_properties(sample_convert PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;67;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(resampler "/root/repo/_dbg/resampler_test")
+set_tests_properties(resampler PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;69;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(delay_line "/root/repo/_dbg/delay_line_test")
+set_tests_properties(delay_line PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;71;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(channel_matrix "/root/repo/_dbg/channel_matrix_test")
+set_tests_properties(channel_matrix PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;73;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(continuity_guard "/root/repo/_dbg/continuity_guard_test")
+set_tests_properties(continuity_guard PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;75;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(shared_buffer_pool "/root/repo/_dbg/shared_buffer_pool_test")
+set_tests_properties(shared_buffer_pool PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;76;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(rect_set "/root/repo/_dbg/rect_set_test")
+set_tests_properties(rect_set PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;77;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(triple_buffer "/root/repo/_dbg/triple_buffer_test")
+set_tests_properties(triple_buffer PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;79;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(timed_frame_queue "/root/repo/_dbg/timed_frame_queue_test")
+set_tests_properties(timed_frame_queue PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;81;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(tile_hash "/root/repo/_dbg/tile_hash_test")
+set_tests_properties(tile_hash PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;82;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(color_convert "/root/repo/_dbg/color_convert_test")
+set_tests_properties(color_convert PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;84;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(scaler "/root/repo/_dbg/scaler_test")
+set_tests_properties(scaler PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;86;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(frame_latency "/root/repo/_dbg/frame_latency_test")
+set_tests_properties(frame_latency PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;88;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(audio_history "/root/repo/_dbg/audio_history_test")
+set_tests_properties(audio_history PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;89;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(capture_file "/root/repo/_dbg/capture_file_test")
+set_tests_properties(capture_file PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;90;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(capture_replay "/root/repo/_dbg/capture_replay_test")
+set_tests_properties(capture_replay PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;91;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(synthetic_backend "/root/repo/_dbg/synthetic_backend_test")
+set_tests_properties(synthetic_backend PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;93;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(level_meter "/root/repo/_dbg/level_meter_test")
+set_tests_properties(level_meter PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;94;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(silence_gate "/root/repo/_dbg/silence_gate_test")
+set_tests_properties(silence_gate PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;95;p1_test;/root/repo/test/CMakeLists.txt;0;")
+add_test(histogram "/root/repo/_dbg/histogram_test")
+set_tests_properties(histogram PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/test/CMakeLists.txt;56;add_test;/root/repo/test/CMakeLists.txt;96;p1_test;/root/repo/test/CMakeLists.txt;0;")
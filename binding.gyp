@@ -11,8 +11,36 @@
             'sources': [
                 'src/display_link.cc',
                 'src/display_stream.cc',
+                'src/display_session.cc',
+                'src/display_region.cc',
+                'src/rect_set.cc',
+                'src/tile_hash.cc',
+                'src/scaler.cc',
+                'src/worker_pool.cc',
                 'src/detect_displays.cc',
                 'src/audio_queue.cc',
+                'src/audio_session.cc',
+                'src/audio_queue_backend.cc',
+                'src/hal_backend.cc',
+                'src/synthetic_backend.cc',
+                'src/capture_backend.cc',
+                'src/core_audio_device.cc',
+                'src/audio_replay.cc',
+                'src/audio_history.cc',
+                'src/capture_pipeline.cc',
+                'src/capture_file.cc',
+                'src/capture_replay.cc',
+                'src/continuity_guard.cc',
+                'src/shared_buffer_pool.cc',
+                'src/channel_matrix.cc',
+                'src/delay_line.cc',
+                'src/sample_convert.cc',
+                'src/resampler.cc',
+                'src/level_meter.cc',
+                'src/silence_gate.cc',
+                'src/cpu_features.cc',
+                'src/host_time.cc',
+                'src/frame_latency.cc',
                 'src/detect_audio_inputs.cc',
                 'src/syphon_client.mm',
                 'src/syphon_directory.mm',
@@ -27,6 +55,7 @@
             'link_settings': {
                 'libraries': [
                     '$(SDKROOT)/System/Library/Frameworks/CoreGraphics.framework',
+                    '$(SDKROOT)/System/Library/Frameworks/ImageIO.framework',
                     '$(SDKROOT)/System/Library/Frameworks/OpenCL.framework'
                 ]
             }
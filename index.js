@@ -11,7 +11,9 @@ module.exports = function(app) {
         _.defaults(settings, {
             type: 'root:p1-mac-plugins',
             audioQueueIds: [],
-            displayStreamIds: []
+            displayStreamIds: [],
+            thumbnailWidth: 320,
+            thumbnailFps: 1
         });
     });
 
@@ -21,7 +23,10 @@ module.exports = function(app) {
         obj.resolveAll('displayStreams');
 
         // Set detected displays on the root.
+        var thumbnailListeners = [];
         obj._detectDisplays = new native.DetectDisplays({
+            thumbnailWidth: obj.cfg.thumbnailWidth,
+            thumbnailFps: obj.cfg.thumbnailFps,
             onEvent: function(id, arg) {
                 switch (id) {
                     case native.EV_DISPLAYS_CHANGED:
@@ -31,6 +36,14 @@ module.exports = function(app) {
                         obj._log.info("Updated displays, %d active", arg.length);
                         break;
 
+                    case native.EV_DISPLAY_THUMBNAIL:
+                        if (arg) {
+                            thumbnailListeners.forEach(function(fn) {
+                                fn(arg);
+                            });
+                        }
+                        break;
+
                     default:
                         obj.handleNativeEvent(obj, id, arg);
                         break;
@@ -38,6 +51,29 @@ module.exports = function(app) {
             }
         });
 
+        // Receive `{ displayId, width, height, data }` thumbnails of all
+        // displays, where data is a JPEG image. Displays are only captured
+        // while there are listeners. Returns a function that removes the
+        // listener.
+        obj.addThumbnailListener = function(fn) {
+            thumbnailListeners.push(fn);
+            if (thumbnailListeners.length === 1) {
+                obj._detectDisplays.subscribeThumbnails();
+            }
+
+            return function() {
+                var idx = thumbnailListeners.indexOf(fn);
+                if (idx === -1) {
+                    return;
+                }
+
+                thumbnailListeners.splice(idx, 1);
+                if (thumbnailListeners.length === 0) {
+                    obj._detectDisplays.unsubscribeThumbnails();
+                }
+            };
+        };
+
         // Set detected audio inputs on the root.
         obj._detectAudioInputs = new native.DetectAudioInputs({
             onEvent: function(id, arg) {
@@ -114,6 +150,19 @@ module.exports = function(app) {
 
     // Implement audio queue source type.
     app.store.onCreate('source:audio:p1-mac-plugins:audio-queue', function(obj) {
+        // Adjust the A/V sync offset without restarting capture.
+        obj.setDelay = function(delayMs) {
+            obj.cfg.delayMs = delayMs;
+            if (obj._instance) {
+                obj._instance.setDelay(delayMs);
+            }
+        };
+
+        // Copy out instant replay history, see `historySeconds`.
+        obj.snapshot = function(options) {
+            return obj._instance ? obj._instance.snapshot(options) : null;
+        };
+
         obj.activation('native audio queue', {
             cond: function() {
                 // In addition to the default condition, ensure the input is
@@ -129,6 +178,25 @@ module.exports = function(app) {
                 try {
                     inst = new native.AudioQueue({
                         deviceId: obj.cfg.deviceId,
+                        format: obj.cfg.format,
+                        interleaved: obj.cfg.interleaved,
+                        driftCompensation: obj.cfg.driftCompensation,
+                        concealment: obj.cfg.concealment,
+                        latencyMs: obj.cfg.latencyMs,
+                        bufferCount: obj.cfg.bufferCount,
+                        adaptive: obj.cfg.adaptive,
+                        meterIntervalMs: obj.cfg.meterIntervalMs,
+                        recordPath: obj.cfg.recordPath,
+                        channelMap: obj.cfg.channelMap,
+                        channelMatrix: obj.cfg.channelMatrix,
+                        delayMs: obj.cfg.delayMs,
+                        historySeconds: obj.cfg.historySeconds,
+                        historyFormat: obj.cfg.historyFormat,
+                        gateThresholdDb: obj.cfg.gateThresholdDb,
+                        gateHoldMs: obj.cfg.gateHoldMs,
+                        gateSkip: obj.cfg.gateSkip,
+                        backend: obj.cfg.backend,
+                        syntheticPath: obj.cfg.syntheticPath,
                         onEvent: onEvent
                     });
                 }
@@ -157,6 +225,16 @@ module.exports = function(app) {
                                 inst.destroy();
                             }
                             break;
+                        case native.EV_AQ_LEVELS:
+                            // Packed peak/RMS pairs per channel, see
+                            // `audio_queue.h`. Polled, so don't mark.
+                            obj.levels = arg;
+                            break;
+                        case native.EV_AQ_GATE:
+                            obj._log.info(arg ? 'Input active' : 'Input silent');
+                            obj.gateOpen = !!arg;
+                            app.mark();
+                            break;
                         default:
                             obj.handleNativeEvent(obj, id, arg);
                             break;
@@ -173,8 +251,51 @@ module.exports = function(app) {
         });
     });
 
+    // Implement audio replay source type, playing back a recording made with
+    // the `recordPath` option of an audio queue source.
+    app.store.onCreate('source:audio:p1-mac-plugins:audio-replay', function(obj) {
+        obj.activation('native audio replay', {
+            start: function() {
+                try {
+                    obj._instance = new native.AudioReplay({
+                        path: obj.cfg.path,
+                        realtime: obj.cfg.realtime,
+                        loop: obj.cfg.loop,
+                        driftCompensation: obj.cfg.driftCompensation,
+                        onEvent: function(id, arg) {
+                            switch (id) {
+                                case native.EV_REPLAY_ENDED:
+                                    obj._log.info('Replay ended');
+                                    break;
+                                default:
+                                    obj.handleNativeEvent(obj, id, arg);
+                                    break;
+                            }
+                        }
+                    });
+                }
+                catch (err) {
+                    return obj.fatal(err, "Failed to instantiate AudioReplay");
+                }
+                app.mark();
+            },
+            stop: function() {
+                if (obj._instance) {
+                    obj._instance.destroy();
+                    obj._instance = null;
+                }
+                app.mark();
+            }
+        });
+    });
+
     // Implement display stream source type.
     app.store.onCreate('source:video:p1-mac-plugins:display-stream', function(obj) {
+        // Capture status counts, and latency from display to render.
+        obj.getStats = function() {
+            return obj._instance ? obj._instance.getStats() : null;
+        };
+
         obj.activation('native display stream', {
             cond: function() {
                 // In addition to the default condition, ensure the display is
@@ -188,6 +309,15 @@ module.exports = function(app) {
                 try {
                     obj._instance = new native.DisplayStream({
                         displayId: obj.cfg.displayId,
+                        sourceRect: obj.cfg.sourceRect,
+                        width: obj.cfg.width,
+                        height: obj.cfg.height,
+                        pixelFormat: obj.cfg.pixelFormat,
+                        maxFps: obj.cfg.maxFps,
+                        queueDepth: obj.cfg.queueDepth,
+                        frameQueue: obj.cfg.frameQueue,
+                        latencyOffsetMs: obj.cfg.latencyOffsetMs,
+                        tileHash: obj.cfg.tileHash,
                         onEvent: function(id, arg) {
                             obj.handleNativeEvent(obj, id, arg);
                         }
@@ -208,6 +338,44 @@ module.exports = function(app) {
         });
     });
 
+    // Implement display region source type, an area of a display stream
+    // source's frames sharing its capture. The stream must use BGRA.
+    app.store.onCreate('source:video:p1-mac-plugins:display-region', function(obj) {
+        obj.activation('native display region', {
+            cond: function() {
+                // In addition to the default condition, wait for the stream,
+                // and restart when it does.
+                var stream = app.o(obj.cfg.streamId);
+                return obj.defaultCond() && stream && stream._instance &&
+                    (!obj._instance || obj._stream === stream._instance);
+            },
+            start: function() {
+                obj._stream = app.o(obj.cfg.streamId)._instance;
+                try {
+                    obj._instance = new native.DisplayRegion({
+                        stream: obj._stream,
+                        sourceRect: obj.cfg.sourceRect,
+                        onEvent: function(id, arg) {
+                            obj.handleNativeEvent(obj, id, arg);
+                        }
+                    });
+                }
+                catch (err) {
+                    return obj.fatal(err, "Failed to instantiate DisplayRegion");
+                }
+                app.mark();
+            },
+            stop: function() {
+                if (obj._instance) {
+                    obj._instance.destroy();
+                    obj._instance = null;
+                }
+                obj._stream = null;
+                app.mark();
+            }
+        });
+    });
+
     // Implement display clock type.
     app.store.onCreate('clock:p1-mac-plugins:display-link', function(obj) {
         obj.activation('native display link', {
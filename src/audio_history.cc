@@ -0,0 +1,172 @@
+#include "audio_history.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace p1_mac_plugins {
+
+
+static void float_to_int16(const float *in, int16_t *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        float v = in[i] * 32768.0f;
+        v = std::max(-32768.0f, std::min(32767.0f, v));
+        out[i] = (int16_t) v;
+    }
+}
+
+
+const size_t audio_history::block_frames;
+
+audio_history::audio_history() :
+    num_channels(0), sample_rate(0), fmt(sample_format_float32), frame_size(0),
+    cap(0), num_blocks(0), begin(0), committed(0)
+{
+}
+
+void audio_history::configure(uint32_t channels_, double rate_, double seconds,
+    sample_format fmt_)
+{
+    num_channels = channels_;
+    sample_rate = rate_;
+    fmt = fmt_;
+    frame_size = num_channels * sample_format_size(fmt);
+
+    num_blocks = std::max((size_t) 2,
+        (size_t) (seconds * sample_rate + block_frames - 1) / block_frames);
+    cap = num_blocks * block_frames;
+
+    // Touch everything now, so the writer never faults in pages.
+    slab.reset(new char[cap * frame_size]);
+    memset(slab.get(), 0, cap * frame_size);
+    block_times.reset(new std::atomic<uint64_t>[num_blocks]);
+    for (size_t i = 0; i < num_blocks; i++)
+        block_times[i].store(0, std::memory_order_relaxed);
+
+    begin.store(0);
+    committed.store(0);
+}
+
+size_t audio_history::memory_size() const
+{
+    return cap * frame_size + num_blocks * sizeof(uint64_t);
+}
+
+void audio_history::write(uint64_t time_ns, const float *in, size_t frames)
+{
+    if (frames > cap) {
+        in += (frames - cap) * num_channels;
+        time_ns += (uint64_t) ((frames - cap) * 1e9 / sample_rate);
+        frames = cap;
+    }
+
+    auto pos = committed.load(std::memory_order_relaxed);
+    begin.store(pos + frames, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t done = 0;
+    while (done < frames) {
+        auto frame = pos + done;
+        auto offset = (size_t) (frame % cap);
+        auto in_block = (size_t) (frame % block_frames);
+        auto count = std::min(frames - done, block_frames - in_block);
+
+        if (in_block == 0) {
+            auto t = time_ns + (uint64_t) (done * 1e9 / sample_rate);
+            block_times[offset / block_frames].store(t, std::memory_order_relaxed);
+        }
+
+        auto *src = in + done * num_channels;
+        auto *dst = slab.get() + offset * frame_size;
+        if (fmt == sample_format_int16)
+            float_to_int16(src, (int16_t *) dst, count * num_channels);
+        else
+            memcpy(dst, src, count * frame_size);
+
+        done += count;
+    }
+
+    committed.store(pos + frames, std::memory_order_release);
+}
+
+uint64_t audio_history::time_at(uint64_t frame) const
+{
+    auto block = frame / block_frames;
+    auto t = block_times[block % num_blocks].load(std::memory_order_relaxed);
+    return t + (uint64_t) ((frame - block * block_frames) * 1e9 / sample_rate);
+}
+
+// Find the frame at a host time, by block, within whole blocks from `first`
+// up to frame `last`.
+uint64_t audio_history::frame_at(uint64_t time_ns, uint64_t first, uint64_t last) const
+{
+    auto lo = first / block_frames;
+    auto hi = (last + block_frames - 1) / block_frames;
+    if (time_ns <= time_at(lo * block_frames))
+        return first;
+
+    // Last block starting at or before the time.
+    while (hi - lo > 1) {
+        auto mid = lo + (hi - lo) / 2;
+        if (time_at(mid * block_frames) <= time_ns)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    auto block_start = lo * block_frames;
+    auto offset = (uint64_t) ((time_ns - time_at(block_start)) * sample_rate / 1e9);
+    return std::min(std::max(block_start + offset, first), last);
+}
+
+bool audio_history::snapshot(uint64_t start_ns, uint64_t end_ns,
+    history_snapshot &out) const
+{
+    if (cap == 0)
+        return false;
+
+    // Skip the oldest block. It is partly overwritten, and the writer may be
+    // about to take the next one.
+    auto last = committed.load(std::memory_order_acquire);
+    auto oldest = last > cap ? last - cap : 0;
+    auto first = (oldest + block_frames - 1) / block_frames * block_frames;
+    if (oldest != 0)
+        first += block_frames;
+    if (first >= last)
+        return false;
+
+    auto a = start_ns != 0 ? frame_at(start_ns, first, last) : first;
+    auto b = end_ns != 0 ? frame_at(end_ns, first, last) : last;
+    if (a >= b)
+        return false;
+    auto time_ns = time_at(a);
+
+    out.data.resize((size_t) (b - a) * frame_size);
+    for (auto frame = a; frame < b; ) {
+        auto offset = (size_t) (frame % cap);
+        auto count = (size_t) std::min(b - frame, (uint64_t) (cap - offset));
+        memcpy(&out.data[(size_t) (frame - a) * frame_size],
+            slab.get() + offset * frame_size, count * frame_size);
+        frame += count;
+    }
+
+    // Drop frames the writer started overwriting while we copied.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto written = begin.load(std::memory_order_relaxed);
+    auto valid = written > cap ? written - cap : 0;
+    if (valid > a) {
+        if (valid >= b)
+            return false;
+        auto drop = (size_t) (valid - a);
+        out.data.erase(out.data.begin(), out.data.begin() + drop * frame_size);
+        time_ns += (uint64_t) (drop * 1e9 / sample_rate);
+        a = valid;
+    }
+
+    out.time_ns = time_ns;
+    out.frames = (size_t) (b - a);
+    return true;
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,82 @@
+#ifndef p1_mac_plugins_audio_history_h
+#define p1_mac_plugins_audio_history_h
+
+#include "sample_convert.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// A range of history, copied out in the storage format.
+struct history_snapshot {
+    uint64_t time_ns;
+    size_t frames;
+    std::vector<char> data;
+};
+
+// Rolling history of the last seconds of interleaved float audio, for
+// instant replay. Everything is allocated up front, in a slab of
+// channels * rate * seconds samples, stored as float or int16.
+//
+// One realtime thread writes, overwriting the oldest audio. Any thread may
+// take snapshots concurrently, without blocking the writer: the writer
+// announces what it is about to overwrite, and readers drop anything that
+// was overwritten while they copied.
+//
+// The host time of every `block_frames` frames is kept to find ranges.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class audio_history {
+public:
+    static const size_t block_frames = 1024;
+
+    audio_history();
+
+    // Only `sample_format_float32` and `sample_format_int16` are valid.
+    void configure(uint32_t channels_, double rate_, double seconds,
+        sample_format fmt_);
+
+    uint32_t channels() const { return num_channels; }
+    double rate() const { return sample_rate; }
+    sample_format format() const { return fmt; }
+    size_t capacity_frames() const { return cap; }
+    size_t memory_size() const;
+
+    // Producer side. Append frames, the first at host time `time_ns`.
+    void write(uint64_t time_ns, const float *in, size_t frames);
+
+    // Any thread. Copy what's available between `start_ns` and `end_ns`,
+    // where zero means unbounded. Returns false if nothing is available.
+    bool snapshot(uint64_t start_ns, uint64_t end_ns, history_snapshot &out) const;
+
+private:
+    uint32_t num_channels;
+    double sample_rate;
+    sample_format fmt;
+    size_t frame_size;
+
+    // Slab of `cap` frames, a multiple of `block_frames`.
+    std::unique_ptr<char[]> slab;
+    size_t cap;
+
+    // Host time of the first frame of each block.
+    std::unique_ptr<std::atomic<uint64_t>[]> block_times;
+    size_t num_blocks;
+
+    // Frames about to be written, and frames written, since configure.
+    std::atomic<uint64_t> begin;
+    std::atomic<uint64_t> committed;
+
+    uint64_t frame_at(uint64_t time_ns, uint64_t first, uint64_t last) const;
+    uint64_t time_at(uint64_t frame) const;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_audio_history_h
@@ -1,38 +1,38 @@
 #include "audio_queue.h"
+#include "audio_queue_backend.h"
+#include "host_time.h"
+
+#include <algorithm>
+#include <cerrno>
 
 namespace p1_mac_plugins {
 
 
-static const UInt32 num_channels = 2;
-static const UInt32 sample_size = sizeof(float);
-static const UInt32 sample_size_bits = sample_size * 8;
-static const UInt32 sample_rate = 44100;
-
-static void property_callback(
-    void *inUserData,
-    AudioQueueRef inAQ,
-    AudioQueuePropertyID inID);
-static void input_callback(
-    void *inUserData,
-    AudioQueueRef inAQ,
-    AudioQueueBufferRef inBuffer,
-    const AudioTimeStamp *inStartTime,
-    UInt32 inNumberPacketDescriptions,
-    const AudioStreamPacketDescription *inPacketDescs);
+// Silence gate hold time, if not specified.
+static const double default_gate_hold_ms = 500;
+
+// Longest instant replay history.
+static const double max_history_seconds = 600;
+
+// Buffer duration and count, if not specified.
+static const double default_latency_ms = 2560.0 * 1000 / audio_session::sample_rate;
+static const UInt32 default_buffer_count = 3;
+
+static bool parse_sample_format(const char *str, sample_format &fmt);
+static bool is_valid_delay(double delay_ms);
 static Local<Value> events_transform(
     Isolate *isolate, event &ev, buffer_slicer &slicer);
-
+static Local<Value> levels_to_js(
+    Isolate *isolate, const char *data, size_t count);
 
 
 audio_queue::audio_queue() :
-    buffer(this, events_transform)
+    buffer(this, events_transform), session(nullptr), gain_columns(0)
 {
 }
 
 void audio_queue::init(const FunctionCallbackInfo<Value>& args)
 {
-    bool ok = true;
-    OSStatus os_ret;
     auto *isolate = args.GetIsolate();
     Handle<Value> val;
 
@@ -43,6 +43,297 @@ void audio_queue::init(const FunctionCallbackInfo<Value>& args)
     }
     auto params = args[0].As<Object>();
 
+    audio_session_config config;
+    config.kind = capture_backend_audio_queue;
+    val = params->Get(backend_sym.Get(isolate));
+    if (!val->IsUndefined()) {
+        String::Utf8Value str(val);
+        if (*str == NULL || !parse_capture_backend(*str, config.kind)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid backend value")));
+            return;
+        }
+    }
+
+    config.format = sample_format_float32;
+    config.use_native_format = true;
+    val = params->Get(format_sym.Get(isolate));
+    if (!val->IsUndefined()) {
+        String::Utf8Value str(val);
+        if (*str != NULL && strcmp(*str, "native") == 0)
+            config.use_native_format = true;
+        else if (*str != NULL && parse_sample_format(*str, config.format))
+            config.use_native_format = false;
+        else {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid format value")));
+            return;
+        }
+    }
+
+    config.interleaved = true;
+    config.use_native_interleaving = true;
+    val = params->Get(interleaved_sym.Get(isolate));
+    if (val->IsBoolean()) {
+        config.interleaved = val->BooleanValue();
+        config.use_native_interleaving = false;
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid interleaved value")));
+        return;
+    }
+
+    config.latency_ms = default_latency_ms;
+    val = params->Get(latency_ms_sym.Get(isolate));
+    if (val->IsNumber()) {
+        config.latency_ms = val->NumberValue();
+        if (!(config.latency_ms >= 1 && config.latency_ms <= 500)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid latencyMs value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid latencyMs value")));
+        return;
+    }
+
+    config.buffer_count = default_buffer_count;
+    val = params->Get(buffer_count_sym.Get(isolate));
+    if (val->IsUint32())
+        config.buffer_count = val->Uint32Value();
+    else if (!val->IsUndefined())
+        config.buffer_count = 0;
+
+    if (config.buffer_count < 2 || config.buffer_count > audio_queue_backend::max_buffers) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid bufferCount value")));
+        return;
+    }
+
+    config.adaptive = false;
+    val = params->Get(adaptive_sym.Get(isolate));
+    if (val->IsBoolean()) {
+        config.adaptive = val->BooleanValue();
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid adaptive value")));
+        return;
+    }
+
+    config.meter_interval_ms = 0;
+    val = params->Get(meter_interval_ms_sym.Get(isolate));
+    if (val->IsNumber()) {
+        config.meter_interval_ms = val->NumberValue();
+        if (!(config.meter_interval_ms > 0)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid meterIntervalMs value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid meterIntervalMs value")));
+        return;
+    }
+
+    val = params->Get(record_path_sym.Get(isolate));
+    if (val->IsString()) {
+        config.record_path = *String::Utf8Value(val);
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid recordPath value")));
+        return;
+    }
+
+    val = params->Get(synthetic_path_sym.Get(isolate));
+    if (val->IsString()) {
+        config.path = *String::Utf8Value(val);
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid syntheticPath value")));
+        return;
+    }
+
+    config.drift_compensation = true;
+    val = params->Get(drift_compensation_sym.Get(isolate));
+    if (val->IsBoolean()) {
+        config.drift_compensation = val->BooleanValue();
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid driftCompensation value")));
+        return;
+    }
+
+    config.conceal = conceal_crossfade;
+    val = params->Get(concealment_sym.Get(isolate));
+    if (!val->IsUndefined()) {
+        String::Utf8Value str(val);
+        if (*str != NULL && strcmp(*str, "crossfade") == 0)
+            config.conceal = conceal_crossfade;
+        else if (*str != NULL && strcmp(*str, "silence") == 0)
+            config.conceal = conceal_silence;
+        else {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid concealment value")));
+            return;
+        }
+    }
+
+    val = params->Get(channel_map_sym.Get(isolate));
+    if (val->IsArray()) {
+        auto arr = val.As<Array>();
+        bool valid = arr->Length() == audio_session::num_channels;
+        for (uint32_t i = 0; valid && i < arr->Length(); i++) {
+            auto el = arr->Get(i);
+            valid = el->IsInt32() && el->Int32Value() >= -1 &&
+                el->Int32Value() < (int32_t) channel_matrix::max_channels;
+            if (valid)
+                channel_map.push_back(el->Int32Value());
+        }
+        if (!valid) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid channelMap value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid channelMap value")));
+        return;
+    }
+
+    // Mutually exclusive with `channelMap`.
+    val = params->Get(channel_matrix_sym.Get(isolate));
+    if (val->IsArray() && channel_map.empty()) {
+        auto arr = val.As<Array>();
+        bool valid = arr->Length() == audio_session::num_channels;
+        for (uint32_t o = 0; valid && o < arr->Length(); o++) {
+            auto row = arr->Get(o);
+            valid = row->IsArray();
+            if (!valid)
+                break;
+
+            auto row_arr = row.As<Array>();
+            if (o == 0)
+                gain_columns = row_arr->Length();
+            valid = row_arr->Length() == gain_columns && gain_columns != 0 &&
+                gain_columns <= channel_matrix::max_channels;
+            for (uint32_t i = 0; valid && i < gain_columns; i++) {
+                auto el = row_arr->Get(i);
+                valid = el->IsNumber();
+                if (valid)
+                    channel_gains.push_back((float) el->NumberValue());
+            }
+        }
+        if (!valid) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid channelMatrix value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid channelMatrix value")));
+        return;
+    }
+
+    double delay_ms = 0;
+    val = params->Get(delay_ms_sym.Get(isolate));
+    if (val->IsNumber()) {
+        delay_ms = val->NumberValue();
+        if (!is_valid_delay(delay_ms)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid delayMs value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid delayMs value")));
+        return;
+    }
+    mix.delay_ms.store(delay_ms);
+
+    double history_seconds = 0;
+    val = params->Get(history_seconds_sym.Get(isolate));
+    if (val->IsNumber()) {
+        history_seconds = val->NumberValue();
+        if (!(history_seconds > 0 && history_seconds <= max_history_seconds)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid historySeconds value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid historySeconds value")));
+        return;
+    }
+
+    sample_format history_format = sample_format_float32;
+    val = params->Get(history_format_sym.Get(isolate));
+    if (!val->IsUndefined()) {
+        String::Utf8Value str(val);
+        if (*str == NULL || !parse_sample_format(*str, history_format) ||
+            (history_format != sample_format_float32 && history_format != sample_format_int16)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid historyFormat value")));
+            return;
+        }
+    }
+
+    val = params->Get(gate_threshold_db_sym.Get(isolate));
+    if (val->IsNumber()) {
+        auto threshold_db = val->NumberValue();
+        if (!(threshold_db >= -120 && threshold_db <= 0)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid gateThresholdDb value")));
+            return;
+        }
+
+        auto hold_ms = default_gate_hold_ms;
+        val = params->Get(gate_hold_ms_sym.Get(isolate));
+        if (val->IsNumber()) {
+            hold_ms = val->NumberValue();
+            if (!(hold_ms >= 0 && hold_ms <= 60000)) {
+                isolate->ThrowException(Exception::TypeError(
+                    String::NewFromUtf8(isolate, "Invalid gateHoldMs value")));
+                return;
+            }
+        }
+        else if (!val->IsUndefined()) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid gateHoldMs value")));
+            return;
+        }
+
+        val = params->Get(gate_skip_sym.Get(isolate));
+        if (val->IsBoolean()) {
+            mix.gate_skip = val->BooleanValue();
+        }
+        else if (!val->IsUndefined()) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid gateSkip value")));
+            return;
+        }
+
+        mix.gating = true;
+        mix.gate.configure(threshold_db, (size_t) (hold_ms * audio_session::sample_rate / 1000),
+            audio_session::num_channels);
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid gateThresholdDb value")));
+        return;
+    }
+
     val = params->Get(on_event_sym.Get(isolate));
     if (!val->IsFunction()) {
         isolate->ThrowException(Exception::TypeError(
@@ -57,92 +348,191 @@ void audio_queue::init(const FunctionCallbackInfo<Value>& args)
 
     buffer.set_callback(isolate->GetCurrentContext(), val.As<Function>());
 
-    AudioStreamBasicDescription fmt;
-    fmt.mFormatID = kAudioFormatLinearPCM;
-    fmt.mFormatFlags = kLinearPCMFormatFlagIsFloat;
-    fmt.mSampleRate = sample_rate;
-    fmt.mBitsPerChannel = sample_size_bits;
-    fmt.mChannelsPerFrame = num_channels;
-    fmt.mBytesPerFrame = num_channels * sample_size;
-    fmt.mFramesPerPacket = 1;
-    fmt.mBytesPerPacket = fmt.mBytesPerFrame;
-    fmt.mReserved = 0;
-    os_ret = AudioQueueNewInput(&fmt, input_callback, this, NULL, kCFRunLoopCommonModes, 0, &queue);
-    if (!(ok = (os_ret == noErr)))
-        buffer.emitf(EV_LOG_ERROR, "AudioQueueNewInput error 0x%x", os_ret);
-
-    os_ret = AudioQueueAddPropertyListener(queue, kAudioQueueProperty_IsRunning, property_callback, this);
-    if (!(ok = (os_ret == noErr)))
-        buffer.emitf(EV_LOG_ERROR, "AudioQueueAddPropertyListener error 0x%x", os_ret);
-
-    if (ok) {
-        val = params->Get(device_id_sym.Get(isolate));
-        if (!val->IsUndefined()) {
-            String::Utf8Value strVal(val);
-            if (!(ok = (*strVal != NULL))) {
-                buffer.emitf(EV_LOG_ERROR, "Invalid device value");
-            }
-            else {
-                CFStringRef str = CFStringCreateWithCStringNoCopy(kCFAllocatorDefault, *strVal, kCFStringEncodingUTF8, kCFAllocatorNull);
-                if (!str)
-                    abort();
-
-                os_ret = AudioQueueSetProperty(queue, kAudioQueueProperty_CurrentDevice, &str, sizeof(str));
-                CFRelease(str);
-                if (!(ok = (os_ret == noErr)))
-                    buffer.emitf(EV_LOG_ERROR, "AudioQueueSetProperty error 0x%x", os_ret);
-            }
-        }
+    val = params->Get(device_id_sym.Get(isolate));
+    if (val->IsString()) {
+        config.device_uid = *String::Utf8Value(val);
+    }
+    else if (!val->IsUndefined()) {
+        buffer.emitf(EV_LOG_ERROR, "Invalid device value");
+        return;
     }
 
-    if (ok) {
-        for (UInt32 i = 0; i < num_buffers; i++) {
-            os_ret = AudioQueueAllocateBuffer(queue, 0x5000, &buffers[i]);
-            if (!(ok = (os_ret == noErr))) {
-                buffer.emitf(EV_LOG_ERROR, "AudioQueueAllocateBuffer error 0x%x", os_ret);
-                break;
-            }
+    // Allocate history before we capture, it's never resized.
+    if (history_seconds != 0) {
+        mix.history.reset(new audio_history());
+        mix.history->configure(audio_session::num_channels, audio_session::sample_rate,
+            history_seconds, history_format);
+    }
 
-            os_ret = AudioQueueEnqueueBuffer(queue, buffers[i], 0, NULL);
-            if (!(ok = (os_ret == noErr))) {
-                buffer.emitf(EV_LOG_ERROR, "AudioQueueEnqueueBuffer error 0x%x", os_ret);
-                AudioQueueFreeBuffer(queue, buffers[i]);
-                break;
-            }
-        }
+    // Join a session capturing from the same device with the same options,
+    // or open a new one.
+    session = audio_session::acquire(config, *this);
+    if (session != nullptr) {
+        configure_matrix(session->capture_channels);
+        mix.configure_delay(session->buffer_frames);
     }
+}
 
-    if (ok) {
-        // Async, waits until running callback.
-        os_ret = AudioQueueStart(queue, NULL);
-        if (!(ok = (os_ret == noErr)))
-            buffer.emitf(EV_LOG_ERROR, "AudioQueueStart error 0x%x", os_ret);
+// Set up our channel matrix, now that we know the device channel count.
+// Called before any sinks are registered, so the callback can't see it.
+void audio_queue::configure_matrix(UInt32 capture_channels)
+{
+    auto out = audio_session::num_channels;
+
+    if (!channel_map.empty()) {
+        for (auto idx : channel_map) {
+            if (idx >= (int32_t) capture_channels)
+                buffer.emitf(EV_LOG_WARN, "channelMap refers to channel %d, device has %u, using silence",
+                    idx, capture_channels);
+        }
+        mix.matrix.configure_map(capture_channels, out, channel_map.data());
+    }
+    else if (!channel_gains.empty()) {
+        if (gain_columns != capture_channels)
+            buffer.emitf(EV_LOG_WARN, "channelMatrix has %u columns, device has %u channels",
+                gain_columns, capture_channels);
+
+        // Drop or zero-fill columns to match the device.
+        std::vector<float> gains(out * capture_channels, 0.0f);
+        for (UInt32 o = 0; o < out; o++) {
+            for (UInt32 i = 0; i < capture_channels && i < gain_columns; i++)
+                gains[o * capture_channels + i] = channel_gains[o * gain_columns + i];
+        }
+        mix.matrix.configure(capture_channels, out, gains.data());
+    }
+    else {
+        mix.matrix.configure_default(capture_channels, out);
     }
 }
 
+// Leave the session. The last instance to leave closes it.
+void audio_queue::detach()
+{
+    if (session != nullptr)
+        audio_session::release(session, *this);
+}
+
 void audio_queue::stop()
 {
-    if (queue != NULL) {
-        auto ret = AudioQueueStop(queue, FALSE);
-        if (ret != noErr)
-            buffer.emitf(EV_LOG_ERROR, "AudioQueueStop error 0x%x\n", ret);
+    bool was_attached = session != nullptr;
+    detach();
+
+    // Other instances may keep capturing, so we don't wait for the queue.
+    if (was_attached) {
+        lock_handle lock(*this);
+        auto *ev = buffer.emit(EV_AQ_IS_RUNNING, sizeof(UInt32));
+        if (ev != nullptr)
+            *(UInt32 *) ev->data = 0;
     }
 }
 
 void audio_queue::destroy()
 {
-    if (queue != NULL) {
-        auto ret = AudioQueueDispose(queue, TRUE);
-        queue = NULL;
-        if (ret != noErr)
-            buffer.emitf(EV_LOG_ERROR, "AudioQueueDispose error 0x%x\n", ret);
-    }
+    detach();
 
     buffer.flush();
 
     Unref();
 }
 
+// Takes effect from the next capture buffer. Changes of a positive delay
+// crossfade over one buffer.
+void audio_queue::set_delay(double delay_ms)
+{
+    mix.delay_ms.store(delay_ms);
+}
+
+// Copy a range of history out, by host time. Returns a Float32Array of
+// interleaved samples, or writes a capture file if a path is given, which
+// can be played back with `AudioReplay`. Doesn't block capture.
+void audio_queue::snapshot(const FunctionCallbackInfo<Value>& args)
+{
+    auto *isolate = args.GetIsolate();
+    Handle<Value> val;
+
+    Local<Object> params;
+    if (args.Length() == 1 && args[0]->IsObject()) {
+        params = args[0].As<Object>();
+    }
+    else if (args.Length() != 0) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Expected an object")));
+        return;
+    }
+
+    // Host times in nanoseconds, or the last number of seconds.
+    uint64_t start_ns = 0, end_ns = 0;
+    std::string path;
+    if (!params.IsEmpty()) {
+        val = params->Get(start_sym.Get(isolate));
+        if (val->IsNumber())
+            start_ns = (uint64_t) std::max(0.0, val->NumberValue());
+        val = params->Get(end_sym.Get(isolate));
+        if (val->IsNumber())
+            end_ns = (uint64_t) std::max(0.0, val->NumberValue());
+        val = params->Get(seconds_sym.Get(isolate));
+        if (val->IsNumber()) {
+            auto now_ns = host_time_to_ns(host_time_now());
+            auto ago_ns = (uint64_t) std::max(0.0, val->NumberValue() * 1e9);
+            start_ns = ago_ns < now_ns ? now_ns - ago_ns : 0;
+        }
+        val = params->Get(path_sym.Get(isolate));
+        if (val->IsString())
+            path = *String::Utf8Value(val);
+    }
+
+    history_snapshot snap;
+    if (!mix.history || !mix.history->snapshot(start_ns, end_ns, snap)) {
+        args.GetReturnValue().Set(Null(isolate));
+        return;
+    }
+
+    auto &history = *mix.history;
+    auto channels = history.channels();
+    auto obj = Object::New(isolate);
+    obj->Set(String::NewFromUtf8(isolate, "time"), Number::New(isolate, (double) snap.time_ns));
+    obj->Set(String::NewFromUtf8(isolate, "frames"), Number::New(isolate, (double) snap.frames));
+    obj->Set(String::NewFromUtf8(isolate, "channels"), Uint32::NewFromUnsigned(isolate, channels));
+    obj->Set(String::NewFromUtf8(isolate, "sampleRate"), Number::New(isolate, history.rate()));
+
+    if (!path.empty()) {
+        capture_file_header hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.format = history.format();
+        hdr.channels = channels;
+        hdr.interleaved = 1;
+        hdr.sample_rate = history.rate();
+
+        // Records of a block each, like capture buffers.
+        capture_file_writer file;
+        bool ok = file.open(path.c_str(), hdr);
+        auto frame_size = snap.data.size() / snap.frames;
+        for (size_t done = 0; ok && done < snap.frames; ) {
+            auto count = std::min(snap.frames - done, audio_history::block_frames);
+            auto time_ns = snap.time_ns + (uint64_t) (done * 1e9 / history.rate());
+            ok = file.append(time_ns, (uint32_t) count,
+                &snap.data[done * frame_size], (uint32_t) (count * frame_size));
+            done += count;
+        }
+        if (!ok) {
+            isolate->ThrowException(Exception::Error(
+                String::NewFromUtf8(isolate, strerror(errno))));
+            return;
+        }
+
+        obj->Set(path_sym.Get(isolate), String::NewFromUtf8(isolate, path.c_str()));
+        args.GetReturnValue().Set(obj);
+        return;
+    }
+
+    auto samples = snap.frames * channels;
+    auto buf = ArrayBuffer::New(isolate, samples * sizeof(float));
+    auto *dst = (float *) buf->GetContents().Data();
+    get_sample_kernels().to_float[history.format()](snap.data.data(), dst, samples);
+    obj->Set(String::NewFromUtf8(isolate, "data"), Float32Array::New(buf, 0, samples));
+    args.GetReturnValue().Set(obj);
+}
+
 lockable *audio_queue::lock()
 {
     return mutex.lock();
@@ -150,61 +540,68 @@ lockable *audio_queue::lock()
 
 void audio_queue::link_audio_source(audio_source_context &ctx)
 {
-    ctxes.push_back(&ctx);
+    auto *sink = new audio_sink(ctx, mix);
+    sinks.push_back(sink);
+    if (session != nullptr)
+        session->add_sink(sink);
 }
 
 void audio_queue::unlink_audio_source(audio_source_context &ctx)
 {
-    ctxes.remove(&ctx);
+    auto it = std::find_if(sinks.begin(), sinks.end(), [&](audio_sink *sink) {
+        return &sink->ctx == &ctx;
+    });
+    if (it == sinks.end())
+        return;
+
+    auto *sink = *it;
+    sinks.erase(it);
+    if (session != nullptr)
+        session->remove_sink(sink);
+    delete sink;
 }
 
-static void property_callback(
-    void *inUserData,
-    AudioQueueRef inAQ,
-    AudioQueuePropertyID inID)
+Local<Value> audio_queue::stats(Isolate *isolate)
 {
-    auto &inst = *(audio_queue *) inUserData;
-
-    lock_handle lock(inst);
-
-    // Sanity check, unlikely false.
-    if (inAQ != inst.queue || inID != kAudioQueueProperty_IsRunning)
-        return;
-
-    UInt32 is_running;
-    UInt32 size = sizeof(is_running);
-    auto ret = AudioQueueGetProperty(inAQ, kAudioQueueProperty_IsRunning, &is_running, &size);
-    if (ret != noErr) {
-        inst.buffer.emitf(EV_LOG_ERROR, "AudioQueueGetProperty error 0x%x\n", ret);
-        return;
+    if (session == nullptr)
+        return Null(isolate);
+
+    auto obj = session->stats(isolate).As<Object>();
+    obj->Set(delay_ms_sym.Get(isolate), Number::New(isolate, mix.delay_ms.load()));
+    if (mix.gating) {
+        obj->Set(String::NewFromUtf8(isolate, "gateOpen"),
+            Boolean::New(isolate, mix.gate_open.load()));
+        obj->Set(String::NewFromUtf8(isolate, "gatedBuffers"),
+            Number::New(isolate, (double) mix.gated_buffers.load()));
     }
-
-    auto *ev = inst.buffer.emit(EV_AQ_IS_RUNNING, sizeof(is_running));
-    if (ev != nullptr)
-        *(UInt32 *) ev->data = is_running;
+    if (mix.history) {
+        obj->Set(history_seconds_sym.Get(isolate),
+            Number::New(isolate, mix.history->capacity_frames() / mix.history->rate()));
+        obj->Set(String::NewFromUtf8(isolate, "historyBytes"),
+            Number::New(isolate, (double) mix.history->memory_size()));
+    }
+    return obj;
 }
 
-static void input_callback(
-    void *inUserData,
-    AudioQueueRef inAQ,
-    AudioQueueBufferRef inBuffer,
-    const AudioTimeStamp *inStartTime,
-    UInt32 inNumberPacketDescriptions,
-    const AudioStreamPacketDescription *inPacketDescs)
+static bool parse_sample_format(const char *str, sample_format &fmt)
 {
-    auto time = inStartTime->mHostTime;
-    auto in = (float *)inBuffer->mAudioData;
-    auto samples = inBuffer->mAudioDataByteSize / sample_size;
-    auto &inst = *(audio_queue *) inUserData;
-
-    lock_handle lock(inst);
-
-    for (auto ctx : inst.ctxes)
-        ctx->render_buffer(time, in, samples);
+    if (strcmp(str, "int16") == 0)
+        fmt = sample_format_int16;
+    else if (strcmp(str, "int24") == 0)
+        fmt = sample_format_int24;
+    else if (strcmp(str, "int32") == 0)
+        fmt = sample_format_int32;
+    else if (strcmp(str, "float32") == 0)
+        fmt = sample_format_float32;
+    else
+        return false;
+    return true;
+}
 
-    OSStatus ret = AudioQueueEnqueueBuffer(inAQ, inBuffer, 0, NULL);
-    if (ret != noErr && ret != kAudioQueueErr_EnqueueDuringReset)
-        inst.buffer.emitf(EV_LOG_ERROR, "AudioQueueEnqueueBuffer error 0x%x\n", ret);
+static bool is_valid_delay(double delay_ms)
+{
+    return delay_ms >= -(double) audio_mix::max_delay_ms &&
+        delay_ms <= (double) audio_mix::max_delay_ms;
 }
 
 static Local<Value> events_transform(
@@ -213,11 +610,38 @@ static Local<Value> events_transform(
     switch (ev.id) {
         case EV_AQ_IS_RUNNING:
             return Uint32::NewFromUnsigned(isolate, *(UInt32 *) ev.data);
+        case EV_AQ_LEVELS:
+            return levels_to_js(isolate, ev.data, ev.size / sizeof(level_snapshot));
+        case EV_AQ_GATE:
+            return Uint32::NewFromUnsigned(isolate, *(UInt32 *) ev.data);
         default:
             return Undefined(isolate);
     }
 }
 
+static Local<Value> levels_to_js(
+    Isolate *isolate, const char *data, size_t count)
+{
+    level_snapshot snapshot;
+
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(&snapshot, data + i * sizeof(snapshot), sizeof(snapshot));
+        len += snapshot.channels * 2;
+    }
+
+    auto arr = Float32Array::New(ArrayBuffer::New(isolate, len * sizeof(float)), 0, len);
+    uint32_t idx = 0;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(&snapshot, data + i * sizeof(snapshot), sizeof(snapshot));
+        for (uint32_t c = 0; c < snapshot.channels; c++) {
+            arr->Set(idx++, Number::New(isolate, snapshot.peak[c]));
+            arr->Set(idx++, Number::New(isolate, snapshot.rms[c]));
+        }
+    }
+    return arr;
+}
+
 void audio_queue::init_prototype(Handle<FunctionTemplate> func)
 {
     NODE_SET_PROTOTYPE_METHOD(func, "stop", [](const FunctionCallbackInfo<Value>& args) {
@@ -228,6 +652,26 @@ void audio_queue::init_prototype(Handle<FunctionTemplate> func)
         auto link = ObjectWrap::Unwrap<audio_queue>(args.This());
         link->destroy();
     });
+    NODE_SET_PROTOTYPE_METHOD(func, "setDelay", [](const FunctionCallbackInfo<Value>& args) {
+        auto *isolate = args.GetIsolate();
+        auto link = ObjectWrap::Unwrap<audio_queue>(args.This());
+        if (args.Length() != 1 || !args[0]->IsNumber() ||
+            !is_valid_delay(args[0]->NumberValue())) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid delayMs value")));
+            return;
+        }
+        link->set_delay(args[0]->NumberValue());
+    });
+    NODE_SET_PROTOTYPE_METHOD(func, "snapshot", [](const FunctionCallbackInfo<Value>& args) {
+        auto link = ObjectWrap::Unwrap<audio_queue>(args.This());
+        link->snapshot(args);
+    });
+    NODE_SET_PROTOTYPE_METHOD(func, "stats", [](const FunctionCallbackInfo<Value>& args) {
+        auto link = ObjectWrap::Unwrap<audio_queue>(args.This());
+        lock_handle lock(*link);
+        args.GetReturnValue().Set(link->stats(args.GetIsolate()));
+    });
 }
 
 
@@ -4,32 +4,58 @@
 #include "p1stream.h"
 #include "module.h"
 
-#include <list>
-#include <AudioToolbox/AudioToolbox.h>
+#include "audio_session.h"
 
 namespace p1_mac_plugins {
 
 
 #define EV_AQ_IS_RUNNING 'qrun'
 
+// Levels event. The argument is a Float32Array of peak and RMS pairs, one
+// pair per captured device channel, for one or more consecutive metering
+// windows.
+#define EV_AQ_LEVELS 'qlvl'
+
+// Silence gate event. The argument is 1 when the gate opens, 0 when it
+// closes. Only with `gateThresholdDb`.
+#define EV_AQ_GATE 'qgat'
+
+// Audio source for a capture device. The actual capture happens in an
+// `audio_session`, which may be shared with other instances.
 class audio_queue : public audio_source, public lockable {
 public:
-    static const UInt32 num_buffers = 3;
-
     audio_queue();
 
     lockable_mutex mutex;
     event_buffer buffer;
 
-    std::list<audio_source_context *> ctxes;
+    // Null once stopped, or if no session could be opened.
+    audio_session *session;
+
+    // Our linked contexts. Modified with the lock held, also registered with
+    // the session while we have one.
+    std::list<audio_sink *> sinks;
+
+    // Mixes device channels to the mixer layout. Either from a channel map,
+    // with a device channel per mixer channel, or a gain matrix, with a row
+    // of device channel gains per mixer channel. Also applies the sync
+    // offset, which can be changed while running.
+    std::vector<int32_t> channel_map;
+    std::vector<float> channel_gains;
+    UInt32 gain_columns;
+    audio_mix mix;
 
-    AudioQueueRef queue;
-    AudioQueueBufferRef buffers[num_buffers];
+    // Internal.
+    void configure_matrix(UInt32 capture_channels);
+    void detach();
 
     // Public JavaScript methods.
     void init(const FunctionCallbackInfo<Value>& args);
     void stop();
     void destroy();
+    void set_delay(double delay_ms);
+    void snapshot(const FunctionCallbackInfo<Value>& args);
+    Local<Value> stats(Isolate *isolate);
 
     // Lockable implementation.
     virtual lockable *lock() final;
@@ -0,0 +1,304 @@
+#include "audio_queue_backend.h"
+#include "core_audio_device.h"
+#include "host_time.h"
+
+#include <algorithm>
+
+namespace p1_mac_plugins {
+
+
+// Adaptive sizing evaluates jitter over windows of this length, and never
+// goes below the minimum latency.
+static const uint64_t adapt_window_ns = 2000000000;
+static const double adapt_min_latency_ms = 5;
+static const UInt32 adapt_shrink_windows = 5;
+
+static void property_callback(
+    void *inUserData,
+    AudioQueueRef inAQ,
+    AudioQueuePropertyID inID);
+static void input_callback(
+    void *inUserData,
+    AudioQueueRef inAQ,
+    AudioQueueBufferRef inBuffer,
+    const AudioTimeStamp *inStartTime,
+    UInt32 inNumberPacketDescriptions,
+    const AudioStreamPacketDescription *inPacketDescs);
+
+
+const UInt32 audio_queue_backend::max_buffers;
+
+audio_queue_backend::audio_queue_backend() :
+    client(nullptr), queue(NULL), enqueue_error(noErr), buffer_count(0),
+    target_capture_frames(0), retired_buffers(max_buffers),
+    min_latency_ms(0), max_latency_ms(0), last_callback_time(0),
+    window_jitter_us(0), window_start(0), quiet_windows(0), num_resizes(0)
+{
+}
+
+audio_queue_backend::~audio_queue_backend()
+{
+    close();
+}
+
+bool audio_queue_backend::open(const capture_backend_config &config_, capture_backend_client &client_)
+{
+    bool ok = true;
+    OSStatus os_ret;
+
+    config = config_;
+    client = &client_;
+
+    AudioObjectID device;
+    os_ret = find_input_device(config.device_uid, device);
+    if (os_ret != noErr)
+        device = kAudioObjectUnknown;
+    choose_capture_format(config, device, fmt, client_);
+
+    // Adaptive mode may grow buffers up to 4 times the requested latency.
+    // The session allocates scratch space for the largest size up front.
+    auto latency_ms = config.latency_ms;
+    buffer_count = std::min(config.buffer_count, max_buffers);
+    min_latency_ms = config.adaptive ? std::min(latency_ms, adapt_min_latency_ms) : latency_ms;
+    max_latency_ms = config.adaptive ? std::min(latency_ms * 4, 500.0) : latency_ms;
+    fmt.max_frames = capture_frames_for(max_latency_ms);
+    target_capture_frames.store(capture_frames_for(latency_ms));
+
+    AudioStreamBasicDescription asbd;
+    fill_asbd(asbd, fmt);
+    os_ret = AudioQueueNewInput(&asbd, input_callback, this, NULL, kCFRunLoopCommonModes, 0, &queue);
+    if (!(ok = (os_ret == noErr)))
+        client->capture_log(capture_log_error, "AudioQueueNewInput error 0x%x", os_ret);
+
+    if (ok) {
+        os_ret = AudioQueueAddPropertyListener(queue, kAudioQueueProperty_IsRunning, property_callback, this);
+        if (!(ok = (os_ret == noErr)))
+            client->capture_log(capture_log_error, "AudioQueueAddPropertyListener error 0x%x", os_ret);
+    }
+
+    if (ok && !config.device_uid.empty()) {
+        CFStringRef device_uid = CFStringCreateWithCString(
+            kCFAllocatorDefault, config.device_uid.c_str(), kCFStringEncodingUTF8);
+        os_ret = AudioQueueSetProperty(queue, kAudioQueueProperty_CurrentDevice, &device_uid, sizeof(device_uid));
+        if (!(ok = (os_ret == noErr)))
+            client->capture_log(capture_log_error, "AudioQueueSetProperty error 0x%x", os_ret);
+        CFRelease(device_uid);
+    }
+
+    if (ok) {
+        auto frames = target_capture_frames.load();
+        for (UInt32 i = 0; i < buffer_count; i++) {
+            alloc_frames[i] = frames;
+            os_ret = AudioQueueAllocateBuffer(queue, frames * fmt.bytes_per_frame(), &buffers[i]);
+            if (!(ok = (os_ret == noErr))) {
+                client->capture_log(capture_log_error, "AudioQueueAllocateBuffer error 0x%x", os_ret);
+                break;
+            }
+
+            buffers[i]->mUserData = (void *) (uintptr_t) i;
+            os_ret = enqueue(buffers[i]);
+            if (!(ok = (os_ret == noErr))) {
+                client->capture_log(capture_log_error, "AudioQueueEnqueueBuffer error 0x%x", os_ret);
+                AudioQueueFreeBuffer(queue, buffers[i]);
+                break;
+            }
+        }
+    }
+
+    return ok;
+}
+
+bool audio_queue_backend::start()
+{
+    // Async, waits until running callback.
+    OSStatus ret = AudioQueueStart(queue, NULL);
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioQueueStart error 0x%x", ret);
+        return false;
+    }
+    return true;
+}
+
+void audio_queue_backend::close()
+{
+    if (queue != NULL) {
+        auto ret = AudioQueueDispose(queue, TRUE);
+        queue = NULL;
+        if (ret != noErr)
+            client->capture_log(capture_log_error, "AudioQueueDispose error 0x%x\n", ret);
+    }
+}
+
+void audio_queue_backend::maintain()
+{
+    auto ret = enqueue_error.exchange(noErr);
+    if (ret != noErr)
+        client->capture_log(capture_log_error, "AudioQueueEnqueueBuffer error 0x%x\n", ret);
+
+    replace_retired_buffers();
+
+    if (config.adaptive)
+        adapt_latency();
+}
+
+capture_backend_stats audio_queue_backend::stats() const
+{
+    capture_backend_stats res;
+    res.latency_ms = target_capture_frames.load() * 1000.0 / fmt.rate;
+    res.buffer_count = buffer_count;
+    res.resizes = num_resizes.load();
+    res.enqueue_delay = &enqueue_delay;
+    return res;
+}
+
+UInt32 audio_queue_backend::capture_frames_for(double latency_ms)
+{
+    return (UInt32) (latency_ms * fmt.rate / 1000);
+}
+
+OSStatus audio_queue_backend::enqueue(AudioQueueBufferRef buf)
+{
+    enqueue_times[(uintptr_t) buf->mUserData] = host_time_now();
+    return AudioQueueEnqueueBuffer(queue, buf, 0, NULL);
+}
+
+// Free buffers the callback retired because their size no longer matches
+// the target, and enqueue replacements.
+void audio_queue_backend::replace_retired_buffers()
+{
+    UInt32 idx;
+    while (retired_buffers.pop(idx)) {
+        OSStatus ret;
+        auto &buf = buffers[idx];
+
+        ret = AudioQueueFreeBuffer(queue, buf);
+        if (ret != noErr)
+            client->capture_log(capture_log_error, "AudioQueueFreeBuffer error 0x%x\n", ret);
+
+        auto frames = target_capture_frames.load();
+        ret = AudioQueueAllocateBuffer(queue, frames * fmt.bytes_per_frame(), &buf);
+        if (ret != noErr) {
+            client->capture_log(capture_log_error, "AudioQueueAllocateBuffer error 0x%x\n", ret);
+            continue;
+        }
+
+        alloc_frames[idx] = frames;
+        buf->mUserData = (void *) (uintptr_t) idx;
+        ret = enqueue(buf);
+        if (ret != noErr && ret != kAudioQueueErr_EnqueueDuringReset)
+            client->capture_log(capture_log_error, "AudioQueueEnqueueBuffer error 0x%x\n", ret);
+    }
+}
+
+// Adjust buffer duration so the queued time beyond the buffer currently
+// filling covers the worst callback jitter with margin. Grow quickly when
+// that margin is violated, shrink slowly once jitter stays low.
+void audio_queue_backend::adapt_latency()
+{
+    auto now = host_time_to_ns(host_time_now());
+    if (window_start == 0)
+        window_start = now;
+    if (now - window_start < adapt_window_ns)
+        return;
+    window_start = now;
+
+    double jitter_ms = window_jitter_us.exchange(0) / 1000.0;
+    double latency_ms = target_capture_frames.load() * 1000.0 / fmt.rate;
+    double headroom_ms = (buffer_count - 1) * latency_ms;
+
+    double next_ms = latency_ms;
+    if (jitter_ms * 2 > headroom_ms) {
+        quiet_windows = 0;
+        next_ms = latency_ms * 1.25;
+    }
+    else if (jitter_ms * 4 < headroom_ms) {
+        if (++quiet_windows >= adapt_shrink_windows) {
+            quiet_windows = 0;
+            next_ms = latency_ms * 0.9;
+        }
+    }
+    else {
+        quiet_windows = 0;
+    }
+
+    next_ms = std::max(min_latency_ms, std::min(max_latency_ms, next_ms));
+    auto next_frames = capture_frames_for(next_ms);
+    if (next_frames != target_capture_frames.load()) {
+        target_capture_frames.store(next_frames);
+        num_resizes++;
+        client->capture_log(capture_log_info, "Capture latency adjusted to %.1f ms, jitter %.1f ms",
+            next_ms, jitter_ms);
+    }
+}
+
+static void property_callback(
+    void *inUserData,
+    AudioQueueRef inAQ,
+    AudioQueuePropertyID inID)
+{
+    auto &backend = *(audio_queue_backend *) inUserData;
+
+    // Sanity check, unlikely false.
+    if (inAQ != backend.queue || inID != kAudioQueueProperty_IsRunning)
+        return;
+
+    UInt32 is_running;
+    UInt32 size = sizeof(is_running);
+    auto ret = AudioQueueGetProperty(inAQ, kAudioQueueProperty_IsRunning, &is_running, &size);
+    if (ret != noErr) {
+        backend.client->capture_log(capture_log_error, "AudioQueueGetProperty error 0x%x\n", ret);
+        return;
+    }
+
+    backend.client->capture_running(is_running != 0);
+}
+
+static void input_callback(
+    void *inUserData,
+    AudioQueueRef inAQ,
+    AudioQueueBufferRef inBuffer,
+    const AudioTimeStamp *inStartTime,
+    UInt32 inNumberPacketDescriptions,
+    const AudioStreamPacketDescription *inPacketDescs)
+{
+    auto &backend = *(audio_queue_backend *) inUserData;
+    size_t frames = inBuffer->mAudioDataByteSize / backend.fmt.bytes_per_frame();
+    auto idx = (uintptr_t) inBuffer->mUserData;
+
+    // Record callback timing.
+    auto now = host_time_now();
+    auto delay_ns = host_time_to_ns(now - backend.enqueue_times[idx]);
+    backend.enqueue_delay.record(delay_ns / 1000);
+    if (backend.last_callback_time != 0) {
+        // Track the worst deviation from the expected period for adaptive
+        // sizing. Only `maintain` resets this.
+        auto period_ns = host_time_to_ns(now - backend.last_callback_time);
+        auto expected_ns = (uint64_t) (frames * 1e9 / backend.fmt.rate);
+        auto jitter_us = (period_ns > expected_ns ? period_ns - expected_ns : expected_ns - period_ns) / 1000;
+        auto prev = backend.window_jitter_us.load(std::memory_order_relaxed);
+        while (jitter_us > prev && !backend.window_jitter_us.compare_exchange_weak(prev, jitter_us));
+    }
+    backend.last_callback_time = now;
+
+    // Sample time lets the pipeline detect holes and overlaps.
+    double sample_time = -1;
+    if (inStartTime->mFlags & kAudioTimeStampSampleTimeValid)
+        sample_time = inStartTime->mSampleTime;
+
+    backend.client->capture_buffer(inBuffer->mAudioData, frames,
+        inStartTime->mHostTime, sample_time);
+
+    // Hand buffers of the wrong size to `maintain` for replacement.
+    if (backend.alloc_frames[idx] != backend.target_capture_frames.load() &&
+        backend.retired_buffers.push((UInt32) idx)) {
+        backend.last_callback_time = 0;
+    }
+    else {
+        OSStatus ret = backend.enqueue(inBuffer);
+        if (ret != noErr && ret != kAudioQueueErr_EnqueueDuringReset)
+            backend.enqueue_error.store(ret);
+    }
+}
+
+
+}  // namespace p1_mac_plugins
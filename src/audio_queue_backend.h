@@ -0,0 +1,71 @@
+#ifndef p1_mac_plugins_audio_queue_backend_h
+#define p1_mac_plugins_audio_queue_backend_h
+
+#include "capture_backend.h"
+#include "histogram.h"
+#include "spsc_ring.h"
+
+#include <atomic>
+#include <AudioToolbox/AudioToolbox.h>
+
+namespace p1_mac_plugins {
+
+
+// Capture through an Audio Queue. Latency is the buffer duration, which may
+// adapt to callback jitter, times the number of buffers in flight.
+class audio_queue_backend : public capture_backend {
+public:
+    static const UInt32 max_buffers = 16;
+
+    audio_queue_backend();
+    virtual ~audio_queue_backend();
+
+    capture_backend_client *client;
+    capture_backend_config config;
+
+    AudioQueueRef queue;
+    std::atomic<OSStatus> enqueue_error;
+
+    // Queue buffers. `mUserData` of each buffer holds its index here.
+    UInt32 buffer_count;
+    AudioQueueBufferRef buffers[max_buffers];
+    UInt32 alloc_frames[max_buffers];
+    uint64_t enqueue_times[max_buffers];
+
+    // Buffer sizing, in frames at the capture rate. The session sizes
+    // scratch space for `fmt.max_frames`, so the target can change while
+    // running. The callback retires buffers of the wrong size, `maintain`
+    // replaces them.
+    std::atomic<UInt32> target_capture_frames;
+    spsc_ring<UInt32> retired_buffers;
+
+    // Adaptive buffer sizing, based on callback jitter.
+    double min_latency_ms;
+    double max_latency_ms;
+    uint64_t last_callback_time;
+    std::atomic<uint64_t> window_jitter_us;
+    uint64_t window_start;
+    UInt32 quiet_windows;
+    std::atomic<UInt32> num_resizes;
+
+    // Time from enqueue to callback, in microseconds.
+    log_histogram enqueue_delay;
+
+    // Internal.
+    void replace_retired_buffers();
+    void adapt_latency();
+    UInt32 capture_frames_for(double latency_ms);
+    OSStatus enqueue(AudioQueueBufferRef buf);
+
+    // Capture backend implementation.
+    virtual bool open(const capture_backend_config &config, capture_backend_client &client) final;
+    virtual bool start() final;
+    virtual void close() final;
+    virtual void maintain() final;
+    virtual capture_backend_stats stats() const final;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_audio_queue_backend_h
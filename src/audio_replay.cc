@@ -0,0 +1,144 @@
+#include "audio_replay.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace p1_mac_plugins {
+
+// Mixer format, see `audio_session`.
+static const uint32_t num_channels = 2;
+static const double sample_rate = 44100;
+
+
+audio_replay::audio_replay() :
+    buffer(this)
+{
+}
+
+void audio_replay::init(const FunctionCallbackInfo<Value>& args)
+{
+    auto *isolate = args.GetIsolate();
+    Handle<Value> val;
+
+    if (args.Length() != 1 || !args[0]->IsObject()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Expected an object")));
+        return;
+    }
+    auto params = args[0].As<Object>();
+
+    val = params->Get(path_sym.Get(isolate));
+    if (!val->IsString()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid path value")));
+        return;
+    }
+    String::Utf8Value path(val);
+
+    bool realtime = true;
+    val = params->Get(realtime_sym.Get(isolate));
+    if (val->IsBoolean()) {
+        realtime = val->BooleanValue();
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid realtime value")));
+        return;
+    }
+
+    bool loop = false;
+    val = params->Get(loop_sym.Get(isolate));
+    if (val->IsBoolean()) {
+        loop = val->BooleanValue();
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid loop value")));
+        return;
+    }
+
+    bool drift_compensation = true;
+    val = params->Get(drift_compensation_sym.Get(isolate));
+    if (val->IsBoolean()) {
+        drift_compensation = val->BooleanValue();
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid driftCompensation value")));
+        return;
+    }
+
+    val = params->Get(on_event_sym.Get(isolate));
+    if (!val->IsFunction()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Expected an onEvent function")));
+        return;
+    }
+
+    // Parameters checked, from here on we no longer throw exceptions.
+    Wrap(args.This());
+    Ref();
+    args.GetReturnValue().Set(handle());
+
+    buffer.set_callback(isolate->GetCurrentContext(), val.As<Function>());
+
+    if (!replay.open(*path, sample_rate, drift_compensation)) {
+        buffer.emitf(EV_LOG_ERROR, "Could not open recording '%s': %s", *path, strerror(errno));
+        return;
+    }
+
+    // Recordings hold all device channels. Map them like `audio_queue` does
+    // by default.
+    matrix.configure_default(replay.channels(), num_channels);
+    scratch.reset(new float[replay.max_output_frames() * num_channels]);
+
+    // Replay runs on its own thread, and takes our lock for each buffer, as
+    // a capture callback would.
+    replay.start(realtime, loop, [this](uint64_t time, const float *in, size_t samples) {
+        lock_handle lock(*this);
+
+        // Mixers get a private copy, the input may point into the mapping.
+        auto frames = samples / matrix.in_channels();
+        matrix.process(in, scratch.get(), frames);
+        for (auto ctx : ctxes)
+            ctx->render_buffer(time, scratch.get(), frames * num_channels);
+    }, [this]() {
+        lock_handle lock(*this);
+        buffer.emit(EV_REPLAY_ENDED, 0);
+    });
+}
+
+void audio_replay::destroy()
+{
+    replay.close();
+
+    buffer.flush();
+
+    Unref();
+}
+
+lockable *audio_replay::lock()
+{
+    return mutex.lock();
+}
+
+void audio_replay::link_audio_source(audio_source_context &ctx)
+{
+    ctxes.push_back(&ctx);
+}
+
+void audio_replay::unlink_audio_source(audio_source_context &ctx)
+{
+    ctxes.remove(&ctx);
+}
+
+void audio_replay::init_prototype(Handle<FunctionTemplate> func)
+{
+    NODE_SET_PROTOTYPE_METHOD(func, "destroy", [](const FunctionCallbackInfo<Value>& args) {
+        auto replay = ObjectWrap::Unwrap<audio_replay>(args.This());
+        replay->destroy();
+    });
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,50 @@
+#ifndef p1_mac_plugins_audio_replay_h
+#define p1_mac_plugins_audio_replay_h
+
+#include "p1stream.h"
+#include "module.h"
+
+#include "capture_replay.h"
+#include "channel_matrix.h"
+
+#include <list>
+
+namespace p1_mac_plugins {
+
+
+#define EV_REPLAY_ENDED 'rend'
+
+// Audio source playing back a recording made with the `recordPath` option of
+// `audio_queue`. Uses no Core Audio, all work is in `capture_replay`.
+class audio_replay : public audio_source, public lockable {
+public:
+    audio_replay();
+
+    lockable_mutex mutex;
+    event_buffer buffer;
+
+    std::list<audio_source_context *> ctxes;
+
+    capture_replay replay;
+    channel_matrix matrix;
+    std::unique_ptr<float[]> scratch;
+
+    // Public JavaScript methods.
+    void init(const FunctionCallbackInfo<Value>& args);
+    void destroy();
+
+    // Lockable implementation.
+    virtual lockable *lock() final;
+
+    // Audio source implementation.
+    virtual void link_audio_source(audio_source_context &ctx) final;
+    virtual void unlink_audio_source(audio_source_context &ctx) final;
+
+    // Module init.
+    static void init_prototype(Handle<FunctionTemplate> func);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_audio_replay_h
@@ -0,0 +1,85 @@
+#ifndef p1_mac_plugins_audio_ring_h
+#define p1_mac_plugins_audio_ring_h
+
+#include "spsc_ring.h"
+#include "shared_buffer_pool.h"
+
+namespace p1_mac_plugins {
+
+
+// Timestamped audio handoff from a capture callback to a consumer stage.
+// Carries references to shared buffers, so one buffer can be queued to any
+// number of consumers without copying. Each queued chunk holds a reference,
+// released once consumed.
+class audio_ring {
+public:
+    struct chunk {
+        uint64_t time;
+        shared_audio_buffer *buf;
+    };
+
+    explicit audio_ring(size_t chunk_capacity) :
+        chunks(chunk_capacity), overruns(0)
+    {
+    }
+
+    ~audio_ring()
+    {
+        clear();
+    }
+
+    size_t capacity() const { return chunks.capacity(); }
+
+    // Producer side. Either the chunk is queued, or it is dropped and
+    // counted as an overrun. A null buffer is counted as an overrun.
+    bool write(uint64_t time, shared_audio_buffer *buf)
+    {
+        if (buf == nullptr || chunks.write_available() < 1) {
+            overruns.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        buf->retain();
+        chunk hdr = { time, buf };
+        chunks.push(hdr);
+        return true;
+    }
+
+    // Consumer side. Calls `fn(time, data, count)` for each queued chunk.
+    // Data is only valid during the call.
+    template<typename F>
+    size_t drain(F fn)
+    {
+        size_t num = 0;
+        chunk hdr;
+        while (chunks.pop(hdr)) {
+            fn(hdr.time, hdr.buf->data.get(), hdr.buf->samples);
+            hdr.buf->release();
+            num++;
+        }
+        return num;
+    }
+
+    // Consumer side. Release all queued chunks.
+    void clear()
+    {
+        chunk hdr;
+        while (chunks.pop(hdr))
+            hdr.buf->release();
+    }
+
+    // Consumer side. Returns and resets the number of dropped chunks.
+    uint32_t take_overruns()
+    {
+        return overruns.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    spsc_ring<chunk> chunks;
+    std::atomic<uint32_t> overruns;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_audio_ring_h
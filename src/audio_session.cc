@@ -0,0 +1,620 @@
+#include "audio_session.h"
+#include "audio_queue.h"
+#include "audio_queue_backend.h"
+#include "hal_backend.h"
+#include "host_time.h"
+#include "synthetic_backend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+
+namespace p1_mac_plugins {
+
+
+// Metering windows not yet emitted by the drain stage.
+static const size_t meter_queue_size = 16;
+
+// Silence gate changes not yet emitted by the drain stage.
+static const size_t gate_queue_size = 16;
+
+// Open sessions, see `audio_session::acquire`.
+static std::mutex registry_mutex;
+static std::list<audio_session *> registry;
+
+static capture_backend *create_backend(capture_backend_kind kind);
+
+
+audio_mix::audio_mix() :
+    delay_ms(0), gating(false), gate_skip(false), gate_events(gate_queue_size),
+    gate_open(true), gated_buffers(0)
+{
+}
+
+void audio_mix::configure_delay(size_t max_block_frames)
+{
+    auto max_frames = (size_t) max_delay_ms * audio_session::sample_rate / 1000;
+    delay.configure(audio_session::num_channels, max_frames, max_block_frames);
+}
+
+shared_audio_buffer *audio_mix::process(shared_audio_buffer *mixed,
+    size_t frames, uint64_t &time, shared_buffer_pool &pool)
+{
+    auto ms = delay_ms.load(std::memory_order_relaxed);
+    if (ms < 0)
+        time -= ns_to_host_time((uint64_t) (-ms * 1000000));
+
+    // Keep feeding the line at zero delay, so history is valid once a
+    // delay is set.
+    auto delay_frames = ms > 0 ? ms * audio_session::sample_rate / 1000 : 0;
+    if (delay.passes_through(delay_frames)) {
+        delay.process(mixed->data.get(), nullptr, frames, 0);
+        mixed->retain();
+        return mixed;
+    }
+
+    auto *out = pool.acquire();
+    if (out == nullptr)
+        return nullptr;
+
+    delay.process(mixed->data.get(), out->data.get(), frames, delay_frames);
+    out->samples = mixed->samples;
+    return out;
+}
+
+
+audio_sink::audio_sink(audio_source_context &ctx_, audio_mix &mix_) :
+    ctx(ctx_), mix(mix_), ring(audio_session::ring_buffers)
+{
+}
+
+
+bool audio_session_config::shares_with(const audio_session_config &other) const
+{
+    // Recordings are private to the instance that asked for them.
+    if (!record_path.empty() || !other.record_path.empty())
+        return false;
+
+    return same_capture(other) &&
+        drift_compensation == other.drift_compensation &&
+        conceal == other.conceal &&
+        meter_interval_ms == other.meter_interval_ms;
+}
+
+
+audio_session::audio_session(const audio_session_config &config_) :
+    config(config_), users(0), active_routes(nullptr), callbacks_running(0),
+    started(false), stopped(false), open_log(nullptr), buffer_frames(0),
+    last_callback_time(0), capture_rate(sample_rate), capture_channels(num_channels),
+    pool_limited(false), logged_gaps(0), logged_overlaps(0), logged_resyncs(0),
+    recording(false),
+    metering(false), meter_snapshots(meter_queue_size),
+    dispatch(NULL), drain_source(NULL)
+{
+}
+
+audio_session::~audio_session()
+{
+    close();
+}
+
+// Find an open session with matching options, or open a new one, and add
+// the instance to it.
+audio_session *audio_session::acquire(const audio_session_config &config, audio_queue &inst)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    auto it = std::find_if(registry.begin(), registry.end(), [&](audio_session *session) {
+        return !session->stopped.load() && session->config.shares_with(config);
+    });
+
+    audio_session *session;
+    if (it != registry.end()) {
+        session = *it;
+    }
+    else {
+        session = new audio_session(config);
+        if (!session->open(inst.buffer)) {
+            delete session;
+            return nullptr;
+        }
+        registry.push_back(session);
+    }
+
+    session->users++;
+
+    // Serialize with the drain stage. A running session won't signal start
+    // again, so tell the new instance directly.
+    dispatch_sync(session->dispatch, ^{
+        session->instances.push_back(&inst);
+        if (session->started.load()) {
+            lock_handle inst_lock(inst);
+            auto *ev = inst.buffer.emit(EV_AQ_IS_RUNNING, sizeof(UInt32));
+            if (ev != nullptr)
+                *(UInt32 *) ev->data = 1;
+        }
+    });
+
+    return session;
+}
+
+// Remove the instance and its sinks from the session, and close the session
+// if this was the last instance. Must be called without the instance lock.
+void audio_session::release(audio_session *session, audio_queue &inst)
+{
+    dispatch_sync(session->dispatch, ^{
+        session->instances.remove(&inst);
+    });
+
+    {
+        lock_handle inst_lock(inst);
+        for (auto *sink : inst.sinks)
+            session->remove_sink(sink);
+        inst.session = nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (--session->users == 0) {
+        registry.remove(session);
+        delete session;
+    }
+}
+
+bool audio_session::open(event_buffer &log)
+{
+    bool ok;
+
+    dispatch = dispatch_queue_create("audio_session", DISPATCH_QUEUE_SERIAL);
+    if (dispatch == NULL) {
+        log.emitf(EV_LOG_ERROR, "dispatch_queue_create error");
+        return false;
+    }
+
+    drain_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, dispatch);
+    if (drain_source == NULL) {
+        log.emitf(EV_LOG_ERROR, "dispatch_source_create error");
+        return false;
+    }
+    dispatch_source_set_event_handler(drain_source, ^{
+        drain();
+    });
+    dispatch_resume(drain_source);
+
+    backend.reset(create_backend(config.kind));
+    if (!backend) {
+        log.emitf(EV_LOG_ERROR, "Capture backend '%s' not available",
+            capture_backend_name(config.kind));
+        return false;
+    }
+
+    open_log = &log;
+    ok = backend->open(config, *this);
+    open_log = nullptr;
+    if (!ok)
+        return false;
+
+    auto &fmt = backend->format();
+    capture_rate = fmt.rate;
+    capture_channels = fmt.channels;
+
+    pipeline.configure(fmt.format, fmt.interleaved, capture_channels,
+        capture_rate, sample_rate, config.drift_compensation, fmt.max_frames,
+        config.conceal);
+    buffer_frames = (UInt32) pipeline.max_output_frames();
+    pool.configure(buffer_frames * num_channels);
+
+    // Record buffers as captured, so replay exercises conversion too.
+    if (!config.record_path.empty()) {
+        capture_file_header hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.format = fmt.format;
+        hdr.channels = capture_channels;
+        hdr.interleaved = fmt.interleaved;
+        hdr.sample_rate = capture_rate;
+        if (!record_file.open(config.record_path.c_str(), hdr)) {
+            log.emitf(EV_LOG_ERROR, "Could not open recording '%s': %s",
+                config.record_path.c_str(), strerror(errno));
+        }
+        else {
+            auto bytes = fmt.max_frames * pipeline.bytes_per_frame();
+            recorder.reset(new capture_recorder(ring_buffers * bytes, ring_buffers * 2));
+            recording.store(true);
+        }
+    }
+
+    metering = config.meter_interval_ms > 0;
+    if (metering && capture_channels > level_snapshot::max_channels) {
+        log.emitf(EV_LOG_WARN, "Metering supports up to %u channels, device has %u, not metering",
+            level_snapshot::max_channels, capture_channels);
+        metering = false;
+    }
+    if (metering)
+        meter.configure(capture_channels, (size_t) (config.meter_interval_ms * sample_rate / 1000));
+
+    open_log = &log;
+    ok = backend->start();
+    open_log = nullptr;
+
+    return ok;
+}
+
+void audio_session::close()
+{
+    if (backend)
+        backend->close();
+
+    // The backend is closed, so no more callbacks. Cancel the consumer stage
+    // and wait for a drain that may still be running.
+    if (drain_source != NULL) {
+        dispatch_source_cancel(drain_source);
+        dispatch_sync(dispatch, ^{});
+        dispatch_release(drain_source);
+        drain_source = NULL;
+    }
+
+    if (dispatch != NULL) {
+        dispatch_release(dispatch);
+        dispatch = NULL;
+    }
+
+    delete active_routes.exchange(nullptr);
+
+    if (recording.exchange(false))
+        recorder->flush(record_file);
+    record_file.close();
+}
+
+void audio_session::add_sink(audio_sink *sink)
+{
+    std::lock_guard<std::mutex> lock(sinks_mutex);
+    sinks.push_back(sink);
+    publish_sinks();
+}
+
+void audio_session::remove_sink(audio_sink *sink)
+{
+    std::lock_guard<std::mutex> lock(sinks_mutex);
+    sinks.remove(sink);
+    publish_sinks();
+
+    // The callback no longer sees the sink. Return its buffers to the pool,
+    // they may not outlive us.
+    sink->ring.clear();
+}
+
+// Swap in a new snapshot of sinks grouped by matrix and instance for the
+// capture callback.
+// Once this returns, the callback no longer references the previous one.
+void audio_session::publish_sinks()
+{
+    auto *next = new std::vector<audio_route>();
+    size_t num_branches = 0;
+    for (auto *sink : sinks) {
+        auto route = std::find_if(next->begin(), next->end(), [&](const audio_route &route) {
+            return route.matrix->equals(sink->mix.matrix);
+        });
+        if (route == next->end())
+            route = next->insert(next->end(), audio_route { &sink->mix.matrix, {} });
+
+        auto branch = std::find_if(route->branches.begin(), route->branches.end(), [&](const audio_branch &branch) {
+            return branch.mix == &sink->mix;
+        });
+        if (branch == route->branches.end()) {
+            branch = route->branches.insert(route->branches.end(), audio_branch { &sink->mix, {} });
+            num_branches++;
+        }
+        branch->sinks.push_back(sink);
+    }
+
+    // Enough buffers for every ring to fill up, plus those in flight in the
+    // callback: one per route, and one per delayed branch.
+    size_t needed = sinks.size() * ring_buffers + next->size() + num_branches;
+    if (!pool.reserve(needed) && !pool_limited) {
+        pool_limited = true;
+        capture_log(capture_log_warn, "Buffer pool limit reached, need %zu buffers, "
+            "have %zu. Slow mixers may drop audio.",
+            needed, shared_buffer_pool::max_buffers);
+    }
+
+    auto *prev = active_routes.exchange(next);
+
+    // A callback may still be writing to rings from the old snapshot. This
+    // is short, so spinning on the mixer side is acceptable. The callback
+    // itself never waits on us.
+    while (callbacks_running.load() != 0)
+        std::this_thread::yield();
+
+    delete prev;
+}
+
+// Consumer stage. Runs on our serial dispatch queue, whenever the capture
+// callback signals new data. Each instance is drained with its lock held.
+void audio_session::drain()
+{
+    backend->maintain();
+
+    if (recording.load())
+        flush_recording();
+
+    log_discontinuities();
+
+    level_snapshot levels[meter_queue_size];
+    size_t num_levels = 0;
+    if (metering) {
+        num_levels = std::min(meter_snapshots.read_available(), meter_queue_size);
+        meter_snapshots.read(levels, num_levels);
+    }
+
+    for (auto *inst : instances) {
+        lock_handle lock(*inst);
+
+        for (auto *sink : inst->sinks) {
+            sink->ring.drain([&](uint64_t time, float *in, uint32_t samples) {
+                sink->ctx.render_buffer(time, in, samples);
+            });
+
+            auto overruns = sink->ring.take_overruns();
+            if (overruns != 0)
+                inst->buffer.emitf(EV_LOG_WARN, "Mixer fell behind, dropped %u buffers", overruns);
+        }
+
+        gate_event gate_ev;
+        while (inst->mix.gate_events.pop(gate_ev)) {
+            auto *ev = inst->buffer.emit(EV_AQ_GATE, sizeof(UInt32));
+            if (ev != nullptr)
+                *(UInt32 *) ev->data = gate_ev.open;
+        }
+
+        // Emit all pending metering windows as a single event.
+        if (num_levels != 0) {
+            auto *ev = inst->buffer.emit(EV_AQ_LEVELS, num_levels * sizeof(level_snapshot));
+            if (ev != nullptr)
+                memcpy(ev->data, levels, num_levels * sizeof(level_snapshot));
+        }
+    }
+}
+
+// Log to all instances. Only on the dispatch queue.
+void audio_session::broadcast(uint32_t id, const char *format, ...)
+{
+    char msg[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(msg, sizeof(msg), format, args);
+    va_end(args);
+
+    for (auto *inst : instances) {
+        lock_handle lock(*inst);
+        inst->buffer.emitf(id, "%s", msg);
+    }
+}
+
+// Only on the dispatch queue.
+void audio_session::broadcast_is_running(UInt32 is_running)
+{
+    for (auto *inst : instances) {
+        lock_handle lock(*inst);
+        auto *ev = inst->buffer.emit(EV_AQ_IS_RUNNING, sizeof(is_running));
+        if (ev != nullptr)
+            *(UInt32 *) ev->data = is_running;
+    }
+}
+
+// Write recorded buffers to the file. Stops recording on write errors.
+void audio_session::flush_recording()
+{
+    if (recorder->flush(record_file) < 0) {
+        broadcast(EV_LOG_ERROR, "Recording write error: %s", strerror(errno));
+        recording.store(false);
+        record_file.close();
+    }
+
+    auto drops = recorder->take_drops();
+    if (drops != 0)
+        broadcast(EV_LOG_WARN, "Recording fell behind, dropped %u buffers", drops);
+}
+
+// Warn about new holes and overlaps in the capture timeline. These were
+// already concealed by the callback.
+void audio_session::log_discontinuities()
+{
+    auto &guard = pipeline.continuity();
+    auto gaps = guard.gaps.load(std::memory_order_relaxed);
+    auto overlaps = guard.overlaps.load(std::memory_order_relaxed);
+    auto resyncs = guard.resyncs.load(std::memory_order_relaxed);
+
+    if (gaps != logged_gaps) {
+        broadcast(EV_LOG_WARN, "Capture skipped, concealed %llu gaps",
+            (unsigned long long) (gaps - logged_gaps));
+        logged_gaps = gaps;
+    }
+    if (overlaps != logged_overlaps) {
+        broadcast(EV_LOG_WARN, "Capture overlapped, trimmed %llu buffers",
+            (unsigned long long) (overlaps - logged_overlaps));
+        logged_overlaps = overlaps;
+    }
+    if (resyncs != logged_resyncs) {
+        broadcast(EV_LOG_WARN, "Capture timeline jumped, resynced %llu times",
+            (unsigned long long) (resyncs - logged_resyncs));
+        logged_resyncs = resyncs;
+    }
+}
+
+// A session that stopped is not joined again, see `acquire`.
+void audio_session::capture_running(bool running)
+{
+    if (running)
+        started.store(true);
+    else
+        stopped.store(true);
+
+    dispatch_async(dispatch, ^{
+        broadcast_is_running(running ? 1 : 0);
+    });
+}
+
+void audio_session::capture_log(capture_log_level level, const char *format, ...)
+{
+    char msg[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(msg, sizeof(msg), format, args);
+    va_end(args);
+
+    uint32_t id = level == capture_log_error ? EV_LOG_ERROR :
+        level == capture_log_warn ? EV_LOG_WARN : EV_LOG_INFO;
+
+    // While opening, the opening instance is not one of ours yet.
+    if (open_log != nullptr) {
+        open_log->emitf(id, "%s", msg);
+        return;
+    }
+
+    std::string str(msg);
+    dispatch_async(dispatch, ^{
+        broadcast(id, "%s", str.c_str());
+    });
+}
+
+void audio_session::capture_buffer(const void *data, size_t frames,
+    uint64_t time, double sample_time)
+{
+    // Record callback timing.
+    auto now = host_time_now();
+    if (last_callback_time != 0) {
+        auto period_ns = host_time_to_ns(now - last_callback_time);
+        callback_period.record(period_ns / 1000);
+    }
+    last_callback_time = now;
+
+    // Record the raw buffer, before any processing.
+    if (recording.load(std::memory_order_relaxed)) {
+        recorder->push(host_time_to_ns(time), (uint32_t) frames,
+            data, (uint32_t) (frames * pipeline.bytes_per_frame()));
+    }
+
+    // Sample time lets the pipeline detect holes and overlaps.
+    const float *in;
+    frames = pipeline.process(data, frames, sample_time, time, in);
+
+    if (metering) {
+        level_snapshot snapshot;
+        if (meter.process(in, frames, time, snapshot))
+            meter_snapshots.push(snapshot);
+    }
+
+    // Mix once per distinct matrix, and only queue references to sink rings
+    // here. Never take a lock, so a slow mixer can't delay the backend.
+    callbacks_running.fetch_add(1);
+    auto *routes = active_routes.load();
+    if (routes != nullptr && frames != 0) {
+        auto samples = (UInt32) (frames * num_channels);
+        for (auto &route : *routes) {
+            auto *mixed = pool.acquire();
+            if (mixed != nullptr) {
+                route.matrix->process(in, mixed->data.get(), frames);
+                mixed->samples = samples;
+            }
+
+            for (auto &branch : route.branches) {
+                auto branch_time = time;
+                shared_audio_buffer *out = nullptr;
+                if (mixed != nullptr)
+                    out = branch.mix->process(mixed, frames, branch_time, pool);
+
+                auto &mix = *branch.mix;
+                if (out != nullptr && mix.history)
+                    mix.history->write(host_time_to_ns(branch_time), out->data.get(), frames);
+
+                bool skip = false;
+                if (out != nullptr && mix.gating) {
+                    if (mix.gate.process(out->data.get(), frames)) {
+                        mix.gate_open.store(mix.gate.is_open(), std::memory_order_relaxed);
+                        mix.gate_events.push(gate_event { branch_time, mix.gate.is_open() });
+                    }
+                    skip = mix.gate_skip && !mix.gate.is_open();
+                    if (skip)
+                        mix.gated_buffers.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                // Rings take their own reference, or count an overrun.
+                if (!skip) {
+                    for (auto *sink : branch.sinks)
+                        sink->ring.write(branch_time, out);
+                }
+                if (out != nullptr)
+                    out->release();
+            }
+
+            if (mixed != nullptr)
+                mixed->release();
+        }
+    }
+    callbacks_running.fetch_sub(1);
+
+    dispatch_source_merge_data(drain_source, 1);
+}
+
+static capture_backend *create_backend(capture_backend_kind kind)
+{
+    switch (kind) {
+        case capture_backend_audio_queue: return new audio_queue_backend();
+        case capture_backend_hal: return new hal_backend();
+        case capture_backend_synthetic: return new synthetic_backend();
+        default: return nullptr;
+    }
+}
+
+Local<Value> audio_session::stats(Isolate *isolate)
+{
+    auto obj = Object::New(isolate);
+    auto backend_stats = backend->stats();
+    obj->Set(backend_sym.Get(isolate),
+        String::NewFromUtf8(isolate, capture_backend_name(config.kind)));
+    obj->Set(latency_ms_sym.Get(isolate), Number::New(isolate, backend_stats.latency_ms));
+    obj->Set(buffer_count_sym.Get(isolate),
+        Uint32::NewFromUnsigned(isolate, backend_stats.buffer_count));
+    obj->Set(adaptive_sym.Get(isolate), Boolean::New(isolate, config.adaptive));
+    obj->Set(String::NewFromUtf8(isolate, "captureChannels"),
+        Uint32::NewFromUnsigned(isolate, capture_channels));
+
+    {
+        std::lock_guard<std::mutex> lock(sinks_mutex);
+        auto *routes = active_routes.load();
+        obj->Set(String::NewFromUtf8(isolate, "mixRoutes"),
+            Uint32::NewFromUnsigned(isolate, routes ? (UInt32) routes->size() : 0));
+        obj->Set(String::NewFromUtf8(isolate, "sharedBuffers"),
+            Uint32::NewFromUnsigned(isolate, (UInt32) pool.size()));
+    }
+    obj->Set(String::NewFromUtf8(isolate, "resizes"),
+        Uint32::NewFromUnsigned(isolate, backend_stats.resizes));
+    auto &guard = pipeline.continuity();
+    obj->Set(String::NewFromUtf8(isolate, "gaps"),
+        Number::New(isolate, (double) guard.gaps.load()));
+    obj->Set(String::NewFromUtf8(isolate, "gapFrames"),
+        Number::New(isolate, (double) guard.gap_frames.load()));
+    obj->Set(String::NewFromUtf8(isolate, "overlaps"),
+        Number::New(isolate, (double) guard.overlaps.load()));
+    obj->Set(String::NewFromUtf8(isolate, "overlapFrames"),
+        Number::New(isolate, (double) guard.overlap_frames.load()));
+    obj->Set(String::NewFromUtf8(isolate, "resyncs"),
+        Number::New(isolate, (double) guard.resyncs.load()));
+    obj->Set(String::NewFromUtf8(isolate, "callbackPeriodUs"),
+        histogram_to_js(isolate, callback_period));
+    if (backend_stats.enqueue_delay != nullptr) {
+        obj->Set(String::NewFromUtf8(isolate, "enqueueDelayUs"),
+            histogram_to_js(isolate, *backend_stats.enqueue_delay));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        obj->Set(String::NewFromUtf8(isolate, "sessionUsers"),
+            Uint32::NewFromUnsigned(isolate, users));
+    }
+    return obj;
+}
+
+
+}  // namespace p1_mac_plugins
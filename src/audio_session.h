@@ -0,0 +1,219 @@
+#ifndef p1_mac_plugins_audio_session_h
+#define p1_mac_plugins_audio_session_h
+
+#include "p1stream.h"
+#include "module.h"
+
+#include "audio_history.h"
+#include "audio_ring.h"
+#include "capture_backend.h"
+#include "capture_pipeline.h"
+#include "capture_file.h"
+#include "channel_matrix.h"
+#include "delay_line.h"
+#include "histogram.h"
+#include "level_meter.h"
+#include "shared_buffer_pool.h"
+#include "silence_gate.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <AudioToolbox/AudioToolbox.h>
+#include <dispatch/dispatch.h>
+
+namespace p1_mac_plugins {
+
+class audio_queue;
+
+
+// Silence gate state change, queued by the callback.
+struct gate_event {
+    uint64_t time;
+    UInt32 open;
+};
+
+// Processing of captured audio for one instance, run by the capture
+// callback: mixing to the mixer layout, then the A/V sync offset. Instances
+// with equal matrices share the mixed buffer.
+class audio_mix {
+public:
+    // Delay line length limit.
+    static const UInt32 max_delay_ms = 1000;
+
+    audio_mix();
+
+    channel_matrix matrix;
+
+    // Sync offset, may be changed at any time. Positive values delay the
+    // audio through the delay line, negative values move timestamps earlier.
+    std::atomic<double> delay_ms;
+    delay_line delay;
+
+    // Instant replay history of the output, if enabled. Written by the
+    // callback, read by snapshots from any thread.
+    std::unique_ptr<audio_history> history;
+
+    // Silence detection on the output, if enabled. With `gate_skip`, buffers
+    // are not queued to sinks while the gate is closed.
+    bool gating;
+    bool gate_skip;
+    silence_gate gate;
+    spsc_ring<gate_event> gate_events;
+    std::atomic<bool> gate_open;
+    std::atomic<uint64_t> gated_buffers;
+
+    void configure_delay(size_t max_block_frames);
+
+    // Only used in the callback. Delays a mixed buffer, adjusting `time` for
+    // negative offsets. Returns `mixed` or a buffer from `pool`, with a new
+    // reference, or nullptr if the pool ran dry.
+    shared_audio_buffer *process(shared_audio_buffer *mixed, size_t frames,
+        uint64_t &time, shared_buffer_pool &pool);
+};
+
+// A linked mixer context, fed through its own ring by the capture callback.
+// The mix is owned by the instance the context is linked to.
+class audio_sink {
+public:
+    audio_sink(audio_source_context &ctx_, audio_mix &mix_);
+
+    audio_source_context &ctx;
+    audio_mix &mix;
+    audio_ring ring;
+};
+
+// Sinks of one instance.
+struct audio_branch {
+    audio_mix *mix;
+    std::vector<audio_sink *> sinks;
+};
+
+// Instances with equal channel matrices. The callback mixes once for all of
+// them, into a shared buffer.
+struct audio_route {
+    const channel_matrix *matrix;
+    std::vector<audio_branch> branches;
+};
+
+// Capture options. Instances with equal options share a session.
+struct audio_session_config : capture_backend_config {
+    bool drift_compensation;
+    conceal_mode conceal;
+    double meter_interval_ms;
+    std::string record_path;
+
+    bool shares_with(const audio_session_config &other) const;
+};
+
+// One capture backend instance, shared by all `audio_queue` instances with
+// the same options. Sessions are reference counted, and closed when the last
+// instance releases them. The backend only delivers raw buffers, see
+// `capture_backend`; everything from conversion on happens here.
+//
+// The list of instances is only accessed on the dispatch queue. Sinks of all
+// instances are gathered under `sinks_mutex`, and published to the capture
+// callback as an immutable snapshot of routes. The callback hands sinks
+// references to pooled buffers, so each distinct mix is produced once per
+// capture buffer, however many mixers consume it.
+//
+// All device channels are captured. Each instance picks or mixes the ones it
+// needs, and applies its own sync offset, see `audio_mix`.
+class audio_session : public capture_backend_client {
+public:
+    // Mixer format. Capture is converted to interleaved float at this layout.
+    static const UInt32 num_channels = 2;
+    static const UInt32 sample_rate = 44100;
+
+    // Number of capture buffers each sink ring can hold before it overruns.
+    static const UInt32 ring_buffers = 8;
+
+    audio_session(const audio_session_config &config_);
+    ~audio_session();
+
+    const audio_session_config config;
+
+    // Registry. `acquire` reports errors to the instance, and returns
+    // nullptr if no session could be opened.
+    UInt32 users;
+    static audio_session *acquire(const audio_session_config &config, audio_queue &inst);
+    static void release(audio_session *session, audio_queue &inst);
+
+    std::list<audio_queue *> instances;
+
+    std::mutex sinks_mutex;
+    std::list<audio_sink *> sinks;
+    std::atomic<std::vector<audio_route> *> active_routes;
+    std::atomic<UInt32> callbacks_running;
+
+    std::unique_ptr<capture_backend> backend;
+    std::atomic<bool> started;
+    std::atomic<bool> stopped;
+
+    // Backend errors go here while opening, and to all instances after.
+    event_buffer *open_log;
+
+    // Maximum mixer frames produced per callback.
+    UInt32 buffer_frames;
+
+    // Time between capture callbacks, in microseconds.
+    uint64_t last_callback_time;
+    log_histogram callback_period;
+
+    // Converts and resamples to the mixer format, following drift of the
+    // device clock against host time. Only used in the callback.
+    Float64 capture_rate;
+    UInt32 capture_channels;
+    capture_pipeline pipeline;
+
+    // Mixed output handed to sinks, see `audio_route`. Grown as sinks are
+    // added, to cover every sink ring filling up. Warned about once if that
+    // takes more than the pool limit.
+    shared_buffer_pool pool;
+    bool pool_limited;
+
+    // Discontinuity counts last logged by the drain stage.
+    uint64_t logged_gaps;
+    uint64_t logged_overlaps;
+    uint64_t logged_resyncs;
+
+    // Recording of raw capture buffers. Queued in the callback, written to
+    // the file by the drain stage.
+    std::atomic<bool> recording;
+    std::unique_ptr<capture_recorder> recorder;
+    capture_file_writer record_file;
+
+    // Level metering. Measured in the callback, emitted by the drain stage.
+    bool metering;
+    level_meter meter;
+    spsc_ring<level_snapshot> meter_snapshots;
+
+    // Consumer stage, drains sink rings into the mixers.
+    dispatch_queue_t dispatch;
+    dispatch_source_t drain_source;
+
+    // Internal.
+    bool open(event_buffer &log);
+    void close();
+    void add_sink(audio_sink *sink);
+    void remove_sink(audio_sink *sink);
+    void publish_sinks();
+    void drain();
+    void broadcast(uint32_t id, const char *format, ...);
+    void broadcast_is_running(UInt32 is_running);
+    void flush_recording();
+    void log_discontinuities();
+    Local<Value> stats(Isolate *isolate);
+
+    // Capture backend client implementation.
+    virtual void capture_buffer(const void *data, size_t frames,
+        uint64_t host_time, double sample_time) final;
+    virtual void capture_running(bool running) final;
+    virtual void capture_log(capture_log_level level, const char *format, ...) final;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_audio_session_h
@@ -0,0 +1,57 @@
+#include "capture_backend.h"
+
+#include <cstring>
+
+namespace p1_mac_plugins {
+
+
+bool capture_backend_config::same_capture(const capture_backend_config &other) const
+{
+    if (kind != other.kind)
+        return false;
+
+    if (kind == capture_backend_synthetic && path != other.path)
+        return false;
+
+    return device_uid == other.device_uid &&
+        use_native_format == other.use_native_format &&
+        (use_native_format || format == other.format) &&
+        use_native_interleaving == other.use_native_interleaving &&
+        (use_native_interleaving || interleaved == other.interleaved) &&
+        latency_ms == other.latency_ms &&
+        buffer_count == other.buffer_count &&
+        adaptive == other.adaptive;
+}
+
+capture_backend_stats capture_backend::stats() const
+{
+    capture_backend_stats res;
+    memset(&res, 0, sizeof(res));
+    return res;
+}
+
+const char *capture_backend_name(capture_backend_kind kind)
+{
+    switch (kind) {
+        case capture_backend_audio_queue: return "audioqueue";
+        case capture_backend_hal: return "hal";
+        case capture_backend_synthetic: return "synthetic";
+        default: return "unknown";
+    }
+}
+
+bool parse_capture_backend(const char *str, capture_backend_kind &kind)
+{
+    if (strcmp(str, "audioqueue") == 0)
+        kind = capture_backend_audio_queue;
+    else if (strcmp(str, "hal") == 0)
+        kind = capture_backend_hal;
+    else if (strcmp(str, "synthetic") == 0)
+        kind = capture_backend_synthetic;
+    else
+        return false;
+    return true;
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,125 @@
+#ifndef p1_mac_plugins_capture_backend_h
+#define p1_mac_plugins_capture_backend_h
+
+#include "histogram.h"
+#include "sample_convert.h"
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Capture backends feed an `audio_session` with raw device buffers.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+
+// Available capture backends.
+enum capture_backend_kind {
+    // Audio Queue Services. Robust, but adds a buffer of latency.
+    capture_backend_audio_queue,
+    // AUHAL input unit, directly on the HAL IO cycle.
+    capture_backend_hal,
+    // Generated tone or a recording, paced in realtime. Needs no hardware.
+    capture_backend_synthetic
+};
+
+// Capture options, as far as the backend is concerned.
+struct capture_backend_config {
+    capture_backend_kind kind;
+    std::string device_uid;
+    sample_format format;
+    bool use_native_format;
+    bool interleaved;
+    bool use_native_interleaving;
+    double latency_ms;
+    uint32_t buffer_count;
+    bool adaptive;
+
+    // Synthetic backend only. A capture file to loop, or empty for a tone.
+    std::string path;
+
+    // Whether two configs capture the same thing.
+    bool same_capture(const capture_backend_config &other) const;
+};
+
+// Format of raw buffers a backend delivers. Non-interleaved buffers hold
+// channel planes one after another.
+struct capture_format {
+    sample_format format;
+    bool interleaved;
+    uint32_t channels;
+    double rate;
+
+    // Largest buffer that will be delivered, in frames.
+    size_t max_frames;
+
+    size_t bytes_per_frame() const { return channels * sample_format_size(format); }
+};
+
+// Backend counters, for stats. Zero or null if not applicable.
+struct capture_backend_stats {
+    double latency_ms;
+    uint32_t buffer_count;
+    uint32_t resizes;
+    const log_histogram *enqueue_delay;
+};
+
+enum capture_log_level {
+    capture_log_error,
+    capture_log_warn,
+    capture_log_info
+};
+
+// Receives buffers and state changes from a backend.
+class capture_backend_client {
+public:
+    virtual ~capture_backend_client() {}
+
+    // On the capture thread, which may be realtime. Host time and sample
+    // time are of the first frame, sample time is negative if unknown.
+    virtual void capture_buffer(const void *data, size_t frames,
+        uint64_t host_time, double sample_time) = 0;
+
+    // Any thread. Not realtime safe, but only called on state changes.
+    virtual void capture_running(bool running) = 0;
+
+    // Any thread but a realtime capture thread.
+    virtual void capture_log(capture_log_level level, const char *format, ...) = 0;
+};
+
+// A source of raw capture buffers. The session does all processing, so a
+// backend only delivers buffers in a format it reports up front. Lifecycle
+// is `open`, `start`, then `close`, after which the client is no longer
+// called.
+class capture_backend {
+public:
+    virtual ~capture_backend() {}
+
+    // Open a device and determine the capture format. Returns false after
+    // logging errors to the client.
+    virtual bool open(const capture_backend_config &config, capture_backend_client &client) = 0;
+    virtual bool start() = 0;
+    virtual void close() = 0;
+
+    const capture_format &format() const { return fmt; }
+
+    // Housekeeping outside the capture thread, after buffers were
+    // delivered. May log to the client.
+    virtual void maintain() {}
+
+    virtual capture_backend_stats stats() const;
+
+protected:
+    capture_format fmt;
+};
+
+// Name as used in options, and the reverse.
+const char *capture_backend_name(capture_backend_kind kind);
+bool parse_capture_backend(const char *str, capture_backend_kind &kind);
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_capture_backend_h
@@ -0,0 +1,269 @@
+#include "capture_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace p1_mac_plugins {
+
+static const char capture_file_magic[4] = { 'P', '1', 'A', 'C' };
+
+// The file grows by at least this much at a time.
+static const size_t min_grow_size = 4 * 1024 * 1024;
+
+static size_t record_size(uint32_t data_size)
+{
+    return (sizeof(capture_record_header) + data_size + 7) & ~(size_t) 7;
+}
+
+
+capture_file_writer::capture_file_writer() :
+    fd(-1), map(nullptr), map_size(0), used(0), pending(0)
+{
+}
+
+capture_file_writer::~capture_file_writer()
+{
+    close();
+}
+
+bool capture_file_writer::open(const char *path, const capture_file_header &hdr)
+{
+    close();
+
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        return false;
+
+    used = 0;
+    if (!reserve(sizeof(hdr))) {
+        int err = errno;
+        close();
+        errno = err;
+        return false;
+    }
+
+    auto &out = *(capture_file_header *) map;
+    out = hdr;
+    memcpy(out.magic, capture_file_magic, sizeof(out.magic));
+    out.version = capture_file_header::current_version;
+    out.data_size = 0;
+    used = sizeof(hdr);
+    return true;
+}
+
+void capture_file_writer::close()
+{
+    if (map != nullptr) {
+        munmap(map, map_size);
+        map = nullptr;
+    }
+
+    // Trim growth slack.
+    if (fd != -1) {
+        if (used != 0)
+            ftruncate(fd, used);
+        ::close(fd);
+        fd = -1;
+    }
+
+    map_size = used = pending = 0;
+}
+
+bool capture_file_writer::reserve(size_t size)
+{
+    if (used + size <= map_size)
+        return true;
+
+    size_t next_size = std::max(map_size * 2, used + size + min_grow_size);
+    if (ftruncate(fd, next_size) != 0)
+        return false;
+
+    // Remap in full. Not all platforms have `mremap`.
+    auto *next = mmap(nullptr, next_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (next == MAP_FAILED)
+        return false;
+
+    if (map != nullptr)
+        munmap(map, map_size);
+    map = (char *) next;
+    map_size = next_size;
+    return true;
+}
+
+void *capture_file_writer::begin_record(uint64_t time_ns, uint32_t frames, uint32_t size)
+{
+    pending = record_size(size);
+    if (!reserve(pending)) {
+        pending = 0;
+        return nullptr;
+    }
+
+    auto *rec = (capture_record_header *) (map + used);
+    rec->time_ns = time_ns;
+    rec->frames = frames;
+    rec->size = size;
+    return rec + 1;
+}
+
+void capture_file_writer::commit_record()
+{
+    used += pending;
+    pending = 0;
+    ((capture_file_header *) map)->data_size = data_size();
+}
+
+bool capture_file_writer::append(uint64_t time_ns, uint32_t frames,
+    const void *data, uint32_t size)
+{
+    auto *dst = begin_record(time_ns, frames, size);
+    if (dst == nullptr)
+        return false;
+
+    memcpy(dst, data, size);
+    commit_record();
+    return true;
+}
+
+
+capture_file_reader::capture_file_reader() :
+    fd(-1), map(nullptr), map_size(0), pos(0), end(0)
+{
+}
+
+capture_file_reader::~capture_file_reader()
+{
+    close();
+}
+
+bool capture_file_reader::open(const char *path)
+{
+    close();
+
+    fd = ::open(path, O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close();
+        errno = err;
+        return false;
+    }
+
+    map_size = (size_t) st.st_size;
+    if (map_size < sizeof(capture_file_header)) {
+        close();
+        errno = EINVAL;
+        return false;
+    }
+
+    auto *ptr = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        int err = errno;
+        close();
+        errno = err;
+        return false;
+    }
+    map = (const char *) ptr;
+
+    auto &hdr = header();
+    if (memcmp(hdr.magic, capture_file_magic, sizeof(hdr.magic)) != 0 ||
+        hdr.version != capture_file_header::current_version) {
+        close();
+        errno = EINVAL;
+        return false;
+    }
+
+    end = sizeof(capture_file_header) + std::min(
+        (size_t) hdr.data_size, map_size - sizeof(capture_file_header));
+    rewind();
+    return true;
+}
+
+void capture_file_reader::close()
+{
+    if (map != nullptr) {
+        munmap((void *) map, map_size);
+        map = nullptr;
+    }
+
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+
+    map_size = pos = end = 0;
+}
+
+bool capture_file_reader::next(capture_record_header &rec, const void *&data)
+{
+    if (end - pos < sizeof(rec))
+        return false;
+
+    memcpy(&rec, map + pos, sizeof(rec));
+    auto size = record_size(rec.size);
+    if (end - pos < size)
+        return false;
+
+    data = map + pos + sizeof(rec);
+    pos += size;
+    return true;
+}
+
+void capture_file_reader::rewind()
+{
+    pos = sizeof(capture_file_header);
+}
+
+
+capture_recorder::capture_recorder(size_t byte_capacity, size_t record_capacity) :
+    bytes(byte_capacity), records(record_capacity), drops(0)
+{
+}
+
+bool capture_recorder::push(uint64_t time_ns, uint32_t frames,
+    const void *data, uint32_t size)
+{
+    // Publish the header after the data, see `audio_ring`.
+    if (records.write_available() < 1 || !bytes.write((const char *) data, size)) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    capture_record_header rec = { time_ns, frames, size };
+    records.push(rec);
+    return true;
+}
+
+ssize_t capture_recorder::flush(capture_file_writer &writer)
+{
+    ssize_t num = 0;
+    capture_record_header rec;
+    while (records.pop(rec)) {
+        auto *dst = writer.begin_record(rec.time_ns, rec.frames, rec.size);
+        if (dst == nullptr) {
+            int err = errno;
+            bytes.skip(rec.size);
+            errno = err;
+            return -1;
+        }
+
+        bytes.read((char *) dst, rec.size);
+        writer.commit_record();
+        num++;
+    }
+    return num;
+}
+
+uint32_t capture_recorder::take_drops()
+{
+    return drops.exchange(0, std::memory_order_relaxed);
+}
+
+
+}  // namespace p1_mac_plugins
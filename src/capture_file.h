@@ -0,0 +1,125 @@
+#ifndef p1_mac_plugins_capture_file_h
+#define p1_mac_plugins_capture_file_h
+
+#include "spsc_ring.h"
+
+#include <sys/types.h>
+
+namespace p1_mac_plugins {
+
+
+// Recordings of raw audio capture, for replaying the exact input of a
+// session. A file is a header followed by records, each a record header and
+// the captured buffer, padded to 8 bytes. Fields are native-endian, times
+// are host time in nanoseconds.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+struct capture_file_header {
+    static const uint32_t current_version = 1;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t channels;
+    uint32_t interleaved;
+    uint32_t reserved;
+    double sample_rate;
+
+    // Size of all complete records. Updated after every append, so a file
+    // left behind by a crash is still readable up to the last record.
+    uint64_t data_size;
+};
+
+struct capture_record_header {
+    uint64_t time_ns;
+    uint32_t frames;
+    uint32_t size;
+};
+
+// Append-only writer. The file is grown and mapped in large steps, so
+// appends are mostly a copy. Not for use on a realtime thread, because
+// growing the file may block; see `capture_recorder`.
+class capture_file_writer {
+public:
+    capture_file_writer();
+    ~capture_file_writer();
+
+    // Create or truncate a file. Returns false with `errno` set on failure.
+    bool open(const char *path, const capture_file_header &hdr);
+    void close();
+    bool is_open() const { return fd != -1; }
+
+    // Reserve a record, and return where to write its `size` bytes of data.
+    // The record becomes part of the file on `commit`. Returns nullptr with
+    // `errno` set if the file could not be grown.
+    void *begin_record(uint64_t time_ns, uint32_t frames, uint32_t size);
+    void commit_record();
+
+    bool append(uint64_t time_ns, uint32_t frames, const void *data, uint32_t size);
+
+    uint64_t data_size() const { return used - sizeof(capture_file_header); }
+
+private:
+    int fd;
+    char *map;
+    size_t map_size;
+    size_t used;
+    size_t pending;
+
+    bool reserve(size_t size);
+};
+
+// Reads records of a file mapped in its entirety.
+class capture_file_reader {
+public:
+    capture_file_reader();
+    ~capture_file_reader();
+
+    // Returns false with `errno` set on failure, or `EINVAL` if this is not a
+    // capture file we understand.
+    bool open(const char *path);
+    void close();
+    bool is_open() const { return map != nullptr; }
+
+    const capture_file_header &header() const { return *(const capture_file_header *) map; }
+
+    // Iterate records. Data points into the mapping, and stays valid until
+    // the reader is closed.
+    bool next(capture_record_header &rec, const void *&data);
+    void rewind();
+
+private:
+    int fd;
+    const char *map;
+    size_t map_size;
+    size_t pos;
+    size_t end;
+};
+
+// Hands captured buffers from a realtime callback to another thread, which
+// writes them to a capture file. Buffers that don't fit are dropped and
+// counted, the producer never blocks.
+class capture_recorder {
+public:
+    capture_recorder(size_t byte_capacity, size_t record_capacity);
+
+    // Producer side.
+    bool push(uint64_t time_ns, uint32_t frames, const void *data, uint32_t size);
+
+    // Consumer side. Writes all queued buffers, returns the number written.
+    // Returns -1 with `errno` set if the file could not be written.
+    ssize_t flush(capture_file_writer &writer);
+
+    // Consumer side. Returns and resets the number of dropped buffers.
+    uint32_t take_drops();
+
+private:
+    spsc_ring<char> bytes;
+    spsc_ring<capture_record_header> records;
+    std::atomic<uint32_t> drops;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_capture_file_h
@@ -0,0 +1,114 @@
+#include "capture_pipeline.h"
+#include "host_time.h"
+
+#include <algorithm>
+
+namespace p1_mac_plugins {
+
+
+// Length of concealment fades.
+static const double fade_ms = 2.0;
+
+
+capture_pipeline::capture_pipeline() :
+    channels(0), in_rate(0), max_capture_frames(0), max_out_frames(0),
+    resampling(false), drift_compensation(false)
+{
+}
+
+void capture_pipeline::configure(sample_format fmt, bool interleaved,
+    uint32_t channels_, double capture_rate_, double mixer_rate,
+    bool drift_compensation_, size_t max_capture_frames_, conceal_mode conceal)
+{
+    channels = channels_;
+    in_rate = capture_rate_;
+    max_capture_frames = max_capture_frames_;
+    drift_compensation = drift_compensation_;
+
+    converter.configure(fmt, interleaved, channels, max_capture_frames);
+    convert_scratch.reset(new float[max_capture_frames * channels]);
+
+    // Conceal holes of up to a buffer, with fades of about 2 ms.
+    auto fade_frames = std::max((size_t) 1, (size_t) (in_rate * fade_ms / 1000));
+    guard.configure(channels, max_capture_frames, max_capture_frames, fade_frames, conceal);
+    auto max_guard_frames = guard.max_output_frames();
+
+    // Resample if rates differ, or to follow the capture clock. Output per
+    // buffer may exceed the input-equivalent by the drift margin.
+    resampling = drift_compensation || in_rate != mixer_rate;
+    if (resampling) {
+        resample.configure(channels, in_rate, mixer_rate, max_guard_frames);
+        drift.configure(in_rate);
+        max_out_frames = resample.max_output_frames(max_guard_frames);
+        resample_scratch.reset(new float[max_out_frames * channels]);
+    }
+    else {
+        max_out_frames = max_guard_frames;
+        resample_scratch.reset();
+    }
+}
+
+void capture_pipeline::reset()
+{
+    guard.reset();
+    if (resampling) {
+        resample.reset();
+        drift.reset();
+    }
+}
+
+size_t capture_pipeline::process(const void *in, size_t frames,
+    double sample_time, uint64_t &time, const float *&out)
+{
+    if (frames > max_capture_frames)
+        frames = max_capture_frames;
+
+    const float *samples;
+    if (converter.is_passthrough()) {
+        samples = (const float *) in;
+    }
+    else {
+        auto *scratch = convert_scratch.get();
+        converter.convert(in, scratch, frames);
+        samples = scratch;
+    }
+
+    // Keep the timeline contiguous. Output may start before or after the
+    // input buffer.
+    int64_t offset;
+    frames = guard.process(samples, frames, sample_time, samples, offset);
+    if (offset != 0) {
+        auto offset_ns = (int64_t) (offset * 1e9 / in_rate);
+        time = ns_to_host_time((uint64_t) ((int64_t) host_time_to_ns(time) + offset_ns));
+    }
+    if (frames == 0) {
+        out = samples;
+        return 0;
+    }
+
+    if (resampling) {
+        // Measure capture clock drift against host time, and adjust the
+        // resampler ratio to match. Discontinuities restart the estimate.
+        auto host_ns = host_time_to_ns(time);
+        if (guard.resynced())
+            drift.reset();
+        if (drift_compensation) {
+            drift.update(host_ns, frames);
+            resample.set_correction(drift.ratio());
+        }
+
+        auto *scratch = resample_scratch.get();
+        frames = resample.process(samples, frames, scratch, max_out_frames);
+        samples = scratch;
+
+        // Timestamp by where the first output frame falls in the input.
+        double offset_ns = resample.last_output_position() * 1e9 / drift.rate();
+        time = ns_to_host_time((uint64_t) (host_ns + offset_ns));
+    }
+
+    out = samples;
+    return frames;
+}
+
+
+}  // namespace p1_mac_plugins
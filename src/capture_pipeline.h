@@ -0,0 +1,63 @@
+#ifndef p1_mac_plugins_capture_pipeline_h
+#define p1_mac_plugins_capture_pipeline_h
+
+#include "sample_convert.h"
+#include "resampler.h"
+#include "continuity_guard.h"
+
+namespace p1_mac_plugins {
+
+
+// Turns raw capture buffers into interleaved float at the mixer rate:
+// sample conversion, concealment of holes and overlaps in the capture
+// timeline, then resampling that follows drift of the capture clock against
+// host time. Shared by live capture and replay of recordings.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class capture_pipeline {
+public:
+    capture_pipeline();
+
+    void configure(sample_format fmt, bool interleaved, uint32_t channels_,
+        double capture_rate_, double mixer_rate, bool drift_compensation_,
+        size_t max_capture_frames_, conceal_mode conceal = conceal_crossfade);
+    void reset();
+
+    size_t bytes_per_frame() const { return converter.bytes_per_frame(); }
+    double capture_rate() const { return in_rate; }
+
+    // Upper bound on mixer frames produced from one capture buffer.
+    size_t max_output_frames() const { return max_out_frames; }
+
+    // Discontinuity counters.
+    const continuity_guard &continuity() const { return guard; }
+
+    // Process `frames` capture frames starting at host time `time`, and at
+    // `sample_time` on the capture clock, or negative if unknown. Returns
+    // mixer frames, points `out` at them and adjusts `time` to the first
+    // output frame. Output is valid until the next call.
+    size_t process(const void *in, size_t frames, double sample_time,
+        uint64_t &time, const float *&out);
+
+private:
+    uint32_t channels;
+    double in_rate;
+    size_t max_capture_frames;
+    size_t max_out_frames;
+
+    sample_converter converter;
+    std::unique_ptr<float[]> convert_scratch;
+
+    continuity_guard guard;
+
+    bool resampling;
+    bool drift_compensation;
+    resampler resample;
+    drift_estimator drift;
+    std::unique_ptr<float[]> resample_scratch;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_capture_pipeline_h
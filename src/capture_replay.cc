@@ -0,0 +1,149 @@
+#include "capture_replay.h"
+#include "host_time.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+namespace p1_mac_plugins {
+
+
+capture_replay::capture_replay() :
+    stopping(false)
+{
+}
+
+capture_replay::~capture_replay()
+{
+    close();
+}
+
+bool capture_replay::open(const char *path, double mixer_rate,
+    bool drift_compensation)
+{
+    close();
+
+    if (!reader.open(path))
+        return false;
+
+    auto &hdr = reader.header();
+    if (hdr.format > sample_format_float32 || hdr.channels == 0 ||
+        !(hdr.sample_rate > 0)) {
+        reader.close();
+        errno = EINVAL;
+        return false;
+    }
+
+    // Size the pipeline for the largest buffer in the recording.
+    size_t max_frames = 1;
+    capture_record_header rec;
+    const void *data;
+    while (reader.next(rec, data))
+        max_frames = std::max(max_frames, (size_t) rec.frames);
+    reader.rewind();
+
+    pipeline.configure((sample_format) hdr.format, hdr.interleaved != 0,
+        hdr.channels, hdr.sample_rate, mixer_rate, drift_compensation, max_frames);
+    return true;
+}
+
+void capture_replay::close()
+{
+    stop();
+    reader.close();
+}
+
+void capture_replay::start(bool realtime, bool loop, output_fn output, end_fn on_end)
+{
+    stop();
+    stopping = false;
+
+    thread = std::thread([=] {
+        uint64_t base_ns = host_time_to_ns(host_time_now());
+        uint64_t end_ns;
+        do {
+            pipeline.reset();
+            if (!replay_pass(output, realtime, base_ns, end_ns))
+                return;
+            base_ns = end_ns;
+        } while (loop);
+
+        if (on_end)
+            on_end();
+    });
+}
+
+void capture_replay::stop()
+{
+    if (!thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+    thread.join();
+}
+
+size_t capture_replay::run(const output_fn &output)
+{
+    size_t num = 0;
+    uint64_t end_ns;
+    pipeline.reset();
+    replay_pass([&](uint64_t time, const float *in, size_t samples) {
+        output(time, in, samples);
+        num++;
+    }, false, host_time_to_ns(host_time_now()), end_ns);
+    return num;
+}
+
+// Replay all records with times rebased so the first falls on `base_ns`.
+// Sets `end_ns` to the rebased time just after the last record.
+bool capture_replay::replay_pass(const output_fn &output, bool realtime,
+    uint64_t base_ns, uint64_t &end_ns)
+{
+    auto &hdr = reader.header();
+    bool first = true;
+    uint64_t first_ns = 0;
+    capture_record_header rec;
+    const void *data;
+
+    end_ns = base_ns;
+    reader.rewind();
+    while (reader.next(rec, data)) {
+        if (first) {
+            first = false;
+            first_ns = rec.time_ns;
+        }
+
+        uint64_t time_ns = base_ns + (rec.time_ns - first_ns);
+        end_ns = time_ns + (uint64_t) (rec.frames * 1e9 / hdr.sample_rate);
+
+        // A capture buffer is delivered once it has been fully recorded.
+        if (realtime) {
+            auto now_ns = host_time_to_ns(host_time_now());
+            std::unique_lock<std::mutex> lock(mutex);
+            if (end_ns > now_ns)
+                cond.wait_for(lock, std::chrono::nanoseconds(end_ns - now_ns),
+                    [&] { return stopping.load(); });
+            if (stopping.load())
+                return false;
+        }
+        else if (stopping.load()) {
+            return false;
+        }
+
+        uint64_t time = ns_to_host_time(time_ns);
+        const float *out;
+        // Recordings carry no sample times, so continuity isn't checked.
+        auto frames = pipeline.process(data, rec.frames, -1, time, out);
+        if (frames != 0)
+            output(time, out, frames * hdr.channels);
+    }
+
+    return true;
+}
+
+
+}  // namespace p1_mac_plugins
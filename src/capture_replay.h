@@ -0,0 +1,68 @@
+#ifndef p1_mac_plugins_capture_replay_h
+#define p1_mac_plugins_capture_replay_h
+
+#include "capture_file.h"
+#include "capture_pipeline.h"
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace p1_mac_plugins {
+
+
+// Plays back a capture file through the capture pipeline, on a thread of
+// its own. Buffers are either paced by their recorded times, or delivered
+// as fast as the output function accepts them, for benchmarks.
+//
+// Output is timestamped by recorded time, rebased to host time at start, so
+// timing behavior of the recording is reproduced exactly in both modes.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class capture_replay {
+public:
+    // Receives interleaved float at the mixer rate, `samples` in total, in the
+    // channel layout of the recording.
+    typedef std::function<void(uint64_t time, const float *in, size_t samples)> output_fn;
+
+    // Called on the replay thread once the file ends, unless looping.
+    typedef std::function<void()> end_fn;
+
+    capture_replay();
+    ~capture_replay();
+
+    // Open a recording, and prepare conversion to the mixer format. Returns
+    // false with `errno` set on failure, see `capture_file_reader`.
+    bool open(const char *path, double mixer_rate, bool drift_compensation);
+    void close();
+
+    const capture_file_header &header() const { return reader.header(); }
+    uint32_t channels() const { return reader.header().channels; }
+    size_t max_output_frames() const { return pipeline.max_output_frames(); }
+
+    void start(bool realtime, bool loop, output_fn output, end_fn on_end);
+    void stop();
+
+    // Deliver the whole file once on the calling thread, as fast as possible.
+    // Returns the number of buffers delivered.
+    size_t run(const output_fn &output);
+
+private:
+    capture_file_reader reader;
+    capture_pipeline pipeline;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> stopping;
+
+    // Replays one pass of the file. Returns false if stopped.
+    bool replay_pass(const output_fn &output, bool realtime,
+        uint64_t base_ns, uint64_t &end_ns);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_capture_replay_h
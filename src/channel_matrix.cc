@@ -0,0 +1,278 @@
+#include "channel_matrix.h"
+#include "cpu_features.h"
+
+#include <cstring>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+
+// Scalar kernels. Also used for tails of the SIMD kernels.
+
+static void mix_scalar(const float *in, float *out, size_t frames,
+    uint32_t in_ch, uint32_t out_ch, const float *rows, uint32_t stride)
+{
+    for (size_t f = 0; f < frames; f++) {
+        const float *x = in + f * in_ch;
+        for (uint32_t o = 0; o < out_ch; o++) {
+            const float *g = rows + o * stride;
+            float acc = 0;
+            for (uint32_t i = 0; i < in_ch; i++)
+                acc += x[i] * g[i];
+            out[f * out_ch + o] = acc;
+        }
+    }
+}
+
+static void select_scalar(const float *in, float *out, size_t frames,
+    uint32_t in_ch, uint32_t out_ch, const int32_t *map)
+{
+    for (size_t f = 0; f < frames; f++) {
+        const float *x = in + f * in_ch;
+        for (uint32_t o = 0; o < out_ch; o++)
+            out[f * out_ch + o] = map[o] < 0 ? 0.0f : x[map[o]];
+    }
+}
+
+// The vector mix kernels take a dot product of each frame with each row.
+// Rows are zero padded to the vector width, so loads may run past the end
+// of a frame into the next. Only the last few frames, where that would read
+// past the buffer, are left to the scalar kernel.
+static size_t vector_frames(size_t frames, uint32_t in_ch, uint32_t stride)
+{
+    size_t total = frames * in_ch;
+    return total < stride ? 0 : (total - stride) / in_ch + 1;
+}
+
+#if P1_HAVE_X86_SIMD
+
+static inline float hsum_sse2(__m128 v)
+{
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+static void mix_sse2(const float *in, float *out, size_t frames,
+    uint32_t in_ch, uint32_t out_ch, const float *rows, uint32_t stride)
+{
+    size_t n = vector_frames(frames, in_ch, stride);
+    for (size_t f = 0; f < n; f++) {
+        const float *x = in + f * in_ch;
+        for (uint32_t o = 0; o < out_ch; o++) {
+            const float *g = rows + o * stride;
+            __m128 acc = _mm_setzero_ps();
+            for (uint32_t i = 0; i < stride; i += 4)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_load_ps(g + i)));
+            out[f * out_ch + o] = hsum_sse2(acc);
+        }
+    }
+    mix_scalar(in + n * in_ch, out + n * out_ch, frames - n, in_ch, out_ch, rows, stride);
+}
+
+P1_TARGET_AVX2
+static void mix_avx2(const float *in, float *out, size_t frames,
+    uint32_t in_ch, uint32_t out_ch, const float *rows, uint32_t stride)
+{
+    size_t n = vector_frames(frames, in_ch, stride);
+    for (size_t f = 0; f < n; f++) {
+        const float *x = in + f * in_ch;
+        for (uint32_t o = 0; o < out_ch; o++) {
+            const float *g = rows + o * stride;
+            __m256 acc = _mm256_setzero_ps();
+            for (uint32_t i = 0; i < stride; i += 8)
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(x + i), _mm256_load_ps(g + i)));
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+            out[f * out_ch + o] = hsum_sse2(s);
+        }
+    }
+    mix_scalar(in + n * in_ch, out + n * out_ch, frames - n, in_ch, out_ch, rows, stride);
+}
+
+// Gathers whole output vectors at once. Needs the output channel count to
+// divide the vector width, so each vector holds whole frames.
+P1_TARGET_AVX2
+static void select_avx2(const float *in, float *out, size_t frames,
+    uint32_t in_ch, uint32_t out_ch, const int32_t *map)
+{
+    if (8 % out_ch != 0)
+        return select_scalar(in, out, frames, in_ch, out_ch, map);
+
+    uint32_t per_vector = 8 / out_ch;
+    alignas(32) int32_t idx[8];
+    alignas(32) int32_t mask[8];
+    for (uint32_t k = 0; k < 8; k++) {
+        int32_t m = map[k % out_ch];
+        idx[k] = m < 0 ? 0 : (int32_t) ((k / out_ch) * in_ch) + m;
+        mask[k] = m < 0 ? 0 : -1;
+    }
+    __m256i vidx = _mm256_load_si256((const __m256i *) idx);
+    __m256 vmask = _mm256_castsi256_ps(_mm256_load_si256((const __m256i *) mask));
+
+    size_t f = 0;
+    for (; f + per_vector <= frames; f += per_vector) {
+        __m256 v = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), in + f * in_ch, vidx, vmask, 4);
+        _mm256_storeu_ps(out + f * out_ch, v);
+    }
+    select_scalar(in + f * in_ch, out + f * out_ch, frames - f, in_ch, out_ch, map);
+}
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+static void mix_neon(const float *in, float *out, size_t frames,
+    uint32_t in_ch, uint32_t out_ch, const float *rows, uint32_t stride)
+{
+    size_t n = vector_frames(frames, in_ch, stride);
+    for (size_t f = 0; f < n; f++) {
+        const float *x = in + f * in_ch;
+        for (uint32_t o = 0; o < out_ch; o++) {
+            const float *g = rows + o * stride;
+            float32x4_t acc = vdupq_n_f32(0);
+            for (uint32_t i = 0; i < stride; i += 4)
+                acc = vmlaq_f32(acc, vld1q_f32(x + i), vld1q_f32(g + i));
+            float32x2_t r = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+            out[f * out_ch + o] = vget_lane_f32(vpadd_f32(r, r), 0);
+        }
+    }
+    mix_scalar(in + n * in_ch, out + n * out_ch, frames - n, in_ch, out_ch, rows, stride);
+}
+
+#endif  // P1_HAVE_NEON
+
+
+channel_matrix::channel_matrix() :
+    in_ch(0), out_ch(0), identity(true), selecting(true),
+    mix(mix_scalar), select(select_scalar), stride(0), row_data(nullptr)
+{
+}
+
+void channel_matrix::configure(uint32_t in_channels_, uint32_t out_channels_,
+    const float *gains)
+{
+    // Recognize matrices that only pick channels.
+    int32_t picks[max_channels];
+    bool pick_only = true;
+    for (uint32_t o = 0; o < out_channels_ && pick_only; o++) {
+        picks[o] = -1;
+        for (uint32_t i = 0; i < in_channels_; i++) {
+            float g = gains[o * in_channels_ + i];
+            if (g == 0.0f)
+                continue;
+            if (g != 1.0f || picks[o] != -1) {
+                pick_only = false;
+                break;
+            }
+            picks[o] = (int32_t) i;
+        }
+    }
+    if (pick_only)
+        return set_map(in_channels_, out_channels_, picks);
+
+    in_ch = in_channels_;
+    out_ch = out_channels_;
+    identity = false;
+    selecting = false;
+
+    // Use the widest kernel that doesn't mostly multiply padding.
+    auto &cpu = get_cpu_features();
+    uint32_t width = 1;
+    mix = mix_scalar;
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2 && in_ch >= 8) {
+        mix = mix_avx2;
+        width = 8;
+    }
+    else if (cpu.sse2 && in_ch >= 4) {
+        mix = mix_sse2;
+        width = 4;
+    }
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon && in_ch >= 4) {
+        mix = mix_neon;
+        width = 4;
+    }
+#endif
+    (void) cpu;
+
+    // Over-allocate to align rows to 32 bytes.
+    stride = (in_ch + width - 1) / width * width;
+    rows.reset(new float[out_ch * stride + 8]);
+    float *aligned = (float *) (((uintptr_t) rows.get() + 31) & ~(uintptr_t) 31);
+    memset(aligned, 0, out_ch * stride * sizeof(float));
+    for (uint32_t o = 0; o < out_ch; o++)
+        memcpy(aligned + o * stride, gains + o * in_ch, in_ch * sizeof(float));
+    row_data = aligned;
+}
+
+void channel_matrix::configure_map(uint32_t in_channels_, uint32_t out_channels_,
+    const int32_t *map_)
+{
+    set_map(in_channels_, out_channels_, map_);
+}
+
+void channel_matrix::configure_default(uint32_t in_channels_, uint32_t out_channels_)
+{
+    int32_t picks[max_channels];
+    for (uint32_t o = 0; o < out_channels_; o++) {
+        if (in_channels_ == 1)
+            picks[o] = 0;
+        else
+            picks[o] = o < in_channels_ ? (int32_t) o : -1;
+    }
+    set_map(in_channels_, out_channels_, picks);
+}
+
+void channel_matrix::set_map(uint32_t in_channels_, uint32_t out_channels_,
+    const int32_t *map_)
+{
+    in_ch = in_channels_;
+    out_ch = out_channels_;
+    selecting = true;
+    rows.reset();
+
+    identity = in_ch == out_ch;
+    for (uint32_t o = 0; o < out_ch; o++) {
+        map[o] = map_[o] < (int32_t) in_ch ? map_[o] : -1;
+        if (map[o] != (int32_t) o)
+            identity = false;
+    }
+
+    select = select_scalar;
+#if P1_HAVE_X86_SIMD
+    if (get_cpu_features().avx2)
+        select = select_avx2;
+#endif
+}
+
+bool channel_matrix::equals(const channel_matrix &other) const
+{
+    if (in_ch != other.in_ch || out_ch != other.out_ch || selecting != other.selecting)
+        return false;
+    if (selecting)
+        return memcmp(map, other.map, out_ch * sizeof(int32_t)) == 0;
+    return stride == other.stride &&
+        memcmp(row_data, other.row_data, out_ch * stride * sizeof(float)) == 0;
+}
+
+void channel_matrix::process(const float *in, float *out, size_t frames) const
+{
+    if (identity)
+        memcpy(out, in, frames * in_ch * sizeof(float));
+    else if (selecting)
+        select(in, out, frames, in_ch, out_ch, map);
+    else
+        mix(in, out, frames, in_ch, out_ch, row_data, stride);
+}
+
+
+}  // namespace p1_mac_plugins
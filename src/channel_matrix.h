@@ -0,0 +1,70 @@
+#ifndef p1_mac_plugins_channel_matrix_h
+#define p1_mac_plugins_channel_matrix_h
+
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Mixes interleaved float frames of one channel count to another, through a
+// gain matrix. This covers picking, reordering, downmixing and upmixing.
+// Matrices that only pick channels skip the multiplies.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class channel_matrix {
+public:
+    static const uint32_t max_channels = 64;
+
+    channel_matrix();
+
+    // `gains` holds `out_channels` rows of `in_channels` gains each.
+    void configure(uint32_t in_channels_, uint32_t out_channels_, const float *gains);
+
+    // Input channel `map[o]` goes to output `o`. Negative entries are silent.
+    void configure_map(uint32_t in_channels_, uint32_t out_channels_, const int32_t *map);
+
+    // The first input channels in order, and a mono input on all outputs.
+    void configure_default(uint32_t in_channels_, uint32_t out_channels_);
+
+    uint32_t in_channels() const { return in_ch; }
+    uint32_t out_channels() const { return out_ch; }
+
+    // True if output equals input, and `process` may be skipped.
+    bool is_identity() const { return identity; }
+
+    // True if both produce the same output from the same input.
+    bool equals(const channel_matrix &other) const;
+
+    // Mix `frames` frames from `in` to `out`, which may not overlap.
+    void process(const float *in, float *out, size_t frames) const;
+
+    // Kernels, exposed for benchmarks.
+    typedef void (*mix_fn)(const float *in, float *out, size_t frames,
+        uint32_t in_ch, uint32_t out_ch, const float *rows, uint32_t stride);
+    typedef void (*select_fn)(const float *in, float *out, size_t frames,
+        uint32_t in_ch, uint32_t out_ch, const int32_t *map);
+
+private:
+    uint32_t in_ch;
+    uint32_t out_ch;
+    bool identity;
+
+    // Pure selection, if set. Otherwise rows of gains, zero padded to
+    // `stride`, the vector width multiple used by the mix kernel.
+    bool selecting;
+    int32_t map[max_channels];
+    mix_fn mix;
+    select_fn select;
+    uint32_t stride;
+    std::unique_ptr<float[]> rows;
+    const float *row_data;
+
+    void set_map(uint32_t in_channels_, uint32_t out_channels_, const int32_t *map_);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_channel_matrix_h
@@ -0,0 +1,817 @@
+#include "color_convert.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+// Rounding biases, with the offsets of 8-bit and 10-bit samples. Chroma is
+// computed from sums of 4 pixels, so has 2 more fractional bits.
+static inline int32_t y8_bias(const color_coeffs &c) { return (c.y_offset << 14) + (1 << 13); }
+static inline int32_t y10_bias(const color_coeffs &c) { return (c.y_offset << 14) + (1 << 11); }
+static const int32_t c8_bias = (128 << 16) + (1 << 15);
+static const int32_t c10_bias = (128 << 16) + (1 << 13);
+
+// Biases of the inverse, folding in the luma offset and chroma center.
+static inline int32_t r_bias(const color_coeffs &c)
+{
+    return -c.ky * c.y_offset - c.rv * 128 + (1 << 12);
+}
+static inline int32_t g_bias(const color_coeffs &c)
+{
+    return -c.ky * c.y_offset - (c.gu + c.gv) * 128 + (1 << 12);
+}
+static inline int32_t b_bias(const color_coeffs &c)
+{
+    return -c.ky * c.y_offset - c.bu * 128 + (1 << 12);
+}
+
+
+void compute_color_coeffs(color_matrix matrix, color_range range, color_coeffs &c)
+{
+    double kr, kb;
+    if (matrix == color_matrix_bt601) {
+        kr = 0.299;
+        kb = 0.114;
+    }
+    else {
+        kr = 0.2126;
+        kb = 0.0722;
+    }
+    double kg = 1 - kr - kb;
+
+    double ys = 1, cs = 1;
+    c.y_offset = 0;
+    if (range == color_range_limited) {
+        ys = 219.0 / 255;
+        cs = 224.0 / 255;
+        c.y_offset = 16;
+    }
+
+    // Rows of the forward matrix sum exactly to the luma scale and zero, so
+    // grays stay neutral.
+    const double f = 1 << 14;
+    c.yr = (int32_t) lround(kr * ys * f);
+    c.yb = (int32_t) lround(kb * ys * f);
+    c.yg = (int32_t) lround(ys * f) - c.yr - c.yb;
+    c.ur = (int32_t) lround(-kr / (2 * (1 - kb)) * cs * f);
+    c.ub = (int32_t) lround(0.5 * cs * f);
+    c.ug = -c.ur - c.ub;
+    c.vr = (int32_t) lround(0.5 * cs * f);
+    c.vb = (int32_t) lround(-kb / (2 * (1 - kr)) * cs * f);
+    c.vg = -c.vr - c.vb;
+
+    const double i = 1 << 13;
+    c.ky = (int32_t) lround(i / ys);
+    c.rv = (int32_t) lround(2 * (1 - kr) / cs * i);
+    c.gu = (int32_t) lround(-2 * kb * (1 - kb) / kg / cs * i);
+    c.gv = (int32_t) lround(-2 * kr * (1 - kr) / kg / cs * i);
+    c.bu = (int32_t) lround(2 * (1 - kb) / cs * i);
+}
+
+// Scalar kernels, the reference. Also used for tails of the SIMD kernels.
+
+static inline uint8_t clamp8(int32_t v)
+{
+    return (uint8_t) (v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+static inline uint16_t clamp10(int32_t v)
+{
+    return (uint16_t) (v < 0 ? 0 : v > 1023 ? 1023 : v);
+}
+
+static void bgra_to_y8_scalar(const uint8_t *src, uint8_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = y8_bias(c);
+    for (int32_t x = 0; x < width; x++) {
+        auto *p = src + x * 4;
+        y[x] = clamp8((c.yr * p[2] + c.yg * p[1] + c.yb * p[0] + bias) >> 14);
+    }
+}
+
+static void bgra_to_y16_scalar(const uint8_t *src, uint16_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = y10_bias(c);
+    for (int32_t x = 0; x < width; x++) {
+        auto *p = src + x * 4;
+        y[x] = (uint16_t) (clamp10((c.yr * p[2] + c.yg * p[1] + c.yb * p[0] + bias) >> 12) << 6);
+    }
+}
+
+// Sum a channel over 2x2 pixels, repeating the last column of odd widths.
+static inline int32_t sum4(const uint8_t *src0, const uint8_t *src1,
+    int32_t x0, int32_t x1, int ch)
+{
+    return src0[x0 * 4 + ch] + src0[x1 * 4 + ch] + src1[x0 * 4 + ch] + src1[x1 * 4 + ch];
+}
+
+static void bgra_to_uv8_scalar(const uint8_t *src0, const uint8_t *src1,
+    uint8_t *u, uint8_t *v, size_t step, int32_t width, const color_coeffs &c)
+{
+    for (int32_t x = 0; x < width; x += 2) {
+        auto x1 = std::min(x + 1, width - 1);
+        auto b = sum4(src0, src1, x, x1, 0);
+        auto g = sum4(src0, src1, x, x1, 1);
+        auto r = sum4(src0, src1, x, x1, 2);
+        auto i = (size_t) (x / 2) * step;
+        u[i] = clamp8((c.ur * r + c.ug * g + c.ub * b + c8_bias) >> 16);
+        v[i] = clamp8((c.vr * r + c.vg * g + c.vb * b + c8_bias) >> 16);
+    }
+}
+
+static void bgra_to_uv16_scalar(const uint8_t *src0, const uint8_t *src1,
+    uint16_t *u, uint16_t *v, size_t step, int32_t width, const color_coeffs &c)
+{
+    for (int32_t x = 0; x < width; x += 2) {
+        auto x1 = std::min(x + 1, width - 1);
+        auto b = sum4(src0, src1, x, x1, 0);
+        auto g = sum4(src0, src1, x, x1, 1);
+        auto r = sum4(src0, src1, x, x1, 2);
+        auto i = (size_t) (x / 2) * step;
+        u[i] = (uint16_t) (clamp10((c.ur * r + c.ug * g + c.ub * b + c10_bias) >> 14) << 6);
+        v[i] = (uint16_t) (clamp10((c.vr * r + c.vg * g + c.vb * b + c10_bias) >> 14) << 6);
+    }
+}
+
+static void yuv_to_bgra_scalar(const uint8_t *y, const uint8_t *u,
+    const uint8_t *v, size_t step, uint8_t *dst, int32_t width,
+    const color_coeffs &c)
+{
+    auto rb = r_bias(c), gb = g_bias(c), bb = b_bias(c);
+    for (int32_t x = 0; x < width; x++) {
+        auto i = (size_t) (x / 2) * step;
+        int32_t yt = c.ky * y[x];
+        int32_t cu = u[i], cv = v[i];
+        auto *p = dst + x * 4;
+        p[0] = clamp8((yt + c.bu * cu + bb) >> 13);
+        p[1] = clamp8((yt + c.gu * cu + c.gv * cv + gb) >> 13);
+        p[2] = clamp8((yt + c.rv * cv + rb) >> 13);
+        p[3] = 255;
+    }
+}
+
+static const color_kernels scalar_kernels = {
+    "scalar",
+    bgra_to_y8_scalar,
+    bgra_to_y16_scalar,
+    bgra_to_uv8_scalar,
+    bgra_to_uv16_scalar,
+    yuv_to_bgra_scalar
+};
+
+#if P1_HAVE_X86_SIMD
+
+// SSE2 kernels. Channels are held in 32-bit lanes below 2^15, so
+// `madd_epi16` with a coefficient in the low half of each lane multiplies
+// exactly. SSE2 is baseline on x86_64.
+
+static inline __m128i mul_sse2(__m128i x, int32_t c)
+{
+    return _mm_madd_epi16(x, _mm_set1_epi32(c));
+}
+
+// Luma of 4 pixels, unshifted.
+static inline __m128i luma_sse2(__m128i px, const color_coeffs &c)
+{
+    auto mask = _mm_set1_epi32(0xff);
+    auto b = _mm_and_si128(px, mask);
+    auto g = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+    auto r = _mm_and_si128(_mm_srli_epi32(px, 16), mask);
+    return _mm_add_epi32(_mm_add_epi32(mul_sse2(r, c.yr), mul_sse2(g, c.yg)), mul_sse2(b, c.yb));
+}
+
+static void bgra_to_y8_sse2(const uint8_t *src, uint8_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = _mm_set1_epi32(y8_bias(c));
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        auto *p = (const __m128i *) (src + x * 4);
+        auto y0 = _mm_srai_epi32(_mm_add_epi32(luma_sse2(_mm_loadu_si128(p), c), bias), 14);
+        auto y1 = _mm_srai_epi32(_mm_add_epi32(luma_sse2(_mm_loadu_si128(p + 1), c), bias), 14);
+        auto y2 = _mm_srai_epi32(_mm_add_epi32(luma_sse2(_mm_loadu_si128(p + 2), c), bias), 14);
+        auto y3 = _mm_srai_epi32(_mm_add_epi32(luma_sse2(_mm_loadu_si128(p + 3), c), bias), 14);
+        auto out = _mm_packus_epi16(_mm_packs_epi32(y0, y1), _mm_packs_epi32(y2, y3));
+        _mm_storeu_si128((__m128i *) (y + x), out);
+    }
+    bgra_to_y8_scalar(src + x * 4, y + x, width - x, c);
+}
+
+static inline __m128i clamp10_sse2(__m128i v)
+{
+    v = _mm_max_epi16(v, _mm_setzero_si128());
+    return _mm_min_epi16(v, _mm_set1_epi16(1023));
+}
+
+static void bgra_to_y16_sse2(const uint8_t *src, uint16_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = _mm_set1_epi32(y10_bias(c));
+    int32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        auto *p = (const __m128i *) (src + x * 4);
+        auto y0 = _mm_srai_epi32(_mm_add_epi32(luma_sse2(_mm_loadu_si128(p), c), bias), 12);
+        auto y1 = _mm_srai_epi32(_mm_add_epi32(luma_sse2(_mm_loadu_si128(p + 1), c), bias), 12);
+        auto out = _mm_slli_epi16(clamp10_sse2(_mm_packs_epi32(y0, y1)), 6);
+        _mm_storeu_si128((__m128i *) (y + x), out);
+    }
+    bgra_to_y16_scalar(src + x * 4, y + x, width - x, c);
+}
+
+// Sums of 2x2 pixels of one channel, for 4 chroma samples from 8 columns.
+static inline __m128i sum4_sse2(__m128i a0, __m128i a1, __m128i b0, __m128i b1,
+    int shift)
+{
+    auto mask = _mm_set1_epi32(0xff);
+    auto s0 = _mm_add_epi32(
+        _mm_and_si128(_mm_srli_epi32(a0, shift), mask),
+        _mm_and_si128(_mm_srli_epi32(b0, shift), mask));
+    auto s1 = _mm_add_epi32(
+        _mm_and_si128(_mm_srli_epi32(a1, shift), mask),
+        _mm_and_si128(_mm_srli_epi32(b1, shift), mask));
+    auto even = _mm_castps_si128(_mm_shuffle_ps(
+        _mm_castsi128_ps(s0), _mm_castsi128_ps(s1), _MM_SHUFFLE(2, 0, 2, 0)));
+    auto odd = _mm_castps_si128(_mm_shuffle_ps(
+        _mm_castsi128_ps(s0), _mm_castsi128_ps(s1), _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+// Chroma of 4 samples from 8 columns of two rows, unshifted.
+static inline void chroma_sse2(const uint8_t *src0, const uint8_t *src1,
+    const color_coeffs &c, __m128i &u, __m128i &v)
+{
+    auto a0 = _mm_loadu_si128((const __m128i *) src0);
+    auto a1 = _mm_loadu_si128((const __m128i *) (src0 + 16));
+    auto b0 = _mm_loadu_si128((const __m128i *) src1);
+    auto b1 = _mm_loadu_si128((const __m128i *) (src1 + 16));
+    auto b = sum4_sse2(a0, a1, b0, b1, 0);
+    auto g = sum4_sse2(a0, a1, b0, b1, 8);
+    auto r = sum4_sse2(a0, a1, b0, b1, 16);
+    u = _mm_add_epi32(_mm_add_epi32(mul_sse2(r, c.ur), mul_sse2(g, c.ug)), mul_sse2(b, c.ub));
+    v = _mm_add_epi32(_mm_add_epi32(mul_sse2(r, c.vr), mul_sse2(g, c.vg)), mul_sse2(b, c.vb));
+}
+
+static void bgra_to_uv8_sse2(const uint8_t *src0, const uint8_t *src1,
+    uint8_t *u, uint8_t *v, size_t step, int32_t width, const color_coeffs &c)
+{
+    if (step != 1 && step != 2)
+        return bgra_to_uv8_scalar(src0, src1, u, v, step, width, c);
+
+    auto bias = _mm_set1_epi32(c8_bias);
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i u0, v0, u1, v1;
+        chroma_sse2(src0 + x * 4, src1 + x * 4, c, u0, v0);
+        chroma_sse2(src0 + x * 4 + 32, src1 + x * 4 + 32, c, u1, v1);
+        u0 = _mm_srai_epi32(_mm_add_epi32(u0, bias), 16);
+        u1 = _mm_srai_epi32(_mm_add_epi32(u1, bias), 16);
+        v0 = _mm_srai_epi32(_mm_add_epi32(v0, bias), 16);
+        v1 = _mm_srai_epi32(_mm_add_epi32(v1, bias), 16);
+        auto uu = _mm_packs_epi32(u0, u1);
+        auto vv = _mm_packs_epi32(v0, v1);
+        auto i = (size_t) (x / 2) * step;
+        if (step == 2) {
+            auto uv = _mm_packus_epi16(uu, vv);
+            _mm_storeu_si128((__m128i *) (u + i), _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 8)));
+        }
+        else {
+            _mm_storel_epi64((__m128i *) (u + i), _mm_packus_epi16(uu, uu));
+            _mm_storel_epi64((__m128i *) (v + i), _mm_packus_epi16(vv, vv));
+        }
+    }
+    auto i = (size_t) (x / 2) * step;
+    bgra_to_uv8_scalar(src0 + x * 4, src1 + x * 4, u + i, v + i, step, width - x, c);
+}
+
+static void bgra_to_uv16_sse2(const uint8_t *src0, const uint8_t *src1,
+    uint16_t *u, uint16_t *v, size_t step, int32_t width, const color_coeffs &c)
+{
+    if (step != 1 && step != 2)
+        return bgra_to_uv16_scalar(src0, src1, u, v, step, width, c);
+
+    auto bias = _mm_set1_epi32(c10_bias);
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i u0, v0, u1, v1;
+        chroma_sse2(src0 + x * 4, src1 + x * 4, c, u0, v0);
+        chroma_sse2(src0 + x * 4 + 32, src1 + x * 4 + 32, c, u1, v1);
+        u0 = _mm_srai_epi32(_mm_add_epi32(u0, bias), 14);
+        u1 = _mm_srai_epi32(_mm_add_epi32(u1, bias), 14);
+        v0 = _mm_srai_epi32(_mm_add_epi32(v0, bias), 14);
+        v1 = _mm_srai_epi32(_mm_add_epi32(v1, bias), 14);
+        auto uu = _mm_slli_epi16(clamp10_sse2(_mm_packs_epi32(u0, u1)), 6);
+        auto vv = _mm_slli_epi16(clamp10_sse2(_mm_packs_epi32(v0, v1)), 6);
+        auto i = (size_t) (x / 2) * step;
+        if (step == 2) {
+            _mm_storeu_si128((__m128i *) (u + i), _mm_unpacklo_epi16(uu, vv));
+            _mm_storeu_si128((__m128i *) (u + i + 8), _mm_unpackhi_epi16(uu, vv));
+        }
+        else {
+            _mm_storeu_si128((__m128i *) (u + i), uu);
+            _mm_storeu_si128((__m128i *) (v + i), vv);
+        }
+    }
+    auto i = (size_t) (x / 2) * step;
+    bgra_to_uv16_scalar(src0 + x * 4, src1 + x * 4, u + i, v + i, step, width - x, c);
+}
+
+// Interleave clamped channels of 4 pixels to BGRA.
+static inline __m128i pack_bgra_sse2(__m128i b, __m128i g, __m128i r)
+{
+    auto bytes = _mm_packus_epi16(_mm_packs_epi32(b, g), _mm_packs_epi32(r, _mm_set1_epi32(255)));
+    auto bg = _mm_unpacklo_epi8(bytes, _mm_srli_si128(bytes, 4));
+    auto ra = _mm_unpacklo_epi8(_mm_srli_si128(bytes, 8), _mm_srli_si128(bytes, 12));
+    return _mm_unpacklo_epi16(bg, ra);
+}
+
+static void yuv_to_bgra_sse2(const uint8_t *y, const uint8_t *u,
+    const uint8_t *v, size_t step, uint8_t *dst, int32_t width,
+    const color_coeffs &c)
+{
+    auto rb = _mm_set1_epi32(r_bias(c));
+    auto gb = _mm_set1_epi32(g_bias(c));
+    auto bb = _mm_set1_epi32(b_bias(c));
+    auto zero = _mm_setzero_si128();
+    int32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        auto y16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (y + x)), zero);
+        __m128i ys[2] = { _mm_unpacklo_epi16(y16, zero), _mm_unpackhi_epi16(y16, zero) };
+
+        auto i = (size_t) (x / 2) * step;
+        for (int h = 0; h < 2; h++, i += 2 * step) {
+            auto cu = _mm_setr_epi32(u[i], u[i], u[i + step], u[i + step]);
+            auto cv = _mm_setr_epi32(v[i], v[i], v[i + step], v[i + step]);
+            auto yt = mul_sse2(ys[h], c.ky);
+            auto r = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(yt, mul_sse2(cv, c.rv)), rb), 13);
+            auto g = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(yt,
+                _mm_add_epi32(mul_sse2(cu, c.gu), mul_sse2(cv, c.gv))), gb), 13);
+            auto b = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(yt, mul_sse2(cu, c.bu)), bb), 13);
+            _mm_storeu_si128((__m128i *) (dst + (x + h * 4) * 4), pack_bgra_sse2(b, g, r));
+        }
+    }
+    auto i = (size_t) (x / 2) * step;
+    yuv_to_bgra_scalar(y + x, u + i, v + i, step, dst + x * 4, width - x, c);
+}
+
+static const color_kernels sse2_kernels = {
+    "sse2",
+    bgra_to_y8_sse2,
+    bgra_to_y16_sse2,
+    bgra_to_uv8_sse2,
+    bgra_to_uv16_sse2,
+    yuv_to_bgra_sse2
+};
+
+// AVX2 kernels for luma and BGRA output, 8 pixels per register. Chroma is
+// a quarter of the work, and uses the SSE2 kernels.
+
+P1_TARGET_AVX2
+static inline __m256i mul_avx2(__m256i x, int32_t c)
+{
+    return _mm256_madd_epi16(x, _mm256_set1_epi32(c));
+}
+
+P1_TARGET_AVX2
+static inline __m256i luma_avx2(__m256i px, const color_coeffs &c)
+{
+    auto mask = _mm256_set1_epi32(0xff);
+    auto b = _mm256_and_si256(px, mask);
+    auto g = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+    auto r = _mm256_and_si256(_mm256_srli_epi32(px, 16), mask);
+    return _mm256_add_epi32(_mm256_add_epi32(mul_avx2(r, c.yr), mul_avx2(g, c.yg)), mul_avx2(b, c.yb));
+}
+
+P1_TARGET_AVX2
+static void bgra_to_y8_avx2(const uint8_t *src, uint8_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = _mm256_set1_epi32(y8_bias(c));
+    // Packing works within 128-bit lanes, this restores pixel order.
+    auto order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int32_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        auto *p = (const __m256i *) (src + x * 4);
+        auto y0 = _mm256_srai_epi32(_mm256_add_epi32(luma_avx2(_mm256_loadu_si256(p), c), bias), 14);
+        auto y1 = _mm256_srai_epi32(_mm256_add_epi32(luma_avx2(_mm256_loadu_si256(p + 1), c), bias), 14);
+        auto y2 = _mm256_srai_epi32(_mm256_add_epi32(luma_avx2(_mm256_loadu_si256(p + 2), c), bias), 14);
+        auto y3 = _mm256_srai_epi32(_mm256_add_epi32(luma_avx2(_mm256_loadu_si256(p + 3), c), bias), 14);
+        auto out = _mm256_packus_epi16(_mm256_packs_epi32(y0, y1), _mm256_packs_epi32(y2, y3));
+        _mm256_storeu_si256((__m256i *) (y + x), _mm256_permutevar8x32_epi32(out, order));
+    }
+    bgra_to_y8_sse2(src + x * 4, y + x, width - x, c);
+}
+
+P1_TARGET_AVX2
+static void bgra_to_y16_avx2(const uint8_t *src, uint16_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = _mm256_set1_epi32(y10_bias(c));
+    auto zero = _mm256_setzero_si256();
+    auto max = _mm256_set1_epi16(1023);
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        auto *p = (const __m256i *) (src + x * 4);
+        auto y0 = _mm256_srai_epi32(_mm256_add_epi32(luma_avx2(_mm256_loadu_si256(p), c), bias), 12);
+        auto y1 = _mm256_srai_epi32(_mm256_add_epi32(luma_avx2(_mm256_loadu_si256(p + 1), c), bias), 12);
+        auto out = _mm256_packs_epi32(y0, y1);
+        out = _mm256_min_epi16(_mm256_max_epi16(out, zero), max);
+        out = _mm256_permute4x64_epi64(_mm256_slli_epi16(out, 6), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *) (y + x), out);
+    }
+    bgra_to_y16_sse2(src + x * 4, y + x, width - x, c);
+}
+
+P1_TARGET_AVX2
+static void yuv_to_bgra_avx2(const uint8_t *y, const uint8_t *u,
+    const uint8_t *v, size_t step, uint8_t *dst, int32_t width,
+    const color_coeffs &c)
+{
+    auto rb = _mm256_set1_epi32(r_bias(c));
+    auto gb = _mm256_set1_epi32(g_bias(c));
+    auto bb = _mm256_set1_epi32(b_bias(c));
+    auto alpha = _mm256_set1_epi32(255);
+    int32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        auto ys = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (y + x)));
+
+        auto i = (size_t) (x / 2) * step;
+        auto cu = _mm256_setr_epi32(u[i], u[i], u[i + step], u[i + step],
+            u[i + 2 * step], u[i + 2 * step], u[i + 3 * step], u[i + 3 * step]);
+        auto cv = _mm256_setr_epi32(v[i], v[i], v[i + step], v[i + step],
+            v[i + 2 * step], v[i + 2 * step], v[i + 3 * step], v[i + 3 * step]);
+
+        auto yt = mul_avx2(ys, c.ky);
+        auto r = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(yt, mul_avx2(cv, c.rv)), rb), 13);
+        auto g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(yt,
+            _mm256_add_epi32(mul_avx2(cu, c.gu), mul_avx2(cv, c.gv))), gb), 13);
+        auto b = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(yt, mul_avx2(cu, c.bu)), bb), 13);
+
+        // Within each 128-bit lane, as in `pack_bgra_sse2`.
+        auto bytes = _mm256_packus_epi16(_mm256_packs_epi32(b, g), _mm256_packs_epi32(r, alpha));
+        auto bg = _mm256_unpacklo_epi8(bytes, _mm256_bsrli_epi128(bytes, 4));
+        auto ra = _mm256_unpacklo_epi8(_mm256_bsrli_epi128(bytes, 8), _mm256_bsrli_epi128(bytes, 12));
+        _mm256_storeu_si256((__m256i *) (dst + x * 4), _mm256_unpacklo_epi16(bg, ra));
+    }
+    auto i = (size_t) (x / 2) * step;
+    yuv_to_bgra_sse2(y + x, u + i, v + i, step, dst + x * 4, width - x, c);
+}
+
+static const color_kernels avx2_kernels = {
+    "avx2",
+    bgra_to_y8_avx2,
+    bgra_to_y16_avx2,
+    bgra_to_uv8_sse2,
+    bgra_to_uv16_sse2,
+    yuv_to_bgra_avx2
+};
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+// NEON kernels. Structure loads split BGRA into channels, arithmetic is in
+// 32-bit lanes like the scalar kernels.
+
+static inline int32x4_t widen_lo(uint16x8_t v)
+{
+    return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v)));
+}
+
+static inline int32x4_t widen_hi(uint16x8_t v)
+{
+    return vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v)));
+}
+
+static inline int32x4_t dot3_neon(int32x4_t r, int32x4_t g, int32x4_t b,
+    int32_t cr, int32_t cg, int32_t cb, int32_t bias)
+{
+    auto acc = vmlaq_n_s32(vdupq_n_s32(bias), r, cr);
+    acc = vmlaq_n_s32(acc, g, cg);
+    return vmlaq_n_s32(acc, b, cb);
+}
+
+static inline uint16x8_t narrow_neon(int32x4_t lo, int32x4_t hi)
+{
+    return vcombine_u16(vqmovun_s32(lo), vqmovun_s32(hi));
+}
+
+static void bgra_to_y8_neon(const uint8_t *src, uint8_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = y8_bias(c);
+    int32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        auto px = vld4_u8(src + x * 4);
+        auto b = vmovl_u8(px.val[0]), g = vmovl_u8(px.val[1]), r = vmovl_u8(px.val[2]);
+        auto lo = vshrq_n_s32(dot3_neon(widen_lo(r), widen_lo(g), widen_lo(b), c.yr, c.yg, c.yb, bias), 14);
+        auto hi = vshrq_n_s32(dot3_neon(widen_hi(r), widen_hi(g), widen_hi(b), c.yr, c.yg, c.yb, bias), 14);
+        vst1_u8(y + x, vqmovn_u16(narrow_neon(lo, hi)));
+    }
+    bgra_to_y8_scalar(src + x * 4, y + x, width - x, c);
+}
+
+static void bgra_to_y16_neon(const uint8_t *src, uint16_t *y, int32_t width,
+    const color_coeffs &c)
+{
+    auto bias = y10_bias(c);
+    int32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        auto px = vld4_u8(src + x * 4);
+        auto b = vmovl_u8(px.val[0]), g = vmovl_u8(px.val[1]), r = vmovl_u8(px.val[2]);
+        auto lo = vshrq_n_s32(dot3_neon(widen_lo(r), widen_lo(g), widen_lo(b), c.yr, c.yg, c.yb, bias), 12);
+        auto hi = vshrq_n_s32(dot3_neon(widen_hi(r), widen_hi(g), widen_hi(b), c.yr, c.yg, c.yb, bias), 12);
+        auto out = vminq_u16(narrow_neon(lo, hi), vdupq_n_u16(1023));
+        vst1q_u16(y + x, vshlq_n_u16(out, 6));
+    }
+    bgra_to_y16_scalar(src + x * 4, y + x, width - x, c);
+}
+
+// Chroma of 8 samples from 16 columns of two rows, shifted.
+static inline void chroma_neon(const uint8_t *src0, const uint8_t *src1,
+    const color_coeffs &c, int32_t bias, int shift, uint16x8_t &u, uint16x8_t &v)
+{
+    auto a = vld4q_u8(src0);
+    auto b = vld4q_u8(src1);
+    auto sb = vaddq_u16(vpaddlq_u8(a.val[0]), vpaddlq_u8(b.val[0]));
+    auto sg = vaddq_u16(vpaddlq_u8(a.val[1]), vpaddlq_u8(b.val[1]));
+    auto sr = vaddq_u16(vpaddlq_u8(a.val[2]), vpaddlq_u8(b.val[2]));
+
+    auto u_lo = dot3_neon(widen_lo(sr), widen_lo(sg), widen_lo(sb), c.ur, c.ug, c.ub, bias);
+    auto u_hi = dot3_neon(widen_hi(sr), widen_hi(sg), widen_hi(sb), c.ur, c.ug, c.ub, bias);
+    auto v_lo = dot3_neon(widen_lo(sr), widen_lo(sg), widen_lo(sb), c.vr, c.vg, c.vb, bias);
+    auto v_hi = dot3_neon(widen_hi(sr), widen_hi(sg), widen_hi(sb), c.vr, c.vg, c.vb, bias);
+
+    // Shift counts must be constants.
+    if (shift == 16) {
+        u = narrow_neon(vshrq_n_s32(u_lo, 16), vshrq_n_s32(u_hi, 16));
+        v = narrow_neon(vshrq_n_s32(v_lo, 16), vshrq_n_s32(v_hi, 16));
+    }
+    else {
+        u = narrow_neon(vshrq_n_s32(u_lo, 14), vshrq_n_s32(u_hi, 14));
+        v = narrow_neon(vshrq_n_s32(v_lo, 14), vshrq_n_s32(v_hi, 14));
+    }
+}
+
+static void bgra_to_uv8_neon(const uint8_t *src0, const uint8_t *src1,
+    uint8_t *u, uint8_t *v, size_t step, int32_t width, const color_coeffs &c)
+{
+    if (step != 1 && step != 2)
+        return bgra_to_uv8_scalar(src0, src1, u, v, step, width, c);
+
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint16x8_t uu, vv;
+        chroma_neon(src0 + x * 4, src1 + x * 4, c, c8_bias, 16, uu, vv);
+        auto i = (size_t) (x / 2) * step;
+        if (step == 2) {
+            uint8x8x2_t uv = { { vqmovn_u16(uu), vqmovn_u16(vv) } };
+            vst2_u8(u + i, uv);
+        }
+        else {
+            vst1_u8(u + i, vqmovn_u16(uu));
+            vst1_u8(v + i, vqmovn_u16(vv));
+        }
+    }
+    auto i = (size_t) (x / 2) * step;
+    bgra_to_uv8_scalar(src0 + x * 4, src1 + x * 4, u + i, v + i, step, width - x, c);
+}
+
+static void bgra_to_uv16_neon(const uint8_t *src0, const uint8_t *src1,
+    uint16_t *u, uint16_t *v, size_t step, int32_t width, const color_coeffs &c)
+{
+    if (step != 1 && step != 2)
+        return bgra_to_uv16_scalar(src0, src1, u, v, step, width, c);
+
+    auto max = vdupq_n_u16(1023);
+    int32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint16x8_t uu, vv;
+        chroma_neon(src0 + x * 4, src1 + x * 4, c, c10_bias, 14, uu, vv);
+        uu = vshlq_n_u16(vminq_u16(uu, max), 6);
+        vv = vshlq_n_u16(vminq_u16(vv, max), 6);
+        auto i = (size_t) (x / 2) * step;
+        if (step == 2) {
+            uint16x8x2_t uv = { { uu, vv } };
+            vst2q_u16(u + i, uv);
+        }
+        else {
+            vst1q_u16(u + i, uu);
+            vst1q_u16(v + i, vv);
+        }
+    }
+    auto i = (size_t) (x / 2) * step;
+    bgra_to_uv16_scalar(src0 + x * 4, src1 + x * 4, u + i, v + i, step, width - x, c);
+}
+
+static void yuv_to_bgra_neon(const uint8_t *y, const uint8_t *u,
+    const uint8_t *v, size_t step, uint8_t *dst, int32_t width,
+    const color_coeffs &c)
+{
+    auto rb = r_bias(c), gb = g_bias(c), bb = b_bias(c);
+    int32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        auto ys = vmovl_u8(vld1_u8(y + x));
+
+        // Repeat each chroma sample for two pixels.
+        auto i = (size_t) (x / 2) * step;
+        uint8_t ub[8], vb[8];
+        for (int k = 0; k < 4; k++) {
+            ub[k * 2] = ub[k * 2 + 1] = u[i + k * step];
+            vb[k * 2] = vb[k * 2 + 1] = v[i + k * step];
+        }
+        auto us = vmovl_u8(vld1_u8(ub));
+        auto vs = vmovl_u8(vld1_u8(vb));
+
+        int32x4_t out[3][2];
+        for (int h = 0; h < 2; h++) {
+            auto yv = h ? widen_hi(ys) : widen_lo(ys);
+            auto uv = h ? widen_hi(us) : widen_lo(us);
+            auto vv = h ? widen_hi(vs) : widen_lo(vs);
+            auto yt = vmulq_n_s32(yv, c.ky);
+            out[0][h] = vshrq_n_s32(vmlaq_n_s32(vaddq_s32(yt, vdupq_n_s32(bb)), uv, c.bu), 13);
+            out[1][h] = vshrq_n_s32(vmlaq_n_s32(vmlaq_n_s32(vaddq_s32(yt, vdupq_n_s32(gb)), uv, c.gu), vv, c.gv), 13);
+            out[2][h] = vshrq_n_s32(vmlaq_n_s32(vaddq_s32(yt, vdupq_n_s32(rb)), vv, c.rv), 13);
+        }
+
+        uint8x8x4_t px;
+        px.val[0] = vqmovn_u16(narrow_neon(out[0][0], out[0][1]));
+        px.val[1] = vqmovn_u16(narrow_neon(out[1][0], out[1][1]));
+        px.val[2] = vqmovn_u16(narrow_neon(out[2][0], out[2][1]));
+        px.val[3] = vdup_n_u8(255);
+        vst4_u8(dst + x * 4, px);
+    }
+    auto i = (size_t) (x / 2) * step;
+    yuv_to_bgra_scalar(y + x, u + i, v + i, step, dst + x * 4, width - x, c);
+}
+
+static const color_kernels neon_kernels = {
+    "neon",
+    bgra_to_y8_neon,
+    bgra_to_y16_neon,
+    bgra_to_uv8_neon,
+    bgra_to_uv16_neon,
+    yuv_to_bgra_neon
+};
+
+#endif  // P1_HAVE_NEON
+
+static const color_kernels &select_kernels()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return avx2_kernels;
+    if (cpu.sse2)
+        return sse2_kernels;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return neon_kernels;
+#endif
+    (void) cpu;
+    return scalar_kernels;
+}
+
+const color_kernels &get_color_kernels()
+{
+    static const color_kernels &kernels = select_kernels();
+    return kernels;
+}
+
+const color_kernels &get_scalar_color_kernels()
+{
+    return scalar_kernels;
+}
+
+
+const int32_t color_converter::min_band_rows;
+
+color_converter::color_converter() :
+    kernels(&get_color_kernels()), pool(nullptr)
+{
+    compute_color_coeffs(color_matrix_bt709, color_range_limited, coeffs);
+}
+
+void color_converter::configure(color_matrix matrix, color_range range,
+    worker_pool *pool_, const color_kernels *kernels_)
+{
+    compute_color_coeffs(matrix, range, coeffs);
+    pool = pool_;
+    kernels = kernels_ != nullptr ? kernels_ : &get_color_kernels();
+}
+
+bool color_converter::convert(const image_desc &src, const image_desc &dst)
+{
+    if (src.width != dst.width || src.height != dst.height ||
+        src.width <= 0 || src.height <= 0)
+        return false;
+
+    bool to_yuv = src.format == image_format_bgra && dst.format != image_format_bgra;
+    bool to_bgra = dst.format == image_format_bgra &&
+        (src.format == image_format_nv12 || src.format == image_format_i420);
+    if (!to_yuv && !to_bgra)
+        return false;
+
+    // Even band heights, so bands never share a chroma row.
+    int32_t height = src.height;
+    int32_t bands = pool != nullptr ? (int32_t) pool->concurrency() * 2 : 1;
+    int32_t band_rows = std::max(min_band_rows, (height + bands - 1) / bands);
+    band_rows = (band_rows + 1) & ~1;
+    size_t count = (size_t) ((height + band_rows - 1) / band_rows);
+
+    if (pool == nullptr || count == 1) {
+        convert_rows(src, dst, 0, height);
+        return true;
+    }
+
+    // Captures one pointer, so the function does not allocate.
+    struct band_job {
+        color_converter *self;
+        const image_desc *src;
+        const image_desc *dst;
+        int32_t band_rows;
+        int32_t height;
+    } job = { this, &src, &dst, band_rows, height };
+    pool->run(count, [&job](size_t i) {
+        auto y0 = (int32_t) i * job.band_rows;
+        auto y1 = std::min(y0 + job.band_rows, job.height);
+        job.self->convert_rows(*job.src, *job.dst, y0, y1);
+    });
+    return true;
+}
+
+void color_converter::convert_rows(const image_desc &src, const image_desc &dst,
+    int32_t y0, int32_t y1)
+{
+    auto &k = *kernels;
+    auto &c = coeffs;
+    auto width = src.width;
+    auto height = src.height;
+
+    if (src.format == image_format_bgra) {
+        auto &in = src.planes[0];
+        auto row = [&](int32_t y) { return in.data + (size_t) y * in.stride; };
+
+        for (int32_t y = y0; y < y1; y++) {
+            auto *out = dst.planes[0].data + (size_t) y * dst.planes[0].stride;
+            if (dst.format == image_format_p010)
+                k.bgra_to_y16(row(y), (uint16_t *) out, width, c);
+            else
+                k.bgra_to_y8(row(y), out, width, c);
+        }
+
+        // Odd heights repeat the last row.
+        for (int32_t y = y0; y < y1; y += 2) {
+            auto *src0 = row(y);
+            auto *src1 = row(std::min(y + 1, height - 1));
+            auto cy = (size_t) (y / 2);
+            if (dst.format == image_format_i420) {
+                k.bgra_to_uv8(src0, src1,
+                    dst.planes[1].data + cy * dst.planes[1].stride,
+                    dst.planes[2].data + cy * dst.planes[2].stride, 1, width, c);
+            }
+            else if (dst.format == image_format_p010) {
+                auto *uv = (uint16_t *) (dst.planes[1].data + cy * dst.planes[1].stride);
+                k.bgra_to_uv16(src0, src1, uv, uv + 1, 2, width, c);
+            }
+            else {
+                auto *uv = dst.planes[1].data + cy * dst.planes[1].stride;
+                k.bgra_to_uv8(src0, src1, uv, uv + 1, 2, width, c);
+            }
+        }
+    }
+    else {
+        auto &out = dst.planes[0];
+        for (int32_t y = y0; y < y1; y++) {
+            auto *luma = src.planes[0].data + (size_t) y * src.planes[0].stride;
+            auto cy = (size_t) (y / 2);
+            const uint8_t *u, *v;
+            size_t step;
+            if (src.format == image_format_i420) {
+                u = src.planes[1].data + cy * src.planes[1].stride;
+                v = src.planes[2].data + cy * src.planes[2].stride;
+                step = 1;
+            }
+            else {
+                u = src.planes[1].data + cy * src.planes[1].stride;
+                v = u + 1;
+                step = 2;
+            }
+            k.yuv_to_bgra(luma, u, v, step, out.data + (size_t) y * out.stride, width, c);
+        }
+    }
+}
+
+
+}  // namespace p1_mac_plugins
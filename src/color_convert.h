@@ -0,0 +1,128 @@
+#ifndef p1_mac_plugins_color_convert_h
+#define p1_mac_plugins_color_convert_h
+
+#include "worker_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Image formats we convert between. 4:2:0 formats have chroma at half
+// resolution in both directions, rounded up for odd sizes.
+//
+//  - BGRA: one plane of 32-bit pixels.
+//  - NV12: a Y plane, then a plane of interleaved Cb Cr pairs. This is what
+//    Core Video calls '420v' in limited range and '420f' in full range.
+//  - I420: Y, Cb and Cr planes.
+//  - P010: like NV12, with 16-bit samples holding 10 bits in the high bits.
+enum image_format {
+    image_format_bgra,
+    image_format_nv12,
+    image_format_i420,
+    image_format_p010
+};
+
+// YCbCr matrix and range.
+enum color_matrix {
+    color_matrix_bt601,
+    color_matrix_bt709
+};
+
+enum color_range {
+    color_range_limited,
+    color_range_full
+};
+
+struct image_plane {
+    uint8_t *data;
+    size_t stride;
+};
+
+// An image in caller memory. Planes in the order listed for the format.
+struct image_desc {
+    image_format format;
+    int32_t width;
+    int32_t height;
+    image_plane planes[3];
+};
+
+// Fixed point coefficients for a matrix and range. The forward direction
+// has 14 fractional bits, the inverse 13.
+struct color_coeffs {
+    int32_t yr, yg, yb;
+    int32_t ur, ug, ub;
+    int32_t vr, vg, vb;
+    int32_t y_offset;
+
+    int32_t ky, rv, gu, gv, bu;
+};
+
+void compute_color_coeffs(color_matrix matrix, color_range range, color_coeffs &c);
+
+// Row kernels. Chroma rows take two BGRA rows, and write every `step`th
+// sample, so interleaved pairs are written with a step of 2. YCbCr rows to
+// BGRA take one luma row, with the chroma row covering it.
+typedef void (*bgra_to_y8_fn)(const uint8_t *src, uint8_t *y, int32_t width,
+    const color_coeffs &c);
+typedef void (*bgra_to_y16_fn)(const uint8_t *src, uint16_t *y, int32_t width,
+    const color_coeffs &c);
+typedef void (*bgra_to_uv8_fn)(const uint8_t *src0, const uint8_t *src1,
+    uint8_t *u, uint8_t *v, size_t step, int32_t width, const color_coeffs &c);
+typedef void (*bgra_to_uv16_fn)(const uint8_t *src0, const uint8_t *src1,
+    uint16_t *u, uint16_t *v, size_t step, int32_t width, const color_coeffs &c);
+typedef void (*yuv_to_bgra_fn)(const uint8_t *y, const uint8_t *u,
+    const uint8_t *v, size_t step, uint8_t *dst, int32_t width,
+    const color_coeffs &c);
+
+// Kernels selected for the running CPU. All kernels give the same result.
+struct color_kernels {
+    const char *name;
+    bgra_to_y8_fn bgra_to_y8;
+    bgra_to_y16_fn bgra_to_y16;
+    bgra_to_uv8_fn bgra_to_uv8;
+    bgra_to_uv16_fn bgra_to_uv16;
+    yuv_to_bgra_fn yuv_to_bgra;
+};
+
+const color_kernels &get_color_kernels();
+const color_kernels &get_scalar_color_kernels();
+
+// Converts images between BGRA and YCbCr formats: BGRA to and from NV12
+// and I420, and BGRA to P010. Rows are split in bands over a worker pool.
+// Chroma is averaged over 2x2 pixels going to YCbCr, and repeated going
+// back. Never allocates.
+//
+// Nothing in the addon converts yet, so this is only built by the tests.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class color_converter {
+public:
+    // Bands are at least this many rows, smaller frames use fewer threads.
+    static const int32_t min_band_rows = 32;
+
+    color_converter();
+
+    // Null pool runs on the calling thread. Kernels may be overridden, for
+    // comparing with the reference.
+    void configure(color_matrix matrix, color_range range, worker_pool *pool_,
+        const color_kernels *kernels_ = nullptr);
+
+    // Returns false if the pair of formats is not supported, or sizes
+    // differ.
+    bool convert(const image_desc &src, const image_desc &dst);
+
+private:
+    const color_kernels *kernels;
+    worker_pool *pool;
+    color_coeffs coeffs;
+
+    void convert_rows(const image_desc &src, const image_desc &dst,
+        int32_t y0, int32_t y1);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_color_convert_h
@@ -0,0 +1,156 @@
+#include "continuity_guard.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace p1_mac_plugins {
+
+
+continuity_guard::continuity_guard() :
+    gaps(0), gap_frames(0), overlaps(0), overlap_frames(0), resyncs(0),
+    channels(0), max_frames(0), max_fill(0), fade_frames(0),
+    mode(conceal_silence), tail_len(0)
+{
+    reset();
+}
+
+void continuity_guard::configure(uint32_t channels_, size_t max_frames_,
+    size_t max_fill_frames_, size_t fade_frames_, conceal_mode mode_)
+{
+    channels = channels_;
+    max_frames = max_frames_;
+    max_fill = max_fill_frames_;
+    fade_frames = fade_frames_;
+    mode = mode_;
+
+    scratch.reset(new float[max_output_frames() * channels]);
+    tail.reset(new float[fade_frames * channels]);
+    reset();
+}
+
+void continuity_guard::reset()
+{
+    have_expected = false;
+    expected = 0;
+    last_resync = false;
+    tail_len = 0;
+}
+
+size_t continuity_guard::process(const float *in, size_t frames,
+    double sample_time, const float *&out, int64_t &offset)
+{
+    out = in;
+    offset = 0;
+    last_resync = false;
+
+    if (sample_time < 0) {
+        have_expected = false;
+        save_tail(in, frames);
+        return frames;
+    }
+
+    auto delta = (int64_t) llround(sample_time - (have_expected ? expected : sample_time));
+    bool first = !have_expected;
+    have_expected = true;
+
+    if (delta == 0 || first) {
+        expected = sample_time + frames;
+        save_tail(in, frames);
+        return frames;
+    }
+
+    // Too far off to conceal. Follow the new timeline.
+    if ((delta > 0 && (size_t) delta > max_fill) ||
+        (delta < 0 && (size_t) -delta > max_fill)) {
+        resyncs.fetch_add(1, std::memory_order_relaxed);
+        last_resync = true;
+        expected = sample_time + frames;
+        save_tail(in, frames);
+        return frames;
+    }
+
+    size_t fill = 0;
+    if (delta > 0) {
+        fill = (size_t) delta;
+        gaps.fetch_add(1, std::memory_order_relaxed);
+        gap_frames.fetch_add(fill, std::memory_order_relaxed);
+    }
+    else {
+        auto trim = std::min((size_t) -delta, frames);
+        overlaps.fetch_add(1, std::memory_order_relaxed);
+        overlap_frames.fetch_add(trim, std::memory_order_relaxed);
+        in += trim * channels;
+        frames -= trim;
+        offset = (int64_t) trim;
+    }
+
+    // Advance by what we output, so a partly dropped overlap doesn't count
+    // twice.
+    expected = std::max(expected, sample_time + (double) (offset + frames));
+    if (fill != 0)
+        offset = -(int64_t) fill;
+
+    if (fill + frames == 0)
+        return 0;
+
+    auto *dst = scratch.get();
+    join(in, frames, fill, dst);
+    save_tail(dst, fill + frames);
+    out = dst;
+    return fill + frames;
+}
+
+// Write `fill` frames of concealment followed by `frames` of input.
+void continuity_guard::join(const float *in, size_t frames, size_t fill, float *out)
+{
+    memset(out, 0, fill * channels * sizeof(float));
+    memcpy(out + fill * channels, in, frames * channels * sizeof(float));
+
+    if (mode != conceal_crossfade)
+        return;
+
+    // Fade out a mirror of the tail around the last output frame, which
+    // continues without a step, while input fades in from where it starts.
+    size_t len = std::min(fade_frames, tail_len);
+    size_t end = fill + std::min(len, frames);
+    for (size_t p = 0; p < end; p++) {
+        auto *dst = out + p * channels;
+
+        float w = 0.0f;
+        if (p >= fill)
+            w = (float) (p - fill + 1) / (len + 1);
+        for (uint32_t c = 0; c < channels; c++)
+            dst[c] *= w;
+
+        if (p < len) {
+            float g = 1.0f - (float) (p + 1) / (len + 1);
+            auto *ext = tail.get() + (tail_len - 1 - p) * channels;
+            for (uint32_t c = 0; c < channels; c++)
+                dst[c] += ext[c] * g;
+        }
+    }
+}
+
+void continuity_guard::save_tail(const float *out, size_t frames)
+{
+    if (mode != conceal_crossfade || fade_frames == 0)
+        return;
+
+    if (frames >= fade_frames) {
+        memcpy(tail.get(), out + (frames - fade_frames) * channels,
+            fade_frames * channels * sizeof(float));
+        tail_len = fade_frames;
+        return;
+    }
+
+    // Shift out the oldest frames to make room.
+    size_t keep = std::min(tail_len, fade_frames - frames);
+    memmove(tail.get(), tail.get() + (tail_len - keep) * channels,
+        keep * channels * sizeof(float));
+    memcpy(tail.get() + keep * channels, out, frames * channels * sizeof(float));
+    tail_len = keep + frames;
+}
+
+
+}  // namespace p1_mac_plugins
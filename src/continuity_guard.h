@@ -0,0 +1,80 @@
+#ifndef p1_mac_plugins_continuity_guard_h
+#define p1_mac_plugins_continuity_guard_h
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// How to fill holes in the capture timeline.
+enum conceal_mode {
+    // Plain silence, and overlaps are cut without smoothing.
+    conceal_silence,
+    // Fade out a mirror of the last frames into the hole, and fade in the
+    // next buffer. Joins after trimmed overlaps are crossfaded the same way.
+    conceal_crossfade
+};
+
+// Keeps a stream of capture buffers contiguous, based on the sample time of
+// each buffer. Holes are filled, overlapping frames are dropped, so the
+// output runs without gaps at the capture rate. Discontinuities too large to
+// conceal within one buffer are passed through and counted as resyncs.
+//
+// Counters may be read from any thread.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class continuity_guard {
+public:
+    continuity_guard();
+
+    void configure(uint32_t channels_, size_t max_frames_, size_t max_fill_frames_,
+        size_t fade_frames_, conceal_mode mode_);
+    void reset();
+
+    // Upper bound on output frames for one buffer.
+    size_t max_output_frames() const { return max_frames + max_fill; }
+
+    // Check a buffer of interleaved float starting at `sample_time`. A
+    // negative sample time means unknown, and passes the buffer unchecked.
+    // Returns output frames, points `out` at them, and sets `offset` to the
+    // position of the first output frame relative to `in`, in frames.
+    size_t process(const float *in, size_t frames, double sample_time,
+        const float *&out, int64_t &offset);
+
+    // Whether the last call passed a discontinuity through.
+    bool resynced() const { return last_resync; }
+
+    std::atomic<uint64_t> gaps;
+    std::atomic<uint64_t> gap_frames;
+    std::atomic<uint64_t> overlaps;
+    std::atomic<uint64_t> overlap_frames;
+    std::atomic<uint64_t> resyncs;
+
+private:
+    uint32_t channels;
+    size_t max_frames;
+    size_t max_fill;
+    size_t fade_frames;
+    conceal_mode mode;
+
+    bool have_expected;
+    double expected;
+    bool last_resync;
+
+    std::unique_ptr<float[]> scratch;
+
+    // Last output frames, for crossfades.
+    std::unique_ptr<float[]> tail;
+    size_t tail_len;
+
+    void join(const float *in, size_t frames, size_t fill, float *out);
+    void save_tail(const float *out, size_t frames);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_continuity_guard_h
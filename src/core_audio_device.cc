@@ -0,0 +1,162 @@
+#include "core_audio_device.h"
+#include "channel_matrix.h"
+
+namespace p1_mac_plugins {
+
+
+static const AudioObjectPropertyAddress default_input_addr = {
+    kAudioHardwarePropertyDefaultInputDevice,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress device_for_uid_addr = {
+    kAudioHardwarePropertyDeviceForUID,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress device_streams_addr = {
+    kAudioDevicePropertyStreams,
+    kAudioObjectPropertyScopeInput,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress physical_format_addr = {
+    kAudioStreamPropertyPhysicalFormat,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static OSStatus get_device_input_format(
+    AudioObjectID device, AudioStreamBasicDescription &asbd);
+
+
+OSStatus find_input_device(const std::string &uid, AudioObjectID &device)
+{
+    OSStatus ret;
+    UInt32 size;
+
+    device = kAudioObjectUnknown;
+    if (!uid.empty()) {
+        CFStringRef cf_uid = CFStringCreateWithCString(
+            kCFAllocatorDefault, uid.c_str(), kCFStringEncodingUTF8);
+        AudioValueTranslation trans = { &cf_uid, sizeof(cf_uid), &device, sizeof(device) };
+        size = sizeof(trans);
+        ret = AudioObjectGetPropertyData(
+            kAudioObjectSystemObject, &device_for_uid_addr,
+            0, NULL, &size, &trans);
+        CFRelease(cf_uid);
+    }
+    else {
+        size = sizeof(device);
+        ret = AudioObjectGetPropertyData(
+            kAudioObjectSystemObject, &default_input_addr,
+            0, NULL, &size, &device);
+    }
+    if (ret != noErr)
+        return ret;
+    if (device == kAudioObjectUnknown)
+        return kAudioHardwareBadDeviceError;
+    return noErr;
+}
+
+void choose_capture_format(const capture_backend_config &config, AudioObjectID device,
+    capture_format &fmt, capture_backend_client &client)
+{
+    fmt.format = config.format;
+    fmt.interleaved = config.interleaved;
+    fmt.rate = 44100;
+    fmt.channels = 2;
+
+    AudioStreamBasicDescription native;
+    sample_format native_format;
+    OSStatus ret = device == kAudioObjectUnknown ?
+        kAudioHardwareBadDeviceError : get_device_input_format(device, native);
+    if (ret != noErr) {
+        client.capture_log(capture_log_warn, "Could not determine native format, error 0x%x", ret);
+        return;
+    }
+
+    if (native.mSampleRate > 0)
+        fmt.rate = native.mSampleRate;
+    if (native.mChannelsPerFrame > 0)
+        fmt.channels = native.mChannelsPerFrame < channel_matrix::max_channels ?
+            native.mChannelsPerFrame : channel_matrix::max_channels;
+
+    if (!sample_format_from_asbd(native, native_format)) {
+        if (config.use_native_format)
+            client.capture_log(capture_log_warn, "Unsupported native format, using float");
+    }
+    else {
+        if (config.use_native_format)
+            fmt.format = native_format;
+        if (config.use_native_interleaving)
+            fmt.interleaved = !(native.mFormatFlags & kAudioFormatFlagIsNonInterleaved);
+    }
+}
+
+bool sample_format_from_asbd(
+    const AudioStreamBasicDescription &asbd, sample_format &fmt)
+{
+    if (asbd.mFormatID != kAudioFormatLinearPCM ||
+        (asbd.mFormatFlags & kAudioFormatFlagIsBigEndian))
+        return false;
+
+    if (asbd.mFormatFlags & kAudioFormatFlagIsFloat) {
+        if (asbd.mBitsPerChannel != 32)
+            return false;
+        fmt = sample_format_float32;
+        return true;
+    }
+
+    switch (asbd.mBitsPerChannel) {
+        case 16: fmt = sample_format_int16; return true;
+        case 24: fmt = sample_format_int24; return true;
+        case 32: fmt = sample_format_int32; return true;
+        default: return false;
+    }
+}
+
+void fill_asbd(AudioStreamBasicDescription &asbd, const capture_format &fmt)
+{
+    UInt32 size = (UInt32) sample_format_size(fmt.format);
+
+    asbd.mFormatID = kAudioFormatLinearPCM;
+    asbd.mFormatFlags = kLinearPCMFormatFlagIsPacked;
+    if (fmt.format == sample_format_float32)
+        asbd.mFormatFlags |= kLinearPCMFormatFlagIsFloat;
+    else
+        asbd.mFormatFlags |= kLinearPCMFormatFlagIsSignedInteger;
+    if (!fmt.interleaved)
+        asbd.mFormatFlags |= kAudioFormatFlagIsNonInterleaved;
+    asbd.mSampleRate = fmt.rate;
+    asbd.mBitsPerChannel = size * 8;
+    asbd.mChannelsPerFrame = fmt.channels;
+    asbd.mBytesPerFrame = fmt.interleaved ? fmt.channels * size : size;
+    asbd.mFramesPerPacket = 1;
+    asbd.mBytesPerPacket = asbd.mBytesPerFrame;
+    asbd.mReserved = 0;
+}
+
+// Get the physical format of the first input stream of a device.
+static OSStatus get_device_input_format(
+    AudioObjectID device, AudioStreamBasicDescription &asbd)
+{
+    OSStatus ret;
+    UInt32 size;
+
+    AudioStreamID stream;
+    size = sizeof(stream);
+    ret = AudioObjectGetPropertyData(device, &device_streams_addr, 0, NULL, &size, &stream);
+    if (ret != noErr)
+        return ret;
+    if (size < sizeof(stream))
+        return kAudioHardwareBadStreamError;
+
+    size = sizeof(asbd);
+    return AudioObjectGetPropertyData(stream, &physical_format_addr, 0, NULL, &size, &asbd);
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,29 @@
+#ifndef p1_mac_plugins_core_audio_device_h
+#define p1_mac_plugins_core_audio_device_h
+
+#include "capture_backend.h"
+
+#include <AudioToolbox/AudioToolbox.h>
+
+namespace p1_mac_plugins {
+
+
+// Core Audio helpers shared by the device capture backends.
+
+// Find a device by UID. An empty UID selects the default input device.
+OSStatus find_input_device(const std::string &uid, AudioObjectID &device);
+
+// Choose the capture format for a device. Prefers its native sample format
+// and rate, so Core Audio doesn't convert samples; we do that ourselves, see
+// `sample_convert` and `resampler`. Falls back to the configured format at
+// stereo 44.1 kHz, logging warnings to the client. Leaves `max_frames` alone.
+void choose_capture_format(const capture_backend_config &config, AudioObjectID device,
+    capture_format &fmt, capture_backend_client &client);
+
+bool sample_format_from_asbd(const AudioStreamBasicDescription &asbd, sample_format &fmt);
+void fill_asbd(AudioStreamBasicDescription &asbd, const capture_format &fmt);
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_core_audio_device_h
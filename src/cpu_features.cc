@@ -0,0 +1,62 @@
+#include "cpu_features.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if P1_HAVE_X86_SIMD
+#   include <cpuid.h>
+#endif
+
+namespace p1_mac_plugins {
+
+static cpu_features detect();
+
+
+const cpu_features &get_cpu_features()
+{
+    // Thread-safe static init.
+    static const cpu_features features = detect();
+    return features;
+}
+
+#if P1_HAVE_X86_SIMD
+
+static cpu_features detect()
+{
+    cpu_features f = { false, false, false };
+    unsigned int a, b, c, d;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return f;
+
+    f.sse2 = (d & bit_SSE2) != 0;
+
+    // AVX2 needs both CPU support and the OS saving YMM state.
+    if ((c & bit_OSXSAVE) && (c & bit_AVX)) {
+        uint32_t xcr0_lo, xcr0_hi;
+        __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        if ((xcr0_lo & 0x6) == 0x6 && __get_cpuid_max(0, NULL) >= 7) {
+            __cpuid_count(7, 0, a, b, c, d);
+            f.avx2 = (b & bit_AVX2) != 0;
+        }
+    }
+
+    return f;
+}
+
+#else
+
+static cpu_features detect()
+{
+    cpu_features f = { false, false, false };
+#if P1_HAVE_NEON
+    // NEON is mandatory on the ARM targets we build for.
+    f.neon = true;
+#endif
+    return f;
+}
+
+#endif
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,31 @@
+#ifndef p1_mac_plugins_cpu_features_h
+#define p1_mac_plugins_cpu_features_h
+
+namespace p1_mac_plugins {
+
+
+// Instruction set extensions usable at runtime, detected once. Kernels are
+// compiled for each extension and selected based on this.
+struct cpu_features {
+    bool sse2;
+    bool avx2;
+    bool neon;
+};
+
+const cpu_features &get_cpu_features();
+
+
+}  // namespace p1_mac_plugins
+
+// Mark a function as compiled for a specific x86 extension, regardless of
+// the baseline target of the translation unit.
+#if defined(__x86_64__) || defined(__i386__)
+#   define P1_HAVE_X86_SIMD 1
+#   define P1_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define P1_HAVE_NEON 1
+#endif
+
+#endif  // p1_mac_plugins_cpu_features_h
@@ -0,0 +1,228 @@
+#include "delay_line.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+
+static void interp_scalar(const float *in, float *out, size_t count,
+    uint32_t stride, const float *coefs)
+{
+    const float *x0 = in, *x1 = in + stride, *x2 = in + 2 * stride, *x3 = in + 3 * stride;
+    for (size_t j = 0; j < count; j++)
+        out[j] = coefs[0] * x0[j] + coefs[1] * x1[j] + coefs[2] * x2[j] + coefs[3] * x3[j];
+}
+
+#if P1_HAVE_X86_SIMD
+
+static void interp_sse2(const float *in, float *out, size_t count,
+    uint32_t stride, const float *coefs)
+{
+    const float *x0 = in, *x1 = in + stride, *x2 = in + 2 * stride, *x3 = in + 3 * stride;
+    __m128 c0 = _mm_set1_ps(coefs[0]), c1 = _mm_set1_ps(coefs[1]);
+    __m128 c2 = _mm_set1_ps(coefs[2]), c3 = _mm_set1_ps(coefs[3]);
+
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m128 acc = _mm_mul_ps(c0, _mm_loadu_ps(x0 + j));
+        acc = _mm_add_ps(acc, _mm_mul_ps(c1, _mm_loadu_ps(x1 + j)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(c2, _mm_loadu_ps(x2 + j)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(c3, _mm_loadu_ps(x3 + j)));
+        _mm_storeu_ps(out + j, acc);
+    }
+    interp_scalar(in + j, out + j, count - j, stride, coefs);
+}
+
+P1_TARGET_AVX2
+static void interp_avx2(const float *in, float *out, size_t count,
+    uint32_t stride, const float *coefs)
+{
+    const float *x0 = in, *x1 = in + stride, *x2 = in + 2 * stride, *x3 = in + 3 * stride;
+    __m256 c0 = _mm256_set1_ps(coefs[0]), c1 = _mm256_set1_ps(coefs[1]);
+    __m256 c2 = _mm256_set1_ps(coefs[2]), c3 = _mm256_set1_ps(coefs[3]);
+
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 acc = _mm256_mul_ps(c0, _mm256_loadu_ps(x0 + j));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(c1, _mm256_loadu_ps(x1 + j)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(c2, _mm256_loadu_ps(x2 + j)));
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(c3, _mm256_loadu_ps(x3 + j)));
+        _mm256_storeu_ps(out + j, acc);
+    }
+    interp_scalar(in + j, out + j, count - j, stride, coefs);
+}
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+static void interp_neon(const float *in, float *out, size_t count,
+    uint32_t stride, const float *coefs)
+{
+    const float *x0 = in, *x1 = in + stride, *x2 = in + 2 * stride, *x3 = in + 3 * stride;
+
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4) {
+        float32x4_t acc = vmulq_n_f32(vld1q_f32(x0 + j), coefs[0]);
+        acc = vmlaq_n_f32(acc, vld1q_f32(x1 + j), coefs[1]);
+        acc = vmlaq_n_f32(acc, vld1q_f32(x2 + j), coefs[2]);
+        acc = vmlaq_n_f32(acc, vld1q_f32(x3 + j), coefs[3]);
+        vst1q_f32(out + j, acc);
+    }
+    interp_scalar(in + j, out + j, count - j, stride, coefs);
+}
+
+#endif  // P1_HAVE_NEON
+
+static delay_interp_fn select_delay_interp_kernel()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return interp_avx2;
+    if (cpu.sse2)
+        return interp_sse2;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return interp_neon;
+#endif
+    (void) cpu;
+    return interp_scalar;
+}
+
+delay_interp_fn get_delay_interp_kernel()
+{
+    static const delay_interp_fn fn = select_delay_interp_kernel();
+    return fn;
+}
+
+
+delay_line::delay_line() :
+    interp(get_delay_interp_kernel()), channels(0), max_delay(0), max_block(0),
+    cap(0), written(0), cur_delay(0)
+{
+}
+
+void delay_line::configure(uint32_t channels_, size_t max_delay_frames_,
+    size_t max_block_frames_)
+{
+    channels = channels_;
+    max_delay = max_delay_frames_;
+    max_block = max_block_frames_;
+
+    // Room for the oldest tap of the first frame of a block at max delay.
+    cap = max_delay + max_block + 4;
+    ring.reset(new float[2 * cap * channels]);
+    fade_scratch.reset(new float[max_block * channels]);
+    reset();
+}
+
+void delay_line::reset()
+{
+    if (ring)
+        std::fill(ring.get(), ring.get() + 2 * cap * channels, 0.0f);
+    written = 0;
+    cur_delay = 0;
+}
+
+void delay_line::write(const float *in, size_t frames)
+{
+    size_t pos = written % cap;
+    size_t first = std::min(frames, cap - pos);
+    size_t rest = frames - first;
+
+    float *lo = ring.get();
+    float *hi = ring.get() + cap * channels;
+    memcpy(lo + pos * channels, in, first * channels * sizeof(float));
+    memcpy(hi + pos * channels, in, first * channels * sizeof(float));
+    memcpy(lo, in + first * channels, rest * channels * sizeof(float));
+    memcpy(hi, in + first * channels, rest * channels * sizeof(float));
+
+    written += frames;
+}
+
+// Read the last written block of `frames` frames, delayed.
+void delay_line::read(float *out, size_t frames, double delay_frames)
+{
+    if (delay_frames <= 0) {
+        size_t pos = (written - frames) % cap;
+        memcpy(out, ring.get() + pos * channels, frames * channels * sizeof(float));
+        return;
+    }
+
+    // Output frame n is input frame n - k - u, which lies between frames
+    // n - k and n - k - 1. Interpolate from frames n - k + 1 to n - k - 2.
+    auto k = (size_t) floor(delay_frames);
+    float u = (float) (delay_frames - k);
+    float coefs[4] = {
+        (u + 1) * u * (u - 1) / 6,
+        -(u + 1) * u * (u - 2) / 2,
+        (u + 1) * (u - 1) * (u - 2) / 2,
+        -u * (u - 1) * (u - 2) / 6
+    };
+
+    // Taps are ordered oldest first, from frame n - k - 2. Before that much
+    // was written, this wraps into the silent ring, not below zero.
+    size_t pos = (written + cap - frames - k - 2) % cap;
+    interp(ring.get() + pos * channels, out, frames * channels, channels, coefs);
+}
+
+double delay_line::clamp_delay(double delay_frames) const
+{
+    delay_frames = std::min(delay_frames, (double) max_delay);
+    if (delay_frames < 0.5)
+        return 0;
+    if (delay_frames < 1)
+        return 1;
+    return delay_frames;
+}
+
+bool delay_line::passes_through(double delay_frames) const
+{
+    return clamp_delay(delay_frames) == 0 && cur_delay == 0;
+}
+
+const float *delay_line::process(const float *in, float *out, size_t frames,
+    double delay_frames)
+{
+    frames = std::min(frames, max_block);
+    delay_frames = clamp_delay(delay_frames);
+
+    write(in, frames);
+    if (delay_frames == 0 && cur_delay == 0)
+        return in;
+
+    read(out, frames, delay_frames);
+
+    // Crossfade from the old delay, to avoid a click on changes.
+    if (delay_frames != cur_delay) {
+        auto *prev = fade_scratch.get();
+        read(prev, frames, cur_delay);
+
+        float step = 1.0f / frames;
+        for (size_t f = 0; f < frames; f++) {
+            float g = f * step;
+            for (uint32_t c = 0; c < channels; c++) {
+                auto i = f * channels + c;
+                out[i] = prev[i] + g * (out[i] - prev[i]);
+            }
+        }
+        cur_delay = delay_frames;
+    }
+
+    return out;
+}
+
+
+}  // namespace p1_mac_plugins
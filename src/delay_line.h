@@ -0,0 +1,66 @@
+#ifndef p1_mac_plugins_delay_line_h
+#define p1_mac_plugins_delay_line_h
+
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Apply `coefs[t]` to taps `t * stride` apart, starting at `in`, producing
+// `count` samples: out[j] = sum of coefs[t] * in[j + t * stride].
+typedef void (*delay_interp_fn)(const float *in, float *out, size_t count,
+    uint32_t stride, const float *coefs);
+
+// Kernel selected for the running CPU.
+delay_interp_fn get_delay_interp_kernel();
+
+// Fractional delay line for interleaved float audio. Delays are in frames,
+// read with 4-point Lagrange interpolation. The delay may change between
+// blocks; the block after a change crossfades from the old to the new delay.
+//
+// History is kept in a mirrored ring, every frame stored twice, so a read
+// window is always contiguous and the interpolation runs as plain vectors.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class delay_line {
+public:
+    delay_line();
+
+    void configure(uint32_t channels_, size_t max_delay_frames_, size_t max_block_frames_);
+    void reset();
+
+    size_t max_delay_frames() const { return max_delay; }
+
+    // Whether `process` with this delay would return its input.
+    bool passes_through(double delay_frames) const;
+
+    // Push a block, and read it back delayed. Returns `out`, or `in` when no
+    // delay is active, in which case `out` may be null.
+    const float *process(const float *in, float *out, size_t frames, double delay_frames);
+
+private:
+    delay_interp_fn interp;
+
+    uint32_t channels;
+    size_t max_delay;
+    size_t max_block;
+
+    // Ring of `cap` frames, stored twice.
+    std::unique_ptr<float[]> ring;
+    size_t cap;
+    uint64_t written;
+
+    double cur_delay;
+    std::unique_ptr<float[]> fade_scratch;
+
+    double clamp_delay(double delay_frames) const;
+    void write(const float *in, size_t frames);
+    void read(float *out, size_t frames, double delay_frames);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_delay_line_h
@@ -1,6 +1,11 @@
 #include "detect_displays.h"
+#include "host_time.h"
+#include "tile_hash.h"
 
+#include <algorithm>
+#include <cstring>
 #include <CoreVideo/CoreVideo.h>
+#include <ImageIO/ImageIO.h>
 
 namespace p1_mac_plugins {
 
@@ -10,6 +15,13 @@ struct display_info {
     size_t height;
 };
 
+// Thumbnail events refer to the latest image, so the buffer does not hold
+// pixels.
+struct thumbnail_event {
+    detect_displays *detect;
+    CGDirectDisplayID display_id;
+};
+
 static void reconfigure_callback(
    CGDirectDisplayID display,
    CGDisplayChangeSummaryFlags flags,
@@ -19,10 +31,16 @@ static Local<Value> events_transform(
 static Local<Value> display_infos_to_js(
     Isolate *isolate, display_info *infos,
     uint32_t count, buffer_slicer &slicer);
+static Local<Value> thumbnail_to_js(
+    Isolate *isolate, thumbnail_event &tev);
+static bool encode_jpeg(
+    const uint8_t *data, size_t stride, size_t width, size_t height,
+    CGColorSpaceRef color_space, std::vector<uint8_t> &out);
 
 
 detect_displays::detect_displays() :
-    buffer(this, events_transform), running(false)
+    buffer(this, events_transform), running(false),
+    thumbnail_width(0), thumbnail_fps(1), thumbnail_interval(0), subscribers(0)
 {
 }
 
@@ -44,13 +62,42 @@ void detect_displays::init(const FunctionCallbackInfo<Value>& args)
             String::NewFromUtf8(isolate, "Expected an onEvent function")));
         return;
     }
+    auto on_event = val.As<Function>();
+
+    val = params->Get(thumbnail_width_sym.Get(isolate));
+    if (!val->IsUndefined()) {
+        if (val->IsUint32())
+            thumbnail_width = val->Uint32Value();
+        if (!val->IsUint32() ||
+            thumbnail_width == 0 || thumbnail_width > DETECT_DISPLAYS_MAX_THUMBNAIL_WIDTH) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid thumbnailWidth value")));
+            return;
+        }
+    }
+
+    val = params->Get(thumbnail_fps_sym.Get(isolate));
+    if (!val->IsUndefined()) {
+        if (val->IsNumber())
+            thumbnail_fps = val->NumberValue();
+        if (!val->IsNumber() ||
+            !(thumbnail_fps > 0 && thumbnail_fps <= DETECT_DISPLAYS_MAX_THUMBNAIL_FPS)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid thumbnailFps value")));
+            return;
+        }
+    }
+
+    // A little short of the frame time, so jitter in the capture stage does
+    // not halve the rate.
+    thumbnail_interval = ns_to_host_time((uint64_t) (875000000 / thumbnail_fps));
 
     // Parameters checked, from here on we no longer throw exceptions.
     Wrap(args.This());
     Ref();
     args.GetReturnValue().Set(handle());
 
-    buffer.set_callback(isolate->GetCurrentContext(), val.As<Function>());
+    buffer.set_callback(isolate->GetCurrentContext(), on_event);
 
     auto cg_ret = CGDisplayRegisterReconfigurationCallback(reconfigure_callback, this);
     if (cg_ret != kCGErrorSuccess) {
@@ -72,11 +119,41 @@ void detect_displays::destroy()
             buffer.emitf(EV_LOG_ERROR, "CGDisplayRemoveReconfigurationCallback error 0x%x", cg_ret);
     }
 
+    // Not running, so this stops all thumbnails.
+    sync_thumbnails();
+
     buffer.flush();
 
     Unref();
 }
 
+void detect_displays::subscribe_thumbnails(const FunctionCallbackInfo<Value>& args)
+{
+    if (thumbnail_width == 0) {
+        auto *isolate = args.GetIsolate();
+        isolate->ThrowException(Exception::Error(
+            String::NewFromUtf8(isolate, "Thumbnails not enabled, set thumbnailWidth")));
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(thumbnail_mutex);
+        subscribers++;
+    }
+    sync_thumbnails();
+}
+
+void detect_displays::unsubscribe_thumbnails()
+{
+    {
+        std::lock_guard<std::mutex> guard(thumbnail_mutex);
+        if (subscribers == 0)
+            return;
+        subscribers--;
+    }
+    sync_thumbnails();
+}
+
 lockable *detect_displays::lock()
 {
     return mutex.lock();
@@ -89,8 +166,11 @@ static void reconfigure_callback(
 {
     // Ignore the begin pass.
     // FIXME: how to neatly emit only once per reconf here?
-    if (flags != kCGDisplayBeginConfigurationFlag)
-        ((detect_displays *) userInfo)->emit_change();
+    if (flags != kCGDisplayBeginConfigurationFlag) {
+        auto *detect = (detect_displays *) userInfo;
+        detect->emit_change();
+        detect->sync_thumbnails();
+    }
 }
 
 void detect_displays::emit_change()
@@ -106,8 +186,8 @@ void detect_displays::emit_change()
         return;
     }
 
-    CGDirectDisplayID ids[count];
-    cg_ret = CGGetOnlineDisplayList(count, ids, &count);
+    std::vector<CGDirectDisplayID> ids(count);
+    cg_ret = CGGetOnlineDisplayList(count, ids.data(), &count);
     if (cg_ret != kCGErrorSuccess) {
         buffer.emitf(EV_LOG_ERROR, "CGGetOnlineDisplayList error 0x%x", cg_ret);
         return;
@@ -127,6 +207,298 @@ void detect_displays::emit_change()
     }
 }
 
+// Start captures of online displays while subscribed, and stop captures of
+// displays that went away or changed size. Never called with the lock.
+void detect_displays::sync_thumbnails()
+{
+    std::lock_guard<std::mutex> guard(thumbnail_mutex);
+
+    uint32_t count = 0;
+    if (running && subscribers != 0) {
+        auto cg_ret = CGGetOnlineDisplayList(0, NULL, &count);
+        if (cg_ret != kCGErrorSuccess) {
+            lock_handle lock(*this);
+            buffer.emitf(EV_LOG_ERROR, "CGGetOnlineDisplayList error 0x%x", cg_ret);
+            count = 0;
+        }
+    }
+
+    std::vector<CGDirectDisplayID> ids(count);
+    if (count != 0) {
+        auto cg_ret = CGGetOnlineDisplayList(count, ids.data(), &count);
+        if (cg_ret != kCGErrorSuccess) {
+            lock_handle lock(*this);
+            buffer.emitf(EV_LOG_ERROR, "CGGetOnlineDisplayList error 0x%x", cg_ret);
+            count = 0;
+        }
+    }
+
+    for (auto it = thumbnails.begin(); it != thumbnails.end(); ) {
+        auto *thumb = *it;
+        auto id = thumb->display_id;
+        bool keep = std::find(ids.begin(), ids.begin() + count, id) != ids.begin() + count &&
+            CGDisplayPixelsWide(id) == thumb->display_width &&
+            CGDisplayPixelsHigh(id) == thumb->display_height;
+        if (keep) {
+            ++it;
+            continue;
+        }
+
+        close_thumbnail(*thumb);
+        delete thumb;
+        it = thumbnails.erase(it);
+
+        std::lock_guard<std::mutex> image_guard(image_mutex);
+        images.erase(id);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        auto id = ids[i];
+        bool found = std::find_if(thumbnails.begin(), thumbnails.end(),
+            [id](display_thumbnail *thumb) { return thumb->display_id == id; }) != thumbnails.end();
+        if (found)
+            continue;
+
+        auto *thumb = new display_thumbnail();
+        thumb->display_id = id;
+        if (open_thumbnail(*thumb)) {
+            thumbnails.push_back(thumb);
+        }
+        else {
+            close_thumbnail(*thumb);
+            delete thumb;
+        }
+    }
+}
+
+bool detect_displays::open_thumbnail(display_thumbnail &thumb)
+{
+    auto id = thumb.display_id;
+    thumb.dispatch = NULL;
+    thumb.cg_handle = NULL;
+    thumb.running = false;
+    thumb.last_time = 0;
+
+    thumb.display_width = CGDisplayPixelsWide(id);
+    thumb.display_height = CGDisplayPixelsHigh(id);
+    if (thumb.display_width == 0 || thumb.display_height == 0) {
+        lock_handle lock(*this);
+        buffer.emitf(EV_LOG_ERROR, "Display %u not available", id);
+        return false;
+    }
+
+    // Never upscale.
+    thumb.width = std::min(thumbnail_width, thumb.display_width);
+    thumb.height = std::max((size_t) 1, thumb.width * thumb.display_height / thumb.display_width);
+    thumb.capture_width = std::min(thumb.width * 2, thumb.display_width);
+    thumb.capture_height = std::max((size_t) 1, thumb.capture_width * thumb.display_height / thumb.display_width);
+    thumb.scaler.configure(scale_filter_lanczos3, nullptr);
+
+    thumb.dispatch = dispatch_queue_create("detect_displays.thumbnail", DISPATCH_QUEUE_SERIAL);
+    if (thumb.dispatch == NULL) {
+        lock_handle lock(*this);
+        buffer.emitf(EV_LOG_ERROR, "dispatch_queue_create error");
+        return false;
+    }
+
+    // Rate limiting and a first downscale happen in the capture stage.
+    auto properties = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    double frame_time = 1.0 / thumbnail_fps;
+    auto num = CFNumberCreate(kCFAllocatorDefault, kCFNumberDoubleType, &frame_time);
+    CFDictionarySetValue(properties, kCGDisplayStreamMinimumFrameTime, num);
+    CFRelease(num);
+
+    auto *thumb_ptr = &thumb;
+    thumb.cg_handle = CGDisplayStreamCreateWithDispatchQueue(
+        id, thumb.capture_width, thumb.capture_height, 'BGRA', properties, thumb.dispatch, ^(
+            CGDisplayStreamFrameStatus status,
+            uint64_t displayTime,
+            IOSurfaceRef frameSurface,
+            CGDisplayStreamUpdateRef updateRef)
+        {
+            if (status == kCGDisplayStreamFrameStatusFrameComplete && frameSurface != NULL)
+                store_thumbnail(*thumb_ptr, frameSurface, displayTime);
+        });
+    CFRelease(properties);
+    if (thumb.cg_handle == NULL) {
+        lock_handle lock(*this);
+        buffer.emitf(EV_LOG_ERROR, "CGDisplayStreamCreateWithDispatchQueue error");
+        return false;
+    }
+
+    auto cg_ret = CGDisplayStreamStart(thumb.cg_handle);
+    if (cg_ret != kCGErrorSuccess) {
+        lock_handle lock(*this);
+        buffer.emitf(EV_LOG_ERROR, "CGDisplayStreamStart error 0x%x", cg_ret);
+        return false;
+    }
+
+    thumb.running = true;
+    return true;
+}
+
+void detect_displays::close_thumbnail(display_thumbnail &thumb)
+{
+    if (thumb.running) {
+        thumb.running = false;
+
+        auto cg_ret = CGDisplayStreamStop(thumb.cg_handle);
+        if (cg_ret != kCGErrorSuccess) {
+            lock_handle lock(*this);
+            buffer.emitf(EV_LOG_ERROR, "CGDisplayStreamStop error 0x%x", cg_ret);
+        }
+    }
+
+    // Let a callback in progress finish.
+    if (thumb.dispatch != NULL)
+        dispatch_sync(thumb.dispatch, ^{});
+
+    if (thumb.cg_handle != NULL) {
+        CFRelease(thumb.cg_handle);
+        thumb.cg_handle = NULL;
+    }
+
+    if (thumb.dispatch != NULL) {
+        dispatch_release(thumb.dispatch);
+        thumb.dispatch = NULL;
+    }
+}
+
+// Compress a frame to the latest image, and emit an event if it changed.
+// Frames are also dropped to the configured rate, in case the capture stage
+// delivers faster. Mostly static screens then cost little more than the
+// capture. Only on the dispatch queue of the thumbnail.
+void detect_displays::store_thumbnail(display_thumbnail &thumb, IOSurfaceRef surface,
+    uint64_t display_time)
+{
+    if (thumb.last_time != 0 && display_time - thumb.last_time < thumbnail_interval)
+        return;
+    thumb.last_time = display_time;
+
+    auto io_ret = IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL);
+    if (io_ret != kIOReturnSuccess) {
+        lock_handle lock(*this);
+        buffer.emitf(EV_LOG_ERROR, "IOSurfaceLock error 0x%x", io_ret);
+        return;
+    }
+
+    auto *data = (const uint8_t *) IOSurfaceGetBaseAddress(surface);
+    auto stride = IOSurfaceGetBytesPerRow(surface);
+    auto capture_width = IOSurfaceGetWidth(surface);
+    auto capture_height = IOSurfaceGetHeight(surface);
+    auto hash = get_tile_hash_kernels().hash(data, stride, capture_width, capture_height);
+    auto width = thumb.width;
+    auto height = thumb.height;
+
+    // Only this queue writes the image of this display.
+    bool changed;
+    {
+        std::lock_guard<std::mutex> guard(image_mutex);
+        auto it = images.find(thumb.display_id);
+        changed = it == images.end() || it->second.hash != hash ||
+            it->second.width != width || it->second.height != height;
+    }
+
+    // Only this queue uses the scaler and pixels of this thumbnail.
+    std::vector<uint8_t> jpeg;
+    bool scaled = true;
+    bool encoded = false;
+    if (changed) {
+        if (capture_width != width || capture_height != height) {
+            thumb.pixels.resize(width * height * 4);
+            image_desc src = { image_format_bgra, (int32_t) capture_width, (int32_t) capture_height,
+                { { (uint8_t *) data, stride } } };
+            image_desc dst = { image_format_bgra, (int32_t) width, (int32_t) height,
+                { { thumb.pixels.data(), width * 4 } } };
+            scaled = thumb.scaler.scale(src, dst);
+            data = thumb.pixels.data();
+            stride = width * 4;
+        }
+
+        if (scaled) {
+            auto color_space = CGDisplayCopyColorSpace(thumb.display_id);
+            if (color_space == NULL)
+                color_space = CGColorSpaceCreateDeviceRGB();
+            encoded = encode_jpeg(data, stride, width, height, color_space, jpeg);
+            CGColorSpaceRelease(color_space);
+        }
+    }
+
+    IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+
+    if (!changed)
+        return;
+    if (!scaled) {
+        lock_handle lock(*this);
+        buffer.emitf(EV_LOG_ERROR, "Thumbnail scaling failed");
+        return;
+    }
+    if (!encoded) {
+        lock_handle lock(*this);
+        buffer.emitf(EV_LOG_ERROR, "Thumbnail JPEG encoding failed");
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(image_mutex);
+        auto &image = images[thumb.display_id];
+        image.width = width;
+        image.height = height;
+        image.hash = hash;
+        image.jpeg.swap(jpeg);
+    }
+
+    lock_handle lock(*this);
+    auto *ev = buffer.emit(EV_DISPLAY_THUMBNAIL, sizeof(thumbnail_event));
+    if (ev != NULL) {
+        auto *tev = (thumbnail_event *) ev->data;
+        tev->detect = this;
+        tev->display_id = thumb.display_id;
+    }
+}
+
+// Compress BGRA rows to a JPEG image. The pixels are not copied.
+static bool encode_jpeg(
+    const uint8_t *data, size_t stride, size_t width, size_t height,
+    CGColorSpaceRef color_space, std::vector<uint8_t> &out)
+{
+    auto provider = CGDataProviderCreateWithData(NULL, data, stride * height, NULL);
+    if (provider == NULL)
+        return false;
+    auto image = CGImageCreate(width, height, 8, 32, stride, color_space,
+        kCGImageAlphaNoneSkipFirst | kCGBitmapByteOrder32Little,
+        provider, NULL, false, kCGRenderingIntentDefault);
+    CGDataProviderRelease(provider);
+    if (image == NULL)
+        return false;
+
+    auto output = CFDataCreateMutable(kCFAllocatorDefault, 0);
+    auto dest = CGImageDestinationCreateWithData(output, CFSTR("public.jpeg"), 1, NULL);
+    bool ok = false;
+    if (dest != NULL) {
+        auto properties = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+            &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        double quality = DETECT_DISPLAYS_THUMBNAIL_QUALITY;
+        auto num = CFNumberCreate(kCFAllocatorDefault, kCFNumberDoubleType, &quality);
+        CFDictionarySetValue(properties, kCGImageDestinationLossyCompressionQuality, num);
+        CFRelease(num);
+
+        CGImageDestinationAddImage(dest, image, properties);
+        ok = CGImageDestinationFinalize(dest);
+        CFRelease(properties);
+        CFRelease(dest);
+    }
+    CGImageRelease(image);
+
+    if (ok) {
+        auto *bytes = CFDataGetBytePtr(output);
+        out.assign(bytes, bytes + CFDataGetLength(output));
+    }
+    CFRelease(output);
+    return ok;
+}
+
 static Local<Value> events_transform(
     Isolate *isolate, event &ev, buffer_slicer &slicer)
 {
@@ -136,6 +508,8 @@ static Local<Value> events_transform(
                 isolate, (display_info *) ev.data,
                 ev.size / sizeof(display_info), slicer
             );
+        case EV_DISPLAY_THUMBNAIL:
+            return thumbnail_to_js(isolate, *(thumbnail_event *) ev.data);
         default:
             return Undefined(isolate);
     }
@@ -161,12 +535,45 @@ static Local<Value> display_infos_to_js(
     return arr;
 }
 
+// Copies the latest image, which may be newer than the event. Null if the
+// thumbnail stopped since.
+static Local<Value> thumbnail_to_js(
+    Isolate *isolate, thumbnail_event &tev)
+{
+    auto *detect = tev.detect;
+    std::lock_guard<std::mutex> guard(detect->image_mutex);
+
+    auto it = detect->images.find(tev.display_id);
+    if (it == detect->images.end())
+        return Null(isolate);
+    auto &image = it->second;
+
+    auto size = image.jpeg.size();
+    auto buf = ArrayBuffer::New(isolate, size);
+    memcpy(buf->GetContents().Data(), image.jpeg.data(), size);
+
+    auto obj = Object::New(isolate);
+    obj->Set(display_id_sym.Get(isolate), Uint32::NewFromUnsigned(isolate, tev.display_id));
+    obj->Set(width_sym.Get(isolate), Uint32::NewFromUnsigned(isolate, image.width));
+    obj->Set(height_sym.Get(isolate), Uint32::NewFromUnsigned(isolate, image.height));
+    obj->Set(String::NewFromUtf8(isolate, "data"), Uint8Array::New(buf, 0, size));
+    return obj;
+}
+
 void detect_displays::init_prototype(Handle<FunctionTemplate> func)
 {
     NODE_SET_PROTOTYPE_METHOD(func, "destroy", [](const FunctionCallbackInfo<Value>& args) {
         auto detect = ObjectWrap::Unwrap<detect_displays>(args.This());
         detect->destroy();
     });
+    NODE_SET_PROTOTYPE_METHOD(func, "subscribeThumbnails", [](const FunctionCallbackInfo<Value>& args) {
+        auto detect = ObjectWrap::Unwrap<detect_displays>(args.This());
+        detect->subscribe_thumbnails(args);
+    });
+    NODE_SET_PROTOTYPE_METHOD(func, "unsubscribeThumbnails", [](const FunctionCallbackInfo<Value>& args) {
+        auto detect = ObjectWrap::Unwrap<detect_displays>(args.This());
+        detect->unsubscribe_thumbnails();
+    });
 }
 
 
@@ -3,11 +3,57 @@
 
 #include "p1stream.h"
 #include "module.h"
+#include "scaler.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <CoreGraphics/CoreGraphics.h>
+#include <IOSurface/IOSurface.h>
+#include <dispatch/dispatch.h>
 
 namespace p1_mac_plugins {
 
 
 #define EV_DISPLAYS_CHANGED 'disp'
+#define EV_DISPLAY_THUMBNAIL 'dthm'
+
+#define DETECT_DISPLAYS_MAX_THUMBNAIL_WIDTH 1920
+#define DETECT_DISPLAYS_MAX_THUMBNAIL_FPS 30
+#define DETECT_DISPLAYS_THUMBNAIL_QUALITY 0.7
+
+// A small, low rate capture of one display, while thumbnails are
+// subscribed to.
+struct display_thumbnail {
+    CGDirectDisplayID display_id;
+    size_t display_width;
+    size_t display_height;
+    size_t width;
+    size_t height;
+
+    // Captured at up to twice our size, and filtered down on the dispatch
+    // queue, which keeps text more legible than scaling in the capture stage.
+    size_t capture_width;
+    size_t capture_height;
+    image_scaler scaler;
+    std::vector<uint8_t> pixels;
+
+    dispatch_queue_t dispatch;
+    CGDisplayStreamRef cg_handle;
+    bool running;
+
+    // Display time of the last frame looked at, for rate limiting.
+    uint64_t last_time;
+};
+
+// Latest image of a display, JPEG compressed.
+struct thumbnail_image {
+    size_t width;
+    size_t height;
+    uint64_t hash;
+    std::vector<uint8_t> jpeg;
+};
 
 class detect_displays : public ObjectWrap, public lockable {
 public:
@@ -18,12 +64,35 @@ public:
 
     bool running;
 
+    // Thumbnail mode, opted into with `thumbnailWidth`. Captures run while
+    // there are subscribers.
+    size_t thumbnail_width;
+    double thumbnail_fps;
+    uint64_t thumbnail_interval;
+    uint32_t subscribers;
+
+    // Serializes starting and stopping of captures. Capture callbacks never
+    // take it, so we can wait for them while holding it.
+    std::mutex thumbnail_mutex;
+    std::list<display_thumbnail *> thumbnails;
+
+    // Latest images by display, copied out when events are transformed.
+    std::mutex image_mutex;
+    std::map<CGDirectDisplayID, thumbnail_image> images;
+
     // Internal.
     void emit_change();
+    void sync_thumbnails();
+    bool open_thumbnail(display_thumbnail &thumb);
+    void close_thumbnail(display_thumbnail &thumb);
+    void store_thumbnail(display_thumbnail &thumb, IOSurfaceRef surface,
+        uint64_t display_time);
 
     // Public JavaScript methods.
     void init(const FunctionCallbackInfo<Value>& args);
     void destroy();
+    void subscribe_thumbnails(const FunctionCallbackInfo<Value>& args);
+    void unsubscribe_thumbnails();
 
     // Lockable implementation.
     virtual lockable *lock() final;
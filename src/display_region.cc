@@ -0,0 +1,259 @@
+#include "display_region.h"
+#include "display_stream.h"
+
+#include <cstring>
+
+namespace p1_mac_plugins {
+
+static IOSurfaceRef create_surface(int32_t width, int32_t height);
+static void set_number(CFMutableDictionaryRef dict, CFStringRef key, int value);
+
+
+display_region::display_region() :
+    buffer(this), session(nullptr), rect { 0, 0, 0, 0 }, surfaces { NULL, NULL },
+    current(0)
+{
+}
+
+void display_region::init(const FunctionCallbackInfo<Value>& args)
+{
+    auto *isolate = args.GetIsolate();
+    Handle<Value> val;
+
+    if (args.Length() != 1 || !args[0]->IsObject()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Expected an object")));
+        return;
+    }
+    auto params = args[0].As<Object>();
+
+    val = params->Get(stream_sym.Get(isolate));
+    auto stream_tmpl = Local<FunctionTemplate>::New(isolate, display_stream_tmpl);
+    if (!stream_tmpl->HasInstance(val)) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Expected a DisplayStream")));
+        return;
+    }
+    auto *stream = ObjectWrap::Unwrap<display_stream>(val.As<Object>());
+
+    // The stream may be rendering, only touch its session while locked.
+    OSType pixel_format;
+    size_t stream_width, stream_height;
+    {
+        lock_handle stream_lock(*stream);
+        if (stream->session == nullptr) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "DisplayStream is not running")));
+            return;
+        }
+        pixel_format = stream->session->config.pixel_format;
+        stream_width = stream->session->width;
+        stream_height = stream->session->height;
+    }
+
+    if (pixel_format != 'BGRA') {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "DisplayStream must use the BGRA pixel format")));
+        return;
+    }
+
+    // In stream output coordinates.
+    val = params->Get(source_rect_sym.Get(isolate));
+    if (!pixel_rect_from_js(isolate, val, rect) ||
+        (size_t) rect.right() > stream_width ||
+        (size_t) rect.bottom() > stream_height) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid sourceRect value")));
+        return;
+    }
+
+    val = params->Get(on_event_sym.Get(isolate));
+    if (!val->IsFunction()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Expected an onEvent function")));
+        return;
+    }
+
+    // Parameters checked, from here on we no longer throw exceptions.
+    Wrap(args.This());
+    Ref();
+    args.GetReturnValue().Set(handle());
+
+    buffer.set_callback(isolate->GetCurrentContext(), val.As<Function>());
+
+    for (auto &surface : surfaces) {
+        surface = create_surface(rect.width, rect.height);
+        if (surface == NULL) {
+            buffer.emitf(EV_LOG_ERROR, "IOSurfaceCreate error");
+            return;
+        }
+    }
+
+    // Share the running session of the stream, and keep it running after the
+    // stream is destroyed. Streams only start and stop on this thread, so it
+    // is still the one we checked above.
+    {
+        lock_handle stream_lock(*stream);
+        session = stream->session;
+        display_session::retain(session);
+    }
+
+    // Start with a full copy.
+    pending.configure((int32_t) session->width, (int32_t) session->height);
+    for (auto &d : dirty) {
+        d.configure((int32_t) session->width, (int32_t) session->height);
+        d.add_all();
+    }
+
+    lock_handle lock(*session);
+    session->consumers.push_back(&pending);
+}
+
+void display_region::destroy()
+{
+    {
+        lock_handle lock(*this);
+
+        if (session != nullptr) {
+            {
+                lock_handle session_lock(*session);
+                session->consumers.remove(&pending);
+            }
+            display_session::release(session, buffer);
+            session = nullptr;
+        }
+
+        for (auto &surface : surfaces) {
+            if (surface != NULL) {
+                CFRelease(surface);
+                surface = NULL;
+            }
+        }
+    }
+
+    buffer.flush();
+
+    Unref();
+}
+
+lockable *display_region::lock()
+{
+    return mutex.lock();
+}
+
+void display_region::produce_video_frame(video_source_context &ctx)
+{
+    lock_handle lock(*this);
+
+    if (session == nullptr)
+        return;
+
+    // The session keeps its current surface while locked.
+    {
+        lock_handle session_lock(*session);
+        auto *frame = session->refresh();
+        if (frame == nullptr || frame->surface == NULL)
+            return;
+        if (!update(frame->surface))
+            return;
+    }
+
+    ctx.render_iosurface(surfaces[current]);
+}
+
+// Bring the surface not shown last up to date from the session surface, and
+// show it next. If the renderer still uses it, keep showing the other one
+// for now. Changes outside our area are of no interest. Returns false if
+// the frame should be skipped.
+//
+// This relies on the renderer holding a use count on a surface for as long
+// as it may read it, as IOSurface users across processes and GPU textures
+// do, so a surface not in use is safe to overwrite. We render one surface
+// per frame, so the other is normally released by the time we need it.
+bool display_region::update(IOSurfaceRef source)
+{
+    if (!pending.empty()) {
+        for (auto &d : dirty)
+            d.add_set(pending);
+        pending.clear();
+    }
+
+    auto next = 1 - current;
+    auto target = surfaces[next];
+    if (dirty[next].empty() || IOSurfaceIsInUse(target))
+        return true;
+
+    if (IOSurfaceGetWidth(source) < (size_t) rect.right() ||
+        IOSurfaceGetHeight(source) < (size_t) rect.bottom()) {
+        dirty[next].clear();
+        return true;
+    }
+
+    auto ret = IOSurfaceLock(source, kIOSurfaceLockReadOnly, NULL);
+    if (ret != kIOReturnSuccess) {
+        buffer.emitf(EV_LOG_ERROR, "IOSurfaceLock error 0x%x", ret);
+        return false;
+    }
+    ret = IOSurfaceLock(target, 0, NULL);
+    if (ret != kIOReturnSuccess) {
+        IOSurfaceUnlock(source, kIOSurfaceLockReadOnly, NULL);
+        buffer.emitf(EV_LOG_ERROR, "IOSurfaceLock error 0x%x", ret);
+        return false;
+    }
+
+    auto *src = (const uint8_t *) IOSurfaceGetBaseAddress(source);
+    auto src_stride = IOSurfaceGetBytesPerRow(source);
+    auto *dst = (uint8_t *) IOSurfaceGetBaseAddress(target);
+    auto dst_stride = IOSurfaceGetBytesPerRow(target);
+
+    for (auto &changed : dirty[next]) {
+        auto r = changed.intersected(rect);
+        if (r.empty())
+            continue;
+
+        auto row_size = (size_t) r.width * 4;
+        for (int32_t y = r.y; y < r.bottom(); y++) {
+            memcpy(dst + (y - rect.y) * dst_stride + (r.x - rect.x) * 4,
+                   src + y * src_stride + r.x * 4, row_size);
+        }
+    }
+
+    IOSurfaceUnlock(target, 0, NULL);
+    IOSurfaceUnlock(source, kIOSurfaceLockReadOnly, NULL);
+
+    dirty[next].clear();
+    current = next;
+    return true;
+}
+
+static IOSurfaceRef create_surface(int32_t width, int32_t height)
+{
+    auto properties = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    set_number(properties, kIOSurfaceWidth, width);
+    set_number(properties, kIOSurfaceHeight, height);
+    set_number(properties, kIOSurfaceBytesPerElement, 4);
+    set_number(properties, kIOSurfacePixelFormat, 'BGRA');
+
+    auto surface = IOSurfaceCreate(properties);
+    CFRelease(properties);
+    return surface;
+}
+
+static void set_number(CFMutableDictionaryRef dict, CFStringRef key, int value)
+{
+    auto num = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &value);
+    CFDictionarySetValue(dict, key, num);
+    CFRelease(num);
+}
+
+void display_region::init_prototype(Handle<FunctionTemplate> func)
+{
+    NODE_SET_PROTOTYPE_METHOD(func, "destroy", [](const FunctionCallbackInfo<Value>& args) {
+        auto region = ObjectWrap::Unwrap<display_region>(args.This());
+        region->destroy();
+    });
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,60 @@
+#ifndef p1_mac_plugins_display_region_h
+#define p1_mac_plugins_display_region_h
+
+#include "p1stream.h"
+#include "module.h"
+
+#include "display_session.h"
+#include "rect_set.h"
+
+#include <IOSurface/IOSurface.h>
+
+namespace p1_mac_plugins {
+
+
+// Video source for an area of a display stream's frames, sharing its
+// session. Sources only render whole surfaces, so we keep surfaces the size
+// of our area, and copy only what changed inside it from the current session
+// frame. Requires a BGRA stream.
+class display_region : public video_source, public lockable {
+public:
+    display_region();
+
+    lockable_mutex mutex;
+    event_buffer buffer;
+
+    // The session of the stream we were created with, null once destroyed.
+    // Our area, in stream output coordinates.
+    display_session *session;
+    pixel_rect rect;
+
+    // Our copy of the area, in two surfaces, so we never write to the one
+    // the renderer may still be reading. Changes of session frames we have
+    // not yet seen, collected by the session in its coordinates, and those
+    // each surface still lacks.
+    IOSurfaceRef surfaces[2];
+    size_t current;
+    rect_set pending;
+    rect_set dirty[2];
+
+    // Internal.
+    bool update(IOSurfaceRef source);
+
+    // Public JavaScript methods.
+    void init(const FunctionCallbackInfo<Value>& args);
+    void destroy();
+
+    // Lockable implementation.
+    virtual lockable *lock() final;
+
+    // Video source implementation.
+    virtual void produce_video_frame(video_source_context &ctx) final;
+
+    // Module init.
+    static void init_prototype(Handle<FunctionTemplate> func);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_display_region.h
@@ -0,0 +1,579 @@
+#include "display_session.h"
+#include "frame_latency.h"
+#include "host_time.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace p1_mac_plugins {
+
+// Open sessions, see `display_session::acquire`.
+static std::mutex registry_mutex;
+static std::list<display_session *> registry;
+
+// How long `close` waits for the capture to stop. It usually takes a frame.
+static const int64_t stop_timeout_ns = 2 * NSEC_PER_SEC;
+
+static void display_session_callback(
+    display_session &session,
+    CGDisplayStreamFrameStatus status,
+    uint64_t display_time,
+    uint64_t arrival_time,
+    IOSurfaceRef frame,
+    CGDisplayStreamUpdateRef update);
+static void add_update_rects(
+    display_session &session,
+    CGDisplayStreamUpdateRef update);
+static void hash_frame(
+    display_session &session,
+    IOSurfaceRef surface,
+    bool skip);
+static void release_surface(IOSurfaceRef &surface);
+static void evict_frame(display_frame &frame, display_frame *next);
+
+
+bool display_session_config::shares_with(const display_session_config &other) const
+{
+    return display_id == other.display_id &&
+        source_rect.x == other.source_rect.x &&
+        source_rect.y == other.source_rect.y &&
+        source_rect.width == other.source_rect.width &&
+        source_rect.height == other.source_rect.height &&
+        width == other.width &&
+        height == other.height &&
+        pixel_format == other.pixel_format &&
+        max_fps == other.max_fps &&
+        queue_depth == other.queue_depth &&
+        frame_queue == other.frame_queue &&
+        latency_offset_ms == other.latency_offset_ms &&
+        tile_hash == other.tile_hash;
+}
+
+
+display_session::display_session(const display_session_config &config_) :
+    config(config_), users(0), dispatch(NULL), cg_handle(NULL), running(false),
+    stopped(NULL),
+    source_rect(CGRectNull), width(0), height(0), pixel_format(config_.pixel_format),
+    scale_x(1), scale_y(1), queue_length(0), latency_offset(0),
+    hash_dispatch(NULL), hash_pending(0),
+    complete_count(0), idle_count(0), blank_count(0), stopped_count(0)
+{
+    for (size_t i = 0; i < frames.num_slots; i++) {
+        auto &slot = frames.slot(i);
+        slot.surface = NULL;
+        slot.display_time = 0;
+        slot.arrival_time = 0;
+    }
+}
+
+// Find a running session with matching options, or start a new one.
+display_session *display_session::acquire(const display_session_config &config, event_buffer &log)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    auto it = std::find_if(registry.begin(), registry.end(), [&](display_session *session) {
+        return session->config.shares_with(config);
+    });
+
+    display_session *session;
+    if (it != registry.end()) {
+        session = *it;
+    }
+    else {
+        session = new display_session(config);
+        if (!session->open(log)) {
+            if (session->close(log))
+                delete session;
+            return nullptr;
+        }
+        registry.push_back(session);
+    }
+
+    session->users++;
+    return session;
+}
+
+// Share a session, without looking it up again. The caller must hold a user,
+// directly or through the lock of one, so it cannot stop meanwhile.
+void display_session::retain(display_session *session)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    session->users++;
+}
+
+// Stop the session if this was the last user. Users must have removed
+// their consumers.
+void display_session::release(display_session *session, event_buffer &log)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (--session->users == 0) {
+        registry.remove(session);
+        if (session->close(log))
+            delete session;
+    }
+}
+
+bool display_session::open(event_buffer &log)
+{
+    CGError cg_ret;
+    auto display_id = config.display_id;
+
+    size_t display_width  = CGDisplayPixelsWide(display_id);
+    size_t display_height = CGDisplayPixelsHigh(display_id);
+    if (display_width == 0 || display_height == 0) {
+        log.emitf(EV_LOG_ERROR, "Display %u not available", display_id);
+        return false;
+    }
+
+    auto &req_rect = config.source_rect;
+    if (req_rect.empty()) {
+        source_rect = CGRectMake(0, 0, display_width, display_height);
+    }
+    else {
+        if ((size_t) req_rect.right() > display_width || (size_t) req_rect.bottom() > display_height) {
+            log.emitf(EV_LOG_ERROR, "Source rect outside of display %u", display_id);
+            return false;
+        }
+        source_rect = CGRectMake(req_rect.x, req_rect.y, req_rect.width, req_rect.height);
+    }
+    auto source_width = (size_t) source_rect.size.width;
+    auto source_height = (size_t) source_rect.size.height;
+
+    // With only one dimension, the other follows the aspect ratio of the
+    // captured area.
+    width = source_width;
+    height = source_height;
+    if (config.width != 0 && config.height != 0) {
+        width = config.width;
+        height = config.height;
+    }
+    else if (config.width != 0) {
+        width = config.width;
+        height = std::max((size_t) 1, config.width * source_height / source_width);
+    }
+    else if (config.height != 0) {
+        height = config.height;
+        width = std::max((size_t) 1, config.height * source_width / source_height);
+    }
+
+    // Chroma subsampled formats need even dimensions.
+    if (pixel_format != 'BGRA') {
+        width = (width + 1) & ~(size_t) 1;
+        height = (height + 1) & ~(size_t) 1;
+    }
+
+    scale_x = (double) width / source_width;
+    scale_y = (double) height / source_height;
+
+    for (size_t i = 0; i < frames.num_slots; i++)
+        frames.slot(i).dirty.configure((int32_t) width, (int32_t) height);
+    update_dirty.configure((int32_t) width, (int32_t) height);
+    carry_dirty.configure((int32_t) width, (int32_t) height);
+    carry_dirty.add_all();
+
+    // Frames in the ring and the queue hold surfaces, so let the stream
+    // allocate more, unless told otherwise.
+    auto queue_depth = config.queue_depth;
+    if (config.frame_queue != 0) {
+        queue_length = config.frame_queue;
+        latency_offset = ns_to_host_time((uint64_t) (config.latency_offset_ms * 1000000));
+        incoming.reset(new spsc_ring<timed_display_frame>(queue_length));
+        queue.configure(queue_length);
+        if (queue_depth == 0)
+            queue_depth = DISPLAY_STREAM_MAX_QUEUE_DEPTH;
+    }
+
+    dispatch = dispatch_queue_create("display_session", DISPATCH_QUEUE_SERIAL);
+    if (dispatch == NULL) {
+        log.emitf(EV_LOG_ERROR, "dispatch_queue_create error");
+        return false;
+    }
+
+    stopped = dispatch_semaphore_create(0);
+    if (stopped == NULL) {
+        log.emitf(EV_LOG_ERROR, "dispatch_semaphore_create error");
+        return false;
+    }
+
+    if (config.tile_hash) {
+        hasher.configure((int32_t) width, (int32_t) height);
+        hash_dispatch = dispatch_queue_create("display_session.hash", DISPATCH_QUEUE_SERIAL);
+        if (hash_dispatch == NULL) {
+            log.emitf(EV_LOG_ERROR, "dispatch_queue_create error");
+            return false;
+        }
+    }
+
+    // Cropping, scaling, conversion and rate limiting happen in the capture
+    // stage.
+    auto properties = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+        &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    if (!req_rect.empty()) {
+        auto rect = CGRectCreateDictionaryRepresentation(source_rect);
+        CFDictionarySetValue(properties, kCGDisplayStreamSourceRect, rect);
+        CFRelease(rect);
+    }
+    if (config.max_fps > 0) {
+        double frame_time = 1.0 / config.max_fps;
+        auto num = CFNumberCreate(kCFAllocatorDefault, kCFNumberDoubleType, &frame_time);
+        CFDictionarySetValue(properties, kCGDisplayStreamMinimumFrameTime, num);
+        CFRelease(num);
+    }
+    if (queue_depth != 0) {
+        int depth = (int) queue_depth;
+        auto num = CFNumberCreate(kCFAllocatorDefault, kCFNumberIntType, &depth);
+        CFDictionarySetValue(properties, kCGDisplayStreamQueueDepth, num);
+        CFRelease(num);
+    }
+    if (pixel_format != 'BGRA') {
+        auto matrix = kCGDisplayStreamYCbCrMatrix_ITU_R_709_2;
+        CFDictionarySetValue(properties, kCGDisplayStreamYCbCrMatrix, matrix);
+    }
+
+    cg_handle = CGDisplayStreamCreateWithDispatchQueue(
+        display_id, width, height, pixel_format, properties, dispatch, ^(
+            CGDisplayStreamFrameStatus status,
+            uint64_t displayTime,
+            IOSurfaceRef frameSurface,
+            CGDisplayStreamUpdateRef updateRef)
+        {
+            auto arrival_time = host_time_now();
+
+            // The last callback. `close` waits for this, then for the
+            // queues to drain, before letting us go.
+            if (status == kCGDisplayStreamFrameStatusStopped)
+                dispatch_semaphore_signal(stopped);
+
+            if (hash_dispatch == NULL) {
+                display_session_callback(*this, status, displayTime, arrival_time,
+                    frameSurface, updateRef);
+                return;
+            }
+
+            // Keep the frame and update for the hash queue.
+            if (frameSurface != NULL) {
+                CFRetain(frameSurface);
+                IOSurfaceIncrementUseCount(frameSurface);
+            }
+            if (updateRef != NULL)
+                CFRetain(updateRef);
+            hash_pending++;
+            dispatch_async(hash_dispatch, ^{
+                display_session_callback(*this, status, displayTime, arrival_time,
+                    frameSurface, updateRef);
+                hash_pending--;
+                if (frameSurface != NULL) {
+                    IOSurfaceDecrementUseCount(frameSurface);
+                    CFRelease(frameSurface);
+                }
+                if (updateRef != NULL)
+                    CFRelease(updateRef);
+            });
+        });
+    CFRelease(properties);
+    if (cg_handle == NULL) {
+        log.emitf(EV_LOG_ERROR, "CGDisplayStreamCreateWithDispatchQueue error");
+        return false;
+    }
+
+    cg_ret = CGDisplayStreamStart(cg_handle);
+    if (cg_ret != kCGErrorSuccess) {
+        log.emitf(EV_LOG_ERROR, "CGDisplayStreamStart error 0x%x", cg_ret);
+        return false;
+    }
+
+    running = true;
+    return true;
+}
+
+bool display_session::close(event_buffer &log)
+{
+    if (running) {
+        running = false;
+
+        auto cg_ret = CGDisplayStreamStop(cg_handle);
+        if (cg_ret != kCGErrorSuccess) {
+            log.emitf(EV_LOG_ERROR, "CGDisplayStreamStop error 0x%x\n", cg_ret);
+            return false;
+        }
+
+        auto timeout = dispatch_time(DISPATCH_TIME_NOW, stop_timeout_ns);
+        if (dispatch_semaphore_wait(stopped, timeout) != 0) {
+            log.emitf(EV_LOG_ERROR, "Display stream did not stop, leaking it");
+            return false;
+        }
+    }
+
+    // Let callbacks in progress finish, then drop frames on both sides.
+    if (dispatch != NULL)
+        dispatch_sync(dispatch, ^{});
+    if (hash_dispatch != NULL)
+        dispatch_sync(hash_dispatch, ^{});
+    {
+        lock_handle lock(*this);
+        for (size_t i = 0; i < frames.num_slots; i++)
+            release_surface(frames.slot(i).surface);
+
+        if (incoming) {
+            timed_display_frame f;
+            while (incoming->pop(f))
+                release_surface(f.frame.surface);
+            queue.clear(evict_frame);
+        }
+    }
+
+    if (cg_handle != NULL) {
+        CFRelease(cg_handle);
+        cg_handle = NULL;
+    }
+
+    if (dispatch != NULL) {
+        dispatch_release(dispatch);
+        dispatch = NULL;
+    }
+
+    if (hash_dispatch != NULL) {
+        dispatch_release(hash_dispatch);
+        hash_dispatch = NULL;
+    }
+
+    if (stopped != NULL) {
+        dispatch_release(stopped);
+        stopped = NULL;
+    }
+
+    return true;
+}
+
+lockable *display_session::lock()
+{
+    return mutex.lock();
+}
+
+// Advance to the newest frame, or in timed mode the frame to show now, and
+// pass its changes to all consumers. Returns the current frame, if any, which
+// may be blank. Call with the lock held.
+display_frame *display_session::refresh()
+{
+    rect_set *dirty = nullptr;
+    display_frame *frame = nullptr;
+
+    if (queue_length == 0) {
+        if (frames.update())
+            dirty = &frames.front().dirty;
+        frame = &frames.front();
+    }
+    else {
+        timed_display_frame f;
+        while (incoming->pop(f))
+            queue.push(f.time, f.frame, evict_frame);
+
+        // The tick time is not passed to sources, but we render within the
+        // tick, so the current time is close.
+        auto now = host_time_now();
+        auto target = now > latency_offset ? now - latency_offset : 0;
+        auto *selected = queue.select(target, evict_frame);
+        if (selected != nullptr) {
+            // Selecting the frame again means nothing changed, because we
+            // clear its changes once passed on.
+            dirty = &selected->frame.dirty;
+            frame = &selected->frame;
+        }
+    }
+
+    if (dirty != nullptr) {
+        for (auto *consumer : consumers)
+            consumer->add_set(*dirty);
+        dirty->clear();
+    }
+
+    return frame;
+}
+
+// Status counts and capture latency, common to all users.
+Local<Object> display_session::stats(Isolate *isolate)
+{
+    auto obj = Object::New(isolate);
+    obj->Set(String::NewFromUtf8(isolate, "completeFrames"),
+        Number::New(isolate, (double) complete_count.load()));
+    obj->Set(String::NewFromUtf8(isolate, "idleFrames"),
+        Number::New(isolate, (double) idle_count.load()));
+    obj->Set(String::NewFromUtf8(isolate, "blankFrames"),
+        Number::New(isolate, (double) blank_count.load()));
+    obj->Set(String::NewFromUtf8(isolate, "stoppedFrames"),
+        Number::New(isolate, (double) stopped_count.load()));
+    obj->Set(String::NewFromUtf8(isolate, "captureLatencyUs"),
+        histogram_to_js(isolate, capture_latency));
+
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        obj->Set(String::NewFromUtf8(isolate, "sessionUsers"),
+            Uint32::NewFromUnsigned(isolate, users));
+    }
+    return obj;
+}
+
+// Publish new frames, and blank frames when the display goes away. Idle
+// means the previous frame is still current. Never takes the lock. Runs on
+// the hash queue with tile hashing.
+static void display_session_callback(
+    display_session &session,
+    CGDisplayStreamFrameStatus status,
+    uint64_t display_time,
+    uint64_t arrival_time,
+    IOSurfaceRef frame,
+    CGDisplayStreamUpdateRef update)
+{
+    switch (status) {
+        case kCGDisplayStreamFrameStatusFrameComplete:
+            session.complete_count++;
+            break;
+        case kCGDisplayStreamFrameStatusFrameIdle:
+            session.idle_count++;
+            return;
+        case kCGDisplayStreamFrameStatusFrameBlank:
+            session.blank_count++;
+            break;
+        case kCGDisplayStreamFrameStatusStopped:
+            session.stopped_count++;
+            break;
+    }
+
+    IOSurfaceRef surface = NULL;
+    session.update_dirty.clear();
+    if (status == kCGDisplayStreamFrameStatusFrameComplete) {
+        session.capture_latency.record(host_latency_us(display_time, arrival_time));
+
+        surface = frame;
+        CFRetain(surface);
+        IOSurfaceIncrementUseCount(surface);
+
+        if (update != NULL)
+            add_update_rects(session, update);
+        else
+            session.update_dirty.add_all();
+
+        if (session.hash_dispatch != NULL)
+            hash_frame(session, surface, session.hash_pending.load() > 1);
+    }
+    else {
+        session.update_dirty.add_all();
+
+        if (session.hash_dispatch != NULL)
+            session.hasher.invalidate_all();
+    }
+
+    // In timed mode, frames the ring can't take are dropped, and their
+    // changes carried to the next frame that makes it.
+    if (session.queue_length != 0) {
+        timed_display_frame f;
+        f.time = display_time;
+        f.frame.surface = surface;
+        f.frame.display_time = surface != NULL ? display_time : 0;
+        f.frame.arrival_time = surface != NULL ? arrival_time : 0;
+        f.frame.dirty = session.carry_dirty;
+        f.frame.dirty.add_set(session.update_dirty);
+        if (session.incoming->push(f)) {
+            session.carry_dirty.clear();
+        }
+        else {
+            session.carry_dirty = f.frame.dirty;
+            release_surface(surface);
+        }
+        return;
+    }
+
+    auto &back = session.frames.back();
+    back.surface = surface;
+    back.display_time = surface != NULL ? display_time : 0;
+    back.arrival_time = surface != NULL ? arrival_time : 0;
+
+    // Users have at least the previously published frame, unless it was
+    // skipped. Report changes since then, which may be more than needed.
+    back.dirty = session.carry_dirty;
+    back.dirty.add_set(session.update_dirty);
+
+    if (session.frames.publish())
+        session.carry_dirty.add_set(session.update_dirty);
+    else
+        session.carry_dirty = session.update_dirty;
+
+    release_surface(session.frames.back().surface);
+}
+
+// Reduce the changes of a new frame to tiles whose content differs. Frames
+// we skip invalidate the tiles they change, so those are reported changed
+// next time.
+static void hash_frame(
+    display_session &session,
+    IOSurfaceRef surface,
+    bool skip)
+{
+    auto &dirty = session.update_dirty;
+    if (dirty.empty())
+        return;
+
+    if (skip) {
+        session.hasher.invalidate(dirty);
+        return;
+    }
+
+    if (IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL) != kIOReturnSuccess) {
+        session.hasher.invalidate(dirty);
+        return;
+    }
+
+    auto *data = (const uint8_t *) IOSurfaceGetBaseAddress(surface);
+    auto stride = IOSurfaceGetBytesPerRow(surface);
+    bool changed = session.hasher.update(data, stride, dirty);
+
+    IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+
+    dirty.clear();
+    if (changed)
+        session.hasher.add_changed(dirty);
+}
+
+// Frames leaving the queue pass on their changes.
+static void evict_frame(display_frame &frame, display_frame *next)
+{
+    if (next != nullptr)
+        next->dirty.add_set(frame.dirty);
+    release_surface(frame.surface);
+}
+
+static void release_surface(IOSurfaceRef &surface)
+{
+    if (surface != NULL) {
+        IOSurfaceDecrementUseCount(surface);
+        CFRelease(surface);
+        surface = NULL;
+    }
+}
+
+// Dirty rects cover both redrawn and moved areas, in display coordinates.
+// Translate and scale them to the output, widening fractional rects to whole
+// pixels. Parts outside the source rect are clipped by the set.
+static void add_update_rects(
+    display_session &session,
+    CGDisplayStreamUpdateRef update)
+{
+    size_t count = 0;
+    auto *rects = CGDisplayStreamUpdateGetRects(update, kCGDisplayStreamUpdateDirtyRects, &count);
+    for (size_t i = 0; i < count; i++) {
+        auto &r = rects[i];
+        auto left = r.origin.x - session.source_rect.origin.x;
+        auto top = r.origin.y - session.source_rect.origin.y;
+        auto x = (int32_t) floor(left * session.scale_x);
+        auto y = (int32_t) floor(top * session.scale_y);
+        session.update_dirty.add(pixel_rect {
+            x, y,
+            (int32_t) ceil((left + r.size.width) * session.scale_x) - x,
+            (int32_t) ceil((top + r.size.height) * session.scale_y) - y
+        });
+    }
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,163 @@
+#ifndef p1_mac_plugins_display_session_h
+#define p1_mac_plugins_display_session_h
+
+#include "p1stream.h"
+#include "module.h"
+
+#include "rect_set.h"
+#include "spsc_ring.h"
+#include "tile_hash.h"
+#include "timed_frame_queue.h"
+#include "triple_buffer.h"
+
+#include <atomic>
+#include <list>
+#include <CoreGraphics/CoreGraphics.h>
+#include <dispatch/dispatch.h>
+
+namespace p1_mac_plugins {
+
+
+// Limits of stream options.
+#define DISPLAY_STREAM_MAX_SIZE 16384
+#define DISPLAY_STREAM_MAX_FPS 240
+#define DISPLAY_STREAM_MAX_QUEUE_DEPTH 8
+#define DISPLAY_STREAM_MAX_FRAME_QUEUE 4
+#define DISPLAY_STREAM_MAX_LATENCY_OFFSET_MS 1000
+
+// A captured frame, and what changed since the frame the reader had before.
+// Host times at which it was on screen, and reached the capture callback,
+// zero for blank frames.
+struct display_frame {
+    IOSurfaceRef surface;
+    rect_set dirty;
+    uint64_t display_time;
+    uint64_t arrival_time;
+};
+
+// A frame in timed mode, with its display time.
+struct timed_display_frame {
+    uint64_t time;
+    display_frame frame;
+};
+
+// Capture options, as requested. Zero width, height, frame rate, queue
+// depth or frame queue means the default, an empty source rect the whole
+// display. Streams with equal options share a session. Tile hashing
+// requires BGRA.
+struct display_session_config {
+    CGDirectDisplayID display_id;
+    pixel_rect source_rect;
+    size_t width;
+    size_t height;
+    OSType pixel_format;
+    double max_fps;
+    uint32_t queue_depth;
+    size_t frame_queue;
+    double latency_offset_ms;
+    bool tile_hash;
+
+    bool shares_with(const display_session_config &other) const;
+};
+
+// One display capture, shared by all `display_stream` instances with the
+// same options, and the regions of those. Sessions are reference counted,
+// and stopped when the last user releases them.
+//
+// The CGDisplayStream crops, scales, converts and rate limits in the capture
+// stage, so frames arrive in the requested size and pixel format. Frames are
+// handed from the capture callback without locking. Users take them, under
+// our lock, through `refresh`, which passes their changes to every
+// registered consumer.
+class display_session : public lockable {
+public:
+    display_session(const display_session_config &config_);
+
+    const display_session_config config;
+
+    // Registry. Errors are reported to the log of the calling user.
+    // `acquire` returns nullptr if no session could be opened. `retain` adds
+    // a user to a session another user already holds.
+    UInt32 users;
+    static display_session *acquire(const display_session_config &config, event_buffer &log);
+    static void retain(display_session *session);
+    static void release(display_session *session, event_buffer &log);
+
+    lockable_mutex mutex;
+
+    dispatch_queue_t dispatch;
+    CGDisplayStreamRef cg_handle;
+    bool running;
+
+    // Signaled by the capture callback with the stopped status. Stopping is
+    // asynchronous, and no callbacks arrive after that one.
+    dispatch_semaphore_t stopped;
+
+    // Captured area in display coordinates. Output size and format. Dirty
+    // rects are translated and scaled from display to output coordinates.
+    CGRect source_rect;
+    size_t width;
+    size_t height;
+    OSType pixel_format;
+    double scale_x;
+    double scale_y;
+
+    // Latest mode, the default. Frames handed from the capture callback to
+    // users, without locking. The callback owns the back slot, and releases
+    // surfaces it gets back from publishing right away, so we hold at most
+    // two surfaces of the stream queue. Users share the front slot, under
+    // our lock.
+    triple_buffer<display_frame> frames;
+
+    // Timed mode, with a frame queue. The callback passes every frame
+    // through `incoming`, dropping frames while it is full. Users move them
+    // to `queue`, and select the frame that was on screen `latency_offset`
+    // before the current time. This paces smoothly when capture and mixer
+    // rates differ, and can delay video to match audio.
+    size_t queue_length;
+    uint64_t latency_offset;
+    std::unique_ptr<spsc_ring<timed_display_frame>> incoming;
+    timed_frame_queue<display_frame> queue;
+
+    // Callback side. Changes of the latest update, and those of frames users
+    // may not have seen.
+    rect_set update_dirty;
+    rect_set carry_dirty;
+
+    // Tile hashing, optional. The capture callback hands frames to a queue
+    // of their own, which hashes the tiles the capture reports changed, and
+    // reduces the changes to tiles whose hash differs. Frames redrawn as they
+    // were then have no changes. Everything on the callback side then runs
+    // there. While that queue falls behind, frames pass without hashing.
+    dispatch_queue_t hash_dispatch;
+    std::atomic<uint32_t> hash_pending;
+    tile_hasher hasher;
+
+    // User side. Every consumer of our frames collects changes of frames it
+    // has not yet used. Modified with our lock held.
+    std::list<rect_set *> consumers;
+
+    // Statistics, counted by the capture callback without locking, and
+    // shared by all users. Capture latency is from display time to the
+    // callback, in microseconds.
+    std::atomic<uint64_t> complete_count;
+    std::atomic<uint64_t> idle_count;
+    std::atomic<uint64_t> blank_count;
+    std::atomic<uint64_t> stopped_count;
+    log_histogram capture_latency;
+
+    // Internal. `close` returns false if the capture did not confirm it
+    // stopped. Callbacks may then still arrive, so we must not be deleted.
+    bool open(event_buffer &log);
+    bool close(event_buffer &log);
+    display_frame *refresh();
+    Local<Object> stats(Isolate *isolate);
+
+    // Lockable implementation.
+    virtual lockable *lock() final;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_display_session_h
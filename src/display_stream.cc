@@ -1,15 +1,15 @@
 #include "display_stream.h"
+#include "host_time.h"
+
+#include <cstring>
 
 namespace p1_mac_plugins {
 
-static void display_stream_callback(
-    display_stream &stream,
-    CGDisplayStreamFrameStatus status,
-    IOSurfaceRef frame);
+static bool parse_pixel_format(const char *str, OSType &fmt);
 
 
 display_stream::display_stream() :
-    buffer(this), dispatch(NULL), cg_handle(NULL), running(false), last_frame(NULL)
+    buffer(this), session(nullptr)
 {
 }
 
@@ -17,7 +17,7 @@ void display_stream::init(const FunctionCallbackInfo<Value>& args)
 {
     auto *isolate = args.GetIsolate();
     Handle<Value> val;
-    CGDirectDisplayID display_id = kCGDirectMainDisplay;
+    display_session_config config;
 
     if (args.Length() != 1 || !args[0]->IsObject()) {
         isolate->ThrowException(Exception::TypeError(
@@ -28,84 +28,190 @@ void display_stream::init(const FunctionCallbackInfo<Value>& args)
 
     val = params->Get(display_id_sym.Get(isolate));
     if (val->IsUint32()) {
-        display_id = val->Uint32Value();
+        config.display_id = val->Uint32Value();
     }
     else if (val->IsUndefined()) {
-        display_id = kCGDirectMainDisplay;
+        config.display_id = kCGDirectMainDisplay;
     }
     else {
         isolate->ThrowException(Exception::TypeError(
             String::NewFromUtf8(isolate, "Invalid display ID")));
         return;
     }
-    val = params->Get(on_event_sym.Get(isolate));
-    if (!val->IsFunction()) {
+    // Area to capture, the whole display by default.
+    config.source_rect = pixel_rect { 0, 0, 0, 0 };
+    val = params->Get(source_rect_sym.Get(isolate));
+    if (!val->IsUndefined() && !pixel_rect_from_js(isolate, val, config.source_rect)) {
         isolate->ThrowException(Exception::TypeError(
-            String::NewFromUtf8(isolate, "Expected an onEvent function")));
+            String::NewFromUtf8(isolate, "Invalid sourceRect value")));
         return;
     }
 
-    // Parameters checked, from here on we no longer throw exceptions.
-    Wrap(args.This());
-    Ref();
-    args.GetReturnValue().Set(handle());
-
-    buffer.set_callback(isolate->GetCurrentContext(), val.As<Function>());
+    // Output size. With only one dimension, the other follows the aspect
+    // ratio of the captured area.
+    config.width = 0;
+    val = params->Get(width_sym.Get(isolate));
+    if (val->IsUint32()) {
+        config.width = val->Uint32Value();
+        if (config.width == 0 || config.width > DISPLAY_STREAM_MAX_SIZE) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid width value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid width value")));
+        return;
+    }
 
-    CGError cg_ret;
+    config.height = 0;
+    val = params->Get(height_sym.Get(isolate));
+    if (val->IsUint32()) {
+        config.height = val->Uint32Value();
+        if (config.height == 0 || config.height > DISPLAY_STREAM_MAX_SIZE) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid height value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid height value")));
+        return;
+    }
 
-    size_t width  = CGDisplayPixelsWide(display_id);
-    size_t height = CGDisplayPixelsHigh(display_id);
+    config.pixel_format = 'BGRA';
+    val = params->Get(pixel_format_sym.Get(isolate));
+    if (!val->IsUndefined()) {
+        String::Utf8Value str(val);
+        if (*str == NULL || !parse_pixel_format(*str, config.pixel_format)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid pixelFormat value")));
+            return;
+        }
+    }
 
-    dispatch = dispatch_queue_create("display_stream", DISPATCH_QUEUE_SERIAL);
-    if (dispatch == NULL) {
-        buffer.emitf(EV_LOG_ERROR, "dispatch_queue_create error");
+    config.max_fps = 0;
+    val = params->Get(max_fps_sym.Get(isolate));
+    if (val->IsNumber()) {
+        config.max_fps = val->NumberValue();
+        if (!(config.max_fps > 0 && config.max_fps <= DISPLAY_STREAM_MAX_FPS)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid maxFps value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid maxFps value")));
         return;
     }
 
-    cg_handle = CGDisplayStreamCreateWithDispatchQueue(
-        display_id, width, height, 'BGRA', NULL, dispatch, ^(
-            CGDisplayStreamFrameStatus status,
-            uint64_t displayTime,
-            IOSurfaceRef frameSurface,
-            CGDisplayStreamUpdateRef updateRef)
-        {
-            display_stream_callback(*this, status, frameSurface);
-        });
-    if (cg_handle == NULL) {
-        buffer.emitf(EV_LOG_ERROR, "CGDisplayStreamCreateWithDispatchQueue error");
+    config.queue_depth = 0;
+    val = params->Get(queue_depth_sym.Get(isolate));
+    if (val->IsUint32()) {
+        config.queue_depth = val->Uint32Value();
+        if (config.queue_depth == 0 || config.queue_depth > DISPLAY_STREAM_MAX_QUEUE_DEPTH) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid queueDepth value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid queueDepth value")));
         return;
     }
 
-    cg_ret = CGDisplayStreamStart(cg_handle);
-    if (cg_ret != kCGErrorSuccess) {
-        buffer.emitf(EV_LOG_ERROR, "CGDisplayStreamStart error 0x%x", cg_ret);
+    config.frame_queue = 0;
+    val = params->Get(frame_queue_sym.Get(isolate));
+    if (val->IsUint32()) {
+        config.frame_queue = val->Uint32Value();
+        if (config.frame_queue < 2 || config.frame_queue > DISPLAY_STREAM_MAX_FRAME_QUEUE) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid frameQueue value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid frameQueue value")));
         return;
     }
 
-    running = true;
-}
+    config.latency_offset_ms = 0;
+    val = params->Get(latency_offset_ms_sym.Get(isolate));
+    if (val->IsNumber()) {
+        config.latency_offset_ms = val->NumberValue();
+        if (!(config.latency_offset_ms >= 0 && config.latency_offset_ms <= DISPLAY_STREAM_MAX_LATENCY_OFFSET_MS)) {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "Invalid latencyOffsetMs value")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid latencyOffsetMs value")));
+        return;
+    }
 
-void display_stream::destroy()
-{
-    if (running) {
-        running = false;
+    // Hashing works on BGRA pixels.
+    config.tile_hash = false;
+    val = params->Get(tile_hash_sym.Get(isolate));
+    if (val->IsBoolean()) {
+        config.tile_hash = val->BooleanValue();
+        if (config.tile_hash && config.pixel_format != 'BGRA') {
+            isolate->ThrowException(Exception::TypeError(
+                String::NewFromUtf8(isolate, "tileHash requires the BGRA pixel format")));
+            return;
+        }
+    }
+    else if (!val->IsUndefined()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Invalid tileHash value")));
+        return;
+    }
 
-        auto cg_ret = CGDisplayStreamStop(cg_handle);
-        if (cg_ret != kCGErrorSuccess)
-            buffer.emitf(EV_LOG_ERROR, "CGDisplayStreamStop error 0x%x\n", cg_ret);
+    val = params->Get(on_event_sym.Get(isolate));
+    if (!val->IsFunction()) {
+        isolate->ThrowException(Exception::TypeError(
+            String::NewFromUtf8(isolate, "Expected an onEvent function")));
+        return;
     }
 
-    // FIXME: delay until stopped status callback
+    // Parameters checked, from here on we no longer throw exceptions.
+    Wrap(args.This());
+    Ref();
+    args.GetReturnValue().Set(handle());
 
-    if (cg_handle != NULL) {
-        CFRelease(cg_handle);
-        cg_handle = NULL;
-    }
+    buffer.set_callback(isolate->GetCurrentContext(), val.As<Function>());
+
+    session = display_session::acquire(config, buffer);
+    if (session == nullptr)
+        return;
+
+    pending_dirty.configure((int32_t) session->width, (int32_t) session->height);
+    pending_dirty.add_all();
+    frame_dirty.configure((int32_t) session->width, (int32_t) session->height);
+
+    lock_handle lock(*session);
+    session->consumers.push_back(&pending_dirty);
+}
+
+void display_stream::destroy()
+{
+    {
+        lock_handle lock(*this);
 
-    if (dispatch != NULL) {
-        dispatch_release(dispatch);
-        dispatch = NULL;
+        if (session != nullptr) {
+            {
+                lock_handle session_lock(*session);
+                session->consumers.remove(&pending_dirty);
+            }
+            display_session::release(session, buffer);
+            session = nullptr;
+        }
     }
 
     buffer.flush();
@@ -122,31 +228,76 @@ void display_stream::produce_video_frame(video_source_context &ctx)
 {
     lock_handle lock(*this);
 
-    if (last_frame != NULL)
-        ctx.render_iosurface(last_frame);
+    if (session == nullptr)
+        return;
+
+    // The session keeps its current surface while locked.
+    lock_handle session_lock(*session);
+    auto *frame = session->refresh();
+    frame_dirty = pending_dirty;
+    pending_dirty.clear();
+
+    if (frame == nullptr || frame->surface == NULL)
+        return;
+
+    // Frames are rendered on every tick, measured the first time only.
+    latency.record(frame->display_time, frame->arrival_time, host_time_now());
+
+    ctx.render_iosurface(frame->surface);
 }
 
-static void display_stream_callback(
-    display_stream &stream,
-    CGDisplayStreamFrameStatus status,
-    IOSurfaceRef frame)
+Local<Value> display_stream::dirty_rects(Isolate *isolate)
 {
-    lock_handle lock(stream);
-
-    // Ditch any previous frame, unless it's the same.
-    // This also doubles as cleanup when stopping.
-    if (stream.last_frame != NULL && status != kCGDisplayStreamFrameStatusFrameIdle) {
-        IOSurfaceDecrementUseCount(stream.last_frame);
-        CFRelease(stream.last_frame);
-        stream.last_frame = NULL;
+    auto arr = Array::New(isolate, (int) frame_dirty.size());
+    uint32_t idx = 0;
+    for (auto &rect : frame_dirty) {
+        auto obj = Object::New(isolate);
+        obj->Set(String::NewFromUtf8(isolate, "x"), Int32::New(isolate, rect.x));
+        obj->Set(String::NewFromUtf8(isolate, "y"), Int32::New(isolate, rect.y));
+        obj->Set(width_sym.Get(isolate), Int32::New(isolate, rect.width));
+        obj->Set(height_sym.Get(isolate), Int32::New(isolate, rect.height));
+        arr->Set(idx++, obj);
     }
+    return arr;
+}
 
-    // A new frame arrived, retain it.
-    if (status == kCGDisplayStreamFrameStatusFrameComplete) {
-        stream.last_frame = frame;
-        CFRetain(stream.last_frame);
-        IOSurfaceIncrementUseCount(stream.last_frame);
+// Session counts and capture latency, which streams with equal options
+// share, and our own latencies.
+Local<Value> display_stream::stats(Isolate *isolate)
+{
+    if (session == nullptr)
+        return Null(isolate);
+
+    auto obj = session->stats(isolate);
+    obj->Set(String::NewFromUtf8(isolate, "consumeLatencyUs"),
+        histogram_to_js(isolate, latency.consume));
+    obj->Set(String::NewFromUtf8(isolate, "displayLatencyUs"),
+        histogram_to_js(isolate, latency.display));
+
+    if (latency.last_display_time != 0) {
+        auto last = Object::New(isolate);
+        last->Set(String::NewFromUtf8(isolate, "displayTimeNs"),
+            Number::New(isolate, (double) host_time_to_ns(latency.last_display_time)));
+        last->Set(String::NewFromUtf8(isolate, "arrivalTimeNs"),
+            Number::New(isolate, (double) host_time_to_ns(latency.last_arrival_time)));
+        last->Set(String::NewFromUtf8(isolate, "consumeTimeNs"),
+            Number::New(isolate, (double) host_time_to_ns(latency.last_consume_time)));
+        obj->Set(String::NewFromUtf8(isolate, "lastFrame"), last);
     }
+    return obj;
+}
+
+static bool parse_pixel_format(const char *str, OSType &fmt)
+{
+    if (strcmp(str, "BGRA") == 0)
+        fmt = 'BGRA';
+    else if (strcmp(str, "420v") == 0)
+        fmt = '420v';
+    else if (strcmp(str, "420f") == 0)
+        fmt = '420f';
+    else
+        return false;
+    return true;
 }
 
 void display_stream::init_prototype(Handle<FunctionTemplate> func)
@@ -155,6 +306,16 @@ void display_stream::init_prototype(Handle<FunctionTemplate> func)
         auto stream = ObjectWrap::Unwrap<display_stream>(args.This());
         stream->destroy();
     });
+    NODE_SET_PROTOTYPE_METHOD(func, "dirtyRects", [](const FunctionCallbackInfo<Value>& args) {
+        auto stream = ObjectWrap::Unwrap<display_stream>(args.This());
+        lock_handle lock(*stream);
+        args.GetReturnValue().Set(stream->dirty_rects(args.GetIsolate()));
+    });
+    NODE_SET_PROTOTYPE_METHOD(func, "getStats", [](const FunctionCallbackInfo<Value>& args) {
+        auto stream = ObjectWrap::Unwrap<display_stream>(args.This());
+        lock_handle lock(*stream);
+        args.GetReturnValue().Set(stream->stats(args.GetIsolate()));
+    });
 }
 
 
@@ -4,11 +4,16 @@
 #include "p1stream.h"
 #include "module.h"
 
-#include <CoreGraphics/CoreGraphics.h>
+#include "display_session.h"
+#include "frame_latency.h"
+#include "rect_set.h"
 
 namespace p1_mac_plugins {
 
 
+// Video source for a display, or an area of it. The actual capture happens
+// in a `display_session`, which may be shared with other instances, and with
+// regions, see `display_region`.
 class display_stream : public video_source, public lockable {
 public:
     display_stream();
@@ -16,15 +21,23 @@ public:
     lockable_mutex mutex;
     event_buffer buffer;
 
-    dispatch_queue_t dispatch;
-    CGDisplayStreamRef cg_handle;
-    bool running;
+    // Null once destroyed, or if no session could be opened.
+    display_session *session;
 
-    IOSurfaceRef last_frame;
+    // Changes of session frames we have not yet used, collected by the
+    // session. What changed since our previous render, empty if the frame
+    // is unchanged. With tile hashing, also if it was redrawn as it was.
+    rect_set pending_dirty;
+    rect_set frame_dirty;
+
+    // Latency of frames when we first render them.
+    frame_latency latency;
 
     // Public JavaScript methods.
     void init(const FunctionCallbackInfo<Value>& args);
     void destroy();
+    Local<Value> dirty_rects(Isolate *isolate);
+    Local<Value> stats(Isolate *isolate);
 
     // Lockable implementation.
     virtual lockable *lock() final;
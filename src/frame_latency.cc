@@ -0,0 +1,31 @@
+#include "frame_latency.h"
+#include "host_time.h"
+
+namespace p1_mac_plugins {
+
+
+uint64_t host_latency_us(uint64_t from, uint64_t to)
+{
+    return to > from ? host_time_to_ns(to - from) / 1000 : 0;
+}
+
+frame_latency::frame_latency() :
+    last_display_time(0), last_arrival_time(0), last_consume_time(0)
+{
+}
+
+bool frame_latency::record(uint64_t display_time, uint64_t arrival_time, uint64_t now)
+{
+    if (display_time == last_display_time)
+        return false;
+
+    last_display_time = display_time;
+    last_arrival_time = arrival_time;
+    last_consume_time = now;
+    display.record(host_latency_us(display_time, now));
+    consume.record(host_latency_us(arrival_time, now));
+    return true;
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,40 @@
+#ifndef p1_mac_plugins_frame_latency_h
+#define p1_mac_plugins_frame_latency_h
+
+#include "histogram.h"
+
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Microseconds between two host times, zero if `to` is not later.
+uint64_t host_latency_us(uint64_t from, uint64_t to);
+
+// Latency of captured frames when a consumer first uses them, in
+// microseconds. `display` measures from when the frame was on screen,
+// `consume` from when it reached the capture callback. Frames used again
+// on later ticks are not counted.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class frame_latency {
+public:
+    frame_latency();
+
+    log_histogram display;
+    log_histogram consume;
+
+    // Host time stamps of the last new frame, zero before the first.
+    uint64_t last_display_time;
+    uint64_t last_arrival_time;
+    uint64_t last_consume_time;
+
+    // Record a frame used at `now`, unless it is the last frame again.
+    // Returns whether it was new.
+    bool record(uint64_t display_time, uint64_t arrival_time, uint64_t now);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_frame_latency_h
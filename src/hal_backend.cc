@@ -0,0 +1,285 @@
+#include "hal_backend.h"
+#include "core_audio_device.h"
+#include "host_time.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace p1_mac_plugins {
+
+
+static const AudioObjectPropertyAddress buffer_frame_size_addr = {
+    kAudioDevicePropertyBufferFrameSize,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress buffer_frame_size_range_addr = {
+    kAudioDevicePropertyBufferFrameSizeRange,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+// AUHAL elements.
+static const AudioUnitElement output_element = 0;
+static const AudioUnitElement input_element = 1;
+
+static void property_callback(
+    void *inRefCon,
+    AudioUnit inUnit,
+    AudioUnitPropertyID inID,
+    AudioUnitScope inScope,
+    AudioUnitElement inElement);
+static OSStatus input_callback(
+    void *inRefCon,
+    AudioUnitRenderActionFlags *ioActionFlags,
+    const AudioTimeStamp *inTimeStamp,
+    UInt32 inBusNumber,
+    UInt32 inNumberFrames,
+    AudioBufferList *ioData);
+
+
+hal_backend::hal_backend() :
+    client(nullptr), device(kAudioObjectUnknown), unit(NULL),
+    render_error(noErr), io_frames(0), list(nullptr)
+{
+}
+
+hal_backend::~hal_backend()
+{
+    close();
+}
+
+bool hal_backend::open(const capture_backend_config &config, capture_backend_client &client_)
+{
+    OSStatus ret;
+    UInt32 size;
+    client = &client_;
+
+    ret = find_input_device(config.device_uid, device);
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "Could not find input device, error 0x%x", ret);
+        return false;
+    }
+
+    // AUHAL converts format and layout, but not rate. The native rate is
+    // all we can get, which is also what we want.
+    choose_capture_format(config, device, fmt, client_);
+
+    AudioComponentDescription desc;
+    desc.componentType = kAudioUnitType_Output;
+    desc.componentSubType = kAudioUnitSubType_HALOutput;
+    desc.componentManufacturer = kAudioUnitManufacturer_Apple;
+    desc.componentFlags = 0;
+    desc.componentFlagsMask = 0;
+    AudioComponent comp = AudioComponentFindNext(NULL, &desc);
+    if (comp == NULL) {
+        client->capture_log(capture_log_error, "AUHAL component not found");
+        return false;
+    }
+
+    ret = AudioComponentInstanceNew(comp, &unit);
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioComponentInstanceNew error 0x%x", ret);
+        return false;
+    }
+
+    UInt32 enable = 1;
+    ret = AudioUnitSetProperty(unit, kAudioOutputUnitProperty_EnableIO,
+        kAudioUnitScope_Input, input_element, &enable, sizeof(enable));
+    if (ret == noErr) {
+        enable = 0;
+        ret = AudioUnitSetProperty(unit, kAudioOutputUnitProperty_EnableIO,
+            kAudioUnitScope_Output, output_element, &enable, sizeof(enable));
+    }
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioUnitSetProperty EnableIO error 0x%x", ret);
+        return false;
+    }
+
+    ret = AudioUnitSetProperty(unit, kAudioOutputUnitProperty_CurrentDevice,
+        kAudioUnitScope_Global, output_element, &device, sizeof(device));
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioUnitSetProperty CurrentDevice error 0x%x", ret);
+        return false;
+    }
+
+    io_frames = set_io_frames((UInt32) (config.latency_ms * fmt.rate / 1000));
+
+    AudioStreamBasicDescription asbd;
+    fill_asbd(asbd, fmt);
+    ret = AudioUnitSetProperty(unit, kAudioUnitProperty_StreamFormat,
+        kAudioUnitScope_Output, input_element, &asbd, sizeof(asbd));
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioUnitSetProperty StreamFormat error 0x%x", ret);
+        return false;
+    }
+
+    UInt32 max_slice;
+    size = sizeof(max_slice);
+    ret = AudioUnitGetProperty(unit, kAudioUnitProperty_MaximumFramesPerSlice,
+        kAudioUnitScope_Global, output_element, &max_slice, &size);
+    if (ret != noErr)
+        max_slice = 4096;
+    fmt.max_frames = std::max(max_slice, io_frames);
+
+    // Allocate the render target for the largest slice.
+    UInt32 num_buffers = fmt.interleaved ? 1 : fmt.channels;
+    data.reset(new char[fmt.max_frames * fmt.bytes_per_frame()]);
+    list_storage.reset(new char[offsetof(AudioBufferList, mBuffers) + num_buffers * sizeof(AudioBuffer)]);
+    list = (AudioBufferList *) list_storage.get();
+    list->mNumberBuffers = num_buffers;
+    for (UInt32 i = 0; i < num_buffers; i++)
+        list->mBuffers[i].mNumberChannels = fmt.interleaved ? fmt.channels : 1;
+
+    AURenderCallbackStruct cb = { input_callback, this };
+    ret = AudioUnitSetProperty(unit, kAudioOutputUnitProperty_SetInputCallback,
+        kAudioUnitScope_Global, output_element, &cb, sizeof(cb));
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioUnitSetProperty SetInputCallback error 0x%x", ret);
+        return false;
+    }
+
+    ret = AudioUnitAddPropertyListener(unit, kAudioOutputUnitProperty_IsRunning, property_callback, this);
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioUnitAddPropertyListener error 0x%x", ret);
+        return false;
+    }
+
+    ret = AudioUnitInitialize(unit);
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioUnitInitialize error 0x%x", ret);
+        return false;
+    }
+
+    return true;
+}
+
+bool hal_backend::start()
+{
+    OSStatus ret = AudioOutputUnitStart(unit);
+    if (ret != noErr) {
+        client->capture_log(capture_log_error, "AudioOutputUnitStart error 0x%x", ret);
+        return false;
+    }
+    return true;
+}
+
+void hal_backend::close()
+{
+    if (unit != NULL) {
+        AudioOutputUnitStop(unit);
+        AudioUnitUninitialize(unit);
+        AudioComponentInstanceDispose(unit);
+        unit = NULL;
+    }
+}
+
+void hal_backend::maintain()
+{
+    auto ret = render_error.exchange(noErr);
+    if (ret != noErr)
+        client->capture_log(capture_log_error, "AudioUnitRender error 0x%x", ret);
+}
+
+capture_backend_stats hal_backend::stats() const
+{
+    auto res = capture_backend::stats();
+    res.latency_ms = io_frames * 1000.0 / fmt.rate;
+    res.buffer_count = 1;
+    return res;
+}
+
+// Ask the device for an IO buffer size, within its range. Returns the size
+// the device actually uses.
+UInt32 hal_backend::set_io_frames(UInt32 frames)
+{
+    OSStatus ret;
+    UInt32 size;
+
+    AudioValueRange range;
+    size = sizeof(range);
+    ret = AudioObjectGetPropertyData(device, &buffer_frame_size_range_addr, 0, NULL, &size, &range);
+    if (ret == noErr)
+        frames = (UInt32) std::max(range.mMinimum, std::min(range.mMaximum, (Float64) frames));
+
+    ret = AudioObjectSetPropertyData(device, &buffer_frame_size_addr, 0, NULL, sizeof(frames), &frames);
+    if (ret != noErr)
+        client->capture_log(capture_log_warn, "Could not set IO buffer size, error 0x%x", ret);
+
+    size = sizeof(frames);
+    AudioObjectGetPropertyData(device, &buffer_frame_size_addr, 0, NULL, &size, &frames);
+    return frames;
+}
+
+static void property_callback(
+    void *inRefCon,
+    AudioUnit inUnit,
+    AudioUnitPropertyID inID,
+    AudioUnitScope inScope,
+    AudioUnitElement inElement)
+{
+    auto &backend = *(hal_backend *) inRefCon;
+
+    // Sanity check, unlikely false.
+    if (inUnit != backend.unit || inID != kAudioOutputUnitProperty_IsRunning)
+        return;
+
+    UInt32 is_running;
+    UInt32 size = sizeof(is_running);
+    auto ret = AudioUnitGetProperty(inUnit, kAudioOutputUnitProperty_IsRunning,
+        kAudioUnitScope_Global, output_element, &is_running, &size);
+    if (ret != noErr) {
+        backend.client->capture_log(capture_log_error, "AudioUnitGetProperty error 0x%x\n", ret);
+        return;
+    }
+
+    backend.client->capture_running(is_running != 0);
+}
+
+// Runs on the HAL IO thread. Pulls the input into our buffer, and delivers
+// it right away.
+static OSStatus input_callback(
+    void *inRefCon,
+    AudioUnitRenderActionFlags *ioActionFlags,
+    const AudioTimeStamp *inTimeStamp,
+    UInt32 inBusNumber,
+    UInt32 inNumberFrames,
+    AudioBufferList *ioData)
+{
+    auto &backend = *(hal_backend *) inRefCon;
+    auto &fmt = backend.fmt;
+    auto *list = backend.list;
+
+    if (inNumberFrames > fmt.max_frames) {
+        backend.render_error.store(kAudioUnitErr_TooManyFramesToProcess);
+        return noErr;
+    }
+
+    auto plane_size = (UInt32) (inNumberFrames * sample_format_size(fmt.format));
+    for (UInt32 i = 0; i < list->mNumberBuffers; i++) {
+        list->mBuffers[i].mData = backend.data.get() + i * plane_size;
+        list->mBuffers[i].mDataByteSize = fmt.interleaved ?
+            (UInt32) (inNumberFrames * fmt.bytes_per_frame()) : plane_size;
+    }
+
+    OSStatus ret = AudioUnitRender(backend.unit, ioActionFlags, inTimeStamp,
+        inBusNumber, inNumberFrames, list);
+    if (ret != noErr) {
+        backend.render_error.store(ret);
+        return ret;
+    }
+
+    auto time = (inTimeStamp->mFlags & kAudioTimeStampHostTimeValid) ?
+        inTimeStamp->mHostTime : host_time_now();
+
+    double sample_time = -1;
+    if (inTimeStamp->mFlags & kAudioTimeStampSampleTimeValid)
+        sample_time = inTimeStamp->mSampleTime;
+
+    backend.client->capture_buffer(backend.data.get(), inNumberFrames, time, sample_time);
+    return noErr;
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,53 @@
+#ifndef p1_mac_plugins_hal_backend_h
+#define p1_mac_plugins_hal_backend_h
+
+#include "capture_backend.h"
+
+#include <atomic>
+#include <memory>
+#include <AudioToolbox/AudioToolbox.h>
+
+namespace p1_mac_plugins {
+
+
+// Capture through an AUHAL input unit. Buffers are rendered on the HAL IO
+// thread as soon as the device delivers them, so latency is a single device
+// IO buffer, which we size from the latency option.
+//
+// The IO buffer size is a device property, shared with other clients of the
+// device. Core Audio settles on the smallest size any client asks for.
+class hal_backend : public capture_backend {
+public:
+    hal_backend();
+    virtual ~hal_backend();
+
+    capture_backend_client *client;
+
+    AudioObjectID device;
+    AudioComponentInstance unit;
+    std::atomic<OSStatus> render_error;
+
+    // Device IO buffer size, in frames.
+    UInt32 io_frames;
+
+    // Render target. Non-interleaved channels are rendered as consecutive
+    // planes of the actual frame count into `data`.
+    std::unique_ptr<char[]> data;
+    std::unique_ptr<char[]> list_storage;
+    AudioBufferList *list;
+
+    // Internal.
+    UInt32 set_io_frames(UInt32 frames);
+
+    // Capture backend implementation.
+    virtual bool open(const capture_backend_config &config, capture_backend_client &client) final;
+    virtual bool start() final;
+    virtual void close() final;
+    virtual void maintain() final;
+    virtual capture_backend_stats stats() const final;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_hal_backend_h
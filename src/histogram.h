@@ -0,0 +1,79 @@
+#ifndef p1_mac_plugins_histogram_h
+#define p1_mac_plugins_histogram_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Histogram with power-of-two buckets, safe to record into from a realtime
+// thread while another thread reads it. All operations are wait-free.
+//
+// Bucket 0 counts zero. Bucket n counts values in [2^(n-1), 2^n).
+class log_histogram {
+public:
+    static const size_t num_buckets = 32;
+
+    log_histogram() { reset(); }
+
+    void record(uint64_t value)
+    {
+        size_t idx = 0;
+        while (value >> idx && idx < num_buckets - 1)
+            idx++;
+        buckets[idx].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(value, std::memory_order_relaxed);
+
+        auto prev = peak.load(std::memory_order_relaxed);
+        while (value > prev && !peak.compare_exchange_weak(prev, value, std::memory_order_relaxed));
+    }
+
+    void reset()
+    {
+        for (auto &b : buckets)
+            b.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        peak.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t bucket(size_t idx) const { return buckets[idx].load(std::memory_order_relaxed); }
+    uint64_t sum() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return peak.load(std::memory_order_relaxed); }
+
+    uint64_t count() const
+    {
+        uint64_t n = 0;
+        for (auto &b : buckets)
+            n += b.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // Upper bound of the bucket containing the given fraction of values.
+    uint64_t percentile(double fraction) const
+    {
+        uint64_t n = count();
+        if (n == 0)
+            return 0;
+
+        auto target = (uint64_t) (n * fraction);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < num_buckets; i++) {
+            seen += bucket(i);
+            if (seen > target)
+                return (uint64_t) 1 << i;
+        }
+        return max();
+    }
+
+private:
+    std::atomic<uint64_t> buckets[num_buckets];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> peak;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_histogram_h
@@ -0,0 +1,67 @@
+#include "host_time.h"
+
+#if defined(__APPLE__)
+#   include <mach/mach_time.h>
+#else
+#   include <time.h>
+#endif
+
+namespace p1_mac_plugins {
+
+
+#if defined(__APPLE__)
+
+static const mach_timebase_info_data_t &timebase()
+{
+    static const mach_timebase_info_data_t info = [] {
+        mach_timebase_info_data_t info;
+        mach_timebase_info(&info);
+        return info;
+    }();
+    return info;
+}
+
+uint64_t host_time_now()
+{
+    return mach_absolute_time();
+}
+
+uint64_t host_time_to_ns(uint64_t t)
+{
+    auto &tb = timebase();
+    if (tb.numer == tb.denom)
+        return t;
+    return (uint64_t) ((double) t * tb.numer / tb.denom);
+}
+
+uint64_t ns_to_host_time(uint64_t ns)
+{
+    auto &tb = timebase();
+    if (tb.numer == tb.denom)
+        return ns;
+    return (uint64_t) ((double) ns * tb.denom / tb.numer);
+}
+
+#else
+
+uint64_t host_time_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t host_time_to_ns(uint64_t t)
+{
+    return t;
+}
+
+uint64_t ns_to_host_time(uint64_t ns)
+{
+    return ns;
+}
+
+#endif
+
+
+}  // namespace p1_mac_plugins
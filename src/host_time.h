@@ -0,0 +1,19 @@
+#ifndef p1_mac_plugins_host_time_h
+#define p1_mac_plugins_host_time_h
+
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Host time is the monotonic clock used for all audio and video timestamps.
+// On Mac, these are `mach_absolute_time` ticks, matching `AudioTimeStamp`
+// host times and `CGDisplayStream` display times. Elsewhere, nanoseconds.
+uint64_t host_time_now();
+uint64_t host_time_to_ns(uint64_t t);
+uint64_t ns_to_host_time(uint64_t ns);
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_host_time_h
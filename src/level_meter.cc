@@ -0,0 +1,223 @@
+#include "level_meter.h"
+#include "cpu_features.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+
+static void levels_scalar(const float *in, size_t frames, uint32_t channels,
+    float *peak, float *sumsq)
+{
+    for (uint32_t c = 0; c < channels; c++)
+        peak[c] = sumsq[c] = 0;
+
+    auto *end = in + frames * channels;
+    for (uint32_t c = 0; c < channels; c++) {
+        for (auto *p = in + c; p < end; p += channels) {
+            float v = *p;
+            peak[c] = std::max(peak[c], fabsf(v));
+            sumsq[c] += v * v;
+        }
+    }
+}
+
+// The SIMD kernels handle channel counts that divide the vector width. Lane
+// k of every vector then always holds channel `k % channels`, and lanes are
+// folded into channels at the end.
+static void fold_lanes(const float *lane_peak, const float *lane_sumsq,
+    uint32_t lanes, const float *tail, size_t tail_len, uint32_t channels,
+    float *peak, float *sumsq)
+{
+    for (uint32_t c = 0; c < channels; c++)
+        peak[c] = sumsq[c] = 0;
+
+    for (uint32_t k = 0; k < lanes; k++) {
+        auto c = k % channels;
+        peak[c] = std::max(peak[c], lane_peak[k]);
+        sumsq[c] += lane_sumsq[k];
+    }
+
+    // Tails start on a frame boundary.
+    for (size_t i = 0; i < tail_len; i++) {
+        auto c = i % channels;
+        float v = tail[i];
+        peak[c] = std::max(peak[c], fabsf(v));
+        sumsq[c] += v * v;
+    }
+}
+
+#if P1_HAVE_X86_SIMD
+
+static void levels_sse2(const float *in, size_t frames, uint32_t channels,
+    float *peak, float *sumsq)
+{
+    if (4 % channels != 0)
+        return levels_scalar(in, frames, channels, peak, sumsq);
+
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 vpeak = _mm_setzero_ps();
+    __m128 vsum = _mm_setzero_ps();
+
+    size_t n = frames * channels;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(in + i);
+        vpeak = _mm_max_ps(vpeak, _mm_and_ps(v, abs_mask));
+        vsum = _mm_add_ps(vsum, _mm_mul_ps(v, v));
+    }
+
+    float lane_peak[4], lane_sumsq[4];
+    _mm_storeu_ps(lane_peak, vpeak);
+    _mm_storeu_ps(lane_sumsq, vsum);
+    fold_lanes(lane_peak, lane_sumsq, 4, in + i, n - i, channels, peak, sumsq);
+}
+
+P1_TARGET_AVX2
+static void levels_avx2(const float *in, size_t frames, uint32_t channels,
+    float *peak, float *sumsq)
+{
+    if (8 % channels != 0)
+        return levels_scalar(in, frames, channels, peak, sumsq);
+
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 vpeak = _mm256_setzero_ps();
+    __m256 vsum = _mm256_setzero_ps();
+
+    size_t n = frames * channels;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(in + i);
+        vpeak = _mm256_max_ps(vpeak, _mm256_and_ps(v, abs_mask));
+        vsum = _mm256_add_ps(vsum, _mm256_mul_ps(v, v));
+    }
+
+    float lane_peak[8], lane_sumsq[8];
+    _mm256_storeu_ps(lane_peak, vpeak);
+    _mm256_storeu_ps(lane_sumsq, vsum);
+    fold_lanes(lane_peak, lane_sumsq, 8, in + i, n - i, channels, peak, sumsq);
+}
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+static void levels_neon(const float *in, size_t frames, uint32_t channels,
+    float *peak, float *sumsq)
+{
+    if (4 % channels != 0)
+        return levels_scalar(in, frames, channels, peak, sumsq);
+
+    float32x4_t vpeak = vdupq_n_f32(0);
+    float32x4_t vsum = vdupq_n_f32(0);
+
+    size_t n = frames * channels;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vld1q_f32(in + i);
+        vpeak = vmaxq_f32(vpeak, vabsq_f32(v));
+        vsum = vmlaq_f32(vsum, v, v);
+    }
+
+    float lane_peak[4], lane_sumsq[4];
+    vst1q_f32(lane_peak, vpeak);
+    vst1q_f32(lane_sumsq, vsum);
+    fold_lanes(lane_peak, lane_sumsq, 4, in + i, n - i, channels, peak, sumsq);
+}
+
+#endif  // P1_HAVE_NEON
+
+static level_fn select_level_kernel()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return levels_avx2;
+    if (cpu.sse2)
+        return levels_sse2;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return levels_neon;
+#endif
+    (void) cpu;
+    return levels_scalar;
+}
+
+level_fn get_level_kernel()
+{
+    static const level_fn fn = select_level_kernel();
+    return fn;
+}
+
+level_fn get_scalar_level_kernel()
+{
+    return levels_scalar;
+}
+
+
+level_meter::level_meter() :
+    kernel(get_level_kernel()), channels(0), window_frames(0)
+{
+    reset();
+}
+
+void level_meter::configure(uint32_t channels_, size_t window_frames_)
+{
+    // Metering is disabled for layouts we can't fit in a snapshot.
+    channels = channels_ <= level_snapshot::max_channels ? channels_ : 0;
+    window_frames = window_frames_;
+    reset();
+}
+
+void level_meter::reset()
+{
+    frames_seen = 0;
+    window_time = 0;
+    std::fill(peak, peak + level_snapshot::max_channels, 0.0f);
+    std::fill(sumsq, sumsq + level_snapshot::max_channels, 0.0);
+}
+
+bool level_meter::process(const float *in, size_t frames, uint64_t time,
+    level_snapshot &out)
+{
+    if (channels == 0 || frames == 0)
+        return false;
+
+    float buf_peak[level_snapshot::max_channels];
+    float buf_sumsq[level_snapshot::max_channels];
+    kernel(in, frames, channels, buf_peak, buf_sumsq);
+
+    if (frames_seen == 0)
+        window_time = time;
+
+    for (uint32_t c = 0; c < channels; c++) {
+        peak[c] = std::max(peak[c], buf_peak[c]);
+        sumsq[c] += buf_sumsq[c];
+    }
+
+    frames_seen += frames;
+    if (frames_seen < window_frames)
+        return false;
+
+    out.time = window_time;
+    out.channels = channels;
+    for (uint32_t c = 0; c < channels; c++) {
+        out.peak[c] = peak[c];
+        out.rms[c] = (float) sqrt(sumsq[c] / frames_seen);
+    }
+
+    reset();
+    return true;
+}
+
+
+}  // namespace p1_mac_plugins
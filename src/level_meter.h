@@ -0,0 +1,60 @@
+#ifndef p1_mac_plugins_level_meter_h
+#define p1_mac_plugins_level_meter_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Per-channel levels over one metering window, as linear amplitudes.
+struct level_snapshot {
+    static const uint32_t max_channels = 16;
+
+    uint64_t time;
+    uint32_t channels;
+    float peak[max_channels];
+    float rms[max_channels];
+};
+
+// Measure peak absolute value and sum of squares per channel of interleaved
+// float. Results are written to `peak` and `sumsq`, `channels` each.
+typedef void (*level_fn)(const float *in, size_t frames, uint32_t channels,
+    float *peak, float *sumsq);
+
+// Kernel selected for the running CPU, and the reference. Peaks are equal,
+// sums of squares may differ in rounding, because they are summed in a
+// different order.
+level_fn get_level_kernel();
+level_fn get_scalar_level_kernel();
+
+// Accumulates levels over windows of a fixed number of frames. Windows end
+// on buffer boundaries, so are at least `window_frames` long.
+class level_meter {
+public:
+    level_meter();
+
+    void configure(uint32_t channels_, size_t window_frames_);
+    void reset();
+
+    // Accumulate a buffer, with the time of its first frame. Returns true
+    // and fills `out` if this completed a window.
+    bool process(const float *in, size_t frames, uint64_t time,
+        level_snapshot &out);
+
+private:
+    level_fn kernel;
+
+    uint32_t channels;
+    size_t window_frames;
+
+    size_t frames_seen;
+    uint64_t window_time;
+    float peak[level_snapshot::max_channels];
+    double sumsq[level_snapshot::max_channels];
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_level_meter_h
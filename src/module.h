@@ -4,6 +4,8 @@
 #define GL_DO_NOT_WARN_IF_MULTI_GL_VERSION_HEADERS_INCLUDED
 
 #include "p1stream.h"
+#include "histogram.h"
+#include "rect_set.h"
 
 namespace p1_mac_plugins {
 
@@ -22,11 +24,49 @@ extern Eternal<String> width_sym;
 extern Eternal<String> height_sym;
 extern Eternal<String> name_sym;
 extern Eternal<String> app_sym;
+extern Eternal<String> format_sym;
+extern Eternal<String> interleaved_sym;
+extern Eternal<String> drift_compensation_sym;
+extern Eternal<String> latency_ms_sym;
+extern Eternal<String> buffer_count_sym;
+extern Eternal<String> adaptive_sym;
+extern Eternal<String> meter_interval_ms_sym;
+extern Eternal<String> record_path_sym;
+extern Eternal<String> path_sym;
+extern Eternal<String> realtime_sym;
+extern Eternal<String> loop_sym;
+extern Eternal<String> channel_map_sym;
+extern Eternal<String> channel_matrix_sym;
+extern Eternal<String> delay_ms_sym;
+extern Eternal<String> concealment_sym;
+extern Eternal<String> history_seconds_sym;
+extern Eternal<String> history_format_sym;
+extern Eternal<String> start_sym;
+extern Eternal<String> end_sym;
+extern Eternal<String> seconds_sym;
+extern Eternal<String> gate_threshold_db_sym;
+extern Eternal<String> gate_hold_ms_sym;
+extern Eternal<String> gate_skip_sym;
+extern Eternal<String> backend_sym;
+extern Eternal<String> synthetic_path_sym;
+extern Eternal<String> pixel_format_sym;
+extern Eternal<String> max_fps_sym;
+extern Eternal<String> queue_depth_sym;
+extern Eternal<String> frame_queue_sym;
+extern Eternal<String> latency_offset_ms_sym;
+extern Eternal<String> source_rect_sym;
+extern Eternal<String> stream_sym;
+extern Eternal<String> tile_hash_sym;
+extern Eternal<String> thumbnail_width_sym;
+extern Eternal<String> thumbnail_fps_sym;
 
 extern Persistent<ObjectTemplate> hook_tmpl;
+extern Persistent<FunctionTemplate> display_stream_tmpl;
 
 Local<String> v8_string_from_cf_string(Isolate *isolate, CFStringRef str);
 CFStringRef cf_string_from_v8_string(Handle<Value> str);
+Local<Object> histogram_to_js(Isolate *isolate, const log_histogram &hist);
+bool pixel_rect_from_js(Isolate *isolate, Handle<Value> val, pixel_rect &rect);
 
 
 }  // namespace p1_mac_plugins
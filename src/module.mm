@@ -1,7 +1,9 @@
 #include "audio_queue.h"
+#include "audio_replay.h"
 #include "detect_audio_inputs.h"
 #include "detect_displays.h"
 #include "display_link.h"
+#include "display_region.h"
 #include "display_stream.h"
 #include "preview_service.h"
 #include "syphon_client.h"
@@ -22,8 +24,44 @@ Eternal<String> width_sym;
 Eternal<String> height_sym;
 Eternal<String> name_sym;
 Eternal<String> app_sym;
+Eternal<String> format_sym;
+Eternal<String> interleaved_sym;
+Eternal<String> drift_compensation_sym;
+Eternal<String> latency_ms_sym;
+Eternal<String> buffer_count_sym;
+Eternal<String> adaptive_sym;
+Eternal<String> meter_interval_ms_sym;
+Eternal<String> record_path_sym;
+Eternal<String> path_sym;
+Eternal<String> realtime_sym;
+Eternal<String> loop_sym;
+Eternal<String> channel_map_sym;
+Eternal<String> channel_matrix_sym;
+Eternal<String> delay_ms_sym;
+Eternal<String> concealment_sym;
+Eternal<String> history_seconds_sym;
+Eternal<String> history_format_sym;
+Eternal<String> start_sym;
+Eternal<String> end_sym;
+Eternal<String> seconds_sym;
+Eternal<String> gate_threshold_db_sym;
+Eternal<String> gate_hold_ms_sym;
+Eternal<String> gate_skip_sym;
+Eternal<String> backend_sym;
+Eternal<String> synthetic_path_sym;
+Eternal<String> pixel_format_sym;
+Eternal<String> max_fps_sym;
+Eternal<String> queue_depth_sym;
+Eternal<String> frame_queue_sym;
+Eternal<String> latency_offset_ms_sym;
+Eternal<String> source_rect_sym;
+Eternal<String> stream_sym;
+Eternal<String> tile_hash_sym;
+Eternal<String> thumbnail_width_sym;
+Eternal<String> thumbnail_fps_sym;
 
 Persistent<ObjectTemplate> hook_tmpl;
+Persistent<FunctionTemplate> display_stream_tmpl;
 
 
 Local<String> v8_string_from_cf_string(Isolate *isolate, CFStringRef str)
@@ -46,6 +84,47 @@ CFStringRef cf_string_from_v8_string(Handle<Value> str)
     return CFStringCreateWithCharacters(kCFAllocatorDefault, *val, val.length());
 }
 
+// Summarize a histogram as an object with bucket counts and percentiles.
+Local<Object> histogram_to_js(Isolate *isolate, const log_histogram &hist)
+{
+    auto count = hist.count();
+
+    auto buckets = Array::New(isolate, log_histogram::num_buckets);
+    for (size_t i = 0; i < log_histogram::num_buckets; i++)
+        buckets->Set(i, Number::New(isolate, hist.bucket(i)));
+
+    auto obj = Object::New(isolate);
+    obj->Set(String::NewFromUtf8(isolate, "count"), Number::New(isolate, count));
+    obj->Set(String::NewFromUtf8(isolate, "mean"),
+        Number::New(isolate, count ? (double) hist.sum() / count : 0));
+    obj->Set(String::NewFromUtf8(isolate, "max"), Number::New(isolate, hist.max()));
+    obj->Set(String::NewFromUtf8(isolate, "p50"), Number::New(isolate, hist.percentile(0.5)));
+    obj->Set(String::NewFromUtf8(isolate, "p99"), Number::New(isolate, hist.percentile(0.99)));
+    obj->Set(String::NewFromUtf8(isolate, "buckets"), buckets);
+    return obj;
+}
+
+// Read an object with `x`, `y`, `width` and `height` as a non-empty rect.
+bool pixel_rect_from_js(Isolate *isolate, Handle<Value> val, pixel_rect &rect)
+{
+    if (!val->IsObject())
+        return false;
+    auto obj = val.As<Object>();
+
+    auto x = obj->Get(String::NewFromUtf8(isolate, "x"));
+    auto y = obj->Get(String::NewFromUtf8(isolate, "y"));
+    auto width = obj->Get(width_sym.Get(isolate));
+    auto height = obj->Get(height_sym.Get(isolate));
+    if (!x->IsUint32() || !y->IsUint32() || !width->IsUint32() || !height->IsUint32())
+        return false;
+
+    rect = pixel_rect {
+        (int32_t) x->Uint32Value(), (int32_t) y->Uint32Value(),
+        (int32_t) width->Uint32Value(), (int32_t) height->Uint32Value()
+    };
+    return rect.x >= 0 && rect.y >= 0 && !rect.empty();
+}
+
 static void display_link_constructor(const FunctionCallbackInfo<Value>& args)
 {
     auto link = new display_link();
@@ -58,6 +137,12 @@ static void display_stream_constructor(const FunctionCallbackInfo<Value>& args)
     stream->init(args);
 }
 
+static void display_region_constructor(const FunctionCallbackInfo<Value>& args)
+{
+    auto region = new display_region();
+    region->init(args);
+}
+
 static void detect_displays_constructor(const FunctionCallbackInfo<Value>& args)
 {
     auto detect = new detect_displays();
@@ -70,6 +155,12 @@ static void audio_queue_constructor(const FunctionCallbackInfo<Value>& args)
     queue->init(args);
 }
 
+static void audio_replay_constructor(const FunctionCallbackInfo<Value>& args)
+{
+    auto replay = new audio_replay();
+    replay->init(args);
+}
+
 static void detect_audio_inputs_constructor(const FunctionCallbackInfo<Value>& args)
 {
     auto detect = new detect_audio_inputs();
@@ -96,9 +187,13 @@ static void init(Handle<Object> exports, Handle<Value> module,
     Handle<FunctionTemplate> func;
 
     NODE_DEFINE_CONSTANT(exports, EV_DISPLAYS_CHANGED);
+    NODE_DEFINE_CONSTANT(exports, EV_DISPLAY_THUMBNAIL);
     NODE_DEFINE_CONSTANT(exports, EV_AUDIO_INPUTS_CHANGED);
     NODE_DEFINE_CONSTANT(exports, EV_PREVIEW_REQUEST);
     NODE_DEFINE_CONSTANT(exports, EV_AQ_IS_RUNNING);
+    NODE_DEFINE_CONSTANT(exports, EV_AQ_LEVELS);
+    NODE_DEFINE_CONSTANT(exports, EV_AQ_GATE);
+    NODE_DEFINE_CONSTANT(exports, EV_REPLAY_ENDED);
     NODE_DEFINE_CONSTANT(exports, EV_DISPLAY_LINK_STOPPED);
     NODE_DEFINE_CONSTANT(exports, EV_SYPHON_SERVERS_CHANGED);
 
@@ -113,6 +208,41 @@ static void init(Handle<Object> exports, Handle<Value> module,
     SYM(height_sym, "height");
     SYM(name_sym, "name");
     SYM(app_sym, "app");
+    SYM(format_sym, "format");
+    SYM(interleaved_sym, "interleaved");
+    SYM(drift_compensation_sym, "driftCompensation");
+    SYM(latency_ms_sym, "latencyMs");
+    SYM(buffer_count_sym, "bufferCount");
+    SYM(adaptive_sym, "adaptive");
+    SYM(meter_interval_ms_sym, "meterIntervalMs");
+    SYM(record_path_sym, "recordPath");
+    SYM(path_sym, "path");
+    SYM(realtime_sym, "realtime");
+    SYM(loop_sym, "loop");
+    SYM(channel_map_sym, "channelMap");
+    SYM(channel_matrix_sym, "channelMatrix");
+    SYM(delay_ms_sym, "delayMs");
+    SYM(concealment_sym, "concealment");
+    SYM(history_seconds_sym, "historySeconds");
+    SYM(history_format_sym, "historyFormat");
+    SYM(start_sym, "start");
+    SYM(end_sym, "end");
+    SYM(seconds_sym, "seconds");
+    SYM(gate_threshold_db_sym, "gateThresholdDb");
+    SYM(gate_hold_ms_sym, "gateHoldMs");
+    SYM(gate_skip_sym, "gateSkip");
+    SYM(backend_sym, "backend");
+    SYM(synthetic_path_sym, "syntheticPath");
+    SYM(pixel_format_sym, "pixelFormat");
+    SYM(max_fps_sym, "maxFps");
+    SYM(queue_depth_sym, "queueDepth");
+    SYM(frame_queue_sym, "frameQueue");
+    SYM(latency_offset_ms_sym, "latencyOffsetMs");
+    SYM(source_rect_sym, "sourceRect");
+    SYM(stream_sym, "stream");
+    SYM(tile_hash_sym, "tileHash");
+    SYM(thumbnail_width_sym, "thumbnailWidth");
+    SYM(thumbnail_fps_sym, "thumbnailFps");
 #undef SYM
 
     name = String::NewFromUtf8(isolate, "DisplayLink");
@@ -128,6 +258,14 @@ static void init(Handle<Object> exports, Handle<Value> module,
     func->SetClassName(name);
     display_stream::init_prototype(func);
     exports->Set(name, func->GetFunction());
+    display_stream_tmpl.Reset(isolate, func);
+
+    name = String::NewFromUtf8(isolate, "DisplayRegion");
+    func = FunctionTemplate::New(isolate, display_region_constructor);
+    func->InstanceTemplate()->SetInternalFieldCount(1);
+    func->SetClassName(name);
+    display_region::init_prototype(func);
+    exports->Set(name, func->GetFunction());
 
     name = String::NewFromUtf8(isolate, "DetectDisplays");
     func = FunctionTemplate::New(isolate, detect_displays_constructor);
@@ -143,6 +281,13 @@ static void init(Handle<Object> exports, Handle<Value> module,
     audio_queue::init_prototype(func);
     exports->Set(name, func->GetFunction());
 
+    name = String::NewFromUtf8(isolate, "AudioReplay");
+    func = FunctionTemplate::New(isolate, audio_replay_constructor);
+    func->InstanceTemplate()->SetInternalFieldCount(1);
+    func->SetClassName(name);
+    audio_replay::init_prototype(func);
+    exports->Set(name, func->GetFunction());
+
     name = String::NewFromUtf8(isolate, "DetectAudioInputs");
     func = FunctionTemplate::New(isolate, detect_audio_inputs_constructor);
     func->InstanceTemplate()->SetInternalFieldCount(1);
@@ -0,0 +1,194 @@
+#include "rect_set.h"
+
+#include <algorithm>
+
+namespace p1_mac_plugins {
+
+
+bool pixel_rect::contains(const pixel_rect &other) const
+{
+    return other.x >= x && other.y >= y &&
+        other.right() <= right() && other.bottom() <= bottom();
+}
+
+bool pixel_rect::intersects(const pixel_rect &other) const
+{
+    return other.x < right() && x < other.right() &&
+        other.y < bottom() && y < other.bottom();
+}
+
+pixel_rect pixel_rect::united(const pixel_rect &other) const
+{
+    auto l = std::min(x, other.x);
+    auto t = std::min(y, other.y);
+    auto r = std::max(right(), other.right());
+    auto b = std::max(bottom(), other.bottom());
+    return pixel_rect { l, t, r - l, b - t };
+}
+
+pixel_rect pixel_rect::intersected(const pixel_rect &other) const
+{
+    auto l = std::max(x, other.x);
+    auto t = std::max(y, other.y);
+    auto r = std::min(right(), other.right());
+    auto b = std::min(bottom(), other.bottom());
+    if (r <= l || b <= t)
+        return pixel_rect { 0, 0, 0, 0 };
+    return pixel_rect { l, t, r - l, b - t };
+}
+
+// Area a merge would cover that neither rectangle does.
+static uint64_t merge_waste(const pixel_rect &a, const pixel_rect &b)
+{
+    auto covered = a.area() + b.area() - a.intersected(b).area();
+    return a.united(b).area() - covered;
+}
+
+
+rect_set::rect_set() :
+    bounds { 0, 0, 0, 0 }, count(0), is_full(false)
+{
+}
+
+void rect_set::configure(int32_t width, int32_t height)
+{
+    bounds = pixel_rect { 0, 0, width, height };
+    clear();
+}
+
+void rect_set::clear()
+{
+    count = 0;
+    is_full = false;
+}
+
+void rect_set::add(const pixel_rect &rect)
+{
+    if (is_full)
+        return;
+
+    auto clipped = rect.intersected(bounds);
+    if (clipped.empty())
+        return;
+
+    if (clipped.contains(bounds))
+        add_all();
+    else
+        insert(clipped);
+}
+
+void rect_set::add_all()
+{
+    rects[0] = bounds;
+    count = bounds.empty() ? 0 : 1;
+    is_full = count != 0;
+}
+
+void rect_set::add_set(const rect_set &other)
+{
+    if (other.is_full) {
+        add_all();
+        return;
+    }
+    for (auto &rect : other)
+        add(rect);
+}
+
+uint64_t rect_set::area() const
+{
+    uint64_t res = 0;
+    for (auto &rect : *this)
+        res += rect.area();
+    return res;
+}
+
+pixel_rect rect_set::bounding_rect() const
+{
+    if (count == 0)
+        return pixel_rect { 0, 0, 0, 0 };
+
+    auto res = rects[0];
+    for (size_t i = 1; i < count; i++)
+        res = res.united(rects[i]);
+    return res;
+}
+
+// Add a clipped rectangle, keeping the set free of contained rectangles.
+// Each merge grows the rectangle, so containment is checked again.
+void rect_set::insert(pixel_rect rect)
+{
+    do {
+        for (size_t i = 0; i < count; i++) {
+            if (rects[i].contains(rect))
+                return;
+        }
+
+        for (size_t i = 0; i < count;) {
+            if (rect.contains(rects[i]))
+                remove(i);
+            else
+                i++;
+        }
+    } while (merge_cheap(rect));
+
+    if (rect.contains(bounds)) {
+        add_all();
+        return;
+    }
+
+    if (count == max_rects)
+        merge_closest();
+
+    // Merging may have covered the new rectangle.
+    for (size_t i = 0; i < count; i++) {
+        if (rects[i].contains(rect))
+            return;
+    }
+    rects[count++] = rect;
+}
+
+void rect_set::remove(size_t idx)
+{
+    rects[idx] = rects[--count];
+}
+
+// Merge with a rectangle that the union mostly covers anyway, such as a
+// neighbor or a heavily overlapping one. Returns true if merged, with the
+// other rectangle removed.
+bool rect_set::merge_cheap(pixel_rect &rect)
+{
+    for (size_t i = 0; i < count; i++) {
+        auto covered = rect.area() + rects[i].area() - rect.intersected(rects[i]).area();
+        if (merge_waste(rect, rects[i]) * 4 <= covered) {
+            rect = rect.united(rects[i]);
+            remove(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Make room by merging the pair of rectangles that wastes the least area.
+void rect_set::merge_closest()
+{
+    size_t best_a = 0, best_b = 1;
+    uint64_t best_waste = UINT64_MAX;
+    for (size_t a = 0; a < count; a++) {
+        for (size_t b = a + 1; b < count; b++) {
+            auto waste = merge_waste(rects[a], rects[b]);
+            if (waste < best_waste) {
+                best_waste = waste;
+                best_a = a;
+                best_b = b;
+            }
+        }
+    }
+
+    auto merged = rects[best_a].united(rects[best_b]);
+    remove(best_b);
+    remove(best_a);
+    insert(merged);
+}
+
+
+}  // namespace p1_mac_plugins
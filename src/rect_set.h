@@ -0,0 +1,78 @@
+#ifndef p1_mac_plugins_rect_set_h
+#define p1_mac_plugins_rect_set_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Rectangle in frame pixels. Half-open, `x + width` is just outside.
+struct pixel_rect {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    int32_t right() const { return x + width; }
+    int32_t bottom() const { return y + height; }
+    uint64_t area() const { return empty() ? 0 : (uint64_t) width * height; }
+
+    bool contains(const pixel_rect &other) const;
+    bool intersects(const pixel_rect &other) const;
+    pixel_rect united(const pixel_rect &other) const;
+    pixel_rect intersected(const pixel_rect &other) const;
+};
+
+// A small set of rectangles covering changed parts of a frame. Additions
+// are clipped to the frame and coalesced, merging rectangles whenever the
+// merge covers little area that wasn't already changed. The set never holds
+// more than `max_rects`, at the cost of growing what is covered. No
+// rectangle is contained in another, but they may overlap.
+//
+// Fixed size and never allocates, so it can be used anywhere.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class rect_set {
+public:
+    static const size_t max_rects = 16;
+
+    rect_set();
+
+    // Set frame dimensions and clear.
+    void configure(int32_t width, int32_t height);
+    void clear();
+
+    // Add changed areas. `add_all` marks the whole frame.
+    void add(const pixel_rect &rect);
+    void add_all();
+    void add_set(const rect_set &other);
+
+    bool empty() const { return count == 0; }
+    bool full() const { return is_full; }
+    size_t size() const { return count; }
+    const pixel_rect *begin() const { return rects; }
+    const pixel_rect *end() const { return rects + count; }
+    const pixel_rect &frame() const { return bounds; }
+
+    // Total area covered, counting overlap once per rectangle.
+    uint64_t area() const;
+    pixel_rect bounding_rect() const;
+
+private:
+    pixel_rect bounds;
+    pixel_rect rects[max_rects];
+    size_t count;
+    bool is_full;
+
+    void insert(pixel_rect rect);
+    void remove(size_t idx);
+    bool merge_cheap(pixel_rect &rect);
+    void merge_closest();
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_rect_set_h
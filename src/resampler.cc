@@ -0,0 +1,308 @@
+#include "resampler.h"
+#include "cpu_features.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+// Filter dot product, interpolated between two adjacent phases:
+// sum(x * h0) + a * (sum(x * h1) - sum(x * h0)). `n` is a multiple of 8.
+typedef float (*dot_interp_fn)(const float *x, const float *h0,
+    const float *h1, float a, size_t n);
+
+static const double max_correction = 0.005;
+
+
+static float dot_interp_scalar(const float *x, const float *h0,
+    const float *h1, float a, size_t n)
+{
+    float s0 = 0, s1 = 0;
+    for (size_t i = 0; i < n; i++) {
+        s0 += x[i] * h0[i];
+        s1 += x[i] * h1[i];
+    }
+    return s0 + a * (s1 - s0);
+}
+
+#if P1_HAVE_X86_SIMD
+
+static inline float hsum_sse2(__m128 v)
+{
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+static float dot_interp_sse2(const float *x, const float *h0,
+    const float *h1, float a, size_t n)
+{
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        s0 = _mm_add_ps(s0, _mm_mul_ps(vx, _mm_loadu_ps(h0 + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(vx, _mm_loadu_ps(h1 + i)));
+    }
+    __m128 va = _mm_set1_ps(a);
+    return hsum_sse2(_mm_add_ps(s0, _mm_mul_ps(va, _mm_sub_ps(s1, s0))));
+}
+
+P1_TARGET_AVX2
+static float dot_interp_avx2(const float *x, const float *h0,
+    const float *h1, float a, size_t n)
+{
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(vx, _mm256_loadu_ps(h0 + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(vx, _mm256_loadu_ps(h1 + i)));
+    }
+    __m256 va = _mm256_set1_ps(a);
+    __m256 s = _mm256_add_ps(s0, _mm256_mul_ps(va, _mm256_sub_ps(s1, s0)));
+    return hsum_sse2(_mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1)));
+}
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+static float dot_interp_neon(const float *x, const float *h0,
+    const float *h1, float a, size_t n)
+{
+    float32x4_t s0 = vdupq_n_f32(0);
+    float32x4_t s1 = vdupq_n_f32(0);
+    for (size_t i = 0; i < n; i += 4) {
+        float32x4_t vx = vld1q_f32(x + i);
+        s0 = vmlaq_f32(s0, vx, vld1q_f32(h0 + i));
+        s1 = vmlaq_f32(s1, vx, vld1q_f32(h1 + i));
+    }
+    float32x4_t s = vmlaq_n_f32(s0, vsubq_f32(s1, s0), a);
+    float32x2_t r = vadd_f32(vget_low_f32(s), vget_high_f32(s));
+    return vget_lane_f32(vpadd_f32(r, r), 0);
+}
+
+#endif  // P1_HAVE_NEON
+
+static dot_interp_fn select_dot_interp()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return dot_interp_avx2;
+    if (cpu.sse2)
+        return dot_interp_sse2;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return dot_interp_neon;
+#endif
+    (void) cpu;
+    return dot_interp_scalar;
+}
+
+static dot_interp_fn get_dot_interp()
+{
+    static const dot_interp_fn fn = select_dot_interp();
+    return fn;
+}
+
+
+resampler::resampler() :
+    channels(0), taps(0), phases(0), max_in_frames(0),
+    nominal_step(1.0), cur_step(1.0),
+    line_cap(0), line_len(0), pos(0), out_position(0)
+{
+}
+
+void resampler::configure(uint32_t channels_, double in_rate_, double out_rate_,
+    size_t max_in_frames_, uint32_t taps_, uint32_t phases_)
+{
+    channels = channels_;
+    taps = (taps_ + 7) & ~7;
+    phases = phases_;
+    max_in_frames = max_in_frames_;
+    nominal_step = cur_step = in_rate_ / out_rate_;
+
+    // Cut off a little below the lower Nyquist frequency.
+    double cutoff = 0.95 * std::min(1.0, out_rate_ / in_rate_);
+    build_bank(cutoff);
+
+    line_cap = taps + 2 * max_in_frames;
+    line.reset(new float[line_cap * channels]);
+    reset();
+}
+
+void resampler::reset()
+{
+    // Start with silent history, so the first output lines up with input.
+    line_len = taps - 1;
+    memset(line.get(), 0, line_cap * channels * sizeof(float));
+    pos = 0;
+    out_position = 0;
+}
+
+void resampler::build_bank(double cutoff)
+{
+    bank.reset(new float[(phases + 1) * taps]);
+
+    const double center = taps / 2 - 1;
+    for (uint32_t p = 0; p <= phases; p++) {
+        auto *row = &bank[p * taps];
+        double frac = (double) p / phases;
+        double sum = 0;
+        for (uint32_t k = 0; k < taps; k++) {
+            double t = k - center - frac;
+            double sinc = t == 0 ? 1.0 : sin(M_PI * cutoff * t) / (M_PI * cutoff * t);
+
+            // Blackman window across the filter span.
+            double w = (t + taps / 2.0) / taps;
+            double window = w <= 0 || w >= 1 ? 0 :
+                0.42 - 0.5 * cos(2 * M_PI * w) + 0.08 * cos(4 * M_PI * w);
+
+            row[k] = (float) (sinc * window);
+            sum += row[k];
+        }
+
+        // Unity gain at DC for every phase.
+        for (uint32_t k = 0; k < taps; k++)
+            row[k] = (float) (row[k] / sum);
+    }
+}
+
+void resampler::set_correction(double correction)
+{
+    correction = std::max(1.0 - max_correction, std::min(1.0 + max_correction, correction));
+    cur_step = nominal_step * correction;
+}
+
+size_t resampler::max_output_frames(size_t in_frames) const
+{
+    return (size_t) ceil((in_frames + taps) / (nominal_step * (1.0 - max_correction))) + 1;
+}
+
+size_t resampler::process(const float *in, size_t in_frames,
+    float *out, size_t max_out_frames)
+{
+    auto dot_interp = get_dot_interp();
+
+    // Drop input that doesn't fit. Only happens if output was starved for
+    // a long time, which the caller should prevent with `max_output_frames`.
+    in_frames = std::min(in_frames, line_cap - line_len);
+
+    // Append input to the per-channel lines.
+    size_t in_start = line_len;
+    for (uint32_t c = 0; c < channels; c++) {
+        auto *dst = &line[c * line_cap + line_len];
+        auto *src = in + c;
+        for (size_t i = 0; i < in_frames; i++, src += channels)
+            dst[i] = *src;
+    }
+    line_len += in_frames;
+
+    out_position = pos + (taps / 2 - 1) - (double) in_start;
+
+    size_t num_out = 0;
+    while (num_out < max_out_frames) {
+        auto base = (size_t) pos;
+        if (base + taps > line_len)
+            break;
+
+        double phase = (pos - base) * phases;
+        auto p = (uint32_t) phase;
+        auto a = (float) (phase - p);
+        auto *h0 = &bank[p * taps];
+        auto *h1 = h0 + taps;
+
+        for (uint32_t c = 0; c < channels; c++)
+            out[num_out * channels + c] = dot_interp(&line[c * line_cap + base], h0, h1, a, taps);
+
+        num_out++;
+        pos += cur_step;
+    }
+
+    // Discard history we no longer need.
+    auto drop = std::min((size_t) pos, line_len);
+    if (drop != 0) {
+        for (uint32_t c = 0; c < channels; c++) {
+            auto *l = &line[c * line_cap];
+            memmove(l, l + drop, (line_len - drop) * sizeof(float));
+        }
+        line_len -= drop;
+        pos -= drop;
+    }
+
+    return num_out;
+}
+
+
+drift_estimator::drift_estimator() :
+    nominal_rate(0), bandwidth_hz(0), started(false), next_time(0), frame_period(0)
+{
+}
+
+void drift_estimator::configure(double nominal_rate_, double bandwidth_hz_)
+{
+    nominal_rate = nominal_rate_;
+    bandwidth_hz = bandwidth_hz_;
+    reset();
+}
+
+void drift_estimator::reset()
+{
+    started = false;
+    next_time = 0;
+    frame_period = 1e9 / nominal_rate;
+}
+
+void drift_estimator::update(uint64_t time_ns, size_t frames)
+{
+    if (frames == 0)
+        return;
+
+    double t = (double) time_ns;
+    double e = t - next_time;
+
+    // Start over on the first buffer, or after a discontinuity, but keep
+    // the period estimate. That's the part that takes long to settle.
+    if (!started || fabs(e) > 1e8) {
+        started = true;
+        next_time = t + frames * frame_period;
+        return;
+    }
+
+    // Second order DLL. Bandwidth is relative to the buffer period.
+    double omega = 2 * M_PI * bandwidth_hz * frames * frame_period * 1e-9;
+    double b = M_SQRT2 * omega;
+    double c = omega * omega;
+
+    next_time += b * e + frames * frame_period;
+    frame_period += c * e / frames;
+
+    double nominal_period = 1e9 / nominal_rate;
+    frame_period = std::max(nominal_period * (1.0 - max_correction),
+        std::min(nominal_period * (1.0 + max_correction), frame_period));
+}
+
+double drift_estimator::rate() const
+{
+    return 1e9 / frame_period;
+}
+
+double drift_estimator::ratio() const
+{
+    return rate() / nominal_rate;
+}
+
+
+}  // namespace p1_mac_plugins
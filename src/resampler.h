@@ -0,0 +1,95 @@
+#ifndef p1_mac_plugins_resampler_h
+#define p1_mac_plugins_resampler_h
+
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Polyphase windowed-sinc resampler for interleaved float audio. The ratio
+// can be nudged continuously while running, to follow clock drift.
+//
+// Output lags input by `taps / 2 - 1` input frames. `last_output_position`
+// accounts for this, so callers can timestamp output precisely.
+class resampler {
+public:
+    resampler();
+
+    void configure(uint32_t channels_, double in_rate_, double out_rate_,
+        size_t max_in_frames_, uint32_t taps_ = 32, uint32_t phases_ = 128);
+    void reset();
+
+    // Scale the nominal input step, e.g. 1.0001 if the input clock runs fast.
+    void set_correction(double correction);
+    double step() const { return cur_step; }
+
+    // Upper bound on output frames for `in_frames` of input.
+    size_t max_output_frames(size_t in_frames) const;
+
+    // Consume up to `max_in_frames` input frames, and write at most
+    // `max_out_frames` output frames. Returns frames written.
+    size_t process(const float *in, size_t in_frames,
+        float *out, size_t max_out_frames);
+
+    // Position of the first output frame of the last `process` call, in input
+    // frames relative to the start of its input. Usually negative.
+    double last_output_position() const { return out_position; }
+
+private:
+    uint32_t channels;
+    uint32_t taps;
+    uint32_t phases;
+    size_t max_in_frames;
+    double nominal_step;
+    double cur_step;
+
+    // Filter bank, `phases + 1` rows of `taps` coefficients.
+    std::unique_ptr<float[]> bank;
+
+    // Per-channel input history, `line_cap` frames each.
+    std::unique_ptr<float[]> line;
+    size_t line_cap;
+    size_t line_len;
+    double pos;
+    double out_position;
+
+    void build_bank(double cutoff);
+};
+
+// Estimates the true rate of a capture clock against host time, using a
+// second order delay-locked loop on buffer timestamps. Jitter in individual
+// timestamps is filtered out, slow drift is tracked.
+class drift_estimator {
+public:
+    drift_estimator();
+
+    void configure(double nominal_rate_, double bandwidth_hz_ = 0.05);
+    void reset();
+
+    // Feed the host time in nanoseconds of the first frame of a buffer.
+    void update(uint64_t time_ns, size_t frames);
+
+    // Estimated actual rate in frames per second.
+    double rate() const;
+
+    // Estimated rate relative to nominal.
+    double ratio() const;
+
+    // Filtered host time in nanoseconds of the frame after the last buffer.
+    double next_time_ns() const { return next_time; }
+
+private:
+    double nominal_rate;
+    double bandwidth_hz;
+
+    bool started;
+    double next_time;
+    double frame_period;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_resampler_h
@@ -0,0 +1,399 @@
+#include "sample_convert.h"
+#include "cpu_features.h"
+
+#include <cstring>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+static const float int16_scale = 1.0f / 32768.0f;
+static const float int24_scale = 1.0f / 8388608.0f;
+static const float int32_scale = 1.0f / 2147483648.0f;
+
+
+size_t sample_format_size(sample_format fmt)
+{
+    switch (fmt) {
+        case sample_format_int16: return 2;
+        case sample_format_int24: return 3;
+        case sample_format_int32: return 4;
+        case sample_format_float32: return 4;
+    }
+    return 0;
+}
+
+// Scalar kernels. Also used for tails of the SIMD kernels.
+
+static inline int32_t load_int24(const uint8_t *p)
+{
+    // Place in the top of an int32, then shift down to sign extend.
+    return (int32_t) ((uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 24) >> 8;
+}
+
+static void int16_to_float_scalar(const void *in, float *out, size_t count)
+{
+    auto *src = (const int16_t *) in;
+    for (size_t i = 0; i < count; i++)
+        out[i] = src[i] * int16_scale;
+}
+
+static void int24_to_float_scalar(const void *in, float *out, size_t count)
+{
+    auto *src = (const uint8_t *) in;
+    for (size_t i = 0; i < count; i++)
+        out[i] = load_int24(src + i * 3) * int24_scale;
+}
+
+static void int32_to_float_scalar(const void *in, float *out, size_t count)
+{
+    auto *src = (const int32_t *) in;
+    for (size_t i = 0; i < count; i++)
+        out[i] = src[i] * int32_scale;
+}
+
+static void float32_to_float(const void *in, float *out, size_t count)
+{
+    memcpy(out, in, count * sizeof(float));
+}
+
+static void interleave_scalar(const float *const *planes, float *out,
+    size_t frames, uint32_t channels)
+{
+    for (uint32_t c = 0; c < channels; c++) {
+        auto *src = planes[c];
+        auto *dst = out + c;
+        for (size_t i = 0; i < frames; i++, dst += channels)
+            *dst = src[i];
+    }
+}
+
+static const sample_kernels scalar_kernels = {
+    "scalar",
+    {
+        int16_to_float_scalar,
+        int24_to_float_scalar,
+        int32_to_float_scalar,
+        float32_to_float
+    },
+    interleave_scalar
+};
+
+#if P1_HAVE_X86_SIMD
+
+// SSE2 kernels. SSE2 has no byte shuffle, so packed 24-bit stays scalar.
+
+static void int16_to_float_sse2(const void *in, float *out, size_t count)
+{
+    auto *src = (const int16_t *) in;
+    const __m128 scale = _mm_set1_ps(int16_scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    int16_to_float_scalar(src + i, out + i, count - i);
+}
+
+static void int32_to_float_sse2(const void *in, float *out, size_t count)
+{
+    auto *src = (const int32_t *) in;
+    const __m128 scale = _mm_set1_ps(int32_scale);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    int32_to_float_scalar(src + i, out + i, count - i);
+}
+
+static void interleave_sse2(const float *const *planes, float *out,
+    size_t frames, uint32_t channels)
+{
+    if (channels != 2)
+        return interleave_scalar(planes, out, frames, channels);
+
+    auto *l = planes[0];
+    auto *r = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 vl = _mm_loadu_ps(l + i);
+        __m128 vr = _mm_loadu_ps(r + i);
+        _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(vl, vr));
+        _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(vl, vr));
+    }
+    for (; i < frames; i++) {
+        out[i * 2] = l[i];
+        out[i * 2 + 1] = r[i];
+    }
+}
+
+static const sample_kernels sse2_kernels = {
+    "sse2",
+    {
+        int16_to_float_sse2,
+        int24_to_float_scalar,
+        int32_to_float_sse2,
+        float32_to_float
+    },
+    interleave_sse2
+};
+
+// AVX2 kernels.
+
+P1_TARGET_AVX2
+static void int16_to_float_avx2(const void *in, float *out, size_t count)
+{
+    auto *src = (const int16_t *) in;
+    const __m256 scale = _mm256_set1_ps(int16_scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (src + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    int16_to_float_scalar(src + i, out + i, count - i);
+}
+
+P1_TARGET_AVX2
+static void int24_to_float_avx2(const void *in, float *out, size_t count)
+{
+    auto *src = (const uint8_t *) in;
+    const __m256 scale = _mm256_set1_ps(int24_scale);
+
+    // Per 128-bit lane, move 4 packed samples into the top 3 bytes of each
+    // 32-bit element. The arithmetic shift then sign extends.
+    const __m256i shuf = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+
+    // Each iteration reads 28 bytes for 24 bytes of samples, so stop early
+    // enough not to read past the input.
+    size_t i = 0;
+    for (; i + 10 <= count; i += 8) {
+        auto *p = src + i * 3;
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) p)),
+            _mm_loadu_si128((const __m128i *) (p + 12)), 1);
+        v = _mm256_srai_epi32(_mm256_shuffle_epi8(v, shuf), 8);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    int24_to_float_scalar(src + i * 3, out + i, count - i);
+}
+
+P1_TARGET_AVX2
+static void int32_to_float_avx2(const void *in, float *out, size_t count)
+{
+    auto *src = (const int32_t *) in;
+    const __m256 scale = _mm256_set1_ps(int32_scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (src + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    int32_to_float_scalar(src + i, out + i, count - i);
+}
+
+P1_TARGET_AVX2
+static void interleave_avx2(const float *const *planes, float *out,
+    size_t frames, uint32_t channels)
+{
+    if (channels != 2)
+        return interleave_scalar(planes, out, frames, channels);
+
+    auto *l = planes[0];
+    auto *r = planes[1];
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 vl = _mm256_loadu_ps(l + i);
+        __m256 vr = _mm256_loadu_ps(r + i);
+        __m256 lo = _mm256_unpacklo_ps(vl, vr);
+        __m256 hi = _mm256_unpackhi_ps(vl, vr);
+        _mm256_storeu_ps(out + i * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + i * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    for (; i < frames; i++) {
+        out[i * 2] = l[i];
+        out[i * 2 + 1] = r[i];
+    }
+}
+
+static const sample_kernels avx2_kernels = {
+    "avx2",
+    {
+        int16_to_float_avx2,
+        int24_to_float_avx2,
+        int32_to_float_avx2,
+        float32_to_float
+    },
+    interleave_avx2
+};
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+static void int16_to_float_neon(const void *in, float *out, size_t count)
+{
+    auto *src = (const int16_t *) in;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), int16_scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), int16_scale));
+    }
+    int16_to_float_scalar(src + i, out + i, count - i);
+}
+
+static void int24_to_float_neon(const void *in, float *out, size_t count)
+{
+    auto *src = (const uint8_t *) in;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // De-interleave the three bytes of 8 samples.
+        uint8x8x3_t b = vld3_u8(src + i * 3);
+        uint16x8_t lo = vorrq_u16(vmovl_u8(b.val[0]), vshlq_n_u16(vmovl_u8(b.val[1]), 8));
+        int16x8_t hi = vmovl_s8(vreinterpret_s8_u8(b.val[2]));
+        int32x4_t v0 = vorrq_s32(
+            vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lo))),
+            vshll_n_s16(vget_low_s16(hi), 16));
+        int32x4_t v1 = vorrq_s32(
+            vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lo))),
+            vshll_n_s16(vget_high_s16(hi), 16));
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(v0), int24_scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(v1), int24_scale));
+    }
+    int24_to_float_scalar(src + i * 3, out + i, count - i);
+}
+
+static void int32_to_float_neon(const void *in, float *out, size_t count)
+{
+    auto *src = (const int32_t *) in;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), int32_scale));
+    int32_to_float_scalar(src + i, out + i, count - i);
+}
+
+static void interleave_neon(const float *const *planes, float *out,
+    size_t frames, uint32_t channels)
+{
+    if (channels != 2)
+        return interleave_scalar(planes, out, frames, channels);
+
+    auto *l = planes[0];
+    auto *r = planes[1];
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t v = { { vld1q_f32(l + i), vld1q_f32(r + i) } };
+        vst2q_f32(out + i * 2, v);
+    }
+    for (; i < frames; i++) {
+        out[i * 2] = l[i];
+        out[i * 2 + 1] = r[i];
+    }
+}
+
+static const sample_kernels neon_kernels = {
+    "neon",
+    {
+        int16_to_float_neon,
+        int24_to_float_neon,
+        int32_to_float_neon,
+        float32_to_float
+    },
+    interleave_neon
+};
+
+#endif  // P1_HAVE_NEON
+
+static const sample_kernels &select_kernels()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return avx2_kernels;
+    if (cpu.sse2)
+        return sse2_kernels;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return neon_kernels;
+#endif
+    (void) cpu;
+    return scalar_kernels;
+}
+
+const sample_kernels &get_sample_kernels()
+{
+    static const sample_kernels &kernels = select_kernels();
+    return kernels;
+}
+
+const sample_kernels &get_scalar_sample_kernels()
+{
+    return scalar_kernels;
+}
+
+
+sample_converter::sample_converter() :
+    kernels(get_sample_kernels()),
+    fmt(sample_format_float32), interleaved(true), channels(1)
+{
+}
+
+void sample_converter::configure(sample_format fmt_, bool interleaved_,
+    uint32_t channels_, size_t max_frames)
+{
+    fmt = fmt_;
+    interleaved = interleaved_ || channels_ == 1;
+    channels = channels_;
+
+    if (interleaved) {
+        scratch.reset();
+        planes.reset();
+    }
+    else {
+        scratch.reset(new float[max_frames * channels]);
+        planes.reset(new const float *[channels]);
+        for (uint32_t c = 0; c < channels; c++)
+            planes[c] = &scratch[c * max_frames];
+    }
+}
+
+bool sample_converter::is_passthrough() const
+{
+    return interleaved && fmt == sample_format_float32;
+}
+
+size_t sample_converter::bytes_per_frame() const
+{
+    return sample_format_size(fmt) * channels;
+}
+
+void sample_converter::convert(const void *in, float *out, size_t frames)
+{
+    auto to_float = kernels.to_float[fmt];
+
+    if (interleaved) {
+        to_float(in, out, frames * channels);
+        return;
+    }
+
+    // Non-interleaved buffers store each channel contiguously.
+    auto *src = (const uint8_t *) in;
+    auto plane_size = frames * sample_format_size(fmt);
+    for (uint32_t c = 0; c < channels; c++)
+        to_float(src + c * plane_size, (float *) planes[c], frames);
+    kernels.interleave(planes.get(), out, frames, channels);
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,70 @@
+#ifndef p1_mac_plugins_sample_convert_h
+#define p1_mac_plugins_sample_convert_h
+
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Linear PCM sample formats we accept from capture devices. Integers are
+// signed, little-endian and packed.
+enum sample_format {
+    sample_format_int16,
+    sample_format_int24,
+    sample_format_int32,
+    sample_format_float32
+};
+
+size_t sample_format_size(sample_format fmt);
+
+// Convert `count` contiguous samples to float in [-1, 1).
+typedef void (*to_float_fn)(const void *in, float *out, size_t count);
+
+// Interleave `channels` float planes into `out`.
+typedef void (*interleave_fn)(const float *const *planes, float *out,
+    size_t frames, uint32_t channels);
+
+// Kernels selected for the running CPU.
+struct sample_kernels {
+    const char *name;
+    to_float_fn to_float[4];
+    interleave_fn interleave;
+};
+
+const sample_kernels &get_sample_kernels();
+const sample_kernels &get_scalar_sample_kernels();
+
+// Converts capture buffers of one format to interleaved float.
+class sample_converter {
+public:
+    sample_converter();
+
+    void configure(sample_format fmt_, bool interleaved_, uint32_t channels_,
+        size_t max_frames);
+
+    // True if input is already interleaved float, and conversion is a copy.
+    bool is_passthrough() const;
+
+    size_t bytes_per_frame() const;
+
+    // Convert `frames` frames from `in` to `out`, which must hold
+    // `frames * channels` floats.
+    void convert(const void *in, float *out, size_t frames);
+
+private:
+    const sample_kernels &kernels;
+
+    sample_format fmt;
+    bool interleaved;
+    uint32_t channels;
+
+    std::unique_ptr<float[]> scratch;
+    std::unique_ptr<const float *[]> planes;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_sample_convert_h
@@ -0,0 +1,535 @@
+#include "scaler.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+// Rounding of each pass. The vertical pass keeps 6 of the 14 fractional
+// bits, the horizontal pass removes the rest.
+static const int32_t vertical_shift = 8;
+static const int32_t horizontal_shift = 20;
+
+// Intermediate samples read past the end by the SIMD horizontal pass.
+static const size_t scratch_padding = 8;
+
+
+static double filter_support(scale_filter filter)
+{
+    switch (filter) {
+        case scale_filter_box: return 0.5;
+        case scale_filter_bilinear: return 1.0;
+        default: return 3.0;
+    }
+}
+
+static double sinc(double x)
+{
+    if (x == 0.0)
+        return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double filter_weight(scale_filter filter, double x)
+{
+    switch (filter) {
+        case scale_filter_box:
+            return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+        case scale_filter_bilinear:
+            x = fabs(x);
+            return x < 1.0 ? 1.0 - x : 0.0;
+        default:
+            return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+}
+
+void build_scale_table(scale_filter filter, int32_t src_size, int32_t dst_size,
+    scale_table &table)
+{
+    double scale = (double) src_size / dst_size;
+    double filter_scale = std::max(scale, 1.0);
+    double support = filter_support(filter) * filter_scale;
+
+    int32_t taps = (int32_t) ceil(support) * 2 + 1;
+    taps = std::min(taps, src_size);
+
+    table.filter = filter;
+    table.src_size = src_size;
+    table.dst_size = dst_size;
+    table.taps = taps;
+    table.offsets.assign(dst_size, 0);
+    table.weights.assign((size_t) dst_size * taps, 0);
+
+    std::vector<double> w(taps);
+    for (int32_t i = 0; i < dst_size; i++) {
+        double center = (i + 0.5) * scale;
+        int32_t lo = std::max((int32_t) (center - support + 0.5), 0);
+        int32_t hi = std::min((int32_t) (center + support + 0.5), src_size);
+        int32_t count = std::min(hi - lo, taps);
+
+        double sum = 0;
+        for (int32_t j = 0; j < count; j++) {
+            w[j] = filter_weight(filter, (j + lo - center + 0.5) / filter_scale);
+            sum += w[j];
+        }
+
+        // Shift windows at the right edge left, padding with zeroes.
+        int32_t offset = std::min(lo, src_size - taps);
+        int32_t shift = lo - offset;
+        table.offsets[i] = offset;
+
+        auto *out = &table.weights[(size_t) i * taps];
+        int32_t total = 0;
+        int32_t largest = shift;
+        for (int32_t j = 0; j < count; j++) {
+            int32_t fixed = sum != 0 ? (int32_t) lround(w[j] / sum * (1 << 14)) : 0;
+            out[shift + j] = (int16_t) fixed;
+            total += fixed;
+            if (fixed > out[largest])
+                largest = shift + j;
+        }
+
+        // Rounding error goes to the largest weight, so flat areas stay flat.
+        out[largest] = (int16_t) (out[largest] + (1 << 14) - total);
+    }
+}
+
+// Scalar kernels, the reference. Also used for tails of the SIMD kernels.
+
+static inline int16_t clamp16(int32_t v)
+{
+    return (int16_t) (v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+}
+
+static inline uint8_t clamp8(int32_t v)
+{
+    return (uint8_t) (v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+static void vertical_scalar(const uint8_t *src, size_t stride,
+    const int16_t *weights, int32_t taps, int16_t *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        int32_t acc = 1 << (vertical_shift - 1);
+        for (int32_t t = 0; t < taps; t++)
+            acc += weights[t] * src[t * stride + i];
+        dst[i] = clamp16(acc >> vertical_shift);
+    }
+}
+
+template<int channels>
+static void horizontal_scalar(const int16_t *src, const int32_t *offsets,
+    int32_t base, const int16_t *weights, int32_t taps, uint8_t *dst,
+    int32_t width)
+{
+    for (int32_t x = 0; x < width; x++) {
+        auto *in = src + (offsets[x] - base) * channels;
+        auto *w = weights + (size_t) x * taps;
+        int32_t acc[channels];
+        for (int c = 0; c < channels; c++)
+            acc[c] = 1 << (horizontal_shift - 1);
+        for (int32_t t = 0; t < taps; t++) {
+            for (int c = 0; c < channels; c++)
+                acc[c] += w[t] * in[t * channels + c];
+        }
+        for (int c = 0; c < channels; c++)
+            dst[x * channels + c] = clamp8(acc[c] >> horizontal_shift);
+    }
+}
+
+static const scale_kernels scalar_kernels = {
+    "scalar",
+    vertical_scalar,
+    horizontal_scalar<1>,
+    horizontal_scalar<2>,
+    horizontal_scalar<4>
+};
+
+#if P1_HAVE_X86_SIMD
+
+// SSE2 kernels. Pairs of taps are interleaved and multiplied with
+// `madd_epi16`, which adds each pair. SSE2 is baseline on x86_64.
+
+static inline __m128i weight_pair(const int16_t *w, int32_t t, int32_t taps)
+{
+    uint32_t w0 = (uint16_t) w[t];
+    uint32_t w1 = t + 1 < taps ? (uint16_t) w[t + 1] : 0;
+    return _mm_set1_epi32((int32_t) (w0 | w1 << 16));
+}
+
+static void vertical_sse2(const uint8_t *src, size_t stride,
+    const int16_t *weights, int32_t taps, int16_t *dst, size_t count)
+{
+    auto zero = _mm_setzero_si128();
+    auto round = _mm_set1_epi32(1 << (vertical_shift - 1));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        auto acc0 = round, acc1 = round, acc2 = round, acc3 = round;
+        for (int32_t t = 0; t < taps; t += 2) {
+            auto w = weight_pair(weights, t, taps);
+            auto a = _mm_loadu_si128((const __m128i *) (src + t * stride + i));
+            // A lone last tap pairs with itself, at zero weight.
+            auto b = t + 1 < taps ? _mm_loadu_si128((const __m128i *) (src + (t + 1) * stride + i)) : a;
+            auto lo = _mm_unpacklo_epi8(a, b);
+            auto hi = _mm_unpackhi_epi8(a, b);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+        }
+        acc0 = _mm_srai_epi32(acc0, vertical_shift);
+        acc1 = _mm_srai_epi32(acc1, vertical_shift);
+        acc2 = _mm_srai_epi32(acc2, vertical_shift);
+        acc3 = _mm_srai_epi32(acc3, vertical_shift);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packs_epi32(acc0, acc1));
+        _mm_storeu_si128((__m128i *) (dst + i + 8), _mm_packs_epi32(acc2, acc3));
+    }
+    vertical_scalar(src + i, stride, weights, taps, dst + i, count - i);
+}
+
+static void horizontal4_sse2(const int16_t *src, const int32_t *offsets,
+    int32_t base, const int16_t *weights, int32_t taps, uint8_t *dst,
+    int32_t width)
+{
+    auto round = _mm_set1_epi32(1 << (horizontal_shift - 1));
+    for (int32_t x = 0; x < width; x++) {
+        auto *in = src + (offsets[x] - base) * 4;
+        auto *w = weights + (size_t) x * taps;
+        auto acc = round;
+        for (int32_t t = 0; t < taps; t += 2) {
+            // Two pixels, interleaved by channel. A lone last tap reads one
+            // pixel past the window, into the scratch padding.
+            auto px = _mm_loadu_si128((const __m128i *) (in + t * 4));
+            px = _mm_unpacklo_epi16(px, _mm_srli_si128(px, 8));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(px, weight_pair(w, t, taps)));
+        }
+        acc = _mm_srai_epi32(acc, horizontal_shift);
+        acc = _mm_packs_epi32(acc, acc);
+        auto out = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+        *(int32_t *) (dst + x * 4) = out;
+    }
+}
+
+static const scale_kernels sse2_kernels = {
+    "sse2",
+    vertical_sse2,
+    horizontal_scalar<1>,
+    horizontal_scalar<2>,
+    horizontal4_sse2
+};
+
+// AVX2 kernels. Unpacking works within 128-bit lanes, so the vertical pass
+// widens 16 pixels to 16-bit first, which keeps the packed result in order.
+// The horizontal pass does two output pixels at once, one per lane.
+
+P1_TARGET_AVX2
+static void vertical_avx2(const uint8_t *src, size_t stride,
+    const int16_t *weights, int32_t taps, int16_t *dst, size_t count)
+{
+    auto round = _mm256_set1_epi32(1 << (vertical_shift - 1));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        auto acc0 = round, acc1 = round;
+        for (int32_t t = 0; t < taps; t += 2) {
+            auto w = _mm256_broadcastsi128_si256(weight_pair(weights, t, taps));
+            auto a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (src + t * stride + i)));
+            auto b = t + 1 < taps ? _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i *) (src + (t + 1) * stride + i))) : a;
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        acc0 = _mm256_srai_epi32(acc0, vertical_shift);
+        acc1 = _mm256_srai_epi32(acc1, vertical_shift);
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_packs_epi32(acc0, acc1));
+    }
+    vertical_scalar(src + i, stride, weights, taps, dst + i, count - i);
+}
+
+P1_TARGET_AVX2
+static void horizontal4_avx2(const int16_t *src, const int32_t *offsets,
+    int32_t base, const int16_t *weights, int32_t taps, uint8_t *dst,
+    int32_t width)
+{
+    auto round = _mm256_set1_epi32(1 << (horizontal_shift - 1));
+    int32_t x = 0;
+    for (; x + 2 <= width; x += 2) {
+        auto *in0 = src + (offsets[x] - base) * 4;
+        auto *in1 = src + (offsets[x + 1] - base) * 4;
+        auto *w0 = weights + (size_t) x * taps;
+        auto *w1 = w0 + taps;
+        auto acc = round;
+        for (int32_t t = 0; t < taps; t += 2) {
+            auto px = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                _mm_loadu_si128((const __m128i *) (in0 + t * 4))),
+                _mm_loadu_si128((const __m128i *) (in1 + t * 4)), 1);
+            px = _mm256_unpacklo_epi16(px, _mm256_srli_si256(px, 8));
+            auto w = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                weight_pair(w0, t, taps)), weight_pair(w1, t, taps), 1);
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(px, w));
+        }
+        acc = _mm256_srai_epi32(acc, horizontal_shift);
+        acc = _mm256_packs_epi32(acc, acc);
+        acc = _mm256_packus_epi16(acc, acc);
+        *(int32_t *) (dst + x * 4) = _mm_cvtsi128_si32(_mm256_castsi256_si128(acc));
+        *(int32_t *) (dst + x * 4 + 4) = _mm_cvtsi128_si32(_mm256_extracti128_si256(acc, 1));
+    }
+    horizontal4_sse2(src, offsets + x, base, weights + (size_t) x * taps, taps,
+        dst + x * 4, width - x);
+}
+
+static const scale_kernels avx2_kernels = {
+    "avx2",
+    vertical_avx2,
+    horizontal_scalar<1>,
+    horizontal_scalar<2>,
+    horizontal4_avx2
+};
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+// NEON kernels. Multiply-accumulate by a scalar weight widens to 32 bits
+// directly, and narrowing saturates, like the clamps of the reference.
+
+static void vertical_neon(const uint8_t *src, size_t stride,
+    const int16_t *weights, int32_t taps, int16_t *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        auto acc0 = vdupq_n_s32(1 << (vertical_shift - 1));
+        auto acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int32_t t = 0; t < taps; t++) {
+            auto px = vld1q_u8(src + t * stride + i);
+            auto lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(px)));
+            auto hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(px)));
+            int16_t w = weights[t];
+            acc0 = vmlal_n_s16(acc0, vget_low_s16(lo), w);
+            acc1 = vmlal_n_s16(acc1, vget_high_s16(lo), w);
+            acc2 = vmlal_n_s16(acc2, vget_low_s16(hi), w);
+            acc3 = vmlal_n_s16(acc3, vget_high_s16(hi), w);
+        }
+        vst1q_s16(dst + i, vcombine_s16(
+            vqmovn_s32(vshrq_n_s32(acc0, vertical_shift)),
+            vqmovn_s32(vshrq_n_s32(acc1, vertical_shift))));
+        vst1q_s16(dst + i + 8, vcombine_s16(
+            vqmovn_s32(vshrq_n_s32(acc2, vertical_shift)),
+            vqmovn_s32(vshrq_n_s32(acc3, vertical_shift))));
+    }
+    vertical_scalar(src + i, stride, weights, taps, dst + i, count - i);
+}
+
+static void horizontal4_neon(const int16_t *src, const int32_t *offsets,
+    int32_t base, const int16_t *weights, int32_t taps, uint8_t *dst,
+    int32_t width)
+{
+    for (int32_t x = 0; x < width; x++) {
+        auto *in = src + (offsets[x] - base) * 4;
+        auto *w = weights + (size_t) x * taps;
+        auto acc = vdupq_n_s32(1 << (horizontal_shift - 1));
+        for (int32_t t = 0; t < taps; t++)
+            acc = vmlal_n_s16(acc, vld1_s16(in + t * 4), w[t]);
+        auto px = vqmovn_s32(vshrq_n_s32(acc, horizontal_shift));
+        auto out = vqmovun_s16(vcombine_s16(px, px));
+        vst1_lane_u32((uint32_t *) (dst + x * 4), vreinterpret_u32_u8(out), 0);
+    }
+}
+
+static const scale_kernels neon_kernels = {
+    "neon",
+    vertical_neon,
+    horizontal_scalar<1>,
+    horizontal_scalar<2>,
+    horizontal4_neon
+};
+
+#endif  // P1_HAVE_NEON
+
+static const scale_kernels &select_kernels()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return avx2_kernels;
+    if (cpu.sse2)
+        return sse2_kernels;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return neon_kernels;
+#endif
+    (void) cpu;
+    return scalar_kernels;
+}
+
+const scale_kernels &get_scale_kernels()
+{
+    static const scale_kernels &kernels = select_kernels();
+    return kernels;
+}
+
+const scale_kernels &get_scalar_scale_kernels()
+{
+    return scalar_kernels;
+}
+
+
+image_scaler::image_scaler() :
+    kernels(&get_scale_kernels()), pool(nullptr), filter(scale_filter_bilinear)
+{
+}
+
+void image_scaler::configure(scale_filter filter_, worker_pool *pool_,
+    const scale_kernels *kernels_)
+{
+    if (filter_ != filter)
+        tables.clear();
+    filter = filter_;
+    pool = pool_;
+    kernels = kernels_ != nullptr ? kernels_ : &get_scale_kernels();
+}
+
+bool image_scaler::scale(const image_desc &src, const image_desc &dst)
+{
+    if (src.format != dst.format ||
+        src.width <= 0 || src.height <= 0 || dst.width <= 0 || dst.height <= 0)
+        return false;
+
+    tiles.clear();
+    size_t size = 0;
+    switch (src.format) {
+        case image_format_bgra:
+            size = add_tiles(0, 4, src.width, src.height, dst.width, dst.height, size);
+            break;
+        case image_format_nv12:
+            size = add_tiles(0, 1, src.width, src.height, dst.width, dst.height, size);
+            size = add_tiles(1, 2, (src.width + 1) / 2, (src.height + 1) / 2,
+                (dst.width + 1) / 2, (dst.height + 1) / 2, size);
+            break;
+        case image_format_i420:
+            size = add_tiles(0, 1, src.width, src.height, dst.width, dst.height, size);
+            for (int32_t plane = 1; plane < 3; plane++)
+                size = add_tiles(plane, 1, (src.width + 1) / 2, (src.height + 1) / 2,
+                    (dst.width + 1) / 2, (dst.height + 1) / 2, size);
+            break;
+        default:
+            return false;
+    }
+    if (scratch.size() < size)
+        scratch.resize(size);
+
+    if (pool == nullptr || tiles.size() == 1) {
+        for (auto &t : tiles)
+            scale_tile(src, dst, t);
+        return true;
+    }
+
+    // Captures one pointer, so the function does not allocate.
+    struct tile_job {
+        image_scaler *self;
+        const image_desc *src;
+        const image_desc *dst;
+    } job = { this, &src, &dst };
+    pool->run(tiles.size(), [&job](size_t i) {
+        job.self->scale_tile(*job.src, *job.dst, job.self->tiles[i]);
+    });
+    return true;
+}
+
+const scale_table *image_scaler::get_table(int32_t src_size, int32_t dst_size)
+{
+    for (auto it = tables.begin(); it != tables.end(); ++it) {
+        auto &table = **it;
+        if (table.src_size == src_size && table.dst_size == dst_size) {
+            std::rotate(it, it + 1, tables.end());
+            return tables.back().get();
+        }
+    }
+
+    // A call uses at most 4 tables, so this never evicts one in use.
+    if (tables.size() == max_tables)
+        tables.erase(tables.begin());
+
+    std::unique_ptr<scale_table> table(new scale_table);
+    build_scale_table(filter, src_size, dst_size, *table);
+    tables.push_back(std::move(table));
+    return tables.back().get();
+}
+
+// Cut a plane into tiles, assigning each a part of the scratch memory from
+// `offset`. Returns the end of the scratch memory used.
+size_t image_scaler::add_tiles(int32_t plane, int32_t channels,
+    int32_t src_width, int32_t src_height, int32_t dst_width, int32_t dst_height,
+    size_t offset)
+{
+    auto *h = get_table(src_width, dst_width);
+    auto *v = get_table(src_height, dst_height);
+
+    for (int32_t x0 = 0; x0 < dst_width; x0 += tile_width) {
+        int32_t x1 = std::min(x0 + tile_width, dst_width);
+        size_t span = (size_t) (h->offsets[x1 - 1] + h->taps - h->offsets[x0]);
+        size_t size = span * channels + scratch_padding;
+
+        for (int32_t y0 = 0; y0 < dst_height; y0 += tile_rows) {
+            tile t;
+            t.plane = plane;
+            t.channels = channels;
+            t.h = h;
+            t.v = v;
+            t.x0 = x0;
+            t.x1 = x1;
+            t.y0 = y0;
+            t.y1 = std::min(y0 + tile_rows, dst_height);
+            t.scratch = offset;
+            tiles.push_back(t);
+            offset += size;
+        }
+    }
+
+    return offset;
+}
+
+void image_scaler::scale_tile(const image_desc &src, const image_desc &dst,
+    const tile &t)
+{
+    auto &in = src.planes[t.plane];
+    auto &out = dst.planes[t.plane];
+    auto &h = *t.h;
+    auto &v = *t.v;
+
+    scale_horizontal_fn horizontal;
+    switch (t.channels) {
+        case 1: horizontal = kernels->horizontal1; break;
+        case 2: horizontal = kernels->horizontal2; break;
+        default: horizontal = kernels->horizontal4; break;
+    }
+
+    // Rows are weighed vertically over the input columns the tile covers,
+    // then horizontally into the output row.
+    int32_t base = h.offsets[t.x0];
+    size_t count = (size_t) (h.offsets[t.x1 - 1] + h.taps - base) * t.channels;
+    auto *row = scratch.data() + t.scratch;
+    auto *h_weights = h.weights.data() + (size_t) t.x0 * h.taps;
+
+    for (int32_t y = t.y0; y < t.y1; y++) {
+        auto *src_row = in.data + (size_t) v.offsets[y] * in.stride + (size_t) base * t.channels;
+        kernels->vertical(src_row, in.stride, v.weights.data() + (size_t) y * v.taps,
+            v.taps, row, count);
+
+        auto *dst_row = out.data + (size_t) y * out.stride + (size_t) t.x0 * t.channels;
+        horizontal(row, h.offsets.data() + t.x0, base, h_weights, h.taps,
+            dst_row, t.x1 - t.x0);
+    }
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,117 @@
+#ifndef p1_mac_plugins_scaler_h
+#define p1_mac_plugins_scaler_h
+
+#include "color_convert.h"
+#include "worker_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace p1_mac_plugins {
+
+
+enum scale_filter {
+    scale_filter_box,
+    scale_filter_bilinear,
+    scale_filter_lanczos3
+};
+
+// Weights of one dimension for a pair of sizes. Every output sample has
+// `taps` weights for consecutive input samples from its offset. Weights
+// have 14 fractional bits and sum to exactly 1. Windows at the edges are
+// cut off and renormalized, and shifted to stay within the input.
+struct scale_table {
+    scale_filter filter;
+    int32_t src_size;
+    int32_t dst_size;
+    int32_t taps;
+    std::vector<int32_t> offsets;
+    std::vector<int16_t> weights;
+};
+
+void build_scale_table(scale_filter filter, int32_t src_size, int32_t dst_size,
+    scale_table &table);
+
+// Row kernels. The vertical pass weighs `taps` rows, `stride` bytes apart,
+// into 16-bit samples with 6 fractional bits. The horizontal pass weighs
+// those into output pixels of 1, 2 or 4 channels. Offsets are relative to
+// `base`, the first input pixel of the row.
+typedef void (*scale_vertical_fn)(const uint8_t *src, size_t stride,
+    const int16_t *weights, int32_t taps, int16_t *dst, size_t count);
+typedef void (*scale_horizontal_fn)(const int16_t *src, const int32_t *offsets,
+    int32_t base, const int16_t *weights, int32_t taps, uint8_t *dst,
+    int32_t width);
+
+// Kernels selected for the running CPU. All kernels give the same result.
+struct scale_kernels {
+    const char *name;
+    scale_vertical_fn vertical;
+    scale_horizontal_fn horizontal1;
+    scale_horizontal_fn horizontal2;
+    scale_horizontal_fn horizontal4;
+};
+
+const scale_kernels &get_scale_kernels();
+const scale_kernels &get_scalar_scale_kernels();
+
+// Resizes BGRA, NV12 and I420 images into caller memory. Each plane is
+// cut into tiles of the output, which run in parallel on a worker pool.
+// Filter tables are cached per size pair, and scratch memory is kept, so
+// scaling repeatedly between the same sizes does not allocate.
+//
+// Filters widen when downscaling, so every input pixel contributes.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class image_scaler {
+public:
+    // Size of output tiles.
+    static const int32_t tile_width = 256;
+    static const int32_t tile_rows = 32;
+
+    // Tables kept, two per plane size pair.
+    static const size_t max_tables = 8;
+
+    image_scaler();
+
+    // Null pool runs on the calling thread. Kernels may be overridden, for
+    // comparing with the reference.
+    void configure(scale_filter filter_, worker_pool *pool_,
+        const scale_kernels *kernels_ = nullptr);
+
+    // Returns false if formats differ or are not supported, or a size is
+    // zero.
+    bool scale(const image_desc &src, const image_desc &dst);
+
+private:
+    struct tile {
+        int32_t plane;
+        int32_t channels;
+        const scale_table *h;
+        const scale_table *v;
+        int32_t x0, x1, y0, y1;
+        size_t scratch;
+    };
+
+    const scale_kernels *kernels;
+    worker_pool *pool;
+    scale_filter filter;
+
+    // Most recently used last.
+    std::vector<std::unique_ptr<scale_table>> tables;
+
+    // Reused between calls.
+    std::vector<tile> tiles;
+    std::vector<int16_t> scratch;
+
+    const scale_table *get_table(int32_t src_size, int32_t dst_size);
+    size_t add_tiles(int32_t plane, int32_t channels, int32_t src_width,
+        int32_t src_height, int32_t dst_width, int32_t dst_height, size_t offset);
+    void scale_tile(const image_desc &src, const image_desc &dst, const tile &t);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_scaler_h
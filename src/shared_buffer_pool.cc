@@ -0,0 +1,57 @@
+#include "shared_buffer_pool.h"
+
+namespace p1_mac_plugins {
+
+
+shared_audio_buffer::shared_audio_buffer(size_t capacity_) :
+    refs(0), samples(0), capacity(capacity_), data(new float[capacity_])
+{
+}
+
+
+shared_buffer_pool::shared_buffer_pool() :
+    buf_samples(0), num_buffers(0), cursor(0)
+{
+}
+
+void shared_buffer_pool::configure(size_t buffer_samples_)
+{
+    buf_samples = buffer_samples_;
+}
+
+bool shared_buffer_pool::reserve(size_t count)
+{
+    bool fits = count <= max_buffers;
+    if (!fits)
+        count = max_buffers;
+
+    auto n = num_buffers.load(std::memory_order_relaxed);
+    for (; n < count; n++) {
+        buffers[n].reset(new shared_audio_buffer(buf_samples));
+        num_buffers.store(n + 1, std::memory_order_release);
+    }
+    return fits;
+}
+
+shared_audio_buffer *shared_buffer_pool::acquire()
+{
+    auto n = num_buffers.load(std::memory_order_acquire);
+
+    // Start after the last buffer handed out. It is most likely still in
+    // use, and the oldest ones most likely free.
+    for (size_t i = 0; i < n; i++) {
+        auto idx = (cursor + i) % n;
+        auto *buf = buffers[idx].get();
+
+        uint32_t expected = 0;
+        if (buf->refs.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+            cursor = idx + 1;
+            buf->samples = 0;
+            return buf;
+        }
+    }
+    return nullptr;
+}
+
+
+}  // namespace p1_mac_plugins
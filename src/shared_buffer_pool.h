@@ -0,0 +1,63 @@
+#ifndef p1_mac_plugins_shared_buffer_pool_h
+#define p1_mac_plugins_shared_buffer_pool_h
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Reference counted audio buffer. Filled once by the producer, then read
+// only, by any number of consumers. Returns to its pool when the last
+// reference is released.
+class shared_audio_buffer {
+public:
+    explicit shared_audio_buffer(size_t capacity_);
+
+    std::atomic<uint32_t> refs;
+    uint32_t samples;
+    const size_t capacity;
+    std::unique_ptr<float[]> data;
+
+    void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+    void release() { refs.fetch_sub(1, std::memory_order_acq_rel); }
+};
+
+// Fixed-size buffers for a realtime producer. Acquiring is lock-free and
+// never allocates; buffers are only allocated by `reserve`, outside the
+// realtime thread, and freed with the pool.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class shared_buffer_pool {
+public:
+    static const size_t max_buffers = 256;
+
+    shared_buffer_pool();
+
+    // Set buffer size, in samples. Only before any buffers exist.
+    void configure(size_t buffer_samples_);
+    size_t buffer_samples() const { return buf_samples; }
+
+    // Allocate buffers until there are at least `count`, up to
+    // `max_buffers`. Returns false if `count` was over the limit. Calls must
+    // be serialized, but may run concurrently with `acquire`.
+    bool reserve(size_t count);
+    size_t size() const { return num_buffers.load(std::memory_order_acquire); }
+
+    // Returns an unused buffer holding one reference, or nullptr if all are
+    // in use. Only one thread may acquire.
+    shared_audio_buffer *acquire();
+
+private:
+    size_t buf_samples;
+    std::unique_ptr<shared_audio_buffer> buffers[max_buffers];
+    std::atomic<size_t> num_buffers;
+    size_t cursor;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_shared_buffer_pool_h
@@ -0,0 +1,170 @@
+#include "silence_gate.h"
+#include "cpu_features.h"
+
+#include <cmath>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+
+// Distance between the open and close thresholds.
+static const double hysteresis_db = 6.0;
+
+static bool any_above_scalar(const float *in, size_t count, float threshold)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (fabsf(in[i]) > threshold)
+            return true;
+    }
+    return false;
+}
+
+// The SIMD kernels test a few vectors at a time, so checking for an early
+// exit doesn't dominate.
+
+#if P1_HAVE_X86_SIMD
+
+static bool any_above_sse2(const float *in, size_t count, float threshold)
+{
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 t = _mm_set1_ps(threshold);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128 a = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(in + i), abs_mask), t);
+        __m128 b = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(in + i + 4), abs_mask), t);
+        __m128 c = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(in + i + 8), abs_mask), t);
+        __m128 d = _mm_cmpgt_ps(_mm_and_ps(_mm_loadu_ps(in + i + 12), abs_mask), t);
+        if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(a, b), _mm_or_ps(c, d))) != 0)
+            return true;
+    }
+    return any_above_scalar(in + i, count - i, threshold);
+}
+
+P1_TARGET_AVX2
+static bool any_above_avx2(const float *in, size_t count, float threshold)
+{
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 t = _mm256_set1_ps(threshold);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256 a = _mm256_cmp_ps(_mm256_and_ps(_mm256_loadu_ps(in + i), abs_mask), t, _CMP_GT_OQ);
+        __m256 b = _mm256_cmp_ps(_mm256_and_ps(_mm256_loadu_ps(in + i + 8), abs_mask), t, _CMP_GT_OQ);
+        __m256 c = _mm256_cmp_ps(_mm256_and_ps(_mm256_loadu_ps(in + i + 16), abs_mask), t, _CMP_GT_OQ);
+        __m256 d = _mm256_cmp_ps(_mm256_and_ps(_mm256_loadu_ps(in + i + 24), abs_mask), t, _CMP_GT_OQ);
+        if (_mm256_movemask_ps(_mm256_or_ps(_mm256_or_ps(a, b), _mm256_or_ps(c, d))) != 0)
+            return true;
+    }
+    return any_above_scalar(in + i, count - i, threshold);
+}
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+static bool any_above_neon(const float *in, size_t count, float threshold)
+{
+    const float32x4_t t = vdupq_n_f32(threshold);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint32x4_t a = vcagtq_f32(vld1q_f32(in + i), t);
+        uint32x4_t b = vcagtq_f32(vld1q_f32(in + i + 4), t);
+        uint32x4_t c = vcagtq_f32(vld1q_f32(in + i + 8), t);
+        uint32x4_t d = vcagtq_f32(vld1q_f32(in + i + 12), t);
+        uint32x4_t any = vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d));
+        uint32x2_t half = vorr_u32(vget_low_u32(any), vget_high_u32(any));
+        if (vget_lane_u32(vpmax_u32(half, half), 0) != 0)
+            return true;
+    }
+    return any_above_scalar(in + i, count - i, threshold);
+}
+
+#endif  // P1_HAVE_NEON
+
+static any_above_fn select_any_above_kernel()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return any_above_avx2;
+    if (cpu.sse2)
+        return any_above_sse2;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return any_above_neon;
+#endif
+    (void) cpu;
+    return any_above_scalar;
+}
+
+any_above_fn get_any_above_kernel()
+{
+    static const any_above_fn fn = select_any_above_kernel();
+    return fn;
+}
+
+any_above_fn get_scalar_any_above_kernel()
+{
+    return any_above_scalar;
+}
+
+
+silence_gate::silence_gate() :
+    kernel(get_any_above_kernel()), open_level(0), close_level(0),
+    hold_frames(0), channels(0)
+{
+    reset();
+}
+
+void silence_gate::configure(double threshold_db, size_t hold_frames_,
+    uint32_t channels_)
+{
+    open_level = (float) pow(10.0, threshold_db / 20);
+    close_level = (float) pow(10.0, (threshold_db - hysteresis_db) / 20);
+    hold_frames = hold_frames_;
+    channels = channels_;
+    reset();
+}
+
+// Start open, so nothing is held back until we know it's silent.
+void silence_gate::reset()
+{
+    open = true;
+    quiet_frames = 0;
+}
+
+bool silence_gate::process(const float *in, size_t frames)
+{
+    auto count = frames * channels;
+
+    if (!open) {
+        if (!kernel(in, count, open_level))
+            return false;
+        open = true;
+        quiet_frames = 0;
+        return true;
+    }
+
+    if (kernel(in, count, close_level)) {
+        quiet_frames = 0;
+        return false;
+    }
+
+    quiet_frames += frames;
+    if (quiet_frames < hold_frames)
+        return false;
+    open = false;
+    return true;
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,51 @@
+#ifndef p1_mac_plugins_silence_gate_h
+#define p1_mac_plugins_silence_gate_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// True if any of `count` samples has an absolute value above `threshold`.
+// Stops at the first one found.
+typedef bool (*any_above_fn)(const float *in, size_t count, float threshold);
+
+// Kernel selected for the running CPU, and the reference.
+any_above_fn get_any_above_kernel();
+any_above_fn get_scalar_any_above_kernel();
+
+// Noise gate style silence detection with hysteresis. The gate opens as soon
+// as a buffer exceeds the threshold, and closes once all buffers stayed
+// below a threshold 6 dB lower for the hold time. Thresholds are in dBFS.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class silence_gate {
+public:
+    silence_gate();
+
+    void configure(double threshold_db, size_t hold_frames_, uint32_t channels_);
+    void reset();
+
+    bool is_open() const { return open; }
+
+    // Check a buffer of interleaved float. Returns true if the gate changed
+    // state, which is then reflected by `is_open`.
+    bool process(const float *in, size_t frames);
+
+private:
+    any_above_fn kernel;
+
+    float open_level;
+    float close_level;
+    size_t hold_frames;
+    uint32_t channels;
+
+    bool open;
+    size_t quiet_frames;
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_silence_gate_h
@@ -0,0 +1,141 @@
+#ifndef p1_mac_plugins_spsc_ring_h
+#define p1_mac_plugins_spsc_ring_h
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace p1_mac_plugins {
+
+
+// Wait-free single-producer, single-consumer ring of trivially copyable
+// elements. One thread may only write, one other thread may only read.
+// Neither side ever blocks; a full ring rejects the write instead.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+template<typename T>
+class spsc_ring {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "spsc_ring elements must be trivially copyable");
+
+public:
+    // Capacity is rounded up to a power of two.
+    explicit spsc_ring(size_t min_capacity);
+
+    size_t capacity() const { return mask + 1; }
+
+    // Producer side.
+    size_t write_available() const;
+    bool write(const T *src, size_t count);
+    bool push(const T &val) { return write(&val, 1); }
+
+    // Consumer side.
+    size_t read_available() const;
+    bool read(T *dst, size_t count);
+    bool pop(T &val) { return read(&val, 1); }
+    void skip(size_t count);
+
+private:
+    std::unique_ptr<T[]> data;
+    size_t mask;
+
+    // Indices increase monotonically and are masked on access. Keep the
+    // producer and consumer indices on separate cache lines.
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+
+    void copy_in(size_t pos, const T *src, size_t count);
+    void copy_out(size_t pos, T *dst, size_t count) const;
+};
+
+
+template<typename T>
+spsc_ring<T>::spsc_ring(size_t min_capacity) :
+    head(0), tail(0)
+{
+    size_t capacity = 1;
+    while (capacity < min_capacity)
+        capacity <<= 1;
+
+    data.reset(new T[capacity]);
+    mask = capacity - 1;
+}
+
+template<typename T>
+size_t spsc_ring<T>::write_available() const
+{
+    auto h = head.load(std::memory_order_relaxed);
+    auto t = tail.load(std::memory_order_acquire);
+    return capacity() - (h - t);
+}
+
+template<typename T>
+bool spsc_ring<T>::write(const T *src, size_t count)
+{
+    auto h = head.load(std::memory_order_relaxed);
+    auto t = tail.load(std::memory_order_acquire);
+    if (capacity() - (h - t) < count)
+        return false;
+
+    copy_in(h & mask, src, count);
+    head.store(h + count, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+size_t spsc_ring<T>::read_available() const
+{
+    auto t = tail.load(std::memory_order_relaxed);
+    auto h = head.load(std::memory_order_acquire);
+    return h - t;
+}
+
+template<typename T>
+bool spsc_ring<T>::read(T *dst, size_t count)
+{
+    auto t = tail.load(std::memory_order_relaxed);
+    auto h = head.load(std::memory_order_acquire);
+    if (h - t < count)
+        return false;
+
+    copy_out(t & mask, dst, count);
+    tail.store(t + count, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+void spsc_ring<T>::skip(size_t count)
+{
+    auto t = tail.load(std::memory_order_relaxed);
+    tail.store(t + count, std::memory_order_release);
+}
+
+template<typename T>
+void spsc_ring<T>::copy_in(size_t pos, const T *src, size_t count)
+{
+    size_t first = capacity() - pos;
+    if (first > count)
+        first = count;
+
+    memcpy(&data[pos], src, first * sizeof(T));
+    memcpy(&data[0], src + first, (count - first) * sizeof(T));
+}
+
+template<typename T>
+void spsc_ring<T>::copy_out(size_t pos, T *dst, size_t count) const
+{
+    size_t first = capacity() - pos;
+    if (first > count)
+        first = count;
+
+    memcpy(dst, &data[pos], first * sizeof(T));
+    memcpy(dst + first, &data[0], (count - first) * sizeof(T));
+}
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_spsc_ring_h
@@ -0,0 +1,170 @@
+#include "synthetic_backend.h"
+#include "host_time.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace p1_mac_plugins {
+
+
+// Tone of 440 Hz left, 660 Hz right, at -20 dBFS. The phase runs in
+// radians per Hz.
+static const double tone_hz[synthetic_backend::tone_channels] = { 440, 660 };
+static const float tone_level = 0.1f;
+
+
+synthetic_backend::synthetic_backend() :
+    client(nullptr), buffer_frames(0), phase(0), stopping(false)
+{
+}
+
+synthetic_backend::~synthetic_backend()
+{
+    close();
+}
+
+bool synthetic_backend::open(const capture_backend_config &config, capture_backend_client &client_)
+{
+    client = &client_;
+
+    if (config.path.empty()) {
+        fmt.format = sample_format_float32;
+        fmt.interleaved = true;
+        fmt.channels = tone_channels;
+        fmt.rate = tone_rate;
+        buffer_frames = std::max((size_t) 1, (size_t) (config.latency_ms * tone_rate / 1000));
+        fmt.max_frames = buffer_frames;
+        tone.reset(new float[buffer_frames * tone_channels]);
+        return true;
+    }
+
+    if (!reader.open(config.path.c_str())) {
+        client->capture_log(capture_log_error, "Could not open capture file '%s': %s",
+            config.path.c_str(), strerror(errno));
+        return false;
+    }
+
+    auto &hdr = reader.header();
+    if (hdr.format > sample_format_float32 || hdr.channels == 0 ||
+        !(hdr.sample_rate > 0)) {
+        client->capture_log(capture_log_error, "Unsupported capture file '%s'",
+            config.path.c_str());
+        reader.close();
+        return false;
+    }
+
+    fmt.format = (sample_format) hdr.format;
+    fmt.interleaved = hdr.interleaved != 0;
+    fmt.channels = hdr.channels;
+    fmt.rate = hdr.sample_rate;
+
+    // Delivered as recorded, so size for the largest record.
+    fmt.max_frames = 0;
+    capture_record_header rec;
+    const void *data;
+    while (reader.next(rec, data))
+        fmt.max_frames = std::max(fmt.max_frames, (size_t) rec.frames);
+    reader.rewind();
+
+    if (fmt.max_frames == 0) {
+        client->capture_log(capture_log_error, "Capture file '%s' is empty",
+            config.path.c_str());
+        reader.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool synthetic_backend::start()
+{
+    stopping = false;
+    thread = std::thread([this] { run(); });
+    return true;
+}
+
+void synthetic_backend::close()
+{
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+
+    reader.close();
+}
+
+capture_backend_stats synthetic_backend::stats() const
+{
+    auto res = capture_backend::stats();
+    res.latency_ms = fmt.max_frames * 1000.0 / fmt.rate;
+    res.buffer_count = 1;
+    return res;
+}
+
+// Deliver buffers in realtime. Buffers are due once their last frame would
+// have been captured. Timing is derived from the sample position, so there
+// is no drift and no jitter beyond that of the wakeup.
+void synthetic_backend::run()
+{
+    typedef std::chrono::steady_clock clock;
+
+    client->capture_running(true);
+
+    auto start_time = clock::now();
+    auto start_host = host_time_now();
+    uint64_t position = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        const void *data;
+        size_t frames;
+        if (reader.is_open()) {
+            capture_record_header rec;
+            if (!reader.next(rec, data)) {
+                reader.rewind();
+                continue;
+            }
+            frames = rec.frames;
+        }
+        else {
+            frames = buffer_frames;
+            generate(frames);
+            data = tone.get();
+        }
+
+        auto due = start_time + std::chrono::nanoseconds(
+            (int64_t) ((position + frames) * 1e9 / fmt.rate));
+        if (cond.wait_until(lock, due, [this] { return stopping; }))
+            break;
+
+        auto time = start_host + ns_to_host_time((uint64_t) (position * 1e9 / fmt.rate));
+        lock.unlock();
+        client->capture_buffer(data, frames, time, (double) position);
+        lock.lock();
+
+        position += frames;
+    }
+}
+
+void synthetic_backend::generate(size_t frames)
+{
+    auto *out = tone.get();
+    for (size_t f = 0; f < frames; f++) {
+        for (uint32_t c = 0; c < tone_channels; c++)
+            *(out++) = tone_level * (float) sin(phase * tone_hz[c]);
+        phase += 2 * M_PI / tone_rate;
+    }
+
+    // Both tones repeat every 1/220 s. Wrap there to keep precision.
+    phase = fmod(phase, 2 * M_PI / 220);
+}
+
+
+}  // namespace p1_mac_plugins
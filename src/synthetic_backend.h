@@ -0,0 +1,55 @@
+#ifndef p1_mac_plugins_synthetic_backend_h
+#define p1_mac_plugins_synthetic_backend_h
+
+#include "capture_backend.h"
+#include "capture_file.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace p1_mac_plugins {
+
+
+// Capture without hardware. Generates a stereo test tone, or loops the
+// buffers of a capture file in its recorded format, on a thread paced to
+// the sample rate. Useful for tests, benchmarks and builds without Core
+// Audio.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class synthetic_backend : public capture_backend {
+public:
+    // Tone format. Not the mixer rate, so resampling is exercised.
+    static const uint32_t tone_channels = 2;
+    static const uint32_t tone_rate = 48000;
+
+    synthetic_backend();
+    virtual ~synthetic_backend();
+
+    // Capture backend implementation.
+    virtual bool open(const capture_backend_config &config, capture_backend_client &client) final;
+    virtual bool start() final;
+    virtual void close() final;
+    virtual capture_backend_stats stats() const final;
+
+private:
+    capture_backend_client *client;
+    capture_file_reader reader;
+    size_t buffer_frames;
+    std::unique_ptr<float[]> tone;
+    double phase;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stopping;
+
+    void run();
+    void generate(size_t frames);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_synthetic_backend_h
@@ -0,0 +1,352 @@
+#include "tile_hash.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if P1_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+#if P1_HAVE_NEON
+#   include <arm_neon.h>
+#endif
+
+namespace p1_mac_plugins {
+
+static const size_t lanes = 8;
+
+
+// Fold both sums of all lanes into one well mixed value.
+static uint64_t finish(const uint32_t *a, const uint32_t *b)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t l = 0; l < lanes; l++) {
+        h = (h ^ a[l]) * 0x100000001b3ULL;
+        h = (h ^ b[l]) * 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Pad the tail of a row with zero pixels to a whole group of lanes.
+static inline void load_tail(uint32_t *pad, const uint32_t *row, size_t count)
+{
+    memset(pad, 0, lanes * sizeof(uint32_t));
+    memcpy(pad, row, count * sizeof(uint32_t));
+}
+
+// Scalar kernel, the reference.
+
+static uint64_t hash_scalar(const uint8_t *data, size_t stride,
+    size_t row_pixels, size_t rows)
+{
+    uint32_t a[lanes] = { 0 };
+    uint32_t b[lanes] = { 0 };
+    uint32_t pad[lanes];
+
+    for (size_t y = 0; y < rows; y++) {
+        auto *row = (const uint32_t *) (data + y * stride);
+        size_t x = 0;
+        for (; x + lanes <= row_pixels; x += lanes) {
+            for (size_t l = 0; l < lanes; l++) {
+                a[l] += row[x + l];
+                b[l] += a[l];
+            }
+        }
+        if (x < row_pixels) {
+            load_tail(pad, row + x, row_pixels - x);
+            for (size_t l = 0; l < lanes; l++) {
+                a[l] += pad[l];
+                b[l] += a[l];
+            }
+        }
+    }
+
+    return finish(a, b);
+}
+
+static const tile_hash_kernels scalar_kernels = {
+    "scalar",
+    hash_scalar
+};
+
+#if P1_HAVE_X86_SIMD
+
+// SSE2 kernel, two registers per group. SSE2 is baseline on x86_64.
+
+static uint64_t hash_sse2(const uint8_t *data, size_t stride,
+    size_t row_pixels, size_t rows)
+{
+    __m128i a0 = _mm_setzero_si128(), a1 = _mm_setzero_si128();
+    __m128i b0 = _mm_setzero_si128(), b1 = _mm_setzero_si128();
+    uint32_t pad[lanes];
+
+    for (size_t y = 0; y < rows; y++) {
+        auto *row = (const uint32_t *) (data + y * stride);
+        size_t x = 0;
+        for (; x + lanes <= row_pixels; x += lanes) {
+            a0 = _mm_add_epi32(a0, _mm_loadu_si128((const __m128i *) (row + x)));
+            a1 = _mm_add_epi32(a1, _mm_loadu_si128((const __m128i *) (row + x + 4)));
+            b0 = _mm_add_epi32(b0, a0);
+            b1 = _mm_add_epi32(b1, a1);
+        }
+        if (x < row_pixels) {
+            load_tail(pad, row + x, row_pixels - x);
+            a0 = _mm_add_epi32(a0, _mm_loadu_si128((const __m128i *) pad));
+            a1 = _mm_add_epi32(a1, _mm_loadu_si128((const __m128i *) (pad + 4)));
+            b0 = _mm_add_epi32(b0, a0);
+            b1 = _mm_add_epi32(b1, a1);
+        }
+    }
+
+    uint32_t a[lanes], b[lanes];
+    _mm_storeu_si128((__m128i *) a, a0);
+    _mm_storeu_si128((__m128i *) (a + 4), a1);
+    _mm_storeu_si128((__m128i *) b, b0);
+    _mm_storeu_si128((__m128i *) (b + 4), b1);
+    return finish(a, b);
+}
+
+static const tile_hash_kernels sse2_kernels = {
+    "sse2",
+    hash_sse2
+};
+
+// AVX2 kernel, one register per group.
+
+P1_TARGET_AVX2
+static uint64_t hash_avx2(const uint8_t *data, size_t stride,
+    size_t row_pixels, size_t rows)
+{
+    __m256i a = _mm256_setzero_si256();
+    __m256i b = _mm256_setzero_si256();
+    uint32_t pad[lanes];
+
+    for (size_t y = 0; y < rows; y++) {
+        auto *row = (const uint32_t *) (data + y * stride);
+        size_t x = 0;
+        for (; x + lanes <= row_pixels; x += lanes) {
+            a = _mm256_add_epi32(a, _mm256_loadu_si256((const __m256i *) (row + x)));
+            b = _mm256_add_epi32(b, a);
+        }
+        if (x < row_pixels) {
+            load_tail(pad, row + x, row_pixels - x);
+            a = _mm256_add_epi32(a, _mm256_loadu_si256((const __m256i *) pad));
+            b = _mm256_add_epi32(b, a);
+        }
+    }
+
+    uint32_t sa[lanes], sb[lanes];
+    _mm256_storeu_si256((__m256i *) sa, a);
+    _mm256_storeu_si256((__m256i *) sb, b);
+    return finish(sa, sb);
+}
+
+static const tile_hash_kernels avx2_kernels = {
+    "avx2",
+    hash_avx2
+};
+
+#endif  // P1_HAVE_X86_SIMD
+
+#if P1_HAVE_NEON
+
+// NEON kernel, two registers per group.
+
+static uint64_t hash_neon(const uint8_t *data, size_t stride,
+    size_t row_pixels, size_t rows)
+{
+    uint32x4_t a0 = vdupq_n_u32(0), a1 = vdupq_n_u32(0);
+    uint32x4_t b0 = vdupq_n_u32(0), b1 = vdupq_n_u32(0);
+    uint32_t pad[lanes];
+
+    for (size_t y = 0; y < rows; y++) {
+        auto *row = (const uint32_t *) (data + y * stride);
+        size_t x = 0;
+        for (; x + lanes <= row_pixels; x += lanes) {
+            a0 = vaddq_u32(a0, vld1q_u32(row + x));
+            a1 = vaddq_u32(a1, vld1q_u32(row + x + 4));
+            b0 = vaddq_u32(b0, a0);
+            b1 = vaddq_u32(b1, a1);
+        }
+        if (x < row_pixels) {
+            load_tail(pad, row + x, row_pixels - x);
+            a0 = vaddq_u32(a0, vld1q_u32(pad));
+            a1 = vaddq_u32(a1, vld1q_u32(pad + 4));
+            b0 = vaddq_u32(b0, a0);
+            b1 = vaddq_u32(b1, a1);
+        }
+    }
+
+    uint32_t a[lanes], b[lanes];
+    vst1q_u32(a, a0);
+    vst1q_u32(a + 4, a1);
+    vst1q_u32(b, b0);
+    vst1q_u32(b + 4, b1);
+    return finish(a, b);
+}
+
+static const tile_hash_kernels neon_kernels = {
+    "neon",
+    hash_neon
+};
+
+#endif  // P1_HAVE_NEON
+
+static const tile_hash_kernels &select_kernels()
+{
+    auto &cpu = get_cpu_features();
+#if P1_HAVE_X86_SIMD
+    if (cpu.avx2)
+        return avx2_kernels;
+    if (cpu.sse2)
+        return sse2_kernels;
+#endif
+#if P1_HAVE_NEON
+    if (cpu.neon)
+        return neon_kernels;
+#endif
+    (void) cpu;
+    return scalar_kernels;
+}
+
+const tile_hash_kernels &get_tile_hash_kernels()
+{
+    static const tile_hash_kernels &kernels = select_kernels();
+    return kernels;
+}
+
+const tile_hash_kernels &get_scalar_tile_hash_kernels()
+{
+    return scalar_kernels;
+}
+
+
+const int32_t tile_hasher::tile_size;
+
+tile_hasher::tile_hasher() :
+    kernels(get_tile_hash_kernels()),
+    width(0), height(0), num_x(0), num_y(0)
+{
+}
+
+void tile_hasher::configure(int32_t width_, int32_t height_)
+{
+    width = width_;
+    height = height_;
+    num_x = (width + tile_size - 1) / tile_size;
+    num_y = (height + tile_size - 1) / tile_size;
+
+    size_t count = (size_t) num_x * num_y;
+    hashes.assign(count, 0);
+    valid.assign(count, false);
+    dirty_tiles.assign(count, false);
+    bits.assign((count + 63) / 64, 0);
+}
+
+bool tile_hasher::update(const uint8_t *data, size_t stride, const rect_set &dirty)
+{
+    mark_dirty(dirty);
+    std::fill(bits.begin(), bits.end(), 0);
+
+    bool any = false;
+    for (int32_t ty = 0; ty < num_y; ty++) {
+        for (int32_t tx = 0; tx < num_x; tx++) {
+            size_t idx = (size_t) ty * num_x + tx;
+            if (!dirty_tiles[idx])
+                continue;
+
+            auto r = tile_rect(tx, ty);
+            auto hash = kernels.hash(data + r.y * stride + r.x * 4, stride,
+                r.width, r.height);
+            if (!valid[idx] || hashes[idx] != hash) {
+                bits[idx / 64] |= (uint64_t) 1 << (idx % 64);
+                any = true;
+            }
+            hashes[idx] = hash;
+            valid[idx] = true;
+        }
+    }
+
+    return any;
+}
+
+void tile_hasher::invalidate(const rect_set &dirty)
+{
+    mark_dirty(dirty);
+    for (size_t i = 0; i < dirty_tiles.size(); i++) {
+        if (dirty_tiles[i])
+            valid[i] = false;
+    }
+}
+
+void tile_hasher::invalidate_all()
+{
+    std::fill(valid.begin(), valid.end(), false);
+}
+
+bool tile_hasher::changed(int32_t tx, int32_t ty) const
+{
+    size_t idx = (size_t) ty * num_x + tx;
+    return (bits[idx / 64] >> (idx % 64)) & 1;
+}
+
+pixel_rect tile_hasher::tile_rect(int32_t tx, int32_t ty) const
+{
+    int32_t x = tx * tile_size;
+    int32_t y = ty * tile_size;
+    return pixel_rect {
+        x, y,
+        std::min(tile_size, width - x),
+        std::min(tile_size, height - y)
+    };
+}
+
+// Runs of changed tiles in a row are added as one rect, which keeps the
+// work of the set low.
+void tile_hasher::add_changed(rect_set &set) const
+{
+    for (int32_t ty = 0; ty < num_y; ty++) {
+        int32_t tx = 0;
+        while (tx < num_x) {
+            if (!changed(tx, ty)) {
+                tx++;
+                continue;
+            }
+
+            int32_t start = tx;
+            while (tx < num_x && changed(tx, ty))
+                tx++;
+
+            auto first = tile_rect(start, ty);
+            auto last = tile_rect(tx - 1, ty);
+            set.add(pixel_rect {
+                first.x, first.y, last.right() - first.x, first.height
+            });
+        }
+    }
+}
+
+void tile_hasher::mark_dirty(const rect_set &dirty)
+{
+    std::fill(dirty_tiles.begin(), dirty_tiles.end(), false);
+    for (auto &r : dirty) {
+        auto c = r.intersected(pixel_rect { 0, 0, width, height });
+        if (c.empty())
+            continue;
+
+        int32_t x0 = c.x / tile_size, x1 = (c.right() - 1) / tile_size;
+        int32_t y0 = c.y / tile_size, y1 = (c.bottom() - 1) / tile_size;
+        for (int32_t ty = y0; ty <= y1; ty++) {
+            for (int32_t tx = x0; tx <= x1; tx++)
+                dirty_tiles[(size_t) ty * num_x + tx] = true;
+        }
+    }
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,80 @@
+#ifndef p1_mac_plugins_tile_hash_h
+#define p1_mac_plugins_tile_hash_h
+
+#include "rect_set.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace p1_mac_plugins {
+
+
+// Hash `rows` rows of `row_pixels` 32-bit pixels, `stride` bytes apart.
+// Pixels are summed in 8 lanes, with a second sum over the first, so the
+// hash depends on position as well as value. Not for adversarial input.
+typedef uint64_t (*tile_hash_fn)(const uint8_t *data, size_t stride,
+    size_t row_pixels, size_t rows);
+
+// Kernels selected for the running CPU. All kernels give the same result.
+struct tile_hash_kernels {
+    const char *name;
+    tile_hash_fn hash;
+};
+
+const tile_hash_kernels &get_tile_hash_kernels();
+const tile_hash_kernels &get_scalar_tile_hash_kernels();
+
+// Finds which tiles of 32-bit pixel frames changed since the previous
+// frame, by hash. Only tiles within the changes the capture reports are
+// hashed, others are assumed unchanged. This turns reported changes of
+// content that was redrawn as it was into nothing.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class tile_hasher {
+public:
+    static const int32_t tile_size = 64;
+
+    tile_hasher();
+
+    // Set frame dimensions, and forget all hashes.
+    void configure(int32_t width, int32_t height);
+
+    // Hash tiles overlapping `dirty`, and compare with their previous
+    // hashes. Returns true if any tile changed.
+    bool update(const uint8_t *data, size_t stride, const rect_set &dirty);
+
+    // Forget hashes of tiles overlapping `dirty`, or all, for frames we did
+    // not hash. The next update reports those tiles changed.
+    void invalidate(const rect_set &dirty);
+    void invalidate_all();
+
+    // Results of the last update. Bits are row-major, one per tile.
+    int32_t tiles_x() const { return num_x; }
+    int32_t tiles_y() const { return num_y; }
+    bool changed(int32_t tx, int32_t ty) const;
+    const std::vector<uint64_t> &changed_bits() const { return bits; }
+    pixel_rect tile_rect(int32_t tx, int32_t ty) const;
+
+    // Add rects of changed tiles to a set.
+    void add_changed(rect_set &set) const;
+
+private:
+    const tile_hash_kernels &kernels;
+
+    int32_t width;
+    int32_t height;
+    int32_t num_x;
+    int32_t num_y;
+    std::vector<uint64_t> hashes;
+    std::vector<bool> valid;
+    std::vector<bool> dirty_tiles;
+    std::vector<uint64_t> bits;
+
+    void mark_dirty(const rect_set &dirty);
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_tile_hash_h
@@ -0,0 +1,135 @@
+#ifndef p1_mac_plugins_timed_frame_queue_h
+#define p1_mac_plugins_timed_frame_queue_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace p1_mac_plugins {
+
+
+// Bounded queue of timestamped frames, from which a renderer picks the frame
+// matching its own time. Single threaded; feed it from a wait-free ring.
+//
+// Frames are pushed in time order. Selection takes the newest frame at or
+// before the target time, or the oldest frame if all are newer. Frames
+// older than the selection can never be selected again, so they are evicted.
+// The selection itself stays, so it can be selected again. When full, a
+// push evicts the oldest frame.
+//
+// Evicted frames are passed to the owner together with the frame that
+// follows them, or nullptr, so the owner can release resources and carry
+// state such as changed regions forward.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+template<typename T>
+class timed_frame_queue {
+public:
+    static const size_t max_capacity = 16;
+
+    struct entry {
+        uint64_t time;
+        T frame;
+    };
+
+    timed_frame_queue() : cap(1), head(0), count(0) {}
+
+    // Only while empty.
+    void configure(size_t capacity);
+
+    size_t size() const { return count; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return count == 0; }
+
+    entry &at(size_t idx) { return entries[(head + idx) % cap]; }
+    entry &oldest() { return at(0); }
+    entry &newest() { return at(count - 1); }
+
+    template<typename Evict>
+    void push(uint64_t time, const T &frame, Evict evict);
+
+    // Returns the selected entry, or nullptr if empty.
+    template<typename Evict>
+    entry *select(uint64_t target, Evict evict);
+
+    template<typename Evict>
+    void clear(Evict evict);
+
+private:
+    entry entries[max_capacity];
+    size_t cap;
+    size_t head;
+    size_t count;
+
+    template<typename Evict>
+    void pop_oldest(Evict &evict);
+};
+
+
+template<typename T>
+void timed_frame_queue<T>::configure(size_t capacity)
+{
+    cap = capacity < 1 ? 1 : capacity > max_capacity ? max_capacity : capacity;
+    head = 0;
+    count = 0;
+}
+
+template<typename T>
+template<typename Evict>
+void timed_frame_queue<T>::push(uint64_t time, const T &frame, Evict evict)
+{
+    if (count == cap)
+        pop_oldest(evict);
+
+    auto &e = entries[(head + count) % cap];
+    e.time = time;
+    e.frame = frame;
+    count++;
+
+    // Frames are in time order. One from the past would never be selected,
+    // so retime it to keep the order.
+    if (count > 1 && at(count - 2).time > time)
+        e.time = at(count - 2).time;
+}
+
+template<typename T>
+template<typename Evict>
+typename timed_frame_queue<T>::entry *timed_frame_queue<T>::select(uint64_t target, Evict evict)
+{
+    if (count == 0)
+        return nullptr;
+
+    // Count frames at or before the target. All but the newest of those go.
+    size_t due = 0;
+    while (due < count && at(due).time <= target)
+        due++;
+    while (due > 1) {
+        pop_oldest(evict);
+        due--;
+    }
+
+    return &at(0);
+}
+
+template<typename T>
+template<typename Evict>
+void timed_frame_queue<T>::clear(Evict evict)
+{
+    while (count != 0)
+        pop_oldest(evict);
+    head = 0;
+}
+
+template<typename T>
+template<typename Evict>
+void timed_frame_queue<T>::pop_oldest(Evict &evict)
+{
+    auto &e = entries[head];
+    head = (head + 1) % cap;
+    count--;
+    evict(e.frame, count != 0 ? &at(0).frame : nullptr);
+}
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_timed_frame_queue_h
@@ -0,0 +1,83 @@
+#ifndef p1_mac_plugins_triple_buffer_h
+#define p1_mac_plugins_triple_buffer_h
+
+#include <atomic>
+#include <cstddef>
+
+namespace p1_mac_plugins {
+
+
+// Wait-free handoff of the latest value from one writer to one reader. The
+// writer fills the back slot and publishes it, the reader takes the latest
+// published slot as its front. Each side owns its slot exclusively, so slots
+// can hold anything, and neither side ever waits for the other.
+//
+// Publishing swaps the back slot with the middle slot, taking back either a
+// value the reader never saw, or one the reader has let go of. `publish`
+// tells which, so the writer can account for skipped values.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+template<typename T>
+class triple_buffer {
+public:
+    triple_buffer();
+
+    // Writer side.
+    T &back() { return slots[back_idx]; }
+    // Returns true if the previously published slot was never read. `back`
+    // then refers to that slot.
+    bool publish();
+
+    // Reader side.
+    T &front() { return slots[front_idx]; }
+    // Take the latest published slot, if there is a new one.
+    bool update();
+
+    // Direct access, only while neither side is active.
+    T &slot(size_t idx) { return slots[idx]; }
+    static const size_t num_slots = 3;
+
+private:
+    static const unsigned index_mask = 3;
+    static const unsigned fresh_bit = 4;
+
+    T slots[num_slots];
+
+    // Index of the middle slot, with `fresh_bit` set if not yet read. The
+    // other indices are private to each side. Keep them on separate cache
+    // lines.
+    alignas(64) std::atomic<unsigned> middle;
+    alignas(64) unsigned back_idx;
+    alignas(64) unsigned front_idx;
+};
+
+
+template<typename T>
+triple_buffer<T>::triple_buffer() :
+    middle(1), back_idx(2), front_idx(0)
+{
+}
+
+template<typename T>
+bool triple_buffer<T>::publish()
+{
+    auto prev = middle.exchange(back_idx | fresh_bit, std::memory_order_acq_rel);
+    back_idx = prev & index_mask;
+    return (prev & fresh_bit) != 0;
+}
+
+template<typename T>
+bool triple_buffer<T>::update()
+{
+    if (!(middle.load(std::memory_order_relaxed) & fresh_bit))
+        return false;
+
+    auto prev = middle.exchange(front_idx, std::memory_order_acq_rel);
+    front_idx = prev & index_mask;
+    return true;
+}
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_triple_buffer_h
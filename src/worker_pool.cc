@@ -0,0 +1,96 @@
+#include "worker_pool.h"
+
+namespace p1_mac_plugins {
+
+
+worker_pool::worker_pool(size_t num_threads) :
+    job(nullptr), count(0), next(0), busy(0), generation(0), stopping(false)
+{
+    for (size_t i = 0; i < num_threads; i++)
+        threads.emplace_back([this] { thread_main(); });
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cond.notify_all();
+
+    for (auto &thread : threads)
+        thread.join();
+}
+
+void worker_pool::run(size_t count_, const std::function<void(size_t)> &fn)
+{
+    if (count_ == 0)
+        return;
+
+    // Not worth waking threads for.
+    if (count_ == 1 || threads.empty()) {
+        for (size_t i = 0; i < count_; i++)
+            fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        count = count_;
+        next.store(0);
+        busy = threads.size();
+        generation++;
+    }
+    work_cond.notify_all();
+
+    work();
+
+    // Threads may still run their last job.
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cond.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+worker_pool &worker_pool::shared()
+{
+    // Thread-safe static init.
+    static worker_pool pool([] {
+        auto cores = std::thread::hardware_concurrency();
+        return cores > 1 ? (size_t) cores - 1 : 0;
+    }());
+    return pool;
+}
+
+void worker_pool::thread_main()
+{
+    uint64_t seen = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_cond.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+            return;
+        seen = generation;
+
+        lock.unlock();
+        work();
+        lock.lock();
+
+        if (--busy == 0)
+            done_cond.notify_one();
+    }
+}
+
+// Claim and run jobs until none are left.
+void worker_pool::work()
+{
+    size_t i;
+    while ((i = next.fetch_add(1)) < count)
+        (*job)(i);
+}
+
+
+}  // namespace p1_mac_plugins
@@ -0,0 +1,59 @@
+#ifndef p1_mac_plugins_worker_pool_h
+#define p1_mac_plugins_worker_pool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace p1_mac_plugins {
+
+
+// Threads that split a batch of independent jobs, such as row bands or
+// tiles of a frame, with the calling thread. One batch runs at a time.
+// Nothing allocates per batch.
+//
+// This file is deliberately free of platform and p1stream dependencies.
+class worker_pool {
+public:
+    // Threads besides the caller. Zero runs everything on the caller.
+    explicit worker_pool(size_t num_threads);
+    ~worker_pool();
+
+    // Threads a batch is spread over, including the caller.
+    size_t concurrency() const { return threads.size() + 1; }
+
+    // Run `fn(i)` for every `i` below `count`, and return once all are
+    // done.
+    void run(size_t count, const std::function<void(size_t)> &fn);
+
+    // A pool with a thread per core, besides the caller.
+    static worker_pool &shared();
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable work_cond;
+    std::condition_variable done_cond;
+    std::mutex run_mutex;
+
+    // Current batch, under `mutex`. Jobs are claimed through `next`.
+    const std::function<void(size_t)> *job;
+    size_t count;
+    std::atomic<size_t> next;
+    size_t busy;
+    uint64_t generation;
+    bool stopping;
+
+    void thread_main();
+    void work();
+};
+
+
+}  // namespace p1_mac_plugins
+
+#endif  // p1_mac_plugins_worker_pool_h
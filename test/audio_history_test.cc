@@ -0,0 +1,167 @@
+#include "audio_history.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// One channel at 1000 Hz, so frame n is at n ms, and holds the value n,
+// wrapped to stay exact in a float.
+static const double rate = 1000;
+static const uint64_t ms = 1000000;
+static const uint64_t wrap = 1 << 20;
+
+static void write_ramp(audio_history &h, uint64_t &next, size_t frames)
+{
+    std::vector<float> buf(frames);
+    for (size_t i = 0; i < frames; i++)
+        buf[i] = (float) ((next + i) % wrap);
+    h.write(next * ms, buf.data(), frames);
+    next += frames;
+}
+
+static float value(const history_snapshot &snap, size_t i)
+{
+    float v;
+    memcpy(&v, &snap.data[i * sizeof(float)], sizeof(float));
+    return v;
+}
+
+static bool is_ramp(const history_snapshot &snap)
+{
+    auto first = snap.time_ns / ms;
+    if (snap.time_ns % ms != 0)
+        return false;
+    for (size_t i = 0; i < snap.frames; i++)
+        if (value(snap, i) != (float) ((first + i) % wrap))
+            return false;
+    return true;
+}
+
+static void test_empty()
+{
+    audio_history h;
+    history_snapshot snap;
+    CHECK(!h.snapshot(0, 0, snap));
+
+    h.configure(1, rate, 4, sample_format_float32);
+    CHECK(!h.snapshot(0, 0, snap));
+}
+
+// After writing more than the capacity in odd chunks, the history holds
+// the newest audio in order, minus the partly overwritten oldest blocks.
+static void test_wraparound()
+{
+    audio_history h;
+    h.configure(1, rate, 4, sample_format_float32);
+    CHECK(h.capacity_frames() == 4 * audio_history::block_frames);
+
+    uint64_t next = 0;
+    while (next < 10000)
+        write_ramp(h, next, std::min((size_t) 300, (size_t) (10000 - next)));
+
+    // Oldest kept is 10000 - 4096 = 5904. Rounded up to the block at 6144,
+    // which is skipped too.
+    history_snapshot snap;
+    CHECK(h.snapshot(0, 0, snap));
+    CHECK(snap.frames == 10000 - 7168);
+    CHECK(value(snap, 0) == 7168);
+    CHECK(is_ramp(snap));
+
+    // A single write larger than the capacity keeps its end.
+    write_ramp(h, next, 5000);
+    CHECK(h.snapshot(0, 0, snap));
+    CHECK(value(snap, snap.frames - 1) == 14999);
+    CHECK(is_ramp(snap));
+}
+
+// Ranges are found by host time, and clamped to what is available.
+static void test_time_range()
+{
+    audio_history h;
+    h.configure(1, rate, 4, sample_format_float32);
+    uint64_t next = 0;
+    while (next < 10240)
+        write_ramp(h, next, 256);
+
+    history_snapshot snap;
+    CHECK(h.snapshot(8000 * ms, 9000 * ms, snap));
+    CHECK(snap.frames == 1000);
+    CHECK(value(snap, 0) == 8000);
+    CHECK(is_ramp(snap));
+
+    CHECK(h.snapshot(9500 * ms, 0, snap));
+    CHECK(snap.frames == 740 && value(snap, 0) == 9500);
+
+    // Partly before the oldest available, at 10240 - 4096 + 1024.
+    CHECK(h.snapshot(1000 * ms, 7500 * ms, snap));
+    CHECK(value(snap, 0) == 7168 && snap.frames == 7500 - 7168);
+
+    // Entirely outside.
+    CHECK(!h.snapshot(1000 * ms, 2000 * ms, snap));
+    CHECK(!h.snapshot(9000 * ms, 8000 * ms, snap));
+}
+
+static void test_int16()
+{
+    audio_history h;
+    h.configure(2, 48000, 1, sample_format_int16);
+    const float in[] = { 0.5f, -0.5f, 1.5f, -1.5f };
+    h.write(1000, in, 2);
+
+    history_snapshot snap;
+    CHECK(h.snapshot(0, 0, snap));
+    CHECK(snap.frames == 2 && snap.time_ns == 1000);
+    int16_t out[4];
+    memcpy(out, snap.data.data(), sizeof(out));
+    CHECK(out[0] == 16384 && out[1] == -16384);
+    CHECK(out[2] == 32767 && out[3] == -32768);
+}
+
+// A writer races through the history while snapshots are taken. Any frame
+// it overwrote during a copy must be dropped, so every snapshot is an
+// unbroken ramp that matches its time. The history is large, so copies take
+// long enough to be overtaken, even on one core.
+static void test_concurrent_overwrite()
+{
+    audio_history h;
+    h.configure(1, rate, 4000, sample_format_float32);
+    const size_t total = 200;
+    std::atomic<size_t> snapshots(0);
+
+    std::thread writer([&] {
+        uint64_t next = 0;
+        size_t size = 1;
+        while (snapshots < total) {
+            write_ramp(h, next, size);
+            size = size % 509 + 1;
+        }
+    });
+
+    size_t broken = 0;
+    history_snapshot snap;
+    while (snapshots < total) {
+        if (!h.snapshot(0, 0, snap))
+            continue;
+        snapshots++;
+        if (!is_ramp(snap))
+            broken++;
+        std::this_thread::yield();
+    }
+    writer.join();
+
+    CHECK(broken == 0);
+}
+
+int main()
+{
+    test_empty();
+    test_wraparound();
+    test_time_range();
+    test_int16();
+    test_concurrent_overwrite();
+    return check_exit();
+}
@@ -0,0 +1,19 @@
+#ifndef p1_mac_plugins_test_bench_h
+#define p1_mac_plugins_test_bench_h
+
+#include <chrono>
+#include <cstdio>
+
+// Average milliseconds per call of `fn`, after one warm-up call.
+template<typename F>
+static double bench_ms(int iterations, F fn)
+{
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+#endif  // p1_mac_plugins_test_bench_h
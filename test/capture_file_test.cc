@@ -0,0 +1,151 @@
+#include "capture_file.h"
+#include "sample_convert.h"
+#include "check.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static const char *path = "capture_file_test.p1ac";
+
+static capture_file_header make_header()
+{
+    capture_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.format = sample_format_int16;
+    hdr.channels = 2;
+    hdr.interleaved = 1;
+    hdr.sample_rate = 48000;
+    return hdr;
+}
+
+// Records of varying, odd sizes come back with their times, frame counts
+// and bytes, in order, and the header keeps the format.
+static void test_round_trip()
+{
+    capture_file_writer writer;
+    CHECK(writer.open(path, make_header()));
+
+    std::vector<char> data;
+    uint64_t size_sum = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        uint32_t frames = 1 + i % 97;
+        data.resize(frames * 4);
+        for (size_t b = 0; b < data.size(); b++)
+            data[b] = (char) (i + b);
+        CHECK(writer.append(1000000 + i * 7919ull, frames, data.data(), (uint32_t) data.size()));
+        size_sum += data.size();
+    }
+    CHECK(writer.data_size() >= size_sum);
+    writer.close();
+
+    capture_file_reader reader;
+    CHECK(reader.open(path));
+    auto &hdr = reader.header();
+    CHECK(hdr.version == capture_file_header::current_version);
+    CHECK(hdr.format == sample_format_int16 && hdr.channels == 2);
+    CHECK(hdr.interleaved == 1 && hdr.sample_rate == 48000);
+
+    // Twice, to cover rewinding.
+    for (int pass = 0; pass < 2; pass++) {
+        capture_record_header rec;
+        const void *ptr;
+        uint32_t i = 0;
+        bool same = true;
+        while (reader.next(rec, ptr)) {
+            uint32_t frames = 1 + i % 97;
+            same = same && rec.time_ns == 1000000 + i * 7919ull &&
+                rec.frames == frames && rec.size == frames * 4;
+            for (size_t b = 0; same && b < rec.size; b++)
+                same = ((const char *) ptr)[b] == (char) (i + b);
+            i++;
+        }
+        CHECK(same);
+        CHECK(i == 1000);
+        reader.rewind();
+    }
+}
+
+// A file cut off in the middle of a record, as after a crash, reads up to
+// the last complete record.
+static void test_truncated()
+{
+    capture_file_writer writer;
+    CHECK(writer.open(path, make_header()));
+    char data[64] = { 0 };
+    for (int i = 0; i < 3; i++)
+        CHECK(writer.append(i, 16, data, sizeof(data)));
+    auto full = sizeof(capture_file_header) + writer.data_size();
+    writer.close();
+    CHECK(truncate(path, (off_t) (full - 10)) == 0);
+
+    capture_file_reader reader;
+    CHECK(reader.open(path));
+    capture_record_header rec;
+    const void *ptr;
+    int count = 0;
+    while (reader.next(rec, ptr))
+        count++;
+    CHECK(count == 2);
+}
+
+static void test_invalid()
+{
+    capture_file_reader reader;
+    CHECK(!reader.open("capture_file_test.missing") && errno == ENOENT);
+
+    auto *file = fopen(path, "wb");
+    char junk[256];
+    memset(junk, 'x', sizeof(junk));
+    fwrite(junk, 1, sizeof(junk), file);
+    fclose(file);
+    CHECK(!reader.open(path) && errno == EINVAL);
+}
+
+// The recorder queues buffers without blocking, drops what doesn't fit,
+// and flushes the rest to a file in order.
+static void test_recorder()
+{
+    capture_recorder recorder(1024, 8);
+    char data[300];
+    for (int i = 0; i < 5; i++) {
+        memset(data, i, sizeof(data));
+        bool fits = i < 3;
+        CHECK(recorder.push(i * 100, 75, data, sizeof(data)) == fits);
+    }
+    CHECK(recorder.take_drops() == 2);
+    CHECK(recorder.take_drops() == 0);
+
+    capture_file_writer writer;
+    CHECK(writer.open(path, make_header()));
+    CHECK(recorder.flush(writer) == 3);
+    CHECK(recorder.flush(writer) == 0);
+    writer.close();
+
+    capture_file_reader reader;
+    CHECK(reader.open(path));
+    capture_record_header rec;
+    const void *ptr;
+    int i = 0;
+    while (reader.next(rec, ptr)) {
+        CHECK(rec.time_ns == (uint64_t) i * 100 && rec.frames == 75 && rec.size == 300);
+        CHECK(((const char *) ptr)[299] == i);
+        i++;
+    }
+    CHECK(i == 3);
+}
+
+int main()
+{
+    test_round_trip();
+    test_truncated();
+    test_invalid();
+    test_recorder();
+    unlink(path);
+    return check_exit();
+}
@@ -0,0 +1,94 @@
+#include "capture_replay.h"
+#include "host_time.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static const char *path = "capture_replay_bench.p1ac";
+
+static const uint32_t rate = 48000;
+static const uint32_t buffer_frames = 480;
+
+// Stereo int16 tones in 10 ms buffers.
+static void record(int seconds)
+{
+    capture_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.format = sample_format_int16;
+    hdr.channels = 2;
+    hdr.interleaved = 1;
+    hdr.sample_rate = rate;
+
+    capture_file_writer writer;
+    writer.open(path, hdr);
+
+    std::vector<int16_t> data(buffer_frames * 2);
+    uint64_t n = 0;
+    for (uint32_t b = 0; b < seconds * rate / buffer_frames; b++) {
+        for (uint32_t f = 0; f < buffer_frames; f++, n++) {
+            data[f * 2] = (int16_t) (3000 * sin(n * 0.0576));
+            data[f * 2 + 1] = (int16_t) (3000 * sin(n * 0.0864));
+        }
+        writer.append(b * 10000000ull, buffer_frames, data.data(),
+            (uint32_t) (data.size() * sizeof(int16_t)));
+    }
+}
+
+// Replay as fast as possible, as a CI benchmark would, then in realtime to
+// measure how late buffers are delivered after they are complete.
+int main()
+{
+    const int seconds = 10;
+    record(seconds);
+
+    struct config {
+        const char *name;
+        double mixer_rate;
+        bool drift;
+    } configs[] = {
+        { "48000 to 48000", 48000, false },
+        { "48000 to 44100", 44100, false },
+        { "48000 to 44100, drift", 44100, true },
+    };
+    for (auto &c : configs) {
+        capture_replay replay;
+        replay.open(path, c.mixer_rate, c.drift);
+        double sum = 0;
+        double ms = bench_ms(10, [&]() {
+            replay.run([&](uint64_t, const float *in, size_t) { sum += in[0]; });
+        });
+        printf("%-22s: %7.2f ms per %d s, %6.0fx realtime\n",
+            c.name, ms, seconds, seconds * 1000 / ms);
+    }
+
+    capture_replay replay;
+    replay.open(path, rate, false);
+    std::mutex mutex;
+    std::vector<int64_t> late;
+    late.reserve(1000);
+    replay.start(true, true, [&](uint64_t time, const float *, size_t samples) {
+        auto now = host_time_to_ns(host_time_now());
+        auto due = host_time_to_ns(time) + samples / 2 * 1000000000ull / rate;
+        std::lock_guard<std::mutex> lock(mutex);
+        late.push_back((int64_t) (now - due));
+    }, nullptr);
+    sleep(2);
+    replay.stop();
+
+    std::sort(late.begin(), late.end());
+    if (!late.empty()) {
+        printf("realtime pacing, %zu buffers: late by median %lld us, p99 %lld us, max %lld us\n",
+            late.size(), (long long) late[late.size() / 2] / 1000,
+            (long long) late[late.size() * 99 / 100] / 1000, (long long) late.back() / 1000);
+    }
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "capture_replay.h"
+#include "host_time.h"
+#include "check.h"
+
+#include <cstring>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static const char *path = "capture_replay_test.p1ac";
+
+static const uint32_t rate = 48000;
+static const uint32_t buffer_frames = 480;
+static const int num_buffers = 20;
+
+// Record planar int16 stereo, as a device might deliver it, with a known
+// ramp per channel. Record times start at an arbitrary host time, with a
+// little jitter, like a live capture.
+static void record(uint64_t first_ns)
+{
+    capture_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.format = sample_format_int16;
+    hdr.channels = 2;
+    hdr.interleaved = 0;
+    hdr.sample_rate = rate;
+
+    capture_file_writer writer;
+    CHECK(writer.open(path, hdr));
+
+    std::vector<int16_t> data(buffer_frames * 2);
+    for (int b = 0; b < num_buffers; b++) {
+        for (uint32_t f = 0; f < buffer_frames; f++) {
+            int32_t n = b * buffer_frames + f;
+            data[f] = (int16_t) n;
+            data[buffer_frames + f] = (int16_t) -n;
+        }
+        uint64_t time_ns = first_ns + b * 10000000ull + (b % 3) * 1000;
+        CHECK(writer.append(time_ns, buffer_frames, data.data(),
+            (uint32_t) (data.size() * sizeof(int16_t))));
+    }
+}
+
+struct delivery {
+    uint64_t time_ns;
+    uint64_t arrival_ns;
+    size_t samples;
+    float first_left;
+    float first_right;
+};
+
+// Fast replay at the recorded rate converts and interleaves every sample
+// exactly, and rebases times to the start while keeping their spacing.
+static void test_round_trip()
+{
+    record(5000000000ull);
+
+    capture_replay replay;
+    CHECK(replay.open(path, rate, false));
+    CHECK(replay.header().format == sample_format_int16);
+    CHECK(replay.channels() == 2);
+
+    std::vector<uint64_t> times;
+    bool exact = true;
+    int32_t n = 0;
+    auto before = host_time_to_ns(host_time_now());
+    auto count = replay.run([&](uint64_t time, const float *in, size_t samples) {
+        times.push_back(host_time_to_ns(time));
+        for (size_t i = 0; i < samples; i += 2, n++) {
+            exact = exact && in[i] == (int16_t) n / 32768.0f;
+            exact = exact && in[i + 1] == (int16_t) -n / 32768.0f;
+        }
+    });
+    CHECK(count == (size_t) num_buffers);
+    CHECK(exact);
+    CHECK(n == num_buffers * (int32_t) buffer_frames);
+
+    CHECK(times.size() == (size_t) num_buffers);
+    CHECK(times[0] >= before);
+    for (int b = 0; b < num_buffers && b < (int) times.size(); b++)
+        CHECK(times[b] - times[0] == b * 10000000ull + (b % 3) * 1000);
+}
+
+// Realtime looping delivers every buffer no earlier than it was complete,
+// and each pass continues where the previous one ended.
+static void test_loop()
+{
+    record(1000);
+
+    capture_replay replay;
+    CHECK(replay.open(path, rate, false));
+
+    std::mutex mutex;
+    std::vector<delivery> got;
+    bool ended = false;
+    replay.start(true, true, [&](uint64_t time, const float *in, size_t samples) {
+        delivery d = { host_time_to_ns(time), host_time_to_ns(host_time_now()),
+            samples, in[0], in[1] };
+        std::lock_guard<std::mutex> lock(mutex);
+        got.push_back(d);
+    }, [&] { ended = true; });
+
+    // Two and a half passes of 200 ms.
+    usleep(500000);
+    replay.stop();
+    CHECK(!ended);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(got.size() > (size_t) num_buffers);
+    // A pass ends when the last buffer does.
+    const uint64_t pass_ns = (num_buffers - 1) * 10000000ull +
+        ((num_buffers - 1) % 3) * 1000 + 10000000;
+    for (size_t i = 0; i < got.size(); i++) {
+        auto &d = got[i];
+        auto b = (int) (i % num_buffers);
+        auto pass = i / num_buffers;
+        CHECK(d.samples == buffer_frames * 2);
+        CHECK(d.first_left == (int16_t) (b * buffer_frames) / 32768.0f);
+        CHECK(d.time_ns - got[0].time_ns ==
+            pass * pass_ns + b * 10000000ull + (b % 3) * 1000);
+        CHECK(d.arrival_ns >= d.time_ns + 10000000);
+    }
+}
+
+// Without looping, the end callback runs once the file is done.
+static void test_end()
+{
+    record(0);
+
+    capture_replay replay;
+    CHECK(replay.open(path, rate, false));
+
+    std::mutex mutex;
+    size_t count = 0;
+    bool ended = false;
+    replay.start(false, false, [&](uint64_t, const float *, size_t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        count++;
+    }, [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        ended = true;
+    });
+
+    for (int i = 0; i < 1000; i++) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ended)
+                break;
+        }
+        usleep(1000);
+    }
+    replay.stop();
+    CHECK(ended);
+    CHECK(count == (size_t) num_buffers);
+}
+
+int main()
+{
+    test_round_trip();
+    test_loop();
+    test_end();
+    unlink(path);
+    return check_exit();
+}
@@ -0,0 +1,37 @@
+#include "channel_matrix.h"
+#include "bench.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// Mixing a multichannel interface down to stereo, in nanoseconds per frame.
+int main()
+{
+    const uint32_t in_counts[] = { 2, 6, 16, 64 };
+    const size_t frames = 512;
+
+    for (uint32_t in_ch : in_counts) {
+        std::vector<float> in(in_ch * frames), out(2 * frames);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = sinf(i * 0.37f);
+
+        std::vector<float> gains(2 * in_ch);
+        for (size_t i = 0; i < gains.size(); i++)
+            gains[i] = 0.1f * (i % 7);
+        channel_matrix mix;
+        mix.configure(in_ch, 2, gains.data());
+
+        int32_t map[2] = { 0, (int32_t) in_ch - 1 };
+        channel_matrix pick;
+        pick.configure_map(in_ch, 2, map);
+
+        double a = bench_ms(20000, [&]() { mix.process(in.data(), out.data(), frames); });
+        double b = bench_ms(20000, [&]() { pick.process(in.data(), out.data(), frames); });
+        printf("%2u -> 2: mix %6.2f ns per frame, select %6.2f ns per frame\n",
+            in_ch, a * 1e6 / frames, b * 1e6 / frames);
+    }
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "channel_matrix.h"
+#include "check.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// Odd frame counts exercise the scalar tails of the kernels.
+static const size_t frames = 1027;
+
+static std::vector<float> make_input(uint32_t channels)
+{
+    std::vector<float> in(channels * frames);
+    for (size_t i = 0; i < in.size(); i++)
+        in[i] = sinf(i * 0.37f);
+    return in;
+}
+
+// Gain matrices match a double precision reference, at channel counts that
+// are and aren't multiples of the vector width.
+static void test_mix()
+{
+    const uint32_t in_counts[] = { 1, 2, 3, 5, 6, 8, 9, 16, 24 };
+    const uint32_t out_counts[] = { 1, 2, 6 };
+
+    for (uint32_t in_ch : in_counts) {
+        for (uint32_t out_ch : out_counts) {
+            auto in = make_input(in_ch);
+            std::vector<float> gains(in_ch * out_ch);
+            for (size_t i = 0; i < gains.size(); i++)
+                gains[i] = 0.1f * (i % 7) - 0.2f;
+
+            channel_matrix m;
+            m.configure(in_ch, out_ch, gains.data());
+            CHECK(!m.is_identity());
+
+            std::vector<float> out(out_ch * frames + 1, 42.0f);
+            m.process(in.data(), out.data(), frames);
+
+            double max_err = 0;
+            for (size_t f = 0; f < frames; f++) {
+                for (uint32_t o = 0; o < out_ch; o++) {
+                    double ref = 0;
+                    for (uint32_t i = 0; i < in_ch; i++)
+                        ref += (double) in[f * in_ch + i] * gains[o * in_ch + i];
+                    max_err = std::max(max_err, fabs(ref - out[f * out_ch + o]));
+                }
+            }
+            CHECK(max_err < 1e-5);
+            CHECK(out[out_ch * frames] == 42.0f);
+        }
+    }
+}
+
+// Maps, and gain matrices of only zeros and ones, copy samples exactly.
+static void test_select()
+{
+    const uint32_t in_ch = 16;
+    auto in = make_input(in_ch);
+    std::vector<float> out(2 * frames);
+
+    int32_t map[2] = { 5, -1 };
+    channel_matrix m;
+    m.configure_map(in_ch, 2, map);
+    CHECK(!m.is_identity());
+    m.process(in.data(), out.data(), frames);
+    for (size_t f = 0; f < frames; f++) {
+        CHECK(out[f * 2] == in[f * in_ch + 5]);
+        CHECK(out[f * 2 + 1] == 0);
+    }
+
+    std::vector<float> pick(2 * in_ch, 0.0f);
+    pick[3] = 1;
+    pick[in_ch + 7] = 1;
+    channel_matrix p;
+    p.configure(in_ch, 2, pick.data());
+    p.process(in.data(), out.data(), frames);
+    for (size_t f = 0; f < frames; f++) {
+        CHECK(out[f * 2] == in[f * in_ch + 3]);
+        CHECK(out[f * 2 + 1] == in[f * in_ch + 7]);
+    }
+
+    // Equal to the same selection as a map.
+    int32_t pick_map[2] = { 3, 7 };
+    m.configure_map(in_ch, 2, pick_map);
+    CHECK(m.equals(p));
+    CHECK(!m.equals(channel_matrix()));
+}
+
+static void test_default()
+{
+    channel_matrix m;
+    m.configure_default(2, 2);
+    CHECK(m.is_identity());
+
+    // Mono goes to both outputs.
+    std::vector<float> mono(frames, 0.5f), out(2 * frames);
+    m.configure_default(1, 2);
+    CHECK(!m.is_identity());
+    m.process(mono.data(), out.data(), frames);
+    for (float s : out)
+        CHECK(s == 0.5f);
+
+    // Extra inputs are dropped, missing ones silent.
+    auto in = make_input(4);
+    m.configure_default(4, 2);
+    m.process(in.data(), out.data(), frames);
+    for (size_t f = 0; f < frames; f++) {
+        CHECK(out[f * 2] == in[f * 4]);
+        CHECK(out[f * 2 + 1] == in[f * 4 + 1]);
+    }
+}
+
+int main()
+{
+    test_mix();
+    test_select();
+    test_default();
+    return check_exit();
+}
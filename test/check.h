@@ -0,0 +1,25 @@
+#ifndef p1_mac_plugins_test_check_h
+#define p1_mac_plugins_test_check_h
+
+#include <cstdio>
+
+// Minimal assertions. Failures are printed and counted, and `check_exit`
+// turns them into the exit status CTest looks at.
+
+static int check_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        check_failures++; \
+    } \
+} while (0)
+
+static inline int check_exit()
+{
+    if (check_failures != 0)
+        fprintf(stderr, "%d checks failed\n", check_failures);
+    return check_failures != 0;
+}
+
+#endif  // p1_mac_plugins_test_check_h
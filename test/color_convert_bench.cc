@@ -0,0 +1,69 @@
+#include "color_convert.h"
+#include "bench.h"
+
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+struct image {
+    std::vector<uint8_t> planes[3];
+    image_desc desc;
+
+    image(image_format format, int32_t width, int32_t height)
+    {
+        desc.format = format;
+        desc.width = width;
+        desc.height = height;
+        int32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+        size_t bytes = format == image_format_p010 ? 2 : 1;
+        if (format == image_format_bgra) {
+            alloc(0, width * 4, height);
+        }
+        else {
+            alloc(0, width * bytes, height);
+            alloc(1, cw * 2 * bytes, ch);
+        }
+    }
+
+    void alloc(int i, size_t stride, int32_t rows)
+    {
+        planes[i].assign(stride * rows, 0);
+        desc.planes[i].data = planes[i].data();
+        desc.planes[i].stride = stride;
+    }
+};
+
+// Converting frames at common display sizes, with the reference and the
+// selected kernels on one thread, and on the shared pool.
+int main()
+{
+    const int32_t sizes[][2] = { { 1920, 1080 }, { 3840, 2160 }, { 5120, 2880 } };
+    const char *names[] = { "scalar", get_color_kernels().name, "pool" };
+    std::mt19937 rng(1);
+
+    printf("shared pool: %zu threads\n", worker_pool::shared().concurrency());
+    for (auto &size : sizes) {
+        image bgra(image_format_bgra, size[0], size[1]);
+        image nv12(image_format_nv12, size[0], size[1]);
+        image p010(image_format_p010, size[0], size[1]);
+        image back(image_format_bgra, size[0], size[1]);
+        for (auto &b : bgra.planes[0])
+            b = (uint8_t) rng();
+
+        for (int variant = 0; variant < 3; variant++) {
+            color_converter conv;
+            conv.configure(color_matrix_bt709, color_range_limited,
+                variant == 2 ? &worker_pool::shared() : nullptr,
+                variant == 0 ? &get_scalar_color_kernels() : nullptr);
+
+            double to_nv12 = bench_ms(20, [&]() { conv.convert(bgra.desc, nv12.desc); });
+            double to_p010 = bench_ms(20, [&]() { conv.convert(bgra.desc, p010.desc); });
+            double to_bgra = bench_ms(20, [&]() { conv.convert(nv12.desc, back.desc); });
+            printf("%dx%d %-6s: to NV12 %6.2f ms, to P010 %6.2f ms, NV12 to BGRA %6.2f ms\n",
+                size[0], size[1], names[variant], to_nv12, to_p010, to_bgra);
+        }
+    }
+
+    return 0;
+}
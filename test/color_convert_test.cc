@@ -0,0 +1,266 @@
+#include "color_convert.h"
+#include "check.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// An image in its own memory. Strides are padded by odd amounts, so
+// kernels can't rely on rows being contiguous.
+struct image {
+    std::vector<uint8_t> planes[3];
+    image_desc desc;
+
+    image(image_format format, int32_t width, int32_t height)
+    {
+        memset(&desc, 0, sizeof(desc));
+        desc.format = format;
+        desc.width = width;
+        desc.height = height;
+
+        int32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+        switch (format) {
+            case image_format_bgra:
+                alloc(0, width * 4 + 12, height);
+                break;
+            case image_format_nv12:
+                alloc(0, width + 7, height);
+                alloc(1, cw * 2 + 5, ch);
+                break;
+            case image_format_i420:
+                alloc(0, width + 3, height);
+                alloc(1, cw + 1, ch);
+                alloc(2, cw + 9, ch);
+                break;
+            case image_format_p010:
+                alloc(0, width * 2 + 6, height);
+                alloc(1, cw * 4 + 8, ch);
+                break;
+        }
+    }
+
+    void alloc(int i, size_t stride, int32_t rows)
+    {
+        planes[i].assign(stride * rows, 0);
+        desc.planes[i].data = planes[i].data();
+        desc.planes[i].stride = stride;
+    }
+
+    uint8_t *pixel(int32_t x, int32_t y)
+    {
+        return desc.planes[0].data + y * desc.planes[0].stride + x * 4;
+    }
+
+    bool operator==(const image &other) const
+    {
+        for (int i = 0; i < 3; i++)
+            if (planes[i] != other.planes[i])
+                return false;
+        return true;
+    }
+};
+
+static const color_matrix matrices[] = { color_matrix_bt601, color_matrix_bt709 };
+static const color_range ranges[] = { color_range_limited, color_range_full };
+
+// The selected kernels on a pool give exactly what the reference gives on
+// one thread, for every format, matrix and range, on odd sizes too.
+static void test_matches_scalar()
+{
+    printf("kernels: %s\n", get_color_kernels().name);
+
+    const int32_t sizes[][2] = {
+        { 1, 1 }, { 3, 5 }, { 17, 9 }, { 33, 3 }, { 64, 64 }, { 127, 71 },
+        { 200, 131 }, { 1921, 67 }
+    };
+    const image_format formats[] = { image_format_nv12, image_format_i420, image_format_p010 };
+
+    std::mt19937 rng(1);
+    worker_pool pool(3);
+    for (auto &size : sizes) {
+        for (auto matrix : matrices) {
+            for (auto range : ranges) {
+                image src(image_format_bgra, size[0], size[1]);
+                for (auto &b : src.planes[0])
+                    b = (uint8_t) rng();
+
+                color_converter ref, conv;
+                ref.configure(matrix, range, nullptr, &get_scalar_color_kernels());
+                conv.configure(matrix, range, &pool);
+
+                for (auto format : formats) {
+                    image a(format, size[0], size[1]), b(format, size[0], size[1]);
+                    CHECK(ref.convert(src.desc, a.desc));
+                    CHECK(conv.convert(src.desc, b.desc));
+                    CHECK(a == b);
+
+                    if (format == image_format_p010)
+                        continue;
+
+                    image a2(image_format_bgra, size[0], size[1]);
+                    image b2(image_format_bgra, size[0], size[1]);
+                    CHECK(ref.convert(a.desc, a2.desc));
+                    CHECK(conv.convert(a.desc, b2.desc));
+                    CHECK(a2 == b2);
+                }
+            }
+        }
+    }
+}
+
+struct golden {
+    color_matrix matrix;
+    color_range range;
+    uint8_t r, g, b;
+    uint16_t y, u, v;
+};
+
+// Rounded from the BT.601 and BT.709 equations.
+static const golden nv12_goldens[] = {
+    { color_matrix_bt709, color_range_limited, 255, 255, 255, 235, 128, 128 },
+    { color_matrix_bt709, color_range_limited, 0, 0, 0, 16, 128, 128 },
+    { color_matrix_bt709, color_range_limited, 255, 0, 0, 63, 102, 240 },
+    { color_matrix_bt709, color_range_limited, 0, 255, 0, 173, 42, 26 },
+    { color_matrix_bt709, color_range_limited, 0, 0, 255, 32, 240, 118 },
+    { color_matrix_bt709, color_range_full, 255, 255, 255, 255, 128, 128 },
+    { color_matrix_bt709, color_range_full, 0, 0, 0, 0, 128, 128 },
+    { color_matrix_bt709, color_range_full, 255, 0, 0, 54, 99, 255 },
+    { color_matrix_bt601, color_range_limited, 255, 255, 255, 235, 128, 128 },
+    { color_matrix_bt601, color_range_limited, 255, 0, 0, 81, 90, 240 },
+    { color_matrix_bt601, color_range_limited, 0, 255, 0, 145, 54, 34 },
+    { color_matrix_bt601, color_range_limited, 0, 0, 255, 41, 240, 110 },
+    { color_matrix_bt601, color_range_full, 255, 0, 0, 76, 85, 255 },
+    { color_matrix_bt601, color_range_full, 128, 128, 128, 128, 128, 128 },
+};
+
+// Same for 10 bits, as stored in the high bits of P010 samples.
+static const golden p010_goldens[] = {
+    { color_matrix_bt709, color_range_limited, 255, 255, 255, 940, 512, 512 },
+    { color_matrix_bt709, color_range_limited, 0, 0, 0, 64, 512, 512 },
+    { color_matrix_bt709, color_range_limited, 255, 0, 0, 250, 409, 960 },
+    { color_matrix_bt601, color_range_limited, 255, 0, 0, 326, 361, 960 },
+};
+
+static void fill(image &img, uint8_t r, uint8_t g, uint8_t b)
+{
+    for (int32_t y = 0; y < img.desc.height; y++) {
+        for (int32_t x = 0; x < img.desc.width; x++) {
+            auto *p = img.pixel(x, y);
+            p[0] = b;
+            p[1] = g;
+            p[2] = r;
+            p[3] = 255;
+        }
+    }
+}
+
+static void test_goldens()
+{
+    for (auto &g : nv12_goldens) {
+        image src(image_format_bgra, 2, 2), out(image_format_nv12, 2, 2);
+        fill(src, g.r, g.g, g.b);
+        color_converter conv;
+        conv.configure(g.matrix, g.range, nullptr);
+        conv.convert(src.desc, out.desc);
+
+        auto *y = out.desc.planes[0].data;
+        auto *uv = out.desc.planes[1].data;
+        if (y[0] != g.y || uv[0] != g.u || uv[1] != g.v) {
+            printf("%s %s %d,%d,%d: got %d,%d,%d, want %d,%d,%d\n",
+                g.matrix == color_matrix_bt709 ? "bt709" : "bt601",
+                g.range == color_range_limited ? "limited" : "full",
+                g.r, g.g, g.b, y[0], uv[0], uv[1], g.y, g.u, g.v);
+            CHECK(!"golden mismatch");
+        }
+    }
+
+    for (auto &g : p010_goldens) {
+        image src(image_format_bgra, 2, 2), out(image_format_p010, 2, 2);
+        fill(src, g.r, g.g, g.b);
+        color_converter conv;
+        conv.configure(g.matrix, g.range, nullptr);
+        conv.convert(src.desc, out.desc);
+
+        uint16_t y, u, v;
+        memcpy(&y, out.desc.planes[0].data, 2);
+        memcpy(&u, out.desc.planes[1].data, 2);
+        memcpy(&v, out.desc.planes[1].data + 2, 2);
+        CHECK((y & 0x3f) == 0 && (u & 0x3f) == 0 && (v & 0x3f) == 0);
+        if (y >> 6 != g.y || u >> 6 != g.u || v >> 6 != g.v) {
+            printf("p010 %d,%d,%d: got %d,%d,%d, want %d,%d,%d\n", g.r, g.g, g.b,
+                y >> 6, u >> 6, v >> 6, g.y, g.u, g.v);
+            CHECK(!"golden mismatch");
+        }
+    }
+}
+
+// Converting smooth content to YCbCr and back loses little, and grays
+// stay gray.
+static void test_round_trip()
+{
+    const int32_t w = 256, h = 64;
+    image src(image_format_bgra, w, h);
+    for (int32_t y = 0; y < h; y++) {
+        for (int32_t x = 0; x < w; x++) {
+            auto *p = src.pixel(x, y);
+            p[0] = (uint8_t) x;
+            p[1] = (uint8_t) (y * 4);
+            p[2] = (uint8_t) (255 - x);
+            p[3] = 255;
+        }
+    }
+
+    for (auto matrix : matrices) {
+        for (auto range : ranges) {
+            for (auto format : { image_format_nv12, image_format_i420 }) {
+                image yuv(format, w, h), back(image_format_bgra, w, h);
+                color_converter conv;
+                conv.configure(matrix, range, nullptr);
+                CHECK(conv.convert(src.desc, yuv.desc));
+                CHECK(conv.convert(yuv.desc, back.desc));
+
+                int max_err = 0;
+                for (int32_t y = 0; y < h; y++)
+                    for (int32_t x = 0; x < w * 4; x++)
+                        max_err = std::max(max_err, abs(src.pixel(0, y)[x] - back.pixel(0, y)[x]));
+                CHECK(max_err <= 4);
+            }
+        }
+    }
+
+    image gray(image_format_bgra, 2, 2), yuv(image_format_nv12, 2, 2), back(image_format_bgra, 2, 2);
+    color_converter conv;
+    conv.configure(color_matrix_bt709, color_range_full, nullptr);
+    for (int v = 0; v < 256; v++) {
+        fill(gray, (uint8_t) v, (uint8_t) v, (uint8_t) v);
+        conv.convert(gray.desc, yuv.desc);
+        conv.convert(yuv.desc, back.desc);
+        CHECK(gray == back);
+    }
+}
+
+// Unsupported pairs and mismatched sizes are refused.
+static void test_refuse()
+{
+    color_converter conv;
+    conv.configure(color_matrix_bt709, color_range_limited, nullptr);
+    image bgra(image_format_bgra, 4, 4), other(image_format_bgra, 4, 4);
+    image nv12(image_format_nv12, 4, 4), small(image_format_nv12, 2, 4);
+    image p010(image_format_p010, 4, 4);
+    CHECK(!conv.convert(bgra.desc, other.desc));
+    CHECK(!conv.convert(nv12.desc, nv12.desc));
+    CHECK(!conv.convert(bgra.desc, small.desc));
+    CHECK(!conv.convert(p010.desc, bgra.desc));
+}
+
+int main()
+{
+    test_matches_scalar();
+    test_goldens();
+    test_round_trip();
+    test_refuse();
+    return check_exit();
+}
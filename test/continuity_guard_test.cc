@@ -0,0 +1,150 @@
+#include "continuity_guard.h"
+#include "check.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static const size_t frames = 256;
+
+static float signal(double t)
+{
+    return (float) sin(t * 0.05);
+}
+
+// Feeds buffers of `frames` frames starting at `starts`, collecting output.
+// Returns the largest step between consecutive output frames.
+static double run(continuity_guard &g, const double *starts, size_t count,
+    std::vector<float> &output)
+{
+    std::vector<float> in(frames);
+    float last = 0;
+    double max_step = 0;
+    for (size_t b = 0; b < count; b++) {
+        for (size_t i = 0; i < frames; i++)
+            in[i] = signal(starts[b] + i);
+
+        const float *out;
+        int64_t offset;
+        size_t n = g.process(in.data(), frames, starts[b], out, offset);
+        for (size_t i = 0; i < n; i++) {
+            if (!output.empty())
+                max_step = std::max(max_step, (double) fabs(out[i] - last));
+            last = out[i];
+            output.push_back(out[i]);
+        }
+    }
+    return max_step;
+}
+
+// Contiguous buffers pass through untouched.
+static void test_contiguous()
+{
+    continuity_guard g;
+    g.configure(1, frames, frames, 16, conceal_crossfade);
+
+    std::vector<float> in(frames, 1.0f);
+    for (int b = 0; b < 10; b++) {
+        const float *out;
+        int64_t offset;
+        CHECK(g.process(in.data(), frames, 1000.0 + b * frames, out, offset) == frames);
+        CHECK(out == in.data());
+        CHECK(offset == 0);
+    }
+    CHECK(g.gaps == 0 && g.overlaps == 0 && g.resyncs == 0);
+}
+
+// Holes are filled and overlaps trimmed, so output length follows the
+// timeline exactly. Offsets say where output starts relative to input.
+static void test_timeline(conceal_mode mode)
+{
+    continuity_guard g;
+    g.configure(1, frames, frames, 16, mode);
+
+    std::vector<float> in(frames, 1.0f);
+    const float *out;
+    int64_t offset;
+
+    CHECK(g.process(in.data(), frames, 0, out, offset) == frames);
+
+    // 44 frame hole.
+    CHECK(g.process(in.data(), frames, 300, out, offset) == frames + 44);
+    CHECK(offset == -44);
+    if (mode == conceal_silence)
+        CHECK(out[0] == 0 && out[43] == 0 && out[44] == 1.0f);
+
+    // 6 frame overlap.
+    CHECK(g.process(in.data(), frames, 550, out, offset) == frames - 6);
+    CHECK(offset == 6);
+
+    // Entirely overlapping.
+    CHECK(g.process(in.data(), frames, 550, out, offset) == 0);
+
+    CHECK(g.gaps == 1 && g.gap_frames == 44);
+    CHECK(g.overlaps == 2 && g.overlap_frames == 6 + frames);
+    CHECK(g.resyncs == 0);
+
+    // Back on the timeline after the overlaps.
+    CHECK(g.process(in.data(), frames, 806, out, offset) == frames);
+    CHECK(out == in.data());
+}
+
+// Jumps beyond the fill limit follow the new timeline.
+static void test_resync()
+{
+    continuity_guard g;
+    g.configure(1, frames, 100, 16, conceal_silence);
+
+    std::vector<float> in(frames, 1.0f);
+    const float *out;
+    int64_t offset;
+    g.process(in.data(), frames, 0, out, offset);
+
+    CHECK(g.process(in.data(), frames, 1000, out, offset) == frames);
+    CHECK(g.resynced());
+    CHECK(g.process(in.data(), frames, 1256, out, offset) == frames);
+    CHECK(!g.resynced());
+
+    CHECK(g.process(in.data(), frames, 0, out, offset) == frames);
+    CHECK(g.resynced());
+    CHECK(g.resyncs == 2 && g.gaps == 0 && g.overlaps == 0);
+
+    // Unknown times pass through, and restart the timeline.
+    CHECK(g.process(in.data(), frames, -1, out, offset) == frames);
+    CHECK(g.process(in.data(), frames, 5000, out, offset) == frames);
+    CHECK(g.resyncs == 2);
+}
+
+// Crossfading conceals holes and overlaps without clicks. Silence doesn't.
+static void test_smooth()
+{
+    const double starts[] = { 0, 256, 512, 800, 1050, 1306, 1562, 1820, 2070 };
+    const size_t count = sizeof(starts) / sizeof(starts[0]);
+
+    continuity_guard a;
+    a.configure(1, frames, frames, 16, conceal_crossfade);
+    std::vector<float> output;
+    double smooth = run(a, starts, count, output);
+    CHECK(output.size() == 2070 + frames);
+
+    continuity_guard b;
+    b.configure(1, frames, frames, 16, conceal_silence);
+    output.clear();
+    double hard = run(b, starts, count, output);
+
+    // The signal itself moves by up to 0.05 per frame.
+    printf("max step: crossfade %g, silence %g\n", smooth, hard);
+    CHECK(smooth < 0.15);
+    CHECK(hard > 0.5);
+}
+
+int main()
+{
+    test_contiguous();
+    test_timeline(conceal_silence);
+    test_timeline(conceal_crossfade);
+    test_resync();
+    test_smooth();
+    return check_exit();
+}
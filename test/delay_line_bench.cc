@@ -0,0 +1,30 @@
+#include "delay_line.h"
+#include "bench.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// Fractional delay of 512 frame blocks, in nanoseconds per frame.
+int main()
+{
+    const uint32_t channel_counts[] = { 1, 2, 8 };
+    const size_t frames = 512;
+
+    for (uint32_t channels : channel_counts) {
+        delay_line d;
+        d.configure(channels, 44100, frames);
+
+        std::vector<float> in(frames * channels), out(frames * channels);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = (float) sin(i * 0.01);
+
+        double ms = bench_ms(100000, [&]() {
+            d.process(in.data(), out.data(), frames, 100.37);
+        });
+        printf("%u channels: %6.2f ns per frame\n", channels, ms * 1e6 / frames);
+    }
+
+    return 0;
+}
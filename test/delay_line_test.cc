@@ -0,0 +1,148 @@
+#include "delay_line.h"
+#include "check.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static double sine(double i)
+{
+    return sin(i * 2 * M_PI * 440 / 44100.0);
+}
+
+// Whole frame delays are exact, across ring wraps and odd block sizes.
+static void test_integer_delay()
+{
+    const uint32_t channels = 2;
+    const size_t blocks[] = { 1, 7, 512, 333, 64, 512 };
+    const size_t delay = 100;
+
+    delay_line d;
+    d.configure(channels, 1000, 512);
+
+    std::vector<float> in(512 * channels), out(512 * channels);
+    size_t n = 0;
+    for (int round = 0; round < 20; round++) {
+        for (size_t frames : blocks) {
+            for (size_t i = 0; i < frames; i++) {
+                in[i * channels] = (float) (n + i + 1);
+                in[i * channels + 1] = -(float) (n + i + 1);
+            }
+            auto *r = d.process(in.data(), out.data(), frames, (double) delay);
+            CHECK(r == out.data());
+
+            // The first block fades in from no delay.
+            for (size_t i = 0; i < frames && n != 0; i++) {
+                float expected = n + i < delay ? 0.0f : (float) (n + i + 1 - delay);
+                CHECK(r[i * channels] == expected);
+                CHECK(r[i * channels + 1] == -expected);
+            }
+            n += frames;
+        }
+    }
+}
+
+// Fractional delays interpolate a low frequency sine closely.
+static void test_fractional_delay()
+{
+    const uint32_t channels = 2;
+    const size_t frames = 512;
+    const double delays[] = { 1.0, 1.5, 2.25, 100.37, 999.99 };
+
+    for (double delay : delays) {
+        delay_line d;
+        d.configure(channels, 1000, frames);
+
+        std::vector<float> in(frames * channels), out(frames * channels);
+        double max_err = 0;
+        for (size_t b = 0; b < 20; b++) {
+            for (size_t i = 0; i < frames; i++) {
+                in[i * channels] = (float) sine((double) (b * frames + i));
+                in[i * channels + 1] = 0.5f * in[i * channels];
+            }
+            auto *r = d.process(in.data(), out.data(), frames, delay);
+            if (b < 3)
+                continue;
+            for (size_t i = 0; i < frames; i++) {
+                double ref = sine(b * frames + i - delay);
+                max_err = std::max(max_err, fabs(r[i * channels] - ref));
+                max_err = std::max(max_err, fabs(r[i * channels + 1] - 0.5 * ref));
+            }
+        }
+        printf("delay %.2f: max error %g\n", delay, max_err);
+        CHECK(max_err < 1e-5);
+    }
+}
+
+// No delay returns the input itself, and a delay below half a frame is none.
+static void test_pass_through()
+{
+    delay_line d;
+    d.configure(1, 100, 64);
+    std::vector<float> in(64, 1.0f);
+
+    CHECK(d.passes_through(0));
+    CHECK(d.passes_through(0.3));
+    CHECK(!d.passes_through(0.7));
+    CHECK(d.process(in.data(), nullptr, 64, 0.3) == in.data());
+
+    // Once delayed, going back to zero still needs one crossfaded block.
+    std::vector<float> out(64);
+    CHECK(d.process(in.data(), out.data(), 64, 10) == out.data());
+    CHECK(!d.passes_through(0));
+    CHECK(d.process(in.data(), out.data(), 64, 0) == out.data());
+    CHECK(d.passes_through(0));
+    CHECK(d.process(in.data(), out.data(), 64, 0) == in.data());
+}
+
+// Delays beyond the maximum are clamped.
+static void test_clamp()
+{
+    delay_line d;
+    d.configure(1, 50, 64);
+    std::vector<float> in(64), out(64);
+    for (size_t n = 0; n < 256; n += 64) {
+        for (size_t i = 0; i < 64; i++)
+            in[i] = (float) (n + i);
+        d.process(in.data(), out.data(), 64, 1e6);
+    }
+    CHECK(out[63] == 255 - 50);
+}
+
+// A delay change crossfades over one block, without a step in the output.
+static void test_crossfade()
+{
+    const size_t frames = 256;
+    delay_line d;
+    d.configure(1, 1000, frames);
+
+    std::vector<float> in(frames), out(frames);
+    float prev = 0;
+    double max_step = 0;
+    for (size_t b = 0; b < 40; b++) {
+        for (size_t i = 0; i < frames; i++)
+            in[i] = (float) sine((double) (b * frames + i));
+        double delay = b < 20 ? 10.0 : 60.5;
+        auto *r = d.process(in.data(), out.data(), frames, delay);
+        for (size_t i = 0; i < frames; i++) {
+            if (b > 0 || i > 0)
+                max_step = std::max(max_step, (double) fabs(r[i] - prev));
+            prev = r[i];
+        }
+    }
+
+    // The sine itself moves by up to 2 * pi * 440 / 44100 per frame.
+    printf("crossfade: max step %g\n", max_step);
+    CHECK(max_step < 0.07);
+}
+
+int main()
+{
+    test_integer_delay();
+    test_fractional_delay();
+    test_pass_through();
+    test_clamp();
+    test_crossfade();
+    return check_exit();
+}
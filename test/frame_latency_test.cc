@@ -0,0 +1,83 @@
+#include "frame_latency.h"
+#include "host_time.h"
+#include "check.h"
+
+using namespace p1_mac_plugins;
+
+static uint64_t ms(double value)
+{
+    return ns_to_host_time((uint64_t) (value * 1000000));
+}
+
+// A known frame, displayed at 100 ms, arriving 4 ms later and rendered
+// 12.5 ms after display, lands in the right buckets with exact sums.
+static void test_known_frame()
+{
+    frame_latency l;
+    uint64_t base = ms(100);
+    CHECK(l.record(base, base + ms(4), base + ms(12.5)));
+
+    CHECK(l.display.count() == 1 && l.consume.count() == 1);
+    CHECK(l.display.sum() == 12500 && l.display.max() == 12500);
+    CHECK(l.consume.sum() == 8500 && l.consume.max() == 8500);
+    // 12500 is in [8192, 16384), 8500 as well.
+    CHECK(l.display.bucket(14) == 1);
+    CHECK(l.consume.bucket(14) == 1);
+
+    CHECK(l.last_display_time == base);
+    CHECK(l.last_arrival_time == base + ms(4));
+    CHECK(l.last_consume_time == base + ms(12.5));
+}
+
+// Rendering the same frame on later ticks is not counted again, and keeps
+// the stamps of its first render.
+static void test_repeat()
+{
+    frame_latency l;
+    uint64_t base = ms(1000);
+    for (int tick = 0; tick < 10; tick++) {
+        uint64_t frame = base + ms(50) * (tick / 3);
+        bool recorded = l.record(frame, frame + ms(2), base + ms(16.7) * tick + ms(5));
+        CHECK(recorded == (tick % 3 == 0));
+    }
+    CHECK(l.display.count() == 4);
+    CHECK(l.last_consume_time == base + ms(16.7) * 9 + ms(5));
+}
+
+// Clocks that seem to run backwards count as zero, not as huge values.
+static void test_backwards()
+{
+    CHECK(host_latency_us(ms(10), ms(5)) == 0);
+    CHECK(host_latency_us(ms(10), ms(10)) == 0);
+    CHECK(host_latency_us(ms(10), ms(11)) == 1000);
+
+    frame_latency l;
+    l.record(ms(20), ms(25), ms(22));
+    CHECK(l.display.sum() == 2000);
+    CHECK(l.consume.sum() == 0 && l.consume.bucket(0) == 1);
+}
+
+// On the real host clock, which only promises to be monotonic, a frame
+// stamped in the past measures at least its age, and the two latencies
+// differ by exactly the time between display and arrival.
+static void test_host_clock()
+{
+    auto now = host_time_now();
+    uint64_t display_time = now - ms(16.7);
+    uint64_t arrival_time = now - ms(12);
+
+    frame_latency l;
+    CHECK(l.record(display_time, arrival_time, host_time_now()));
+    CHECK(l.display.max() >= 16700);
+    CHECK(l.consume.max() >= 12000);
+    CHECK(l.display.max() - l.consume.max() >= 4699 && l.display.max() - l.consume.max() <= 4701);
+}
+
+int main()
+{
+    test_known_frame();
+    test_repeat();
+    test_backwards();
+    test_host_clock();
+    return check_exit();
+}
@@ -0,0 +1,99 @@
+#include "histogram.h"
+#include "check.h"
+
+#include <thread>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// Bucket 0 holds zero, bucket n holds [2^(n-1), 2^n).
+static void test_boundaries()
+{
+    log_histogram h;
+    h.record(0);
+    CHECK(h.bucket(0) == 1);
+
+    for (size_t n = 1; n < log_histogram::num_buckets - 1; n++) {
+        log_histogram b;
+        uint64_t lo = (uint64_t) 1 << (n - 1);
+        uint64_t hi = ((uint64_t) 1 << n) - 1;
+        b.record(lo);
+        b.record(hi);
+        CHECK(b.bucket(n) == 2);
+        CHECK(b.count() == 2);
+    }
+}
+
+// Anything too large for the buckets lands in the last one, and still
+// counts toward the sum and maximum.
+static void test_overflow()
+{
+    const size_t last = log_histogram::num_buckets - 1;
+    log_histogram h;
+    h.record((uint64_t) 1 << (last - 1));
+    h.record((uint64_t) 1 << 40);
+    h.record(UINT64_MAX / 4);
+    CHECK(h.bucket(last) == 3);
+    CHECK(h.count() == 3);
+    CHECK(h.max() == UINT64_MAX / 4);
+    CHECK(h.sum() == ((uint64_t) 1 << (last - 1)) + ((uint64_t) 1 << 40) + UINT64_MAX / 4);
+}
+
+// Percentiles give the upper bound of the bucket the fraction falls in.
+static void test_percentile()
+{
+    log_histogram h;
+    CHECK(h.percentile(0.5) == 0);
+
+    // 90 values around 100, in [64, 128), and 10 around 5000, in
+    // [4096, 8192).
+    for (int i = 0; i < 90; i++)
+        h.record(100);
+    for (int i = 0; i < 10; i++)
+        h.record(5000);
+    CHECK(h.percentile(0) == 128);
+    CHECK(h.percentile(0.5) == 128);
+    CHECK(h.percentile(0.89) == 128);
+    CHECK(h.percentile(0.9) == 8192);
+    CHECK(h.percentile(0.99) == 8192);
+    CHECK(h.percentile(1.0) == 5000);
+    CHECK(h.sum() == 90 * 100 + 10 * 5000);
+    CHECK(h.max() == 5000);
+
+    h.reset();
+    CHECK(h.count() == 0 && h.sum() == 0 && h.max() == 0);
+}
+
+// Concurrent recording loses nothing, and a reader never sees more than
+// was recorded.
+static void test_concurrent()
+{
+    log_histogram h;
+    const int per_thread = 200000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; t++) {
+        threads.emplace_back([&h, t] {
+            for (int i = 0; i < per_thread; i++)
+                h.record((uint64_t) (i % 1000) + t);
+        });
+    }
+
+    bool bounded = true;
+    for (int i = 0; i < 1000; i++)
+        bounded = bounded && h.count() <= 3 * (uint64_t) per_thread;
+    for (auto &thread : threads)
+        thread.join();
+
+    CHECK(bounded);
+    CHECK(h.count() == 3 * (uint64_t) per_thread);
+    CHECK(h.max() == 999 + 2);
+}
+
+int main()
+{
+    test_boundaries();
+    test_overflow();
+    test_percentile();
+    test_concurrent();
+    return check_exit();
+}
@@ -0,0 +1,91 @@
+#include "level_meter.h"
+#include "check.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// The selected kernel finds the same peaks as the reference, for every
+// channel count and odd lengths, which exercise the tails. Sums of squares
+// are added in another order, so agree to rounding only.
+static void test_matches_scalar()
+{
+    auto kernel = get_level_kernel();
+    auto ref = get_scalar_level_kernel();
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    std::vector<float> in(4099 * level_snapshot::max_channels);
+    for (auto &v : in)
+        v = dist(rng);
+
+    bool peaks_equal = true, sums_close = true;
+    for (uint32_t channels = 1; channels <= level_snapshot::max_channels; channels++) {
+        for (size_t frames : { 0, 1, 3, 7, 8, 9, 255, 4099 }) {
+            float peak_a[level_snapshot::max_channels], sumsq_a[level_snapshot::max_channels];
+            float peak_b[level_snapshot::max_channels], sumsq_b[level_snapshot::max_channels];
+            ref(in.data(), frames, channels, peak_a, sumsq_a);
+            kernel(in.data(), frames, channels, peak_b, sumsq_b);
+            for (uint32_t c = 0; c < channels; c++) {
+                peaks_equal = peaks_equal && peak_a[c] == peak_b[c];
+                sums_close = sums_close &&
+                    std::fabs(sumsq_a[c] - sumsq_b[c]) <= 1e-5f * std::max(1.0f, sumsq_a[c]);
+            }
+        }
+    }
+    CHECK(peaks_equal);
+    CHECK(sums_close);
+}
+
+// A full scale square wave on one channel and a half scale sine on the
+// other measure as expected, over windows that end on buffer boundaries.
+static void test_windows()
+{
+    level_meter meter;
+    meter.configure(2, 1000);
+
+    std::vector<float> buf(300 * 2);
+    level_snapshot snap;
+    int windows = 0;
+    size_t n = 0;
+    for (int b = 0; b < 10; b++) {
+        for (size_t f = 0; f < 300; f++, n++) {
+            buf[f * 2] = n % 2 ? 1.0f : -1.0f;
+            buf[f * 2 + 1] = 0.5f * (float) sin(n * 2 * M_PI / 100);
+        }
+
+        bool done = meter.process(buf.data(), 300, 1000 + b, snap);
+        // Windows of 1200 frames, the first buffer boundary past 1000.
+        CHECK(done == (b % 4 == 3));
+        if (!done)
+            continue;
+
+        windows++;
+        CHECK(snap.time == (uint64_t) (1000 + b - 3));
+        CHECK(snap.channels == 2);
+        CHECK(snap.peak[0] == 1.0f && snap.rms[0] == 1.0f);
+        CHECK(std::fabs(snap.peak[1] - 0.5f) < 1e-6f);
+        CHECK(std::fabs(snap.rms[1] - 0.5f / std::sqrt(2.0f)) < 1e-4f);
+    }
+    CHECK(windows == 2);
+}
+
+// Layouts wider than a snapshot are not metered.
+static void test_too_many_channels()
+{
+    level_meter meter;
+    meter.configure(level_snapshot::max_channels + 1, 10);
+    std::vector<float> buf(100 * (level_snapshot::max_channels + 1), 1.0f);
+    level_snapshot snap;
+    CHECK(!meter.process(buf.data(), 100, 0, snap));
+}
+
+int main()
+{
+    test_matches_scalar();
+    test_windows();
+    test_too_many_channels();
+    return check_exit();
+}
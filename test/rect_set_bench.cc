@@ -0,0 +1,36 @@
+#include "rect_set.h"
+#include "bench.h"
+
+#include <random>
+
+using namespace p1_mac_plugins;
+
+// Frames of 12 updates on a 5K display, typing along a line or scattered.
+int main()
+{
+    std::mt19937 rng(1);
+    const char *names[] = { "typing", "scattered" };
+
+    for (int pattern = 0; pattern < 2; pattern++) {
+        rect_set s;
+        s.configure(5120, 2880);
+        size_t rects = 0;
+        const int iterations = 100000;
+
+        double ms = bench_ms(iterations, [&]() {
+            s.clear();
+            for (int32_t i = 0; i < 12; i++) {
+                pixel_rect r = pattern == 0 ?
+                    pixel_rect { 100 + i * 9, 200, 9, 18 } :
+                    pixel_rect { (int32_t) (rng() % 5000), (int32_t) (rng() % 2800),
+                        (int32_t) (rng() % 200) + 1, (int32_t) (rng() % 100) + 1 };
+                s.add(r);
+            }
+            rects += s.size();
+        });
+        printf("%-9s: %6.1f ns per add, %5.2f rects per frame\n", names[pattern],
+            ms * 1e6 / 12, (double) rects / (iterations + 1));
+    }
+
+    return 0;
+}
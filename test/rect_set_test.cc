@@ -0,0 +1,137 @@
+#include "rect_set.h"
+#include "check.h"
+
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static void test_rect()
+{
+    pixel_rect a = { 0, 0, 10, 10 };
+    pixel_rect b = { 5, 5, 10, 10 };
+    pixel_rect c = { 10, 0, 5, 5 };
+
+    CHECK(a.intersects(b));
+    CHECK(!a.intersects(c));
+    CHECK(!a.contains(b));
+    pixel_rect inner = { 2, 2, 3, 3 };
+    CHECK(a.contains(inner));
+
+    auto i = a.intersected(b);
+    CHECK(i.x == 5 && i.y == 5 && i.width == 5 && i.height == 5);
+    CHECK(a.intersected(c).empty());
+
+    auto u = a.united(c);
+    CHECK(u.x == 0 && u.y == 0 && u.width == 15 && u.height == 10);
+    pixel_rect empty = { 0, 0, 0, 10 };
+    CHECK(empty.empty() && empty.area() == 0);
+}
+
+// Additions are clipped, adjacent ones coalesced, and contained ones dropped.
+static void test_coalesce()
+{
+    rect_set s;
+    s.configure(100, 100);
+    CHECK(s.empty());
+
+    s.add(pixel_rect { -10, -10, 20, 20 });
+    CHECK(s.size() == 1);
+    CHECK(s.begin()->x == 0 && s.begin()->width == 10);
+
+    s.add(pixel_rect { 2, 2, 3, 3 });
+    CHECK(s.size() == 1);
+
+    // Typing along a line merges into one run.
+    s.clear();
+    for (int32_t i = 0; i < 10; i++)
+        s.add(pixel_rect { 10 + i * 8, 40, 8, 16 });
+    CHECK(s.size() == 1);
+    CHECK(s.area() == 80 * 16);
+
+    // Far apart stays apart.
+    s.clear();
+    s.add(pixel_rect { 0, 0, 4, 4 });
+    s.add(pixel_rect { 90, 90, 4, 4 });
+    CHECK(s.size() == 2);
+    CHECK(s.area() == 32);
+    auto bb = s.bounding_rect();
+    CHECK(bb.x == 0 && bb.y == 0 && bb.right() == 94 && bb.bottom() == 94);
+
+    s.add(pixel_rect { 200, 200, 10, 10 });
+    CHECK(s.size() == 2);
+
+    s.add_all();
+    CHECK(s.full());
+    CHECK(s.size() == 1);
+    CHECK(s.area() == 100 * 100);
+}
+
+// Random additions are always covered by at most `max_rects` rectangles
+// within the frame, none containing another, without covering much more.
+static void test_random()
+{
+    const int32_t w = 640, h = 360;
+    std::mt19937 rng(1);
+    double over = 0;
+    const int trials = 1000;
+
+    for (int t = 0; t < trials; t++) {
+        rect_set s;
+        s.configure(w, h);
+        std::vector<char> truth(w * h, 0);
+
+        int n = rng() % 40 + 1;
+        for (int i = 0; i < n; i++) {
+            pixel_rect r = { (int32_t) (rng() % (w + 40)) - 20,
+                (int32_t) (rng() % (h + 40)) - 20,
+                (int32_t) (rng() % 80), (int32_t) (rng() % 60) };
+            if (rng() % 3 == 0) {
+                r.width = (int32_t) (rng() % 16) + 1;
+                r.height = (int32_t) (rng() % 16) + 1;
+            }
+            s.add(r);
+
+            auto c = r.intersected(s.frame());
+            for (int32_t y = c.y; y < c.bottom(); y++)
+                for (int32_t x = c.x; x < c.right(); x++)
+                    truth[y * w + x] = 1;
+        }
+
+        CHECK(s.size() <= rect_set::max_rects);
+        for (auto &a : s)
+            for (auto &b : s)
+                CHECK(&a == &b || !a.contains(b));
+
+        std::vector<char> covered(w * h, 0);
+        for (auto &r : s) {
+            CHECK(s.frame().contains(r));
+            for (int32_t y = r.y; y < r.bottom(); y++)
+                for (int32_t x = r.x; x < r.right(); x++)
+                    covered[y * w + x] = 1;
+        }
+
+        long want = 0, have = 0;
+        for (int32_t i = 0; i < w * h; i++) {
+            if (truth[i] && !covered[i]) {
+                CHECK(!"uncovered pixel");
+                break;
+            }
+            want += truth[i];
+            have += covered[i];
+        }
+        if (want != 0)
+            over += (double) have / want;
+    }
+
+    printf("mean coverage over changed area: %.3f\n", over / trials);
+    CHECK(over / trials < 2.0);
+}
+
+int main()
+{
+    test_rect();
+    test_coalesce();
+    test_random();
+    return check_exit();
+}
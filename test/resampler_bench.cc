@@ -0,0 +1,35 @@
+#include "resampler.h"
+#include "bench.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// Stereo throughput for common device rates into the 44.1 kHz mixer, in
+// 10 ms buffers, as a multiple of real time.
+int main()
+{
+    const uint32_t channels = 2;
+    const double rates[] = { 44100, 48000, 96000 };
+
+    for (double rate : rates) {
+        size_t frames = (size_t) rate / 100;
+        resampler rs;
+        rs.configure(channels, rate, 44100, frames);
+        rs.set_correction(1.0001);
+
+        std::vector<float> in(frames * channels);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = (float) sin(i * 0.01);
+        std::vector<float> out(rs.max_output_frames(frames) * channels);
+
+        double ms = bench_ms(20000, [&]() {
+            rs.process(in.data(), frames, out.data(), rs.max_output_frames(frames));
+        });
+        printf("%6.0f -> 44100: %8.2f us per 10 ms, %6.0fx real time\n",
+            rate, ms * 1000, 10 / ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "resampler.h"
+#include "check.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static const size_t chunk = 512;
+
+// Runs `in` through the resampler in chunks, and for every output frame
+// records the input position it corresponds to.
+static void run(resampler &rs, uint32_t channels, const std::vector<float> &in,
+    std::vector<float> &out, std::vector<double> &positions)
+{
+    size_t frames = in.size() / channels;
+    std::vector<float> buf(rs.max_output_frames(chunk) * channels);
+    for (size_t offset = 0; offset < frames; offset += chunk) {
+        size_t n = std::min(chunk, frames - offset);
+        size_t num_out = rs.process(&in[offset * channels], n,
+            buf.data(), rs.max_output_frames(n));
+        for (size_t j = 0; j < num_out; j++)
+            positions.push_back(offset + rs.last_output_position() + j * rs.step());
+        out.insert(out.end(), buf.begin(), buf.begin() + num_out * channels);
+    }
+}
+
+// At equal rates, output lands on whole input frames, the first one half
+// the filter length before the input starts.
+static void test_equal_rates()
+{
+    const uint32_t channels = 2;
+    resampler rs;
+    rs.configure(channels, 48000, 48000, chunk);
+
+    std::vector<float> in(10000 * channels, 0.25f);
+    std::vector<float> out;
+    std::vector<double> positions;
+    run(rs, channels, in, out, positions);
+
+    CHECK(positions.size() == 10000);
+    for (size_t j = 0; j < positions.size(); j++)
+        CHECK(positions[j] == (double) j - 16);
+}
+
+// Unity gain at DC for every phase.
+static void test_dc()
+{
+    resampler rs;
+    rs.configure(1, 48000, 44100, chunk);
+
+    std::vector<float> in(48000, 0.5f);
+    std::vector<float> out;
+    std::vector<double> positions;
+    run(rs, 1, in, out, positions);
+
+    for (size_t j = 0; j < out.size(); j++)
+        if (positions[j] > 32 && positions[j] < in.size() - 32)
+            CHECK(fabs(out[j] - 0.5f) < 1e-5);
+}
+
+// A sine in the pass band comes out where `last_output_position` says it is.
+static void test_sine(double in_rate, double out_rate, double correction)
+{
+    const uint32_t channels = 2;
+    const double freq = 1000;
+    resampler rs;
+    rs.configure(channels, in_rate, out_rate, chunk);
+    rs.set_correction(correction);
+
+    size_t frames = (size_t) in_rate * 2;
+    std::vector<float> in(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        in[i * channels] = (float) (0.8 * sin(2 * M_PI * freq * i / in_rate));
+        in[i * channels + 1] = -in[i * channels];
+    }
+
+    std::vector<float> out;
+    std::vector<double> positions;
+    run(rs, channels, in, out, positions);
+
+    // Output count follows the step.
+    double expected = frames / rs.step();
+    CHECK(fabs(positions.size() - expected) < 2);
+
+    double max_err = 0;
+    for (size_t j = 0; j < positions.size(); j++) {
+        double p = positions[j];
+        if (p < 32 || p > frames - 32)
+            continue;
+        double ref = 0.8 * sin(2 * M_PI * freq * p / in_rate);
+        max_err = std::max(max_err, fabs(out[j * channels] - ref));
+        CHECK(out[j * channels + 1] == -out[j * channels]);
+    }
+    printf("sine %.0f -> %.0f x %.4f: max error %g\n", in_rate, out_rate,
+        correction, max_err);
+    CHECK(max_err < 1e-4);
+}
+
+// Correction is limited to 0.5%.
+static void test_correction_limit()
+{
+    resampler rs;
+    rs.configure(1, 48000, 48000, chunk);
+    rs.set_correction(1.1);
+    CHECK(fabs(rs.step() - 1.005) < 1e-12);
+    rs.set_correction(0.9);
+    CHECK(fabs(rs.step() - 0.995) < 1e-12);
+}
+
+static uint32_t next_random(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// A device clock running `ratio` fast, with buffer timestamps jittered by up
+// to +/- 0.5 ms, settles to the true rate.
+static void test_drift(double ratio)
+{
+    const double nominal = 48000;
+    const size_t frames = 512;
+    drift_estimator dll;
+    dll.configure(nominal);
+
+    uint32_t state = 1;
+    double t = 1e9;
+    double period = 1e9 / (nominal * ratio);
+    double max_late_err = 0;
+    for (int i = 0; i < 10 * 60 * 94; i++) {
+        double jitter = ((int32_t) next_random(state) / 2147483648.0) * 5e5;
+        dll.update((uint64_t) (t + jitter), frames);
+        t += frames * period;
+
+        // Check the last minute.
+        if (i > 9 * 60 * 94)
+            max_late_err = std::max(max_late_err, fabs(dll.ratio() - ratio));
+    }
+    printf("drift %.5f: estimate %.7f, max error over last minute %g\n",
+        ratio, dll.ratio(), max_late_err);
+    CHECK(max_late_err < 2e-5);
+    CHECK(fabs(dll.next_time_ns() - t) < 1e5);
+}
+
+// A jump in timestamps restarts the loop, but keeps the rate estimate.
+static void test_discontinuity()
+{
+    drift_estimator dll;
+    dll.configure(48000);
+    double t = 0;
+    double period = 1e9 / (48000 * 1.001);
+    for (int i = 0; i < 100000; i++, t += 512 * period)
+        dll.update((uint64_t) t, 512);
+    double before = dll.ratio();
+
+    t += 5e9;
+    dll.update((uint64_t) t, 512);
+    CHECK(dll.ratio() == before);
+    CHECK(fabs(dll.next_time_ns() - (t + 512 * 1e9 / 48000 / before)) < 1);
+}
+
+int main()
+{
+    test_equal_rates();
+    test_dc();
+    test_sine(48000, 44100, 1.0);
+    test_sine(44100, 48000, 1.0);
+    test_sine(96000, 44100, 1.003);
+    test_sine(48000, 44100, 0.997);
+    test_correction_limit();
+    test_drift(1.0);
+    test_drift(1.0003);
+    test_drift(0.9995);
+    test_discontinuity();
+    return check_exit();
+}
@@ -0,0 +1,50 @@
+#include "sample_convert.h"
+#include "bench.h"
+
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static const char *format_names[] = { "int16", "int24", "int32", "float32" };
+
+// Converts 10 ms of 48 kHz stereo, the size of a typical capture buffer,
+// and a larger buffer that does not fit in L1.
+int main()
+{
+    auto &simd = get_sample_kernels();
+    auto &ref = get_scalar_sample_kernels();
+    const size_t sizes[] = { 960, 96000 };
+
+    for (size_t count : sizes) {
+        std::vector<uint8_t> in(count * 4, 0x55);
+        std::vector<float> out(count);
+        int iterations = (int) (100000000 / count);
+
+        for (int fmt = 0; fmt < 4; fmt++) {
+            double a = bench_ms(iterations, [&]() {
+                ref.to_float[fmt](in.data(), out.data(), count);
+            });
+            double b = bench_ms(iterations, [&]() {
+                simd.to_float[fmt](in.data(), out.data(), count);
+            });
+            printf("%-7s x %6zu: scalar %8.2f Msamples/s, %s %8.2f Msamples/s\n",
+                format_names[fmt], count, count / a / 1000.0, simd.name,
+                count / b / 1000.0);
+        }
+
+        const uint32_t channels = 2;
+        size_t frames = count / channels;
+        const float *planes[channels] = { (const float *) in.data(),
+            (const float *) in.data() + frames };
+        double a = bench_ms(iterations, [&]() {
+            ref.interleave(planes, out.data(), frames, channels);
+        });
+        double b = bench_ms(iterations, [&]() {
+            simd.interleave(planes, out.data(), frames, channels);
+        });
+        printf("interleave x %6zu: scalar %8.2f Mframes/s, %s %8.2f Mframes/s\n",
+            frames, frames / a / 1000.0, simd.name, frames / b / 1000.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "sample_convert.h"
+#include "check.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// Every integer sample has an exact float representation, except int32
+// beyond 24 bits, which rounds to nearest. Odd counts exercise SIMD tails.
+
+static const size_t counts[] = { 0, 1, 7, 8, 15, 16, 17, 31, 33, 1001 };
+
+static uint32_t next_random(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void store_int24(uint8_t *p, int32_t v)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+}
+
+static void test_int16(const sample_kernels &k)
+{
+    std::vector<int16_t> in(65536);
+    for (int32_t i = 0; i < 65536; i++)
+        in[i] = (int16_t) (i - 32768);
+
+    std::vector<float> out(in.size());
+    k.to_float[sample_format_int16](in.data(), out.data(), in.size());
+    for (size_t i = 0; i < in.size(); i++)
+        CHECK(out[i] == (float) in[i] / 32768.0f);
+    CHECK(out.front() == -1.0f);
+    CHECK(out.back() < 1.0f);
+}
+
+static void test_int24(const sample_kernels &k)
+{
+    // Every value, in blocks.
+    const size_t block = 4099;
+    std::vector<uint8_t> in(block * 3);
+    std::vector<float> out(block);
+    int32_t v = -8388608;
+    while (v < 8388608) {
+        size_t n = 0;
+        for (; n < block && v + (int32_t) n < 8388608; n++)
+            store_int24(&in[n * 3], v + (int32_t) n);
+        k.to_float[sample_format_int24](in.data(), out.data(), n);
+        for (size_t i = 0; i < n; i++) {
+            if (out[i] != (float) (v + (int32_t) i) / 8388608.0f) {
+                CHECK(out[i] == (float) (v + (int32_t) i) / 8388608.0f);
+                return;
+            }
+        }
+        v += (int32_t) n;
+    }
+}
+
+static void test_int32(const sample_kernels &k)
+{
+    uint32_t state = 0x12345678;
+    std::vector<int32_t> in(100000);
+    for (auto &s : in)
+        s = (int32_t) next_random(state);
+    in[0] = INT32_MIN;
+    in[1] = INT32_MAX;
+    in[2] = 0;
+    in[3] = -1;
+
+    std::vector<float> out(in.size());
+    k.to_float[sample_format_int32](in.data(), out.data(), in.size());
+    for (size_t i = 0; i < in.size(); i++)
+        CHECK(out[i] == (float) ((double) in[i] / 2147483648.0));
+    CHECK(out[0] == -1.0f);
+    // Rounds up to exactly 1.
+    CHECK(out[1] == 1.0f);
+}
+
+// SIMD kernels must match the reference bit for bit, at every length.
+static void test_matches_scalar(const sample_kernels &k)
+{
+    auto &ref = get_scalar_sample_kernels();
+    uint32_t state = 0xdeadbeef;
+
+    std::vector<uint8_t> in(1001 * 4);
+    for (auto &b : in)
+        b = (uint8_t) next_random(state);
+
+    for (int fmt = 0; fmt < 4; fmt++) {
+        for (size_t count : counts) {
+            std::vector<float> a(count + 1, 42.0f), b(count + 1, 42.0f);
+            ref.to_float[fmt](in.data(), a.data(), count);
+            k.to_float[fmt](in.data(), b.data(), count);
+            CHECK(memcmp(a.data(), b.data(), (count + 1) * sizeof(float)) == 0);
+        }
+    }
+
+    for (uint32_t channels = 1; channels <= 8; channels++) {
+        for (size_t frames : counts) {
+            std::vector<float> planar(frames * channels);
+            std::vector<const float *> planes(channels);
+            for (size_t i = 0; i < planar.size(); i++)
+                planar[i] = (float) i;
+            for (uint32_t c = 0; c < channels; c++)
+                planes[c] = &planar[c * frames];
+
+            std::vector<float> a(frames * channels + 1, 42.0f);
+            std::vector<float> b(frames * channels + 1, 42.0f);
+            ref.interleave(planes.data(), a.data(), frames, channels);
+            k.interleave(planes.data(), b.data(), frames, channels);
+            CHECK(memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+        }
+    }
+}
+
+static void test_converter()
+{
+    const uint32_t channels = 3;
+    const size_t frames = 37;
+
+    // Planar int16, channel c holding c * 1000 + frame.
+    std::vector<int16_t> in(frames * channels);
+    for (uint32_t c = 0; c < channels; c++)
+        for (size_t i = 0; i < frames; i++)
+            in[c * frames + i] = (int16_t) (c * 1000 + i);
+
+    sample_converter conv;
+    conv.configure(sample_format_int16, false, channels, frames);
+    CHECK(!conv.is_passthrough());
+    CHECK(conv.bytes_per_frame() == 2 * channels);
+
+    std::vector<float> out(frames * channels);
+    conv.convert(in.data(), out.data(), frames);
+    for (size_t i = 0; i < frames; i++)
+        for (uint32_t c = 0; c < channels; c++)
+            CHECK(out[i * channels + c] == (float) (c * 1000 + i) / 32768.0f);
+
+    conv.configure(sample_format_float32, true, 2, frames);
+    CHECK(conv.is_passthrough());
+}
+
+int main()
+{
+    auto &k = get_sample_kernels();
+    printf("kernels: %s\n", k.name);
+
+    test_int16(k);
+    test_int24(k);
+    test_int32(k);
+    test_matches_scalar(k);
+    test_converter();
+
+    // The reference itself.
+    auto &ref = get_scalar_sample_kernels();
+    test_int16(ref);
+    test_int24(ref);
+    test_int32(ref);
+
+    return check_exit();
+}
@@ -0,0 +1,79 @@
+#include "scaler.h"
+#include "bench.h"
+
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+struct image {
+    std::vector<uint8_t> planes[3];
+    image_desc desc;
+
+    image(image_format format, int32_t width, int32_t height)
+    {
+        desc.format = format;
+        desc.width = width;
+        desc.height = height;
+        int32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+        if (format == image_format_bgra) {
+            alloc(0, width * 4, height);
+        }
+        else {
+            alloc(0, width, height);
+            alloc(1, cw * 2, ch);
+        }
+    }
+
+    void alloc(int i, size_t stride, int32_t rows)
+    {
+        planes[i].assign(stride * rows, 0);
+        desc.planes[i].data = planes[i].data();
+        desc.planes[i].stride = stride;
+    }
+};
+
+// Scaling common capture sizes down to common output sizes, with the
+// reference on one thread, then the selected kernels on pools of growing
+// size. Tiles per frame are printed, as they bound the useful threads.
+int main()
+{
+    const int32_t sizes[][4] = {
+        { 3840, 2160, 1920, 1080 }, { 1920, 1080, 1280, 720 }, { 5120, 2880, 640, 360 }
+    };
+    const image_format formats[] = { image_format_bgra, image_format_nv12 };
+    const char *filter_names[] = { "box", "bilinear", "lanczos3" };
+    size_t max_threads = worker_pool::shared().concurrency();
+    std::mt19937 rng(1);
+
+    printf("kernels: %s, cores: %zu\n", get_scale_kernels().name, max_threads);
+    for (auto &size : sizes) {
+        for (auto format : formats) {
+            image src(format, size[0], size[1]), dst(format, size[2], size[3]);
+            for (auto &plane : src.planes)
+                for (auto &b : plane)
+                    b = (uint8_t) rng();
+
+            int32_t columns = (size[2] + image_scaler::tile_width - 1) / image_scaler::tile_width;
+            int32_t rows = (size[3] + image_scaler::tile_rows - 1) / image_scaler::tile_rows;
+            printf("%dx%d to %dx%d %s, %d luma tiles\n", size[0], size[1], size[2], size[3],
+                format == image_format_bgra ? "BGRA" : "NV12", columns * rows);
+
+            for (int filter = 0; filter < 3; filter++) {
+                image_scaler scaler;
+                scaler.configure((scale_filter) filter, nullptr, &get_scalar_scale_kernels());
+                double ms = bench_ms(10, [&]() { scaler.scale(src.desc, dst.desc); });
+                printf("  %-8s scalar     : %6.2f ms\n", filter_names[filter], ms);
+
+                for (size_t threads = 1; threads <= max_threads * 2; threads *= 2) {
+                    worker_pool pool(threads - 1);
+                    scaler.configure((scale_filter) filter, &pool);
+                    ms = bench_ms(10, [&]() { scaler.scale(src.desc, dst.desc); });
+                    printf("  %-8s %2zu threads: %6.2f ms\n", filter_names[filter], threads, ms);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
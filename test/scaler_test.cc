@@ -0,0 +1,214 @@
+#include "scaler.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// An image in its own memory. Strides are padded by odd amounts, so
+// kernels can't rely on rows being contiguous.
+struct image {
+    std::vector<uint8_t> planes[3];
+    image_desc desc;
+
+    image(image_format format, int32_t width, int32_t height)
+    {
+        memset(&desc, 0, sizeof(desc));
+        desc.format = format;
+        desc.width = width;
+        desc.height = height;
+
+        int32_t cw = (width + 1) / 2, ch = (height + 1) / 2;
+        switch (format) {
+            case image_format_bgra:
+                alloc(0, width * 4 + 12, height);
+                break;
+            case image_format_nv12:
+                alloc(0, width + 7, height);
+                alloc(1, cw * 2 + 5, ch);
+                break;
+            default:
+                alloc(0, width + 3, height);
+                alloc(1, cw + 1, ch);
+                alloc(2, cw + 9, ch);
+                break;
+        }
+    }
+
+    void alloc(int i, size_t stride, int32_t rows)
+    {
+        planes[i].assign(stride * rows, 0);
+        desc.planes[i].data = planes[i].data();
+        desc.planes[i].stride = stride;
+    }
+
+    bool operator==(const image &other) const
+    {
+        for (int i = 0; i < 3; i++)
+            if (planes[i] != other.planes[i])
+                return false;
+        return true;
+    }
+};
+
+static const scale_filter filters[] = {
+    scale_filter_box, scale_filter_bilinear, scale_filter_lanczos3
+};
+static const image_format formats[] = {
+    image_format_bgra, image_format_nv12, image_format_i420
+};
+
+// Source and destination sizes, up and down, odd, tiny, and across tiles.
+static const int32_t sizes[][4] = {
+    { 1, 1, 1, 1 }, { 1, 1, 7, 5 }, { 7, 5, 1, 1 }, { 17, 9, 5, 3 },
+    { 64, 64, 64, 64 }, { 100, 50, 33, 17 }, { 33, 17, 100, 50 },
+    { 640, 360, 1919, 81 }, { 2000, 100, 37, 21 }, { 3, 200, 300, 2 }
+};
+
+// Weights of every output sample sum to exactly 1.
+static void test_tables()
+{
+    for (auto filter : filters) {
+        for (auto &size : sizes) {
+            scale_table table;
+            build_scale_table(filter, size[0], size[2], table);
+            CHECK(table.offsets.size() == (size_t) size[2]);
+            for (int32_t x = 0; x < size[2]; x++) {
+                int32_t sum = 0;
+                for (int32_t t = 0; t < table.taps; t++)
+                    sum += table.weights[(size_t) x * table.taps + t];
+                CHECK(sum == 1 << 14);
+                CHECK(table.offsets[x] >= 0);
+                CHECK(table.offsets[x] + table.taps <= std::max(size[0], table.taps));
+            }
+        }
+    }
+}
+
+// The selected kernels on a pool give exactly what the reference gives on
+// one thread.
+static void test_matches_scalar()
+{
+    printf("kernels: %s\n", get_scale_kernels().name);
+
+    std::mt19937 rng(1);
+    worker_pool pool(3);
+    for (auto filter : filters) {
+        image_scaler ref, scaler;
+        ref.configure(filter, nullptr, &get_scalar_scale_kernels());
+        scaler.configure(filter, &pool);
+
+        for (auto format : formats) {
+            for (auto &size : sizes) {
+                image src(format, size[0], size[1]);
+                for (auto &plane : src.planes)
+                    for (auto &b : plane)
+                        b = (uint8_t) rng();
+
+                image a(format, size[2], size[3]), b(format, size[2], size[3]);
+                CHECK(ref.scale(src.desc, a.desc));
+                CHECK(scaler.scale(src.desc, b.desc));
+                CHECK(a == b);
+            }
+        }
+    }
+}
+
+// A flat image stays flat, at every size and with every filter, including
+// at the edges, where windows are cut off.
+static void test_flat()
+{
+    const uint8_t values[] = { 0, 1, 128, 173, 254, 255 };
+
+    worker_pool pool(2);
+    for (auto filter : filters) {
+        image_scaler scaler;
+        scaler.configure(filter, &pool);
+
+        for (auto format : formats) {
+            for (auto &size : sizes) {
+                for (auto value : values) {
+                    image src(format, size[0], size[1]);
+                    for (auto &plane : src.planes)
+                        std::fill(plane.begin(), plane.end(), value);
+
+                    image dst(format, size[2], size[3]);
+                    CHECK(scaler.scale(src.desc, dst.desc));
+
+                    bool flat = true;
+                    int32_t cw = (size[2] + 1) / 2, ch = (size[3] + 1) / 2;
+                    for (int i = 0; i < 3; i++) {
+                        auto &plane = dst.desc.planes[i];
+                        if (plane.data == nullptr)
+                            continue;
+                        int32_t bytes, rows;
+                        if (format == image_format_bgra) {
+                            bytes = size[2] * 4;
+                            rows = size[3];
+                        }
+                        else if (i == 0) {
+                            bytes = size[2];
+                            rows = size[3];
+                        }
+                        else {
+                            bytes = format == image_format_nv12 ? cw * 2 : cw;
+                            rows = ch;
+                        }
+                        for (int32_t y = 0; y < rows; y++)
+                            for (int32_t x = 0; x < bytes; x++)
+                                if (plane.data[y * plane.stride + x] != value)
+                                    flat = false;
+                    }
+                    CHECK(flat);
+                }
+            }
+        }
+    }
+}
+
+// Halving with a box filter averages pairs.
+static void test_box()
+{
+    image src(image_format_bgra, 4, 2), dst(image_format_bgra, 2, 1);
+    const uint8_t values[] = { 10, 20, 30, 40 };
+    for (int32_t y = 0; y < 2; y++)
+        for (int32_t x = 0; x < 4; x++)
+            memset(src.desc.planes[0].data + y * src.desc.planes[0].stride + x * 4,
+                values[x] + y * 10, 4);
+
+    image_scaler scaler;
+    scaler.configure(scale_filter_box, nullptr);
+    CHECK(scaler.scale(src.desc, dst.desc));
+    CHECK(dst.planes[0][0] == 20 && dst.planes[0][3] == 20);
+    CHECK(dst.planes[0][4] == 40 && dst.planes[0][7] == 40);
+}
+
+static void test_refuses()
+{
+    image_scaler scaler;
+    image bgra(image_format_bgra, 8, 8), nv12(image_format_nv12, 4, 4);
+    image empty(image_format_bgra, 0, 4);
+    CHECK(!scaler.scale(bgra.desc, nv12.desc));
+    CHECK(!scaler.scale(bgra.desc, empty.desc));
+    CHECK(!scaler.scale(empty.desc, bgra.desc));
+
+    image_desc p010;
+    memset(&p010, 0, sizeof(p010));
+    p010.format = image_format_p010;
+    p010.width = 4;
+    p010.height = 4;
+    CHECK(!scaler.scale(p010, p010));
+}
+
+int main()
+{
+    test_tables();
+    test_matches_scalar();
+    test_flat();
+    test_box();
+    test_refuses();
+    return check_exit();
+}
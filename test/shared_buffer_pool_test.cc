@@ -0,0 +1,58 @@
+#include "shared_buffer_pool.h"
+#include "check.h"
+
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static void test_reserve()
+{
+    shared_buffer_pool pool;
+    pool.configure(64);
+    CHECK(pool.size() == 0);
+    CHECK(pool.acquire() == nullptr);
+
+    CHECK(pool.reserve(4));
+    CHECK(pool.size() == 4);
+
+    // Never shrinks.
+    CHECK(pool.reserve(2));
+    CHECK(pool.size() == 4);
+
+    // Over the limit, fills up to it and reports.
+    CHECK(!pool.reserve(shared_buffer_pool::max_buffers + 1));
+    CHECK(pool.size() == shared_buffer_pool::max_buffers);
+    CHECK(pool.reserve(shared_buffer_pool::max_buffers));
+}
+
+static void test_acquire()
+{
+    shared_buffer_pool pool;
+    pool.configure(64);
+    pool.reserve(3);
+
+    std::vector<shared_audio_buffer *> held;
+    for (int i = 0; i < 3; i++) {
+        auto *buf = pool.acquire();
+        CHECK(buf != nullptr);
+        CHECK(buf->refs == 1);
+        CHECK(buf->capacity == 64);
+        held.push_back(buf);
+    }
+    CHECK(held[0] != held[1] && held[1] != held[2] && held[0] != held[2]);
+    CHECK(pool.acquire() == nullptr);
+
+    // Returns when the last reference goes.
+    held[1]->retain();
+    held[1]->release();
+    CHECK(pool.acquire() == nullptr);
+    held[1]->release();
+    CHECK(pool.acquire() == held[1]);
+}
+
+int main()
+{
+    test_reserve();
+    test_acquire();
+    return check_exit();
+}
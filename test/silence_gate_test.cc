@@ -0,0 +1,108 @@
+#include "silence_gate.h"
+#include "check.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// The selected kernel finds a single loud sample anywhere, including the
+// tails, and agrees with the reference on values at the threshold.
+static void test_matches_scalar()
+{
+    auto kernel = get_any_above_kernel();
+    auto ref = get_scalar_any_above_kernel();
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-0.1f, 0.1f);
+    std::vector<float> in(1031);
+    for (auto &v : in)
+        v = dist(rng);
+
+    bool same = true;
+    for (size_t count : { 0, 1, 15, 16, 17, 31, 32, 33, 100, 1031 }) {
+        same = same && !kernel(in.data(), count, 0.1f) && !ref(in.data(), count, 0.1f);
+        for (size_t i = 0; i < count; i++) {
+            for (float spike : { 0.1f, 0.1001f, -0.1001f }) {
+                float saved = in[i];
+                in[i] = spike;
+                same = same && kernel(in.data(), count, 0.1f) == ref(in.data(), count, 0.1f);
+                in[i] = saved;
+            }
+        }
+    }
+    CHECK(same);
+
+    std::vector<float> at(100, 0.1f);
+    CHECK(!kernel(at.data(), at.size(), 0.1f));
+    CHECK(kernel(at.data(), at.size(), 0.0999f));
+}
+
+static bool feed(silence_gate &gate, float level, size_t frames = 256)
+{
+    std::vector<float> buf(frames * 2);
+    for (size_t i = 0; i < buf.size(); i++)
+        buf[i] = i % 2 ? level : -level;
+    return gate.process(buf.data(), frames);
+}
+
+// Opening at -40 dBFS, closing below -46 dBFS after 1000 quiet frames.
+static void test_transitions()
+{
+    silence_gate gate;
+    gate.configure(-40, 1000, 2);
+    const float open_level = 0.01f;
+    const float between = 0.008f;
+    const float quiet = 0.004f;
+
+    // Starts open, and closes once the hold time passed, on the buffer that
+    // completes it.
+    CHECK(gate.is_open());
+    for (int i = 0; i < 3; i++)
+        CHECK(!feed(gate, quiet) && gate.is_open());
+    CHECK(feed(gate, quiet) && !gate.is_open());
+
+    // Closed, levels between the thresholds, and at the open threshold,
+    // don't open it.
+    CHECK(!feed(gate, between) && !gate.is_open());
+    CHECK(!feed(gate, open_level) && !gate.is_open());
+
+    // Just above opens it right away.
+    CHECK(feed(gate, open_level * 1.01f) && gate.is_open());
+
+    // Open, levels between the thresholds keep it open, and restart the
+    // hold time.
+    for (int i = 0; i < 10; i++)
+        CHECK(!feed(gate, between) && gate.is_open());
+    for (int i = 0; i < 3; i++)
+        CHECK(!feed(gate, quiet));
+    CHECK(!feed(gate, between));
+    for (int i = 0; i < 3; i++)
+        CHECK(!feed(gate, quiet) && gate.is_open());
+    CHECK(feed(gate, quiet) && !gate.is_open());
+
+    // Reset opens it again.
+    gate.reset();
+    CHECK(gate.is_open());
+}
+
+// Hold time counts frames, not buffers.
+static void test_hold_expiry()
+{
+    silence_gate gate;
+    gate.configure(-60, 480, 2);
+    CHECK(!feed(gate, 0, 479) && gate.is_open());
+    CHECK(feed(gate, 0, 1) && !gate.is_open());
+
+    gate.reset();
+    CHECK(feed(gate, 0, 480) && !gate.is_open());
+}
+
+int main()
+{
+    test_matches_scalar();
+    test_transitions();
+    test_hold_expiry();
+    return check_exit();
+}
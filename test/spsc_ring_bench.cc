@@ -0,0 +1,52 @@
+#include "bench.h"
+#include "spsc_ring.h"
+
+#include <thread>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+
+// Throughput of audio-sized chunks from a producer thread to a consumer
+// thread, and of a single thread writing and reading.
+int main()
+{
+    const size_t chunk = 1024;
+    const size_t chunks = 100000;
+    std::vector<float> in(chunk, 1.0f), out(chunk);
+
+    for (size_t capacity : { 4096, 16384, 65536 }) {
+        spsc_ring<float> ring(capacity);
+        double ms = bench_ms(3, [&] {
+            std::thread producer([&] {
+                for (size_t i = 0; i < chunks; ) {
+                    if (ring.write(in.data(), chunk))
+                        i++;
+                    else
+                        std::this_thread::yield();
+                }
+            });
+            for (size_t i = 0; i < chunks; ) {
+                if (ring.read(out.data(), chunk))
+                    i++;
+                else
+                    std::this_thread::yield();
+            }
+            producer.join();
+        });
+        double gb = chunks * chunk * sizeof(float) / 1e9;
+        printf("two threads, capacity %6zu: %7.2f ms, %5.2f GB/s\n",
+            capacity, ms, gb / (ms / 1000));
+    }
+
+    spsc_ring<float> ring(chunk * 4);
+    double ms = bench_ms(3, [&] {
+        for (size_t i = 0; i < chunks; i++) {
+            ring.write(in.data(), chunk);
+            ring.read(out.data(), chunk);
+        }
+    });
+    double gb = chunks * chunk * sizeof(float) / 1e9;
+    printf("one thread:                  %7.2f ms, %5.2f GB/s\n", ms, gb / (ms / 1000));
+    return 0;
+}
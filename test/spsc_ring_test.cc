@@ -0,0 +1,127 @@
+#include "check.h"
+#include "spsc_ring.h"
+#include "audio_ring.h"
+
+#include <thread>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+
+static void test_basics()
+{
+    spsc_ring<int> ring(5);
+    CHECK(ring.capacity() == 8);
+    CHECK(ring.write_available() == 8);
+    CHECK(ring.read_available() == 0);
+
+    int in[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    int out[8];
+
+    // Wrap around the end a few times.
+    for (int round = 0; round < 5; round++) {
+        CHECK(ring.write(in, 5));
+        CHECK(!ring.write(in, 4));
+        CHECK(ring.read_available() == 5);
+        CHECK(ring.read(out, 5));
+        for (int i = 0; i < 5; i++)
+            CHECK(out[i] == i);
+        CHECK(!ring.read(out, 1));
+    }
+
+    CHECK(ring.write(in, 8));
+    CHECK(!ring.push(8));
+    ring.skip(6);
+    int val;
+    CHECK(ring.pop(val) && val == 6);
+    CHECK(ring.pop(val) && val == 7);
+    CHECK(!ring.pop(val));
+}
+
+// A producer thread writes a counting sequence in chunks of varying size,
+// and the consumer checks it arrives in order without loss.
+static void test_stress()
+{
+    const uint64_t total = 4000000;
+    spsc_ring<uint64_t> ring(1024);
+
+    std::thread producer([&] {
+        uint64_t chunk[61];
+        uint64_t next = 0;
+        size_t size = 1;
+        while (next < total) {
+            size_t n = (size_t) std::min<uint64_t>(size, total - next);
+            for (size_t i = 0; i < n; i++)
+                chunk[i] = next + i;
+            if (ring.write(chunk, n))
+                next += n;
+            else
+                std::this_thread::yield();
+            size = size % 61 + 1;
+        }
+    });
+
+    uint64_t expected = 0;
+    bool in_order = true;
+    uint64_t chunk[37];
+    size_t size = 1;
+    while (expected < total) {
+        size_t n = std::min(ring.read_available(), size);
+        if (n == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        ring.read(chunk, n);
+        for (size_t i = 0; i < n; i++)
+            in_order = in_order && chunk[i] == expected++;
+        size = size % 37 + 1;
+    }
+    producer.join();
+
+    CHECK(in_order);
+    CHECK(ring.read_available() == 0);
+}
+
+// Chunks hold a buffer reference until consumed. Full rings drop and count.
+static void test_audio_ring()
+{
+    shared_buffer_pool pool;
+    pool.configure(16);
+    pool.reserve(4);
+
+    audio_ring a(2), b(2);
+    auto *buf = pool.acquire();
+    CHECK(buf != nullptr);
+    buf->samples = 16;
+    for (int i = 0; i < 16; i++)
+        buf->data[i] = (float) i;
+
+    CHECK(a.write(100, buf));
+    CHECK(b.write(100, buf));
+    buf->release();
+    CHECK(buf->refs.load() == 2);
+
+    CHECK(a.write(200, nullptr) == false);
+    CHECK(a.take_overruns() == 1);
+    CHECK(a.take_overruns() == 0);
+
+    size_t drained = a.drain([&](uint64_t time, const float *data, uint32_t samples) {
+        CHECK(time == 100);
+        CHECK(samples == 16);
+        CHECK(data[15] == 15.0f);
+    });
+    CHECK(drained == 1);
+    CHECK(buf->refs.load() == 1);
+
+    b.clear();
+    CHECK(buf->refs.load() == 0);
+    CHECK(pool.acquire() != nullptr);
+}
+
+int main()
+{
+    test_basics();
+    test_stress();
+    test_audio_ring();
+    return check_exit();
+}
@@ -0,0 +1,199 @@
+#include "synthetic_backend.h"
+#include "capture_pipeline.h"
+#include "host_time.h"
+#include "check.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+static const char *path = "synthetic_backend_test.p1ac";
+
+// Drives captured buffers through the pipeline, as a session does: convert,
+// keep continuous, then resample to the mixer rate following the capture
+// clock.
+class pipeline_client : public capture_backend_client {
+public:
+    capture_pipeline pipeline;
+    std::mutex mutex;
+
+    bool running;
+    std::vector<std::string> errors;
+
+    size_t buffers;
+    size_t in_frames;
+    size_t out_frames;
+    double next_sample_time;
+    bool sample_times_contiguous;
+    uint64_t last_time;
+    bool times_increasing;
+    float peak;
+
+    pipeline_client() :
+        running(false), buffers(0), in_frames(0), out_frames(0),
+        next_sample_time(0), sample_times_contiguous(true), last_time(0),
+        times_increasing(true), peak(0)
+    {
+    }
+
+    void configure(const capture_format &fmt, double mixer_rate, bool drift)
+    {
+        pipeline.configure(fmt.format, fmt.interleaved, fmt.channels, fmt.rate,
+            mixer_rate, drift, fmt.max_frames);
+    }
+
+    virtual void capture_buffer(const void *data, size_t frames,
+        uint64_t host_time, double sample_time) final
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sample_time != next_sample_time)
+            sample_times_contiguous = false;
+        next_sample_time = sample_time + frames;
+        buffers++;
+        in_frames += frames;
+
+        uint64_t time = host_time;
+        const float *out;
+        auto n = pipeline.process(data, frames, sample_time, time, out);
+        if (n != 0) {
+            if (time <= last_time)
+                times_increasing = false;
+            last_time = time;
+        }
+        out_frames += n;
+        for (size_t i = 0; i < n * 2; i++)
+            peak = std::max(peak, std::fabs(out[i]));
+    }
+
+    virtual void capture_running(bool running_) final
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = running_;
+    }
+
+    virtual void capture_log(capture_log_level level, const char *format, ...) final
+    {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (level == capture_log_error)
+            errors.push_back(buf);
+    }
+};
+
+static capture_backend_config make_config()
+{
+    capture_backend_config config;
+    config.kind = capture_backend_synthetic;
+    config.format = sample_format_float32;
+    config.use_native_format = true;
+    config.interleaved = true;
+    config.use_native_interleaving = true;
+    config.latency_ms = 10;
+    config.buffer_count = 1;
+    config.adaptive = false;
+    return config;
+}
+
+// The tone runs through the pipeline without discontinuities, resampled to
+// the mixer rate at its level.
+static void test_tone()
+{
+    synthetic_backend backend;
+    pipeline_client client;
+    CHECK(backend.open(make_config(), client));
+
+    auto &fmt = backend.format();
+    CHECK(fmt.format == sample_format_float32 && fmt.interleaved);
+    CHECK(fmt.channels == 2 && fmt.rate == 48000);
+    CHECK(fmt.max_frames == 480);
+    client.configure(fmt, 44100, true);
+
+    CHECK(backend.start());
+    usleep(300000);
+    backend.close();
+
+    std::lock_guard<std::mutex> lock(client.mutex);
+    CHECK(client.running);
+    CHECK(client.errors.empty());
+    CHECK(client.buffers >= 10);
+    CHECK(client.sample_times_contiguous);
+    CHECK(client.times_increasing);
+
+    auto &guard = client.pipeline.continuity();
+    CHECK(guard.gaps == 0 && guard.overlaps == 0 && guard.resyncs == 0);
+
+    // Output follows the rate ratio, give or take the resampler delay.
+    double expected = client.in_frames * 44100.0 / 48000;
+    CHECK(std::fabs(client.out_frames - expected) < 100);
+    CHECK(client.peak > 0.09f && client.peak < 0.11f);
+}
+
+// A recording is looped in its own format, and converted exactly by the
+// pipeline, which has nothing to resample.
+static void test_file()
+{
+    capture_file_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.format = sample_format_int16;
+    hdr.channels = 2;
+    hdr.interleaved = 0;
+    hdr.sample_rate = 44100;
+    {
+        capture_file_writer writer;
+        CHECK(writer.open(path, hdr));
+        std::vector<int16_t> data(441 * 2, 16384);
+        for (int i = 0; i < 3; i++)
+            writer.append(i * 10000000ull, 441, data.data(),
+                (uint32_t) (data.size() * sizeof(int16_t)));
+    }
+
+    auto config = make_config();
+    config.path = path;
+    synthetic_backend backend;
+    pipeline_client client;
+    CHECK(backend.open(config, client));
+
+    auto &fmt = backend.format();
+    CHECK(fmt.format == sample_format_int16 && !fmt.interleaved);
+    CHECK(fmt.channels == 2 && fmt.rate == 44100);
+    CHECK(fmt.max_frames == 441);
+    client.configure(fmt, 44100, false);
+
+    CHECK(backend.start());
+    usleep(100000);
+    backend.close();
+
+    std::lock_guard<std::mutex> lock(client.mutex);
+    CHECK(client.buffers > 3);
+    CHECK(client.sample_times_contiguous);
+    CHECK(client.pipeline.continuity().resyncs == 0);
+    CHECK(client.peak == 0.5f);
+}
+
+static void test_missing_file()
+{
+    auto config = make_config();
+    config.path = "synthetic_backend_test.missing";
+    synthetic_backend backend;
+    pipeline_client client;
+    CHECK(!backend.open(config, client));
+    CHECK(client.errors.size() == 1);
+}
+
+int main()
+{
+    test_tone();
+    test_file();
+    test_missing_file();
+    unlink(path);
+    return check_exit();
+}
@@ -0,0 +1,54 @@
+#include "tile_hash.h"
+#include "bench.h"
+
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// Keeps hashing from being optimized away.
+static volatile uint64_t sink;
+
+// Hashing whole BGRA frames at common display sizes, with the reference
+// and the selected kernels, and through the hasher.
+int main()
+{
+    auto &k = get_tile_hash_kernels();
+    auto &ref = get_scalar_tile_hash_kernels();
+    const int32_t sizes[][2] = { { 1920, 1080 }, { 3840, 2160 }, { 5120, 2880 } };
+    std::mt19937 rng(1);
+
+    for (auto &size : sizes) {
+        int32_t w = size[0], h = size[1];
+        size_t stride = (size_t) w * 4;
+        std::vector<uint8_t> frame(stride * h);
+        for (size_t i = 0; i < frame.size(); i += 64)
+            frame[i] = (uint8_t) rng();
+
+        for (auto *kernels : { &ref, &k }) {
+            double ms = bench_ms(20, [&]() {
+                uint64_t sum = 0;
+                for (int32_t y = 0; y < h; y += tile_hasher::tile_size) {
+                    for (int32_t x = 0; x < w; x += tile_hasher::tile_size) {
+                        sum += kernels->hash(&frame[y * stride + x * 4], stride,
+                            std::min(tile_hasher::tile_size, w - x),
+                            std::min(tile_hasher::tile_size, h - y));
+                    }
+                }
+                sink = sum;
+            });
+            printf("%dx%d %-6s: %6.2f ms per frame, %5.1f GB/s\n", w, h,
+                kernels->name, ms, frame.size() / ms / 1e6);
+        }
+
+        tile_hasher hasher;
+        hasher.configure(w, h);
+        rect_set all;
+        all.configure(w, h);
+        all.add_all();
+        double ms = bench_ms(20, [&]() { hasher.update(frame.data(), stride, all); });
+        printf("%dx%d update: %6.2f ms per frame\n", w, h, ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "tile_hash.h"
+#include "check.h"
+
+#include <random>
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+// The selected kernels match the reference on any size and alignment.
+static void test_matches_scalar()
+{
+    auto &k = get_tile_hash_kernels();
+    auto &ref = get_scalar_tile_hash_kernels();
+    printf("kernels: %s\n", k.name);
+
+    std::mt19937 rng(1);
+    const size_t stride = 4000;
+    std::vector<uint8_t> buf(stride * 100);
+    for (auto &b : buf)
+        b = (uint8_t) rng();
+
+    for (int t = 0; t < 2000; t++) {
+        size_t w = 1 + rng() % 200, h = 1 + rng() % 50, x = rng() % 50;
+        auto *p = buf.data() + x * 4;
+        CHECK(k.hash(p, stride, w, h) == ref.hash(p, stride, w, h));
+    }
+}
+
+// Any single bit flip changes the hash, and so does swapping pixels.
+static void test_sensitivity()
+{
+    auto &k = get_tile_hash_kernels();
+    std::mt19937 rng(2);
+    const size_t stride = 64 * 4;
+    std::vector<uint8_t> tile(stride * 64);
+    for (auto &b : tile)
+        b = (uint8_t) rng();
+
+    auto h0 = k.hash(tile.data(), stride, 64, 64);
+    int misses = 0;
+    for (size_t i = 0; i < tile.size(); i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            tile[i] ^= (uint8_t) (1 << bit);
+            misses += k.hash(tile.data(), stride, 64, 64) == h0;
+            tile[i] ^= (uint8_t) (1 << bit);
+        }
+    }
+    CHECK(misses == 0);
+
+    // Same pixels in another order.
+    std::swap(tile[0], tile[stride * 10 + 20]);
+    std::swap(tile[1], tile[stride * 10 + 21]);
+    std::swap(tile[2], tile[stride * 10 + 22]);
+    std::swap(tile[3], tile[stride * 10 + 23]);
+    CHECK(k.hash(tile.data(), stride, 64, 64) != h0);
+}
+
+static void test_hasher()
+{
+    const int32_t w = 300, h = 200;
+    const size_t stride = w * 4;
+    std::vector<uint8_t> frame(stride * h, 7);
+
+    tile_hasher th;
+    th.configure(w, h);
+    CHECK(th.tiles_x() == 5 && th.tiles_y() == 4);
+
+    rect_set all;
+    all.configure(w, h);
+    all.add_all();
+
+    // Everything is new at first, then a redraw of the same is nothing.
+    CHECK(th.update(frame.data(), stride, all));
+    CHECK(!th.update(frame.data(), stride, all));
+
+    // One pixel marks its tile, which is clipped to the frame.
+    frame[(130 * w + 70) * 4] = 9;
+    CHECK(th.update(frame.data(), stride, all));
+    CHECK(th.changed(1, 2));
+    CHECK(!th.changed(0, 0));
+
+    rect_set out;
+    out.configure(w, h);
+    th.add_changed(out);
+    CHECK(out.size() == 1);
+    CHECK(out.begin()->x == 64 && out.begin()->y == 128);
+    CHECK(out.begin()->width == 64 && out.begin()->height == 64);
+
+    auto edge = th.tile_rect(4, 3);
+    CHECK(edge.x == 256 && edge.width == 44 && edge.y == 192 && edge.height == 8);
+
+    // Changes outside what the capture reports are not looked at.
+    frame[0] = 1;
+    rect_set dirty;
+    dirty.configure(w, h);
+    pixel_rect elsewhere = { 200, 100, 10, 10 };
+    dirty.add(elsewhere);
+    CHECK(!th.update(frame.data(), stride, dirty));
+
+    // Until invalidated.
+    th.invalidate(dirty);
+    CHECK(th.update(frame.data(), stride, dirty));
+    CHECK(th.changed(3, 1));
+
+    th.invalidate_all();
+    CHECK(th.update(frame.data(), stride, all));
+    CHECK(th.changed(0, 0) && th.changed(4, 3));
+}
+
+int main()
+{
+    test_matches_scalar();
+    test_sensitivity();
+    test_hasher();
+    return check_exit();
+}
@@ -0,0 +1,135 @@
+#include "timed_frame_queue.h"
+#include "check.h"
+
+#include <vector>
+
+using namespace p1_mac_plugins;
+
+struct frame {
+    int id;
+    int carried;
+};
+
+// Evicted frames pass what they carried on to the next one.
+struct carry_forward {
+    std::vector<int> *evicted;
+    void operator()(frame &f, frame *next) const
+    {
+        evicted->push_back(f.id);
+        if (next != nullptr)
+            next->carried += 1 + f.carried;
+    }
+};
+
+static void test_select()
+{
+    std::vector<int> evicted;
+    carry_forward evict = { &evicted };
+    timed_frame_queue<frame> q;
+    q.configure(4);
+
+    CHECK(q.select(100, evict) == nullptr);
+
+    for (int i = 0; i < 4; i++)
+        q.push(100 + i * 10, frame { i, 0 }, evict);
+    CHECK(q.size() == 4);
+
+    // All frames are newer, the oldest is shown.
+    CHECK(q.select(50, evict)->frame.id == 0);
+    CHECK(q.size() == 4);
+
+    // Newest at or before the target, older ones evicted and carried.
+    auto *e = q.select(125, evict);
+    CHECK(e->frame.id == 2);
+    CHECK(e->frame.carried == 2);
+    CHECK(evicted.size() == 2 && evicted[0] == 0 && evicted[1] == 1);
+
+    // The selection stays selectable.
+    CHECK(q.select(125, evict) == e);
+    CHECK(q.size() == 2);
+
+    CHECK(q.select(1000, evict)->frame.id == 3);
+    CHECK(q.size() == 1);
+}
+
+static void test_overflow()
+{
+    std::vector<int> evicted;
+    carry_forward evict = { &evicted };
+    timed_frame_queue<frame> q;
+    q.configure(2);
+
+    for (int i = 0; i < 5; i++)
+        q.push(i * 10, frame { i, 0 }, evict);
+    CHECK(q.size() == 2);
+    CHECK(evicted.size() == 3);
+    CHECK(q.oldest().frame.id == 3 && q.oldest().frame.carried == 3);
+
+    // Frames from the past are retimed to keep order.
+    q.push(5, frame { 9, 0 }, evict);
+    CHECK(q.newest().frame.id == 9);
+    CHECK(q.newest().time == 40);
+
+    evicted.clear();
+    q.clear(evict);
+    CHECK(q.empty());
+    CHECK(evicted.size() == 2);
+
+    // Capacity is limited.
+    q.configure(100);
+    CHECK(q.capacity() == timed_frame_queue<frame>::max_capacity);
+    q.configure(0);
+    CHECK(q.capacity() == 1);
+}
+
+// 60 Hz capture rendered at 50 Hz, 30 ms behind. Every render shows the
+// newest frame due, so frames advance by one or two, never repeat, and
+// nothing is lost without being carried.
+static void test_cadence()
+{
+    std::vector<int> evicted;
+    carry_forward evict = { &evicted };
+    timed_frame_queue<frame> q;
+    q.configure(4);
+
+    const uint64_t delay = 30000;
+    uint64_t capture_time = 0, render_time = delay;
+    int pushed = 0, shown = -1, skips = 0, repeats = 0;
+    bool wrong = false;
+    for (int step = 0; step < 20000; step++) {
+        if (capture_time <= render_time) {
+            q.push(capture_time, frame { pushed++, 0 }, evict);
+            capture_time += 16667;
+            continue;
+        }
+
+        uint64_t target = render_time - delay;
+        auto *e = q.select(target, evict);
+        if (e != nullptr) {
+            wrong |= e->time > target;
+            if (q.size() > 1)
+                wrong |= q.at(1).time <= target;
+            if (e->frame.id == shown)
+                repeats++;
+            else if (shown >= 0 && e->frame.id != shown + 1)
+                skips++;
+            shown = e->frame.id;
+        }
+        render_time += 20000;
+    }
+
+    printf("%d pushed, %d shown frames skipped one, %d repeated\n", pushed,
+        skips, repeats);
+    CHECK(!wrong);
+    CHECK(repeats == 0);
+    CHECK(skips > 0);
+    CHECK(evicted.size() + q.size() == (size_t) pushed);
+}
+
+int main()
+{
+    test_select();
+    test_overflow();
+    test_cadence();
+    return check_exit();
+}
@@ -0,0 +1,52 @@
+#include "triple_buffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+using namespace p1_mac_plugins;
+
+struct payload {
+    uint64_t seq;
+    uint64_t data[15];
+};
+
+// Publishes with a reader polling as fast as it can, the worst case for
+// contention on the middle slot, and without a reader.
+int main()
+{
+    const uint64_t count = 20000000;
+
+    for (int with_reader = 1; with_reader >= 0; with_reader--) {
+        triple_buffer<payload> tb;
+        std::atomic<bool> done(false);
+        uint64_t reads = 0;
+
+        std::thread reader([&]() {
+            while (with_reader && !done.load(std::memory_order_relaxed)) {
+                if (tb.update())
+                    reads++;
+            }
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t skipped = 0;
+        for (uint64_t s = 1; s <= count; s++) {
+            tb.back().seq = s;
+            if (tb.publish())
+                skipped++;
+        }
+        auto end = std::chrono::steady_clock::now();
+        done = true;
+        reader.join();
+
+        double secs = std::chrono::duration<double>(end - start).count();
+        printf("%s reader: %6.1f ns per publish, %llu reads, %llu skipped\n",
+            with_reader ? "with   " : "without", secs * 1e9 / count,
+            (unsigned long long) reads, (unsigned long long) skipped);
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "triple_buffer.h"
+#include "check.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace p1_mac_plugins;
+
+static void test_basics()
+{
+    triple_buffer<int> tb;
+    for (size_t i = 0; i < triple_buffer<int>::num_slots; i++)
+        tb.slot(i) = 0;
+
+    CHECK(!tb.update());
+
+    tb.back() = 1;
+    CHECK(!tb.publish());
+    CHECK(tb.update());
+    CHECK(tb.front() == 1);
+    CHECK(!tb.update());
+
+    // An unread value is reported when overwritten, and the reader only
+    // sees the latest.
+    tb.back() = 2;
+    CHECK(!tb.publish());
+    tb.back() = 3;
+    CHECK(tb.publish());
+    CHECK(tb.update());
+    CHECK(tb.front() == 3);
+
+    // The reader keeps its front until it updates.
+    tb.back() = 4;
+    tb.publish();
+    CHECK(tb.front() == 3);
+}
+
+// A large value, so torn reads would show.
+struct payload {
+    uint64_t seq;
+    uint64_t data[15];
+};
+
+// The reader only sees complete values, in order. Every value is either
+// read or reported skipped, exactly once.
+static void test_stress()
+{
+    const uint64_t count = 1000000;
+    triple_buffer<payload> tb;
+    for (size_t i = 0; i < triple_buffer<payload>::num_slots; i++)
+        tb.slot(i) = payload();
+
+    std::atomic<bool> done(false);
+    uint64_t skipped = 0;
+    std::thread writer([&]() {
+        for (uint64_t s = 1; s <= count; s++) {
+            auto &b = tb.back();
+            b.seq = s;
+            for (auto &d : b.data)
+                d = s * 7;
+            if (tb.publish())
+                skipped++;
+
+            // Give the reader a chance on few cores.
+            if (s % 16 == 0)
+                std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    uint64_t reads = 0, last = 0;
+    bool torn = false, reordered = false;
+    for (;;) {
+        bool finished = done.load();
+        if (tb.update()) {
+            auto &f = tb.front();
+            reordered |= f.seq <= last;
+            for (auto d : f.data)
+                torn |= d != f.seq * 7;
+            last = f.seq;
+            reads++;
+        }
+        else if (finished) {
+            break;
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    writer.join();
+
+    printf("%llu reads, %llu skipped\n", (unsigned long long) reads,
+        (unsigned long long) skipped);
+    CHECK(!torn);
+    CHECK(!reordered);
+    CHECK(last == count);
+    CHECK(reads + skipped == count);
+}
+
+int main()
+{
+    test_basics();
+    test_stress();
+    return check_exit();
+}